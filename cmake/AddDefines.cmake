@@ -32,3 +32,9 @@ if(SOLARUS_DEFAULT_QUEST_HEIGHT)
   add_definitions(-DSOLARUS_DEFAULT_QUEST_HEIGHT=${SOLARUS_DEFAULT_QUEST_HEIGHT})
 endif()
 
+
+# Built-in profiler.
+option(SOLARUS_PROFILING "Compile the built-in profiler zones (disabled at runtime by default)." ON)
+if(SOLARUS_PROFILING)
+  add_definitions(-DSOLARUS_PROFILING)
+endif()
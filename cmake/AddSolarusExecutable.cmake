@@ -29,3 +29,42 @@ target_link_libraries(solarus-run
   "${MODPLUG_LIBRARY}"
 )
 
+
+# The solarus-bench executable, to measure the performance of the engine.
+add_executable(solarus-bench
+  src/main/Bench.cpp
+)
+
+target_link_libraries(solarus-bench
+  solarus
+  "${SDL2_LIBRARY}"
+  "${SDL2_IMAGE_LIBRARY}"
+  "${SDL2_TTF_LIBRARY}"
+  "${OPENAL_LIBRARY}"
+  "${LUA_LIBRARY}"
+  "${DL_LIBRARY}"
+  "${PHYSFS_LIBRARY}"
+  "${VORBISFILE_LIBRARY}"
+  "${OGG_LIBRARY}"
+  "${MODPLUG_LIBRARY}"
+)
+
+# The solarus-export-binary executable, to convert data files to their
+# binary format when packaging a quest.
+add_executable(solarus-export-binary
+  src/main/ExportBinary.cpp
+)
+
+target_link_libraries(solarus-export-binary
+  solarus
+  "${SDL2_LIBRARY}"
+  "${SDL2_IMAGE_LIBRARY}"
+  "${SDL2_TTF_LIBRARY}"
+  "${OPENAL_LIBRARY}"
+  "${LUA_LIBRARY}"
+  "${DL_LIBRARY}"
+  "${PHYSFS_LIBRARY}"
+  "${VORBISFILE_LIBRARY}"
+  "${OGG_LIBRARY}"
+  "${MODPLUG_LIBRARY}"
+)
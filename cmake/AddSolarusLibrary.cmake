@@ -7,6 +7,8 @@ file(
 	include/solarus/audio/Music.h
 	include/solarus/audio/OggDecoder.h
 	include/solarus/audio/Sound.h
+	include/solarus/audio/SoundCache.h
+	include/solarus/audio/SoundDecoder.h
 	include/solarus/audio/SpcDecoder.h
 
 	include/solarus/containers/Grid.h
@@ -16,6 +18,7 @@ file(
 	include/solarus/core/Ability.h
 	include/solarus/core/AbilityInfo.h
 	include/solarus/core/Arguments.h
+	include/solarus/core/BinaryStream.h
 	include/solarus/core/CommandsEffects.h
 	include/solarus/core/Common.h
 	include/solarus/core/config.h
@@ -42,6 +45,8 @@ file(
 	include/solarus/core/PixelBits.h
 	include/solarus/core/Point.h
 	include/solarus/core/Point.inl
+	include/solarus/core/Profiler.h
+	include/solarus/core/Profiler.inl
 	include/solarus/core/QuestFiles.h
 	include/solarus/core/QuestDatabase.h
 	include/solarus/core/QuestProperties.h
@@ -61,6 +66,7 @@ file(
 	include/solarus/core/Timer.h
 	include/solarus/core/TimerPtr.h
 	include/solarus/core/Treasure.h
+	include/solarus/core/WorkerPool.h
 
 	include/solarus/entities/AnimatedTilePattern.h
 	include/solarus/entities/Arrow.h
@@ -157,6 +163,7 @@ file(
 	include/solarus/graphics/SurfacePtr.h
 	include/solarus/graphics/TextSurface.h
 	include/solarus/graphics/Texture.h
+	include/solarus/graphics/TextureAtlas.h
 	include/solarus/graphics/TransitionFade.h
 	include/solarus/graphics/Transition.h
 	include/solarus/graphics/TransitionImmediate.h
@@ -238,11 +245,14 @@ file(
 	src/audio/Music.cpp
 	src/audio/OggDecoder.cpp
 	src/audio/Sound.cpp
+	src/audio/SoundCache.cpp
+	src/audio/SoundDecoder.cpp
 	src/audio/SpcDecoder.cpp
 
 
 	src/core/AbilityInfo.cpp
 	src/core/Arguments.cpp
+	src/core/BinaryStream.cpp
 	src/core/CommandsEffects.cpp
 	src/core/CurrentQuest.cpp
 	src/core/Debug.cpp
@@ -263,6 +273,7 @@ file(
 	src/core/MapData.cpp
 	src/core/PixelBits.cpp
 	src/core/Point.cpp
+	src/core/Profiler.cpp
 	src/core/QuestFiles.cpp
 	src/core/QuestDatabase.cpp
 	src/core/QuestProperties.cpp
@@ -279,6 +290,7 @@ file(
 	src/core/StringResources.cpp
 	src/core/Timer.cpp
 	src/core/Treasure.cpp
+	src/core/WorkerPool.cpp
 
 	src/entities/AnimatedTilePattern.cpp
 	src/entities/Arrow.cpp
@@ -357,6 +369,7 @@ file(
 	src/graphics/SurfaceImpl.cpp
 	src/graphics/TextSurface.cpp
 	src/graphics/Texture.cpp
+	src/graphics/TextureAtlas.cpp
 	src/graphics/Transition.cpp
 	src/graphics/TransitionFade.cpp
 	src/graphics/TransitionImmediate.cpp
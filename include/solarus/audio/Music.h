@@ -20,8 +20,11 @@
 #include "solarus/core/Common.h"
 #include "solarus/audio/Sound.h"
 #include "solarus/lua/ScopedLuaRef.h"
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace Solarus {
@@ -40,6 +43,10 @@ class SpcDecoder;
  * initialized, by calling Sound::initialize().
  * Sound and Music are the only classes that depends on audio libraries.
  *
+ * The music is decoded by a separate thread into a small ring of PCM chunks.
+ * The main thread only gives these chunks to OpenAL and calls the Lua
+ * callback when the music ends.
+ *
  * TODO move the non-static parts to an internal private class.
  * TODO make a subclass for each format?
  */
@@ -91,8 +98,21 @@ class SOLARUS_API Music {
     static void stop_playing();
     static const std::string& get_current_music_id();
 
+    ~Music();
+
   private:
 
+    /**
+     * \brief A chunk of PCM data decoded by the decoding thread.
+     */
+    struct DecodedChunk {
+      std::vector<ALshort> data;                 /**< The decoded samples. */
+      ALsizei size = 0;                          /**< Number of bytes to play. 0 means the end of the music. */
+      ALenum al_format = AL_FORMAT_STEREO16;     /**< OpenAL format of the data. */
+      ALsizei frequency = 0;                     /**< Sample rate in Hz. */
+      std::string error;                         /**< Decoding error to report from the main thread. */
+    };
+
     Music();
     Music(
         const std::string& music_id,
@@ -106,9 +126,14 @@ class SOLARUS_API Music {
     void set_paused(bool pause);
     void set_callback(const ScopedLuaRef& callback_ref);
 
-    void decode_spc(ALuint destination_buffer, ALsizei nb_samples);
-    void decode_it(ALuint destination_buffer, ALsizei nb_samples);
-    void decode_ogg(ALuint destination_buffer, ALsizei nb_samples);
+    void decode_spc(DecodedChunk& chunk, ALsizei nb_samples);
+    void decode_it(DecodedChunk& chunk, ALsizei nb_samples);
+    void decode_ogg(DecodedChunk& chunk, ALsizei nb_samples);
+
+    void start_decoding_thread();
+    void stop_decoding_thread();
+    void decoding_thread_loop();
+    bool queue_decoded_chunk(ALuint buffer);
 
     bool update_playing();
 
@@ -121,6 +146,18 @@ class SOLARUS_API Music {
     static constexpr int nb_buffers = 8;
     ALuint buffers[nb_buffers];                  /**< multiple buffers used to stream the music */
     ALuint source;                               /**< the OpenAL source streaming the buffers */
+    std::vector<ALuint> free_buffers;            /**< Buffers not queued because no decoded data was ready. */
+
+    static constexpr int nb_decoded_chunks = 4;
+    DecodedChunk decoded_chunks[nb_decoded_chunks];
+                                                 /**< Ring of chunks decoded in advance. */
+    int first_ready_chunk;                       /**< Index of the oldest decoded chunk not played yet. */
+    int nb_ready_chunks;                         /**< Number of decoded chunks not played yet. */
+    bool end_of_stream;                          /**< Whether the decoding thread reached the end of the music. */
+    bool decoding_stopped;                       /**< Whether the decoding thread was asked to stop. */
+    std::mutex chunks_mutex;                     /**< Protects the ring of decoded chunks. */
+    std::condition_variable chunks_condition;    /**< Wakes up the decoding thread when a chunk is free. */
+    std::thread decoding_thread;                 /**< Thread that decodes the music. */
 
     static std::unique_ptr<SpcDecoder>
         spc_decoder;                             /**< The SPC decoder. */
@@ -128,6 +165,8 @@ class SOLARUS_API Music {
         it_decoder;                              /**< The IT decoder. */
     static std::unique_ptr<OggDecoder>
         ogg_decoder;                             /**< The OGG decoder. */
+    static std::mutex decoder_mutex;             /**< Protects the decoders from concurrent accesses
+                                                  * by the main thread and the decoding thread. */
     static float volume;                         /**< volume of musics (0.0 to 1.0) */
 
     static std::unique_ptr<Music> current_music; /**< the music currently played (if any) */
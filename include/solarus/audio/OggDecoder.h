@@ -21,6 +21,7 @@
 #include "solarus/audio/Sound.h"
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -35,7 +36,13 @@ class OggDecoder {
 
     bool load(std::string&& ogg_data, bool loop);
     void unload();
-    void decode(ALuint destination_buffer, ALsizei nb_samples);
+    ALenum get_al_format() const;
+    ALsizei get_sample_rate() const;
+    ALsizei decode(
+        std::vector<ALshort>& decoded_data,
+        ALsizei nb_samples,
+        std::string& error
+    );
 
   private:
 
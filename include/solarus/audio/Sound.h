@@ -18,6 +18,8 @@
 #define SOLARUS_SOUND_H
 
 #include "solarus/core/Common.h"
+#include "solarus/audio/SoundCache.h"
+#include "solarus/audio/SoundDecoder.h"
 #include <string>
 #include <list>
 #include <map>
@@ -37,6 +39,11 @@ class Arguments;
  * rather than calling directly the constructor of Sound.
  * This class is the only one that depends on the sound decoding library (libsndfile).
  * This class and the Music class are the only ones that depend on the audio mixer library (OpenAL).
+ *
+ * Sounds are decoded lazily by a small pool of threads the first time they
+ * are played or preloaded.
+ * Decoded sounds are kept in a cache of limited size: when the cache is full,
+ * the least recently played sounds that are not playing are unloaded.
  */
 class SOLARUS_API Sound {
 
@@ -63,6 +70,7 @@ class SOLARUS_API Sound {
     bool start();
 
     static void load_all();
+    static void preload(const std::string& sound_id);
     static bool exists(const std::string& sound_id);
     static void play(const std::string& sound_id);
 
@@ -73,10 +81,27 @@ class SOLARUS_API Sound {
 
     static int get_volume();
     static void set_volume(int volume);
+    static int get_cache_size();
+    static void set_cache_size(int cache_size);
 
   private:
 
-    ALuint decode_file(const std::string& file_name);
+    /**
+     * \brief Loading state of a sound.
+     */
+    enum class LoadingState {
+      UNLOADED,                 /**< Not decoded. */
+      LOADING,                  /**< Being decoded by a decoding thread. */
+      LOADED                    /**< Decoded into an OpenAL buffer. */
+    };
+
+    static void update_decoded_sounds();
+    static void shrink_cache();
+
+    void set_decoded_data(const SoundDecoder::DecodedSound& decoded_sound);
+    void unload();
+    void touch();
+    bool play_source();
     bool update_playing();
 
     static ALCdevice* device;
@@ -84,12 +109,18 @@ class SOLARUS_API Sound {
 
     std::string id;                              /**< id of this sound */
     ALuint buffer;                               /**< the OpenAL buffer containing the PCM decoded data of this sound */
+    size_t buffer_size;                          /**< Size in bytes of the decoded data in the buffer. */
+    LoadingState loading_state;                  /**< Whether the sound is decoded. */
+    bool play_when_loaded;                       /**< Whether to play the sound as soon as it is decoded. */
     std::list<ALuint> sources;                   /**< the sources currently playing this sound */
     static std::list<Sound*> current_sounds;     /**< the sounds currently playing */
     static std::map<std::string, Sound> all_sounds;   /**< all sounds created before */
+    static SoundCache cache;                     /**< Decoded sounds, from the least recently played one. */
+    static SoundDecoder decoder;                 /**< Threads that decode sounds. */
 
     static bool initialized;                     /**< indicates that the audio system is initialized */
     static bool sounds_preloaded;                /**< true if load_all() was called */
+    static constexpr int default_cache_size = 64 * 1024 * 1024;
     static float volume;                         /**< the volume of sound effects (0.0 to 1.0) */
 
 };
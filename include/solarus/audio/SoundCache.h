@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SOUND_CACHE_H
+#define SOLARUS_SOUND_CACHE_H
+
+#include "solarus/core/Common.h"
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Keeps track of the decoded sounds and of their size in memory.
+ *
+ * Sounds are ordered from the least recently used one to the most
+ * recently used one. When the total size exceeds the maximum size,
+ * the least recently used sounds are evicted first.
+ *
+ * This class does not hold the decoded data: it only decides which sounds
+ * to unload, so that it does not depend on the audio device.
+ */
+class SOLARUS_API SoundCache {
+
+  public:
+
+    explicit SoundCache(size_t max_size);
+
+    size_t get_max_size() const;
+    void set_max_size(size_t max_size);
+    size_t get_size() const;
+    size_t get_num_sounds() const;
+    bool contains(const std::string& sound_id) const;
+
+    void add(const std::string& sound_id, size_t size);
+    void remove(const std::string& sound_id);
+    void touch(const std::string& sound_id);
+    std::vector<std::string> shrink(
+        const std::function<bool (const std::string&)>& can_evict
+    );
+
+  private:
+
+    /**
+     * \brief A sound in the cache.
+     */
+    struct Entry {
+      size_t size;                                 /**< Size of the decoded data in bytes. */
+      std::list<std::string>::iterator position;   /**< Position in sounds_by_use. */
+    };
+
+    size_t max_size;                               /**< Maximum total size in bytes. */
+    size_t size;                                   /**< Total size in bytes of the sounds. */
+    std::map<std::string, Entry> entries;          /**< Sounds in the cache. */
+    std::list<std::string> sounds_by_use;          /**< Ids of the sounds, from the least
+                                                    * recently used one. */
+
+};
+
+}
+
+#endif
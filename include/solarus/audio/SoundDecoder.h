@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SOUND_DECODER_H
+#define SOLARUS_SOUND_DECODER_H
+
+#include "solarus/core/Common.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A pool of threads that decode sound files into PCM data.
+ *
+ * Sounds are decoded in the order of the queue. The main thread collects
+ * the results with take_decoded_sounds().
+ * This class does not use the audio device, so decoding errors are only
+ * reported through the results.
+ */
+class SOLARUS_API SoundDecoder {
+
+  public:
+
+    /**
+     * \brief PCM data produced by a decoding thread.
+     */
+    struct DecodedSound {
+      std::string id;             /**< Id of the sound. */
+      std::vector<char> samples;  /**< Stereo 16-bit samples. */
+      int sample_rate = 0;        /**< Sample rate in Hz. */
+      std::string error;          /**< Error message, empty in case of success. */
+    };
+
+    SoundDecoder();
+    ~SoundDecoder();
+
+    SoundDecoder(const SoundDecoder& other) = delete;
+    SoundDecoder& operator=(const SoundDecoder& other) = delete;
+
+    void start(int num_threads);
+    void stop();
+    bool is_started() const;
+
+    void request(const std::string& sound_id, bool urgent);
+    void make_urgent(const std::string& sound_id);
+    std::vector<DecodedSound> take_decoded_sounds();
+
+    static void decode_file(
+        const std::string& file_name,
+        DecodedSound& decoded_sound
+    );
+
+  private:
+
+    void thread_loop();
+
+    std::vector<std::thread> threads;            /**< Threads that decode sounds. */
+    std::deque<std::string> queue;               /**< Ids of sounds waiting to be decoded. */
+    std::vector<DecodedSound> decoded_sounds;    /**< Sounds decoded and not taken yet. */
+    std::mutex mutex;                            /**< Protects the queue and the decoded sounds. */
+    std::condition_variable condition;           /**< Wakes up decoding threads. */
+    bool stopped;                                /**< Whether decoding threads should exit. */
+
+};
+
+}
+
+#endif
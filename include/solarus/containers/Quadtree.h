@@ -20,12 +20,8 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
-#include "solarus/graphics/Color.h"
 #include "solarus/graphics/SurfacePtr.h"
-#include <array>
-#include <map>
-#include <memory>
-#include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace Solarus {
@@ -38,7 +34,7 @@ class Color;
  * The main goal of this container is to get objects in a given rectangle as
  * quickly as possible.
  *
- * \param T Type of objects.
+ * \param T Type of objects. It must be hashable with std::hash.
  */
 template <typename T>
 class Quadtree {
@@ -60,6 +56,15 @@ class Quadtree {
     std::vector<T> get_elements(
         const Rectangle& where
     ) const;
+    void get_elements(
+        const Rectangle& where,
+        std::vector<T>& result
+    ) const;
+    template<typename F>
+    void visit_elements(
+        const Rectangle& where,
+        F&& visitor
+    ) const;
 
     int get_num_elements() const;
     bool contains(const T& element) const;
@@ -81,76 +86,95 @@ class Quadtree {
 
   private:
 
-    class Node {
-
-      public:
-
-        explicit Node(const Quadtree& quadtree);
-        Node(const Quadtree& quadtree, const Rectangle& cell);
-
-        void clear();
-        void initialize(const Rectangle& cell);
-
-        Rectangle get_cell() const;
-        Size get_cell_size() const;
-
-        bool add(
-            const T& element,
-            const Rectangle& bounding_box
-        );
-        bool remove(
-            const T& element,
-            const Rectangle& bounding_box
-        );
-
-        void get_elements(
-            const Rectangle& region,
-            std::set<T>& result
-        ) const;
-
-        int get_num_elements() const;
-
-        void draw(
-            const SurfacePtr& dst_surface, const Point& dst_position
-        );
-        void draw_rectangle(
-            const Rectangle& rectangle,
-            const Color& line_color,
-            const SurfacePtr& dst_surface,
-            const Point& dst_position
-        );
-
-      private:
-
-        bool is_split() const;
-        void split();
-        void merge();
-        bool is_main_cell(const Rectangle& bounding_box) const;
-
-        const Quadtree& quadtree;
-        std::vector<std::pair<T, Rectangle>> elements;
-        std::array<std::unique_ptr<Node>, 4> children;
-        Rectangle cell;
-        Point center;
-        Color color;
-
+    /**
+     * \brief Information about an element of the quadtree.
+     */
+    struct ElementInfo {
+        Rectangle bounding_box;             /**< Bounding box of the element. */
+        bool outside;                       /**< Whether the element is
+                                             * outside the quadtree space. */
+        mutable unsigned query_stamp;       /**< Stamp of the last query that
+                                             * found this element. */
     };
 
-    struct ElementInfo {
-        Rectangle bounding_box;
+    /**
+     * \brief A cell of the quadtree.
+     *
+     * Nodes are stored in a pool and refer to their children by index.
+     * The elements of a leaf are stored as parallel arrays so that queries
+     * only scan a contiguous array of bounding boxes.
+     */
+    struct Node {
+        Rectangle cell;                     /**< Rectangle of this cell. */
+        int first_child;                    /**< Index of the first of the 4
+                                             * consecutive children nodes,
+                                             * or -1 if this is a leaf. */
+        std::vector<Rectangle> boxes;       /**< Bounding boxes of elements
+                                             * of this leaf. */
+        std::vector<T> elements;            /**< Elements of this leaf. */
+        std::vector<const ElementInfo*>
+            infos;                          /**< Info of elements of this leaf. */
     };
 
-    std::map<T, ElementInfo> elements;      /**< Elements in the quadtree and
-                                             * intersecting its space. */
-    std::set<T> elements_outside;           /**< Elements that were added to
-                                             * the quadtree but that are
-                                             * currently outside its space. */
-    Node root;                              /** The root node of the tree. */
+    unsigned new_query_stamp() const;
+
+    // Nodes.
+    int create_children(const Rectangle& cell);
+    void destroy_children(int first_child);
+    Rectangle get_cell(int node_index) const;
+    bool is_split(int node_index) const;
+    bool is_main_cell(int node_index, const Rectangle& bounding_box) const;
+    int get_num_elements(int node_index) const;
+
+    bool add(
+        int node_index,
+        const T& element,
+        const Rectangle& bounding_box,
+        const ElementInfo* info
+    );
+    bool remove(
+        int node_index,
+        const T& element,
+        const Rectangle& bounding_box
+    );
+    void split(int node_index);
+    void merge(int node_index);
+
+    template<typename F>
+    void visit_elements(
+        int node_index,
+        const Rectangle& region,
+        unsigned stamp,
+        F& visitor
+    ) const;
 
-};
+    void draw(
+        int node_index,
+        const SurfacePtr& dst_surface,
+        const Point& dst_position
+    ) const;
+    static void draw_rectangle(
+        const Rectangle& rectangle,
+        const Color& line_color,
+        const SurfacePtr& dst_surface,
+        const Point& dst_position
+    );
+
+    std::unordered_map<T, ElementInfo>
+        elements;                           /**< All elements of the quadtree,
+                                             * including the ones outside its
+                                             * space. */
+    int num_elements_outside;               /**< Number of elements that were
+                                             * added to the quadtree but that
+                                             * are currently outside its space. */
+    std::vector<Node> nodes;                /**< Pool of nodes.
+                                             * The root node has index 0. */
+    std::vector<int> free_children;         /**< Indexes of unused blocks of 4
+                                             * consecutive nodes in the pool. */
+    mutable unsigned query_stamp;           /**< Stamp of the last query,
+                                             * used to avoid duplicates. */
 
-template<typename T>
-using QuadtreeNode = typename Quadtree<T>::Node;
+};
 
 }
 
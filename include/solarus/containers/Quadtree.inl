@@ -15,11 +15,9 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Debug.h"
-#include "solarus/core/Random.h"
+#include "solarus/graphics/Color.h"
 #include "solarus/graphics/Surface.h"
 #include <algorithm>
-#include <iterator>
-#include <set>
 
 namespace Solarus {
 
@@ -41,7 +39,10 @@ Quadtree<T>::Quadtree() :
 template<typename T>
 Quadtree<T>::Quadtree(const Rectangle& space) :
     elements(),
-    root(*this) {
+    num_elements_outside(0),
+    nodes(1),
+    free_children(),
+    query_stamp(0) {
 
     initialize(space);
 }
@@ -53,8 +54,16 @@ template<typename T>
 void Quadtree<T>::clear() {
 
   elements.clear();
-  elements_outside.clear();
-  root.clear();
+  num_elements_outside = 0;
+
+  // Only keep the root node.
+  nodes.resize(1);
+  free_children.clear();
+  Node& root = nodes[0];
+  root.first_child = -1;
+  root.boxes.clear();
+  root.elements.clear();
+  root.infos.clear();
 }
 
 /**
@@ -77,7 +86,11 @@ void Quadtree<T>::initialize(const Rectangle& space) {
     square.set_width(square.get_height());
   }
 
-  root.initialize(square);
+  Node& root = nodes[0];
+  root.cell = square;
+  root.boxes.reserve(max_in_cell);
+  root.elements.reserve(max_in_cell);
+  root.infos.reserve(max_in_cell);
 }
 
 /**
@@ -86,7 +99,7 @@ void Quadtree<T>::initialize(const Rectangle& space) {
  */
 template<typename T>
 Rectangle Quadtree<T>::get_space() const {
-    return root.get_cell();
+    return get_cell(0);
 }
 
 /**
@@ -107,18 +120,20 @@ bool Quadtree<T>::add(const T& element, const Rectangle& bounding_box) {
     return false;
   }
 
+  ElementInfo info = { bounding_box, false, 0 };
+  const auto& it = elements.emplace(element, info).first;
+
   if (!bounding_box.overlaps(get_space())) {
     // Out of the space of the quadtree.
-    elements_outside.insert(element);
+    it->second.outside = true;
+    ++num_elements_outside;
   }
-  else if (!root.add(element, bounding_box)) {
+  else if (!add(0, element, bounding_box, &it->second)) {
     // Add failed.
+    elements.erase(it);
     return false;
   }
 
-  ElementInfo info = { bounding_box };
-  elements.emplace(element, info);
-
   return true;
 }
 
@@ -136,15 +151,18 @@ bool Quadtree<T>::remove(const T& element) {
     return false;
   }
 
-  Rectangle box = it->second.bounding_box;
-  elements.erase(element);
-  if (elements_outside.erase(element) > 0) {
+  bool removed = true;
+  if (it->second.outside) {
     // It was outside the quadtree space.
-    return true;
+    --num_elements_outside;
+  }
+  else {
+    // Normal case.
+    removed = remove(0, element, it->second.bounding_box);
   }
 
-  // Normal case.
-  return root.remove(element, box);
+  elements.erase(it);
+  return removed;
 }
 
 /**
@@ -169,20 +187,32 @@ bool Quadtree<T>::move(const T& element, const Rectangle& bounding_box) {
     // Not in the quadtree: error.
     return false;
   }
-  else {
-    if (it->second.bounding_box == bounding_box) {
-      // Already in the quadtree and no change.
-      return true;
-    }
 
-    if (!remove(element)) {
-      // Failed to remove.
-      return false;
-    }
+  ElementInfo& info = it->second;
+  if (info.bounding_box == bounding_box) {
+    // Already in the quadtree and no change.
+    return true;
   }
 
-  if (!add(element, bounding_box)) {
+  // Remove it from its old cells.
+  if (info.outside) {
+    --num_elements_outside;
+  }
+  else if (!remove(0, element, info.bounding_box)) {
+    // Failed to remove.
+    return false;
+  }
+
+  // Add it to its new cells.
+  // The element info stays in place, so this does not allocate memory.
+  info.bounding_box = bounding_box;
+  info.outside = !bounding_box.overlaps(get_space());
+  if (info.outside) {
+    ++num_elements_outside;
+  }
+  else if (!add(0, element, bounding_box, &info)) {
     // Failed to add.
+    elements.erase(it);
     return false;
   }
   return true;
@@ -195,11 +225,16 @@ bool Quadtree<T>::move(const T& element, const Rectangle& bounding_box) {
  */
 template<typename T>
 int Quadtree<T>::get_num_elements() const {
-  return root.get_num_elements() + elements_outside.size();
+  return get_num_elements(0) + num_elements_outside;
 }
 
 /**
  * \brief Gets the elements intersecting the given rectangle.
+ *
+ * This allocates a new vector for each call.
+ * Prefer the other get_elements() or visit_elements() in performance-critical
+ * code.
+ *
  * \param region The rectangle to check.
  * The rectangle should be entirely contained in the quadtree space.
  * \return A list of elements intersecting the rectangle, in arbitrary order.
@@ -209,9 +244,81 @@ template<typename T>
 std::vector<T> Quadtree<T>::get_elements(
     const Rectangle& region
 ) const {
-  std::set<T> element_set;
-  root.get_elements(region, element_set);
-  return std::vector<T>(element_set.begin(), element_set.end());
+  std::vector<T> result;
+  get_elements(region, result);
+  return result;
+}
+
+/**
+ * \brief Gets the elements intersecting the given rectangle into a vector
+ * provided by the caller.
+ *
+ * The vector is cleared first.
+ * Its capacity is kept, so reusing the same vector for several queries
+ * avoids memory allocations.
+ *
+ * \param[in] region The rectangle to check.
+ * The rectangle should be entirely contained in the quadtree space.
+ * \param[out] result The elements intersecting the rectangle,
+ * in arbitrary order.
+ * Elements outside the quadtree space are not added there.
+ */
+template<typename T>
+void Quadtree<T>::get_elements(
+    const Rectangle& region,
+    std::vector<T>& result
+) const {
+  result.clear();
+  visit_elements(region, [&result](const T& element) {
+    result.push_back(element);
+  });
+}
+
+/**
+ * \brief Calls a function on each element intersecting the given rectangle.
+ *
+ * No memory is allocated and elements are not copied.
+ * Each element is visited once even if it overlaps several cells.
+ *
+ * The visitor must not modify the quadtree and must not make other
+ * queries on it.
+ * If you need to do this, get the elements with get_elements() first.
+ *
+ * \param region The rectangle to check.
+ * The rectangle should be entirely contained in the quadtree space.
+ * \param visitor A function taking a const T& parameter, called on elements
+ * intersecting the rectangle, in arbitrary order.
+ * Elements outside the quadtree space are not visited.
+ */
+template<typename T>
+template<typename F>
+void Quadtree<T>::visit_elements(
+    const Rectangle& region,
+    F&& visitor
+) const {
+  visit_elements(0, region, new_query_stamp(), visitor);
+}
+
+/**
+ * \brief Returns a new stamp to mark elements found by a query.
+ *
+ * Elements found by the query are marked with the stamp, which is enough to
+ * detect duplicates without any additional storage.
+ *
+ * \return The new stamp.
+ */
+template<typename T>
+unsigned Quadtree<T>::new_query_stamp() const {
+
+  ++query_stamp;
+  if (query_stamp == 0) {
+    // The counter has wrapped: reset all stamps.
+    for (const auto& kvp : elements) {
+      kvp.second.query_stamp = 0;
+    }
+    query_stamp = 1;
+  }
+  return query_stamp;
 }
 
 /**
@@ -235,260 +342,288 @@ bool Quadtree<T>::contains(const T& element) const {
 template<typename T>
 void Quadtree<T>::draw(const SurfacePtr& dst_surface, const Point& dst_position) {
 
-  root.draw(dst_surface, dst_position);
+  draw(0, dst_surface, dst_position);
 }
 
 /**
- * \brief Creates a node with default coordinates.
+ * \brief Creates 4 children nodes that split a cell.
  *
- * Call initialize later to set coordinates.
+ * Unused nodes of the pool are reused if possible.
  *
- * \param quadtree The quadtree this node belongs to.
+ * \param cell The cell to split.
+ * \return Index of the first child in the pool.
+ * The other ones follow.
  */
 template<typename T>
-Quadtree<T>::Node::Node(const Quadtree& quadtree) :
-    Node(quadtree, Rectangle(0, 0, 256, 256)) {
+int Quadtree<T>::create_children(const Rectangle& cell) {
 
-}
-
-/**
- * \brief Creates a node with the given coordinates.
- * \param quadtree The quadtree this node belongs to.
- * \param cell Cell coordinates of the node.
- */
-template<typename T>
-Quadtree<T>::Node::Node(const Quadtree& quadtree, const Rectangle& cell) :
-    quadtree(quadtree),
-    elements(),
-    children(),
-    cell(cell),
-    center(cell.get_center()),
-    color() {
+  const Point& center = cell.get_center();
+  const Rectangle children_cells[] = {
+      Rectangle(cell.get_top_left(), center),
+      Rectangle(Point(center.x, cell.get_top()), Point(cell.get_right(), center.y)),
+      Rectangle(Point(cell.get_left(), center.y), Point(center.x, cell.get_bottom())),
+      Rectangle(center, cell.get_bottom_right())
+  };
 
-  initialize(cell);
+  int first_child = 0;
+  if (!free_children.empty()) {
+    first_child = free_children.back();
+    free_children.pop_back();
+  }
+  else {
+    first_child = nodes.size();
+    nodes.resize(nodes.size() + 4);
+  }
 
-  if (debug_quadtrees) {
-    color = Color(Random::get_number(256), Random::get_number(256), Random::get_number(256));
+  for (int i = 0; i < 4; ++i) {
+    Node& child = nodes[first_child + i];
+    child.cell = children_cells[i];
+    child.first_child = -1;
+    child.boxes.reserve(max_in_cell);
+    child.elements.reserve(max_in_cell);
+    child.infos.reserve(max_in_cell);
   }
+  return first_child;
 }
 
 /**
- * \brief Clears this node.
+ * \brief Gives back to the pool 4 children nodes and their descendants.
  *
- * Children nodes and their content are destroyed.
- */
-template<typename T>
-void Quadtree<T>::Node::clear() {
-
-  elements.clear();
-  std::fill(std::begin(children), std::end(children), nullptr);
-}
-
-/**
- * \brief Clears this node and initializes it with a new cell rectangle.
- * \param cell The new cell.
+ * The memory of their elements is kept to be reused later.
+ *
+ * \param first_child Index of the first child.
  */
 template<typename T>
-void Quadtree<T>::Node::initialize(const Rectangle& cell) {
+void Quadtree<T>::destroy_children(int first_child) {
 
-  clear();
-  this->cell = cell;
-  elements.reserve(max_in_cell);
+  for (int i = 0; i < 4; ++i) {
+    Node& child = nodes[first_child + i];
+    if (child.first_child != -1) {
+      destroy_children(child.first_child);
+      child.first_child = -1;
+    }
+    child.boxes.clear();
+    child.elements.clear();
+    child.infos.clear();
+  }
+  free_children.push_back(first_child);
 }
 
 /**
- * \brief Returns the cell represented by this node.
+ * \brief Returns the cell represented by a node.
+ * \param node_index Index of a node.
  * \return The cell's rectangle.
  */
 template<typename T>
-Rectangle Quadtree<T>::Node::get_cell() const {
-  return cell;
+Rectangle Quadtree<T>::get_cell(int node_index) const {
+  return nodes[node_index].cell;
 }
 
 /**
- * \brief Returns the size of the cell represented by this node.
- * \return The cell size.
+ * \brief Returns whether a node is split or is a leaf cell.
+ * \param node_index Index of a node.
+ * \return \c true if the node is split.
  */
 template<typename T>
-Size Quadtree<T>::Node::get_cell_size() const {
-    return get_cell().get_size();
+bool Quadtree<T>::is_split(int node_index) const {
+
+  return nodes[node_index].first_child != -1;
 }
 
 /**
- * \brief Adds an element to this node if its bounding box intersects it.
+ * \brief Adds an element to a node if its bounding box intersects it.
  *
  * Splits the node if necessary when the threshold is exceeded.
  *
+ * \param node_index Index of the node.
  * \param element The element to add.
  * \param bounding_box Bounding box of the element.
+ * \param info Info of the element in the quadtree.
  * \return \c true in case of success.
  */
 template<typename T>
-bool Quadtree<T>::Node::add(
+bool Quadtree<T>::add(
+    int node_index,
     const T& element,
-    const Rectangle& bounding_box
+    const Rectangle& bounding_box,
+    const ElementInfo* info
 ) {
-  if (!get_cell().overlaps(bounding_box)) {
+  const Rectangle& cell = get_cell(node_index);
+  if (!cell.overlaps(bounding_box)) {
     // Nothing to do.
     return false;
   }
 
-  if (!is_split()) {
+  if (!is_split(node_index)) {
 
     // See if it is time to split.
-    if (is_main_cell(bounding_box)) {
+    if (is_main_cell(node_index, bounding_box)) {
       // We are the main cell of this element: it counts in the total.
-      if (get_num_elements() >= max_in_cell &&
-          get_cell_size().width > min_cell_size &&
-          get_cell_size().height > min_cell_size) {
-        split();
+      if (get_num_elements(node_index) >= max_in_cell &&
+          cell.get_width() > min_cell_size &&
+          cell.get_height() > min_cell_size) {
+        split(node_index);
       }
     }
   }
 
-  if (!is_split()) {
+  if (!is_split(node_index)) {
     // Add it to the current node.
-    elements.emplace_back(element, bounding_box);
+    Node& node = nodes[node_index];
+    node.boxes.push_back(bounding_box);
+    node.elements.push_back(element);
+    node.infos.push_back(info);
     return true;
   }
 
   // Add it to children cells.
-  for (const std::unique_ptr<Node>& child : children) {
-    child->add(element, bounding_box);
+  // Don't keep references to nodes here: children may split and
+  // reallocate the pool.
+  const int first_child = nodes[node_index].first_child;
+  for (int i = 0; i < 4; ++i) {
+    add(first_child + i, element, bounding_box, info);
   }
   return true;
 }
 
 /**
- * \brief Removes an element from this node if its bounding box intersects it.
+ * \brief Removes an element from a node if its bounding box intersects it.
  *
  * Merges nodes when necessary.
  *
+ * \param node_index Index of the node.
  * \param element The element to remove.
  * \param bounding_box Bounding box of the element.
  * \return \c true in the element was found and removed.
  */
 template<typename T>
-bool Quadtree<T>::Node::remove(
+bool Quadtree<T>::remove(
+    int node_index,
     const T& element,
     const Rectangle& bounding_box
 ) {
-  if (!get_cell().overlaps(bounding_box)) {
+  if (!get_cell(node_index).overlaps(bounding_box)) {
     // Nothing to do.
     return false;
   }
 
-  if (!is_split()) {
+  if (!is_split(node_index)) {
     // Remove from this cell.
-    const auto& it = std::find(elements.begin(), elements.end(), std::make_pair(element, bounding_box));
-    if (it == elements.end()) {
+    Node& node = nodes[node_index];
+    const auto& it = std::find(node.elements.begin(), node.elements.end(), element);
+    if (it == node.elements.end()) {
       // The element was not here.
       return false;
     }
-    elements.erase(it);
+    const int index = it - node.elements.begin();
+    node.boxes.erase(node.boxes.begin() + index);
+    node.elements.erase(it);
+    node.infos.erase(node.infos.begin() + index);
     return true;
   }
 
   // Remove from children cells.
   bool removed = false;
-  for (const std::unique_ptr<Node>& child : children) {
-    removed |= child->remove(element, bounding_box);
+  const int first_child = nodes[node_index].first_child;
+  for (int i = 0; i < 4; ++i) {
+    removed |= remove(first_child + i, element, bounding_box);
   }
 
   if (removed &&
-      !children[0]->is_split()  // We are the parent node of where the element was removed.
+      !is_split(first_child)  // We are the parent node of where the element was removed.
   ) {
     // See if it is time to merge.
-    int num_elements_in_children = get_num_elements();
+    int num_elements_in_children = get_num_elements(node_index);
     if (num_elements_in_children < min_in_4_cells) {
-      merge();
+      merge(node_index);
     }
   }
   return removed;
 }
 
 /**
- * \brief Returns whether this node is split or is a leaf cell.
- * \return \c true if the node is split.
- */
-template<typename T>
-bool Quadtree<T>::Node::is_split() const {
-
-  return children[0] != nullptr;
-}
-
-/**
- * \brief Splits this cell in four parts and moves its elements to them.
+ * \brief Splits a cell in four parts and moves its elements to them.
+ * \param node_index Index of the node to split.
  */
 template<typename T>
-void Quadtree<T>::Node::split() {
+void Quadtree<T>::split(int node_index) {
 
-  Debug::check_assertion(!is_split(), "Quadtree node already split");
+  Debug::check_assertion(!is_split(node_index), "Quadtree node already split");
 
   // Create 4 children cells.
-  const Rectangle& cell = get_cell();
-  const Point& center = cell.get_center();
-  children[0] = std::unique_ptr<Node>(
-      new Node(quadtree, Rectangle(cell.get_top_left(), center))
-  );
-  children[1] = std::unique_ptr<Node>(
-      new Node(quadtree, Rectangle(Point(center.x, cell.get_top()), Point(cell.get_right(), center.y)))
-  );
-  children[2] = std::unique_ptr<Node>(
-      new Node(quadtree, Rectangle(Point(cell.get_left(), center.y), Point(center.x, cell.get_bottom())))
-  );
-  children[3] = std::unique_ptr<Node>(
-      new Node(quadtree, Rectangle(center, cell.get_bottom_right()))
-  );
-
-  // Move existing elements into them.
-  for (const std::pair<T, Rectangle>& pair : elements) {
-    for (const std::unique_ptr<Node>& child : children) {
-      child->add(pair.first, pair.second);
+  const int first_child = create_children(get_cell(node_index));
+
+  // Take the existing elements from the node.
+  Node& node = nodes[node_index];
+  node.first_child = first_child;
+  std::vector<Rectangle> boxes;
+  std::vector<T> elements;
+  std::vector<const ElementInfo*> infos;
+  boxes.swap(node.boxes);
+  elements.swap(node.elements);
+  infos.swap(node.infos);
+
+  // Move them into the children.
+  for (size_t i = 0; i < elements.size(); ++i) {
+    for (int j = 0; j < 4; ++j) {
+      add(first_child + j, elements[i], boxes[i], infos[i]);
     }
   }
-  elements.clear();
 
-  Debug::check_assertion(is_split(), "Quadtree node split failed");
+  Debug::check_assertion(is_split(node_index), "Quadtree node split failed");
 }
 
 /**
- * \brief Merges the four children cell into this one and destroys them.
+ * \brief Merges the four children cell of a node into it and destroys them.
  *
  * The children must already be leaves.
+ *
+ * \param node_index Index of the node to merge.
  */
 template<typename T>
-void Quadtree<T>::Node::merge() {
+void Quadtree<T>::merge(int node_index) {
 
-  Debug::check_assertion(is_split(), "Quadtree node already merged");
+  Debug::check_assertion(is_split(node_index), "Quadtree node already merged");
 
   // We want to avoid duplicates while preserving a deterministic order.
-  std::set<T> merged_elements;
-  for (const std::unique_ptr<Node>& child : children) {
-    Debug::check_assertion(!child->is_split(), "Quadtree node child is not a leaf");
-    for (const std::pair<T, Rectangle>& pair : child->elements) {
-      const T& element = pair.first;
-      if (merged_elements.insert(element).second) {
-        elements.push_back(pair);
+  Node& node = nodes[node_index];
+  const int first_child = node.first_child;
+  const unsigned stamp = new_query_stamp();
+  for (int i = 0; i < 4; ++i) {
+    const Node& child = nodes[first_child + i];
+    Debug::check_assertion(child.first_child == -1, "Quadtree node child is not a leaf");
+    for (size_t j = 0; j < child.elements.size(); ++j) {
+      const ElementInfo* info = child.infos[j];
+      if (info->query_stamp != stamp) {
+        info->query_stamp = stamp;
+        node.boxes.push_back(child.boxes[j]);
+        node.elements.push_back(child.elements[j]);
+        node.infos.push_back(info);
       }
     }
   }
 
-  std::fill(std::begin(children), std::end(children), nullptr);
+  node.first_child = -1;
+  destroy_children(first_child);
 
-  Debug::check_assertion(!is_split(), "Quadtree node merge failed");
+  Debug::check_assertion(!is_split(node_index), "Quadtree node merge failed");
 }
 
 /**
- * \brief Returns whether this cell contains a box and is also its main cell.
+ * \brief Returns whether a cell contains a box and is also its main cell.
  *
  * The main cell is used to ensure uniqueness, for example when counting
  * elements.
+ *
+ * \param node_index Index of the node.
+ * \param bounding_box A bounding box.
+ * \return \c true if this node is the main cell of the box.
  */
 template<typename T>
-bool Quadtree<T>::Node::is_main_cell(const Rectangle& bounding_box) const {
+bool Quadtree<T>::is_main_cell(int node_index, const Rectangle& bounding_box) const {
 
-  if (!get_cell().overlaps(bounding_box)) {
+  const Rectangle& cell = get_cell(node_index);
+  if (!cell.overlaps(bounding_box)) {
     // Not overlapping this cell.
     return false;
   }
@@ -498,7 +633,7 @@ bool Quadtree<T>::Node::is_main_cell(const Rectangle& bounding_box) const {
 
   // Clamp the center to the quadtree space,
   // in case the center it actually outside.
-  const Rectangle& quadtree_space = quadtree.get_space();
+  const Rectangle& quadtree_space = get_space();
   center = {
       std::max(quadtree_space.get_left(), std::min(quadtree_space.get_right() - 1, center.x)),
       std::max(quadtree_space.get_top(), std::min(quadtree_space.get_bottom() - 1, center.y))
@@ -506,92 +641,111 @@ bool Quadtree<T>::Node::is_main_cell(const Rectangle& bounding_box) const {
 
   Debug::check_assertion(quadtree_space.contains(center), "Wrong center position");
 
-  return get_cell().contains(center);
+  return cell.contains(center);
 }
 
 /**
- * \brief Returns the number of elements whose center is under this node.
+ * \brief Returns the number of elements whose center is under a node.
+ * \param node_index Index of the node.
  * \return The number of elements under this node.
  */
 template<typename T>
-int Quadtree<T>::Node::get_num_elements() const {
+int Quadtree<T>::get_num_elements(int node_index) const {
 
+  const Node& node = nodes[node_index];
   int num_elements = 0;
-  if (!is_split()) {
+  if (node.first_child == -1) {
     // Some elements can overlap several cells.
     // To avoid duplicates, we count an element if this cell is its main cell.
     // TODO This information could be stored for better performance.
-    for (const std::pair<T, Rectangle>& pair : elements) {
-      const Rectangle& box = pair.second;
-      if (is_main_cell(box)) {
+    for (const Rectangle& box : node.boxes) {
+      if (is_main_cell(node_index, box)) {
         ++num_elements;
       }
     }
   }
   else {
     // Ask children.
-    for (const std::unique_ptr<Node>& child : children) {
-      num_elements += child->get_num_elements();
+    for (int i = 0; i < 4; ++i) {
+      num_elements += get_num_elements(node.first_child + i);
     }
   }
   return num_elements;
 }
 
 /**
- * \brief Gets the elements intersecting the given rectangle under this node.
- * \param[in] region The rectangle to check.
- * \param[in/out] result A list that will be filled with elements.
+ * \brief Calls a function on elements intersecting the given rectangle
+ * under a node.
+ * \param node_index Index of the node.
+ * \param region The rectangle to check.
+ * \param stamp Stamp of the current query.
+ * Elements already marked with this stamp were visited before and are
+ * skipped.
+ * \param visitor The function to call on each element.
  */
 template<typename T>
-void Quadtree<T>::Node::get_elements(
+template<typename F>
+void Quadtree<T>::visit_elements(
+    int node_index,
     const Rectangle& region,
-    std::set<T>& result
+    unsigned stamp,
+    F& visitor
 ) const {
 
-  if (!get_cell().overlaps(region)) {
+  const Node& node = nodes[node_index];
+  if (!node.cell.overlaps(region)) {
     // Nothing here.
     return;
   }
 
-  if (!is_split()) {
-    for (const std::pair<T, Rectangle>& pair : elements) {
-      if (pair.second.overlaps(region)) {
-        result.insert(pair.first);
+  if (node.first_child == -1) {
+    const size_t num_elements = node.boxes.size();
+    for (size_t i = 0; i < num_elements; ++i) {
+      if (node.boxes[i].overlaps(region) &&
+          node.infos[i]->query_stamp != stamp) {
+        node.infos[i]->query_stamp = stamp;
+        visitor(node.elements[i]);
       }
     }
   }
   else {
     // Get from from children cells.
-    for (const std::unique_ptr<Node>& child : children) {
-      child->get_elements(region, result);
+    for (int i = 0; i < 4; ++i) {
+      visit_elements(node.first_child + i, region, stamp, visitor);
     }
   }
 }
 
 /**
- * \brief Draws the node on a surface for debugging purposes.
+ * \brief Draws a node on a surface for debugging purposes.
+ * \param node_index Index of the node.
  * \param dst_surface The destination surface.
  * \param dst_position Where to draw on that surface.
  */
 template<typename T>
-void Quadtree<T>::Node::draw(const SurfacePtr& dst_surface, const Point& dst_position) {
+void Quadtree<T>::draw(
+    int node_index,
+    const SurfacePtr& dst_surface,
+    const Point& dst_position
+) const {
 
-  if (!is_split()) {
-    // Draw the rectangle of the node.
-    draw_rectangle(get_cell(), color, dst_surface, dst_position);
+  const Node& node = nodes[node_index];
+  if (node.first_child == -1) {
+    // Draw the rectangle of the node with a color that depends on its index.
+    const Color color((node_index * 67) % 256, (node_index * 151) % 256, (node_index * 223) % 256);
+    draw_rectangle(node.cell, color, dst_surface, dst_position);
 
     // Draw bounding boxes of elements.
-    for (const std::pair<T, Rectangle>& pair : elements) {
-      const Rectangle& bounding_box = pair.second;
-      if (is_main_cell(bounding_box)) {
+    for (const Rectangle& bounding_box : node.boxes) {
+      if (is_main_cell(node_index, bounding_box)) {
         draw_rectangle(bounding_box, color, dst_surface, dst_position);
       }
     }
   }
   else {
     // Draw children nodes.
-    for (const std::unique_ptr<Node>& child : children) {
-      child->draw(dst_surface, dst_position);
+    for (int i = 0; i < 4; ++i) {
+      draw(node.first_child + i, dst_surface, dst_position);
     }
   }
 }
@@ -604,7 +758,7 @@ void Quadtree<T>::Node::draw(const SurfacePtr& dst_surface, const Point& dst_pos
  * \param dst_position Where to draw on that surface.
  */
 template<typename T>
-void Quadtree<T>::Node::draw_rectangle(
+void Quadtree<T>::draw_rectangle(
     const Rectangle& rectangle,
     const Color& line_color,
     const SurfacePtr& dst_surface,
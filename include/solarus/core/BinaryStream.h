@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_BINARY_STREAM_H
+#define SOLARUS_BINARY_STREAM_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <string>
+
+namespace Solarus {
+
+/**
+ * \brief Appends values to a buffer in a compact binary format.
+ *
+ * Integers are stored in little-endian order and strings are stored
+ * with their length, so that data files can be read back without parsing.
+ */
+class SOLARUS_API BinaryWriter {
+
+  public:
+
+    explicit BinaryWriter(std::string& buffer);
+
+    void write_header(const std::string& format_name, int format_version);
+    void write_uint8(uint8_t value);
+    void write_int(int value);
+    void write_bool(bool value);
+    void write_string(const std::string& value);
+
+  private:
+
+    std::string& buffer;          /**< The buffer to write. */
+
+};
+
+/**
+ * \brief Reads values written by BinaryWriter.
+ *
+ * Reading past the end of the buffer does not crash: it marks the reader
+ * as invalid and returns default values.
+ * Check is_valid() once everything is read.
+ */
+class SOLARUS_API BinaryReader {
+
+  public:
+
+    explicit BinaryReader(const std::string& buffer);
+
+    bool is_valid() const;
+    void set_invalid();
+    bool is_at_end() const;
+
+    bool read_header(const std::string& format_name, int format_version);
+    uint8_t read_uint8();
+    int read_int();
+    bool read_bool();
+    std::string read_string();
+    int read_count(int min_element_size);
+
+  private:
+
+    bool can_read(size_t size);
+
+    const std::string& buffer;    /**< The buffer to read. */
+    size_t position;              /**< Current position in the buffer. */
+    bool valid;                   /**< \c false if a read failed. */
+
+};
+
+}
+
+#endif
+
@@ -18,21 +18,44 @@
 #define SOLARUS_FONT_RESOURCE_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <SDL_ttf.h>
 
 namespace Solarus {
 
+class Color;
+
 /**
  * \brief Provides access to font files.
+ *
+ * Characters of outline fonts are rendered once in glyph atlases:
+ * texts are then drawn as regions of these atlases.
+ * Only the most recently used atlases of each font are kept, so that texts
+ * whose color keeps changing do not accumulate atlases.
  */
 class FontResource {
 
   public:
 
+    /**
+     * \brief A character of an outline font rendered in a glyph atlas.
+     */
+    struct Glyph {
+      SurfacePtr atlas;                               /**< Atlas page containing the glyph,
+                                                       * or nullptr if the glyph is invisible. */
+      Rectangle src_rect;                             /**< Region of the glyph in the atlas page. */
+      int x_offset;                                   /**< X of the region relative to the pen position. */
+      int advance;                                    /**< Distance between this glyph and the next one. */
+      uint32_t code_point;                            /**< Unicode code point of the character. */
+    };
+
     static void initialize();
     static void quit();
 
@@ -41,6 +64,16 @@ class FontResource {
     static bool is_bitmap_font(const std::string& font_id);
     static SurfacePtr get_bitmap_font(const std::string& font_id);
     static TTF_Font& get_outline_font(const std::string& font_id, int size);
+    static const Glyph& get_outline_glyph(
+        const std::string& font_id,
+        int size,
+        bool antialiasing,
+        const Color& color,
+        const std::string& character
+    );
+
+    static constexpr int glyph_atlas_page_size = 256; /**< Width and height of glyph atlas pages. */
+    static constexpr size_t max_glyph_atlases = 16;   /**< Glyph atlases kept per font. */
 
   private:
 
@@ -66,6 +99,32 @@ class FontResource {
         TTF_Font_UniquePtr outline_font;
     };
 
+    /**
+     * Identifies the glyphs of an outline font rendered with some settings.
+     */
+    struct GlyphAtlasKey {
+      int size;                                       /**< Font size. */
+      bool antialiasing;                              /**< Whether glyphs are antialiased. */
+      uint32_t color;                                 /**< RGBA color of the glyphs. */
+
+      bool operator<(const GlyphAtlasKey& other) const;
+    };
+
+    /**
+     * Glyphs of an outline font rendered with some settings.
+     *
+     * Glyphs are packed in rows of atlas pages. Pages are never reorganized,
+     * so that glyphs keep their place.
+     */
+    struct GlyphAtlas {
+      std::vector<SurfacePtr> pages;                  /**< Atlas pages. Only the last one is being filled. */
+      Point next_position;                            /**< Where the next glyph goes in the last page. */
+      int row_height = 0;                             /**< Height of the current row of the last page. */
+      std::unordered_map<std::string, Glyph> glyphs;  /**< Glyphs already rendered, by UTF-8 character. */
+      uint64_t last_use = 0;                          /**< Value of glyph_atlas_clock when a glyph
+                                                       * of this atlas was last requested. */
+    };
+
     /**
      * This structure stores in memory the content of a font file.
      */
@@ -77,11 +136,26 @@ class FontResource {
       std::map<int, OutlineFontReader>
           outline_fonts;                              /**< This font in any size it was loaded with.
                                                        * Only used for outline fonts. */
+      std::map<GlyphAtlasKey, GlyphAtlas>
+          glyph_atlases;                              /**< Glyphs rendered so far, by rendering settings.
+                                                       * Only used for outline fonts. */
     };
 
     static void load_fonts();
+    static void remove_least_recently_used_atlas(
+        FontFile& font,
+        const GlyphAtlasKey& key_in_use
+    );
+    static Glyph render_glyph(
+        TTF_Font& outline_font,
+        const Color& color,
+        bool antialiasing,
+        const std::string& character,
+        GlyphAtlas& atlas
+    );
 
     static bool fonts_loaded;
+    static uint64_t glyph_atlas_clock;
     static std::map<std::string, FontFile> fonts;
 
 };
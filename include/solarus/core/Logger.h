@@ -30,6 +30,8 @@ namespace Solarus {
  * simulated time.
  * This allows to better distinguish messages from the engine and messages
  * from the quest.
+ *
+ * These functions can be called from any thread.
  */
 namespace Logger {
 
@@ -47,6 +47,7 @@ class SOLARUS_API MainLoop {
 
     void run();
     void step();
+    void draw();
 
     void set_exiting();
     bool is_exiting();
@@ -63,7 +64,6 @@ class SOLARUS_API MainLoop {
 
     void check_input();
     void notify_input(const InputEvent& event);
-    void draw();
     void update();
 
     void load_quest_properties();
@@ -30,6 +30,7 @@
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/lua/ExportableToLua.h"
+#include <deque>
 
 namespace Solarus {
 
@@ -181,7 +182,36 @@ class SOLARUS_API Map: public ExportableToLua {
 
   private:
 
+    /**
+     * \brief A vector of entities borrowed from the map for the time
+     * of a spatial query and of the processing of its results.
+     *
+     * Vectors are reused from a query to another to avoid allocations.
+     * Each living instance has its own vector because queries can be nested,
+     * for example when a collision callback makes an entity move.
+     */
+    class EntitiesNearby {
+
+      public:
+
+        explicit EntitiesNearby(Map& map);
+        ~EntitiesNearby();
+
+        EntitiesNearby(const EntitiesNearby& other) = delete;
+        EntitiesNearby& operator=(const EntitiesNearby& other) = delete;
+
+        EntityVector& get();
+
+      private:
+
+        Map& map;                 /**< The map that provides the vector. */
+        EntityVector& entities;   /**< The borrowed vector. */
+
+    };
+
     void set_suspended(bool suspended);
+    EntityVector& borrow_entities_nearby_buffer();
+    void give_back_entities_nearby_buffer();
     void build_background_surface();
     void build_foreground_surface();
     void draw_background(const SurfacePtr& dst_surface);
@@ -234,6 +264,12 @@ class SOLARUS_API Map: public ExportableToLua {
     std::unique_ptr<Entities>
         entities;                 /**< The entities on the map. */
     bool suspended;               /**< Whether the game is suspended. */
+
+    std::deque<EntityVector>
+        entities_nearby_buffers;  /**< Vectors reused by spatial queries
+                                   * (a deque never moves its elements). */
+    size_t num_entities_nearby_buffers_used;
+                                  /**< Number of vectors currently borrowed. */
 };
 
 /**
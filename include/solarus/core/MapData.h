@@ -187,6 +187,8 @@ class SOLARUS_API MapData : public LuaData {
 
     virtual bool import_from_lua(lua_State* l) override;
     virtual bool export_to_lua(std::ostream& out) const override;
+    virtual bool import_from_binary(const std::string& buffer) override;
+    virtual bool export_to_binary(std::string& buffer) const override;
 
     static constexpr int NO_FLOOR = -9999;  /**< Represents a non-existent floor (nil in Lua data files). */
 
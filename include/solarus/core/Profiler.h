@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PROFILER_H
+#define SOLARUS_PROFILER_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/EnumInfo.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Parts of the engine whose duration can be measured.
+ *
+ * Zones may be nested: for example ENTITIES_UPDATE is part of GAME_UPDATE.
+ * Lua events like on_update() are measured in additional zones
+ * named after the event.
+ */
+enum class ProfilerZone {
+  GAME_UPDATE,          /**< Game::update(). */
+  LUA_UPDATE,           /**< LuaContext::update(). */
+  LUA_TIMERS,           /**< LuaContext::update_timers(). */
+  LUA_MOVEMENTS,        /**< LuaContext::update_movements(). */
+  LUA_MENUS,            /**< LuaContext::update_menus(). */
+  ENTITIES_UPDATE,      /**< Entities::update(). */
+  ENTITIES_DRAW,        /**< Entities::draw(). */
+  COLLISIONS,           /**< Collision checks between entities. */
+  DRAW,                 /**< Drawing the game and Lua on the quest surface. */
+  RENDER                /**< Rendering the quest surface to the screen. */
+};
+
+template <>
+struct SOLARUS_API EnumInfoTraits<ProfilerZone> {
+  static const std::string pretty_name;
+
+  static const EnumInfo<ProfilerZone>::names_type names;
+};
+
+/**
+ * \brief Measures the time spent in the main parts of the engine.
+ *
+ * When enabled, each activation of a zone is recorded in the current frame.
+ * A new frame starts at each simulation step, and the last frames are
+ * kept in a ring buffer.
+ * When a zone is entered again while it is already active (for example
+ * collision checks triggered by a collision callback), only the outermost
+ * one is measured.
+ *
+ * When disabled, entering a zone only costs a test.
+ * When the engine is compiled without SOLARUS_PROFILING, zones are not
+ * even compiled and nothing is ever recorded.
+ *
+ * The profiler is only used from the main thread.
+ */
+class SOLARUS_API Profiler {
+
+  public:
+
+    /**
+     * \brief Measures a zone during the lifetime of this object.
+     */
+    class ScopedZone {
+
+      public:
+
+        explicit ScopedZone(ProfilerZone zone);
+        explicit ScopedZone(const char* zone_name);
+        ~ScopedZone();
+
+        ScopedZone(const ScopedZone& other) = delete;
+        ScopedZone& operator=(const ScopedZone& other) = delete;
+
+      private:
+
+        int zone_id;          /**< The zone measured, or -1 if the profiler was disabled. */
+
+    };
+
+    /**
+     * \brief Time spent in a zone during the recorded frames.
+     */
+    struct ZoneStatistics {
+      std::string name;       /**< Name of the zone. */
+      uint64_t total_time;    /**< Total time in nanoseconds. */
+      uint64_t max_time;      /**< Maximum time during one frame in nanoseconds. */
+      int count;              /**< Number of activations. */
+    };
+
+    static constexpr int default_max_frames = 120;
+
+    static bool is_enabled();
+    static void set_enabled(bool enabled);
+    static int get_max_frames();
+    static void set_max_frames(int max_frames);
+
+    static void begin_frame();
+    static uint64_t get_zone_time(ProfilerZone zone);
+    static int get_num_frames();
+    static std::vector<ZoneStatistics> get_statistics();
+    static void write_chrome_trace(std::ostream& out);
+
+    static int get_zone_id(const char* zone_name);
+    static void begin_zone(int zone_id);
+    static void end_zone(int zone_id);
+
+  private:
+
+    static bool enabled;      /**< Whether zones are measured. */
+
+};
+
+}
+
+#ifdef SOLARUS_PROFILING
+
+#define SOLARUS_PROFILER_CONCAT_IMPL(a, b) a##b
+#define SOLARUS_PROFILER_CONCAT(a, b) SOLARUS_PROFILER_CONCAT_IMPL(a, b)
+
+/**
+ * \brief Measures the time spent in the rest of the current scope.
+ * \param zone A ProfilerZone value, or the name of a zone.
+ */
+#define SOLARUS_PROFILE_ZONE(zone) \
+  Solarus::Profiler::ScopedZone SOLARUS_PROFILER_CONCAT(profiler_zone_, __LINE__)(zone)
+
+#else
+
+#define SOLARUS_PROFILE_ZONE(zone)
+
+#endif
+
+#include "solarus/core/Profiler.inl"
+
+#endif
+
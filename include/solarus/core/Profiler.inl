@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+namespace Solarus {
+
+/**
+ * \brief Starts measuring a zone if the profiler is enabled.
+ * \param zone The zone to measure.
+ */
+inline Profiler::ScopedZone::ScopedZone(ProfilerZone zone):
+  zone_id(-1) {
+
+  if (Profiler::is_enabled()) {
+    zone_id = static_cast<int>(zone);
+    Profiler::begin_zone(zone_id);
+  }
+}
+
+/**
+ * \brief Starts measuring a zone identified by its name if the profiler
+ * is enabled.
+ * \param zone_name Name of the zone to measure.
+ */
+inline Profiler::ScopedZone::ScopedZone(const char* zone_name):
+  zone_id(-1) {
+
+  if (Profiler::is_enabled()) {
+    zone_id = Profiler::get_zone_id(zone_name);
+    Profiler::begin_zone(zone_id);
+  }
+}
+
+/**
+ * \brief Stops measuring the zone.
+ */
+inline Profiler::ScopedZone::~ScopedZone() {
+
+  if (zone_id != -1) {
+    Profiler::end_zone(zone_id);
+  }
+}
+
+/**
+ * \brief Returns whether the profiler measures zones.
+ * \return \c true if the profiler is enabled.
+ */
+inline bool Profiler::is_enabled() {
+  return enabled;
+}
+
+}
+
@@ -67,6 +67,11 @@ SOLARUS_API bool data_file_exists(
     const std::string& file_name,
     bool language_specific = false
 );
+SOLARUS_API bool data_files_have_same_location(
+    const std::string& file_name,
+    const std::string& other_file_name,
+    bool language_specific = false
+);
 SOLARUS_API std::string data_file_read(
     const std::string& file_name,
     bool language_specific = false
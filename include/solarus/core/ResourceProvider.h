@@ -21,32 +21,69 @@
 #include "solarus/core/ResourceType.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/entities/TilePattern.h"
+#include <atomic>
+#include <condition_variable>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 
 namespace Solarus {
 
+class LuaContext;
+class MapData;
+
 /**
  * \brief Provides fast access to quest resources.
  *
  * Maintains a cache of already loaded quest resources
  * so that next accesses are faster.
+ *
+ * The resources of a map can also be prepared in advance by a background
+ * thread: its data file, its tileset and the sprites of its entities
+ * are read and decoded there, and the main thread only has to create
+ * the textures and the entities when the map is loaded.
  */
 class SOLARUS_API ResourceProvider {
 
   public:
 
     ResourceProvider();
+    ~ResourceProvider();
+
+    void quit();
 
     const Tileset& get_tileset(const std::string& tileset_id);
     // TODO other types of resources
 
+    void preload_map(const std::string& map_id);
+    bool get_preloaded_map_data(const std::string& map_id, MapData& map_data);
+
+    void set_lua_context(LuaContext* lua_context);
     void invalidate_resource_element(ResourceType resource_type, const std::string& element_id);
 
   private:
 
+    struct PreloadRequest;
+    struct PreloadedMap;
+
+    void cancel_preloading();
+    void preloading_thread_loop();
+    std::unique_ptr<PreloadedMap> preload_map_resources(const PreloadRequest& request) const;
+
+    LuaContext* lua_context;                                                 /**< Lua world whose compiled scripts are invalidated
+                                                                              * with their resource element, or nullptr. */
     std::map<std::string, std::unique_ptr<Tileset>> tileset_cache;          /**< Cache of loaded tilesets. */
+
+    std::thread preloading_thread;                                           /**< Thread that prepares maps in advance. */
+    std::mutex preloading_mutex;                                             /**< Lock for the preloading fields below. */
+    std::condition_variable preloading_condition;                            /**< Notified when a request or a result arrives. */
+    std::atomic<bool> preloading_stopped;                                    /**< Tells the preloading thread to stop. */
+    std::string preloading_map_id;                                           /**< Map being preloaded or empty. */
+    std::unique_ptr<PreloadRequest> preload_request;                         /**< Request not started yet by the thread. */
+    std::unique_ptr<PreloadedMap> preloaded_map;                             /**< Result of the request, when finished. */
 };
 
 }
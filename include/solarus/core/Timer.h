@@ -44,6 +44,7 @@ class Timer: public ExportableToLua {
     uint32_t get_initial_duration() const;
     uint32_t get_expiration_date() const;
     void set_expiration_date(uint32_t expiration_date);
+    uint32_t get_next_update_date() const;
 
     void update();
     void notify_map_suspended(bool suspended);
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_WORKER_POOL_H
+#define SOLARUS_WORKER_POOL_H
+
+#include "solarus/core/Common.h"
+#include <functional>
+
+namespace Solarus {
+
+/**
+ * \brief Threads that help the main thread process independent items
+ * in parallel.
+ *
+ * The threads are created when they are first needed and then wait for
+ * work until the end of the program.
+ *
+ * Jobs run on worker threads must not throw exceptions and must not
+ * use Lua, SDL rendering functions or Debug and Logger functions.
+ */
+class WorkerPool {
+
+  public:
+
+    static void run(
+        int num_items,
+        int max_threads,
+        const std::function<void(int)>& job
+    );
+
+    static int get_default_num_threads();
+
+};
+
+}
+
+#endif
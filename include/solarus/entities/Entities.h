@@ -33,6 +33,7 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace Solarus {
@@ -72,6 +73,7 @@ class SOLARUS_API Entities {
     Hero& get_hero();
     const CameraPtr& get_camera() const;
     Ground get_tile_ground(int layer, int x, int y) const;
+    bool is_ground_modified(int layer, int x, int y) const;
     EntityVector get_entities();
     const std::shared_ptr<Destination>& get_default_destination();
 
@@ -105,6 +107,8 @@ class SOLARUS_API Entities {
     void get_entities_in_rectangle(const Rectangle& rectangle, EntityVector& result);
     void get_entities_in_rectangle_sorted(const Rectangle& rectangle, ConstEntityVector& result) const;
     void get_entities_in_rectangle_sorted(const Rectangle& rectangle, EntityVector& result);
+    template<typename F>
+    void visit_entities_in_rectangle(const Rectangle& rectangle, F&& visitor) const;
 
     // By separator region.
     void get_entities_in_region(const Point& xy, EntityVector& result);
@@ -124,10 +128,24 @@ class SOLARUS_API Entities {
     void bring_to_back(Entity& entity);
     void set_entity_layer(Entity& entity, int layer);
     void notify_entity_bounding_box_changed(Entity& entity);
+    void notify_entity_ground_changed(Entity& entity);
 
     // Specific to some entity types.
     bool overlaps_raised_blocks(int layer, const Rectangle& rectangle) ;
 
+    // Collisions.
+    bool is_collision_broad_phase_enabled() const;
+    void set_collision_broad_phase_enabled(bool enabled);
+    bool defer_collision_check(Entity& entity, bool from_detector);
+
+    // Optimized tiles.
+    int get_num_resident_tile_cells() const;
+    int get_num_tile_cells_built_last_draw() const;
+    const NonAnimatedRegions* get_non_animated_regions(int layer) const;
+
+    // Drawing order.
+    int get_num_draw_list_changes_last_draw() const;
+
     // Map events.
     void notify_map_started();
     void notify_map_opening_transition_finished();
@@ -147,10 +165,43 @@ class SOLARUS_API Entities {
     template<typename T>
     using ByLayer = std::map<int, T>;
 
+    /**
+     * \brief Position of an entity in the drawing order of its layer.
+     *
+     * Entities drawn in Z order come first, then entities drawn in Y order.
+     * The Z order breaks ties so that keys of a layer are unique.
+     */
+    struct DrawOrderKey {
+        bool y_order;                               /**< Whether the entity is drawn in Y order. */
+        int y;                                      /**< Y coordinate if drawn in Y order, 0 otherwise. */
+        int z;                                      /**< Relative Z order of the entity. */
+
+        bool operator==(const DrawOrderKey& other) const;
+        bool operator<(const DrawOrderKey& other) const;
+    };
+
+    /**
+     * \brief An entity in a draw list.
+     */
+    struct DrawListEntry {
+        DrawOrderKey key;                           /**< Drawing order of the entity when it was inserted. */
+        EntityPtr entity;                           /**< The entity. */
+
+        bool operator<(const DrawListEntry& other) const;
+    };
+
+    /**
+     * \brief Where an entity is stored in the draw lists.
+     */
+    struct DrawListInfo {
+        int layer;                                  /**< Layer of the draw list containing the entity. */
+        DrawOrderKey key;                           /**< Key of the entity in this draw list. */
+    };
+
     /**
      * \brief Ordered list of entities to be drawn.
      */
-    using EntitiesToDraw = std::vector<EntityPtr>;
+    using DrawList = std::vector<DrawListEntry>;
 
     /**
      * \brief Internal fast cached information about the entity insertion order.
@@ -174,11 +225,41 @@ class SOLARUS_API Entities {
         int max;
     };
 
+    /**
+     * \brief Area where a ground modifier entity is registered
+     * in the ground modifiers grid.
+     */
+    struct GroundModifierInfo {
+        int layer;                                  /**< Layer where the entity was registered. */
+        Rectangle box;                              /**< Box where the entity was registered. */
+    };
+
+    /**
+     * \brief Simple collision checks of an entity deferred to the broad phase.
+     */
+    struct DeferredCollisionCheck {
+        EntityPtr entity;                           /**< The entity to check. */
+        bool with_detectors;                        /**< Whether to check the entity with detectors. */
+        bool from_detector;                         /**< Whether to check the entity as a detector. */
+    };
+
     void initialize_layers();
     void set_tile_ground(int layer, int x8, int y8, Ground ground);
+    void add_ground_modifier(const Entity& entity);
+    void remove_ground_modifier(const Entity& entity);
+    void update_ground_modifiers_grid(int layer, const Rectangle& box, int delta);
     void remove_marked_entities();
     void notify_entity_removed(Entity& entity);
     void update_crystal_blocks();
+    void check_deferred_collisions();
+    DrawOrderKey get_draw_order_key(const Entity& entity) const;
+    bool is_in_draw_region(const Entity& entity) const;
+    void update_draw_region();
+    void rebuild_draw_lists();
+    void refresh_draw_list_keys();
+    void update_draw_list(Entity& entity);
+    void add_to_draw_list(const EntityPtr& entity);
+    void remove_from_draw_list(const Entity& entity);
 
     // map
     Game& game;                                     /**< The game running this map */
@@ -192,6 +273,13 @@ class SOLARUS_API Entities {
     ByLayer<std::vector<Ground>> tiles_ground;      /**< For each layer, list of size tiles_grid_size
                                                      * representing the ground property
                                                      * of each 8x8 square. */
+    ByLayer<std::vector<int>>
+        ground_modifiers_grid;                      /**< For each layer, list of size tiles_grid_size
+                                                     * with the number of entities that may
+                                                     * modify the ground of each 8x8 square.
+                                                     * When zero, the ground is the tile ground. */
+    std::unordered_map<const Entity*, GroundModifierInfo>
+        ground_modifiers;                           /**< Entities registered in ground_modifiers_grid. */
     ByLayer<std::unique_ptr<NonAnimatedRegions>>
         non_animated_regions;                       /**< For each layer, all non-animated tiles are managed
                                                      * here for performance. */
@@ -215,10 +303,32 @@ class SOLARUS_API Entities {
     ByLayer<EntityVector>
         entities_drawn_not_at_their_position;       /**< For each layer, entities to draw even if there position
                                                      * is outside the camera. */
-    ByLayer<EntitiesToDraw> entities_to_draw;       /**< For each layer, entities to be drawn at this cycle. */
+    ByLayer<DrawList> draw_lists;                   /**< For each layer, entities that may be drawn,
+                                                     * sorted in drawing order. */
+    std::unordered_map<const Entity*, DrawListInfo>
+        draw_list_infos;                            /**< Entities stored in draw_lists. */
+    Rectangle draw_region;                          /**< Entities overlapping this area are in draw_lists.
+                                                     * Empty until the first draw. */
+    Size draw_region_camera_size;                   /**< Size of the camera when draw_region was computed. */
+    int num_draw_list_changes;                      /**< Draw list insertions and removals since the last draw. */
+    int num_draw_list_changes_last_draw;            /**< Draw list insertions and removals during the last draw. */
+    bool drawing_entities;                          /**< Whether draw lists are being iterated. */
+    EntityVector entities_changed_while_drawing;    /**< Entities to update in draw lists after drawing. */
 
     EntityList entities_to_remove;                  /**< List of entities that need to be removed right now. */
 
+    // collisions
+    bool collision_broad_phase_enabled;             /**< Whether simple collision checks of entities
+                                                     * are gathered during each update
+                                                     * and done together at the end. */
+    bool collision_checks_deferred;                 /**< Whether simple collision checks are currently
+                                                     * deferred to the broad phase. */
+    std::vector<DeferredCollisionCheck>
+        deferred_collision_checks;                  /**< Checks to do at the broad phase,
+                                                     * in the order they were requested. */
+    std::unordered_map<const Entity*, size_t>
+        deferred_collision_check_indices;           /**< Index of each entity in deferred_collision_checks. */
+
     std::shared_ptr<Destination>
         default_destination;                        /**< Default destination of this map or nullptr. */
 
@@ -244,6 +354,46 @@ inline Ground Entities::get_tile_ground(int layer, int x, int y) const {
   return tiles_ground.at(layer)[(y >> 3) * map_width8 + (x >> 3)];
 }
 
+/**
+ * \brief Returns whether a dynamic entity may change the ground at the
+ * specified point.
+ *
+ * When this function returns \c false, the ground of the point is the one
+ * returned by get_tile_ground() and no spatial search is needed.
+ *
+ * This function assumes that the parameters are correct: for performance
+ * reasons, no check is done here.
+ *
+ * \param layer Layer of the point.
+ * \param x X coordinate of the point.
+ * \param y Y coordinate of the point.
+ * \return \c true if at least one ground modifier entity is registered
+ * on the 8x8 square of this point.
+ */
+inline bool Entities::is_ground_modified(int layer, int x, int y) const {
+
+  return ground_modifiers_grid.at(layer)[(y >> 3) * map_width8 + (x >> 3)] != 0;
+}
+
+/**
+ * \brief Calls a function on each entity whose bounding box overlaps the
+ * given rectangle.
+ *
+ * This is faster than get_entities_in_rectangle() because nothing is
+ * allocated or copied, but the function must not add, remove or move
+ * entities and must not make other spatial queries.
+ * In particular, it must not call Lua.
+ *
+ * \param rectangle A rectangle.
+ * \param visitor A function taking a const EntityPtr& parameter,
+ * called on entities in that rectangle in arbitrary order.
+ */
+template<typename F>
+void Entities::visit_entities_in_rectangle(const Rectangle& rectangle, F&& visitor) const {
+
+  quadtree.visit_elements(rectangle, std::forward<F>(visitor));
+}
+
 /**
  * \brief Returns the camera of the map.
  * \return The camera, or nullptr if there is no camera.
@@ -28,6 +28,9 @@
 
 namespace Solarus {
 
+class BinaryReader;
+class BinaryWriter;
+
 /**
  * \brief Stores the properties of a map entity.
  *
@@ -145,6 +148,8 @@ class SOLARUS_API EntityData : public LuaData {
 
     bool import_from_lua(lua_State* l) override;
     bool export_to_lua(std::ostream& out) const override;
+    void write_binary(BinaryWriter& writer) const;
+    bool read_binary(BinaryReader& reader);
 
     static EntityData check_entity_data(lua_State* l, int index, EntityType type);
     static const std::map<EntityType, const EntityTypeDescription> get_entity_type_descriptions();
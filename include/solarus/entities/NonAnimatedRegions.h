@@ -21,6 +21,7 @@
 #include "solarus/containers/Grid.h"
 #include "solarus/entities/TileInfo.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include <chrono>
 #include <vector>
 
 namespace Solarus {
@@ -34,22 +35,56 @@ class Map;
  * tile. The tiles in such rectangles of the map can be pre-drawn once for all
  * on an intermediate surface for performance. Furthermore, this intermediate
  * surface is drawn lazily when the camera moves.
+ *
+ * Cells of the grid that are about to become visible are built in advance,
+ * in the direction the camera is moving, within a time budget per frame.
+ * Cells far from the camera are unloaded when the total size of the cells of
+ * all layers exceeds the cache size.
+ *
+ * When possible, the pixels of cells are composed on the CPU by worker
+ * threads, and each cell is then uploaded at once.
  */
 class NonAnimatedRegions {
 
   public:
 
     NonAnimatedRegions(Map& map, int layer);
+    ~NonAnimatedRegions();
 
     void add_tile(const TileInfo& tile);
     void build(std::vector<TileInfo>& rejected_tiles);
     void notify_tileset_changed();
     void draw_on_map();
 
+    int get_num_resident_cells() const;
+    int get_num_cells_built_last_draw() const;
+
+    int get_num_cells() const;
+    SurfacePtr compose_cell(int cell_index) const;
+    SurfacePtr render_cell(int cell_index) const;
+
+    static int get_cache_size();
+    static void set_cache_size(int cache_size);
+    static int get_cache_memory();
+
   private:
 
+    using Clock = std::chrono::steady_clock;
+
     bool overlaps_animated_tile(const TileInfo& tile) const;
-    void build_cell(int cell_index);
+    Rectangle get_cell_box(int cell_index) const;
+    int get_cell_memory() const;
+    Rectangle get_prebuild_box(const Rectangle& camera_position) const;
+    void prebuild_cells(
+        const Rectangle& prebuild_box,
+        const Point& camera_center,
+        const Clock::time_point& start_time
+    );
+    void shrink_cache(const Rectangle& prebuild_box, const Point& camera_center);
+    void build_cells(const std::vector<int>& cell_indices);
+    void draw_cell(int cell_index, const SurfacePtr& cell_surface) const;
+    std::vector<Rectangle> get_animated_squares(int cell_index) const;
+    void unload_cell(int cell_index);
 
     Map& map;                               /**< The map. */
     int layer;                              /**< Layer of the map managed by this object. */
@@ -67,6 +102,20 @@ class NonAnimatedRegions {
         optimized_tiles_surfaces;           /**< All non-animated tiles are drawn here once for all
                                              * for performance. Each cell of the grid has a surface
                                              * or nullptr before it is drawn. */
+    int num_resident_cells;                 /**< Number of cells currently built. */
+    int num_cells_built_last_draw;          /**< Number of cells built during the last call
+                                             * to draw_on_map(). */
+    Point previous_camera_xy;               /**< Camera position at the last draw. */
+    Point camera_direction;                 /**< Direction of the last camera move
+                                             * (-1, 0 or 1 on each axis). */
+
+    static int cache_size;                  /**< Maximum size in bytes of the cells of all layers. */
+    static int cache_memory;                /**< Current size in bytes of the cells of all layers. */
+
+    static constexpr int default_cache_size = 96 * 1024 * 1024;
+    static constexpr int prebuild_time_budget = 1000;  /**< Time in microseconds allowed
+                                                        * to build cells in advance at each
+                                                        * draw of a layer. */
 
 };
 
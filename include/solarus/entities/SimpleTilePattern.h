@@ -43,6 +43,7 @@ class SimpleTilePattern: public TilePattern {
     ) const override;
 
     virtual bool is_animated() const override;
+    virtual bool get_static_region(Rectangle& region) const override;
 
   protected:
 
@@ -73,6 +73,7 @@ class TilePattern {
     ) const = 0;
     virtual bool is_animated() const;
     virtual bool is_drawn_at_its_position() const;
+    virtual bool get_static_region(Rectangle& region) const;
 
   protected:
 
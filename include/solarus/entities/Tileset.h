@@ -30,6 +30,7 @@ namespace Solarus {
 
 class TilePattern;
 class TilePatternData;
+class TilesetData;
 
 /**
  * \brief A set of tile patterns that are used to compose a map.
@@ -43,6 +44,7 @@ class Tileset {
     explicit Tileset(const std::string& id);
 
     void load();
+    void load(const TilesetData& data);
     void unload();
 
     const std::string& get_id() const;
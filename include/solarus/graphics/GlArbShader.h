@@ -43,19 +43,29 @@ class GlArbShader : public Shader {
     explicit GlArbShader(const std::string& shader_id);
     ~GlArbShader();
 
+    int get_uniform_handle(const std::string& uniform_name) override;
+
+    using Shader::set_uniform_1b;
+    using Shader::set_uniform_1i;
+    using Shader::set_uniform_1f;
+    using Shader::set_uniform_2f;
+    using Shader::set_uniform_3f;
+    using Shader::set_uniform_4f;
+    using Shader::set_uniform_texture;
+
     void set_uniform_1b(
-        const std::string& uniform_name, bool value) override;
+        int uniform_handle, bool value) override;
     void set_uniform_1i(
-        const std::string& uniform_name, int value) override;
+        int uniform_handle, int value) override;
     void set_uniform_1f(
-        const std::string& uniform_name, float value) override;
+        int uniform_handle, float value) override;
     void set_uniform_2f(
-        const std::string& uniform_name, float value_1, float value_2) override;
+        int uniform_handle, float value_1, float value_2) override;
     void set_uniform_3f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3) override;
+        int uniform_handle, float value_1, float value_2, float value_3) override;
     void set_uniform_4f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) override;
-    bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) override;
+        int uniform_handle, float value_1, float value_2, float value_3, float value_4) override;
+    bool set_uniform_texture(int uniform_handle, const SurfacePtr& value) override;
 
     void render(const VertexArray &array, const Surface &texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) override;
 
@@ -82,8 +92,8 @@ class GlArbShader : public Shader {
     GLint color_location;                        /**< The location of the color attrib. */
     mutable std::map<std::string, GLint>
         uniform_locations;                       /**< Cache of uniform locations. */
-    mutable std::map<std::string, TextureUniform>
-        uniform_textures;                        /**< Uniform texture value of surfaces. */
+    std::map<GLint, TextureUniform>
+        uniform_textures;                        /**< Uniform texture value of surfaces by location. */
     GLuint current_texture_unit = 0;
 #else
 
@@ -21,7 +21,9 @@
 #include "solarus/graphics/Shader.h"
 #include <unordered_map>
 #include <SDL.h>
+#include <map>
 #include <string>
+#include <vector>
 
 
 namespace Solarus {
@@ -42,21 +44,32 @@ class GlShader : public Shader {
   explicit GlShader(const std::string& shader_id);
   ~GlShader();
 
+  int get_uniform_handle(const std::string& uniform_name) override;
+
+  using Shader::set_uniform_1b;
+  using Shader::set_uniform_1i;
+  using Shader::set_uniform_1f;
+  using Shader::set_uniform_2f;
+  using Shader::set_uniform_3f;
+  using Shader::set_uniform_4f;
+  using Shader::set_uniform_texture;
+
   void set_uniform_1b(
-      const std::string& uniform_name, bool value) override;
+      int uniform_handle, bool value) override;
   void set_uniform_1i(
-      const std::string& uniform_name, int value) override;
+      int uniform_handle, int value) override;
   void set_uniform_1f(
-      const std::string& uniform_name, float value) override;
+      int uniform_handle, float value) override;
   void set_uniform_2f(
-      const std::string& uniform_name, float value_1, float value_2) override;
+      int uniform_handle, float value_1, float value_2) override;
   void set_uniform_3f(
-      const std::string& uniform_name, float value_1, float value_2, float value_3) override;
+      int uniform_handle, float value_1, float value_2, float value_3) override;
   void set_uniform_4f(
-      const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) override;
-  bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) override;
+      int uniform_handle, float value_1, float value_2, float value_3, float value_4) override;
+  bool set_uniform_texture(int uniform_handle, const SurfacePtr& value) override;
 
   void render(const VertexArray &array, const Surface &texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) override;
+  void render_vertices(const VertexArray &array, SDL_Texture* texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3());
 
   std::string default_vertex_source() const override;
   std::string default_fragment_source() const override;
@@ -65,7 +78,7 @@ protected:
 private:
 
   void check_gl_error();
-  void enable_attribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer);
+  void enable_attribute(GLint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer);
   void restore_attribute_states();
 
   struct TextureUniform{
@@ -73,9 +86,30 @@ private:
     GLuint unit;
   };
 
+  /**
+   * \brief A uniform of the program and its value not uploaded yet.
+   *
+   * Values are uploaded when the program is used for rendering, so that
+   * setting a uniform never needs to switch programs.
+   */
+  struct Uniform {
+    GLint location;         /**< Location in the program. */
+    GLenum type;            /**< GL type of the uniform, or 0 if unknown. */
+    bool dirty;             /**< Whether the value below is not uploaded yet. */
+    bool integer;           /**< Whether the value is an integer or a float vector. */
+    int num_components;     /**< Number of floats of the value (1 to 4). */
+    GLint int_value;        /**< The value if it is an integer. */
+    GLfloat float_values[4]; /**< The value if it is a float vector. */
+  };
+
   GLuint create_shader(unsigned int type, const char* source);
   static void set_rendering_settings();
-  GLint get_uniform_location(const std::string& uniform_name) const;
+  void resolve_locations();
+  int add_uniform(const std::string& uniform_name, GLint location, GLenum type);
+  Uniform* get_uniform(int uniform_handle);
+  void set_uniform_int(int uniform_handle, GLint value);
+  void set_uniform_floats(int uniform_handle, int num_components, const GLfloat* values);
+  void upload_uniforms();
 
   GLuint program;                         /**< The program which bind the vertex and fragment shader. */
   GLuint vertex_shader;                   /**< The vertex shader. */
@@ -83,11 +117,17 @@ private:
   GLint position_location;                     /**< The location of the position attrib. */
   GLint tex_coord_location;                    /**< The location of the tex_coord attrib. */
   GLint color_location;                        /**< The location of the color attrib. */
-  mutable std::map<std::string, GLint>
-      uniform_locations;                       /**< Cache of uniform locations. */
-  mutable std::map<std::string, TextureUniform>
-      uniform_textures;                        /**< Uniform texture value of surfaces. */
-  std::unordered_map<GLuint, GLint> attribute_states;    /**< Previous attrib states. */
+  GLint mvp_matrix_location;                   /**< The location of the MVP matrix uniform. */
+  GLint uv_matrix_location;                    /**< The location of the UV matrix uniform. */
+  std::vector<Uniform> uniforms;               /**< Uniforms known so far, indexed by handle. */
+  std::unordered_map<std::string, int>
+      uniform_handles;                         /**< Handle of each uniform name, or -1 if the
+                                                * program has no such uniform. */
+  std::vector<int> dirty_uniforms;             /**< Handles of uniforms to upload. */
+  std::map<int, TextureUniform>
+      uniform_textures;                        /**< Uniform texture value of surfaces by handle. */
+  std::vector<GLuint> enabled_attributes;      /**< Attribute arrays enabled for the
+                                                * current draw only. */
   GLuint current_texture_unit = 0;
 
 };
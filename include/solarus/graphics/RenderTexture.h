@@ -6,10 +6,15 @@
 #include "solarus/graphics/Video.h"
 #include "solarus/core/Debug.h"
 #include "DrawProxies.h"
+#include <memory>
+#include <vector>
 
 
 namespace Solarus {
 
+class GlShader;
+class VertexArray;
+
 #ifdef DEBUG
 #define SOLARUS_CHECK_SDL_HIGHER(expr,bound) if((expr) < bound) Debug::error(std::string(SDL_GetError()) + "! " + __FILE__ + ":" + std::to_string(__LINE__));
 #else
@@ -24,6 +29,21 @@ namespace Solarus {
  *
  * RenderTextures are created when instantiating empty surface
  * that are likely to be filled or drawn to.
+ *
+ * Surfaces drawn on a render texture are not copied right away:
+ * consecutive draws on the same render texture are batched and flushed
+ * together, with a single render target switch, when something else
+ * is drawn or when the result is needed.
+ *
+ * When GLSL shaders are available, a batch is drawn as vertex streams:
+ * images are taken from TextureAtlas pages, and consecutive draws that use
+ * the same page and blend mode make a single draw call. Otherwise, each
+ * draw of the batch is an SDL copy.
+ *
+ * The pixels are only read back from the GPU when they are needed, and only
+ * in the region modified since the last read. Callers that can accept pixels
+ * one frame old can use get_previous_surface() to avoid reading back during
+ * the frame.
  */
 class RenderTexture : public SurfaceImpl
 {
@@ -31,6 +51,7 @@ public:
     RenderTexture(int width, int height);
     SDL_Texture* get_texture() const override;
     SDL_Surface* get_surface() const override;
+    SDL_Surface* get_previous_surface() const override;
 
     template<typename Func>
     /**
@@ -38,10 +59,20 @@ public:
      * @param closure work to achieve while the target texture is bound
      */
     void with_target(Func closure) const {
-      surface_dirty = true;
-      auto renderer = Video::get_renderer();
-      SOLARUS_CHECK_SDL(SDL_SetRenderTarget(renderer,target.get()));
-      closure(renderer);
+      with_target(Rectangle(0,0,get_width(),get_height()),closure);
+    }
+
+    template<typename Func>
+    /**
+     * @brief setup draw environnement for drawing on a region of the target texture
+     * @param where the only region that the closure modifies
+     * @param closure work to achieve while the target texture is bound
+     */
+    void with_target(const Rectangle& where, Func closure) const {
+      flush_batch();
+      mark_dirty(where);
+      Video::set_render_target(target.get());
+      closure(Video::get_renderer());
     }
 
     int get_width() const override;
@@ -56,11 +87,54 @@ public:
 
     void clear();
     void clear(const Rectangle& where);
-    ~RenderTexture(){
-    }
+    void replace_pixels(const SDL_Surface& pixels);
+    ~RenderTexture();
+
+    static void initialize();
+    static void quit();
+    static void flush_batch();
+    static void update_previous_surfaces();
 private:
-    mutable bool surface_dirty = true; /**< is the surface not up to date*/
+    void mark_dirty(const Rectangle& where) const;
+
+    /**
+     * @brief A copy of a surface waiting in the batch
+     */
+    struct BatchedDraw {
+      const SurfaceImpl* texture;  /**< the surface to copy */
+      Rectangle region;            /**< region of the surface to copy */
+      Rectangle dst_rect;          /**< where to copy it on the target */
+      SDL_BlendMode blend_mode;    /**< blend mode to use */
+      uint8_t opacity;             /**< alpha modulation to use */
+    };
+
+    /**
+     * @brief Where the pixels of a batched draw are read
+     */
+    struct BatchedSource {
+      SDL_Texture* texture;        /**< the texture or atlas page to sample */
+      Rectangle region;            /**< region in pixels of the texture */
+      Size size;                   /**< size of the texture */
+    };
+
+    static Color get_modulation_color(const BatchedDraw& draw);
+    static void render_batch_vertices(const RenderTexture& target, const std::vector<BatchedDraw>& draws);
+
+    static const RenderTexture* batch_target;  /**< render texture of the pending draws or nullptr */
+    static std::vector<BatchedDraw> batch;     /**< draws not flushed yet, in drawing order */
+    static std::unique_ptr<GlShader>
+        batch_shader;                          /**< shader drawing batches as vertex streams,
+                                                 * or nullptr to copy each draw with SDL */
+    static VertexArray batch_vertices;         /**< quads of the draws being flushed */
+    static std::vector<BatchedSource>
+        batch_sources;                         /**< sources of the draws being flushed */
+    static std::vector<const RenderTexture*>
+        previous_surface_textures;             /**< render textures whose previous surface is kept */
+
+    mutable Rectangle dirty_region; /**< region of the surface that is not up to date*/
     mutable SDL_Surface_UniquePtr surface; /**< cpu side pixels data */
+    mutable SDL_Surface_UniquePtr previous_surface; /**< cpu side pixels at the end of the previous frame */
+    mutable bool previous_surface_used = false; /**< whether previous_surface was used during this frame */
     mutable SDL_Texture_UniquePtr target; /**< gpu side pixels data */
 };
 
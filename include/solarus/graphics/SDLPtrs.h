@@ -1,10 +1,12 @@
 #pragma once
 
+#include "solarus/graphics/Video.h"
 #include <SDL_render.h>
 #include <memory>
 
 struct SDL_Texture_Deleter {
     void operator()(SDL_Texture* texture) const {
+      Solarus::Video::notify_texture_destroyed(texture);
       SDL_DestroyTexture(texture);
     }
 };
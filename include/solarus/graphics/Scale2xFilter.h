@@ -27,6 +27,8 @@ namespace Solarus {
  * \brief Implementation of the Scale2x algorithm.
  *
  * See http://scale2x.sourceforge.net/algorithm.html
+ *
+ * Pixels are processed 4 by 4 with SSE2 when available.
  */
 class Scale2xFilter: public SoftwarePixelFilter {
 
@@ -35,11 +37,16 @@ class Scale2xFilter: public SoftwarePixelFilter {
     Scale2xFilter();
 
     virtual int get_scaling_factor() const override;
-    virtual void filter(
+
+  protected:
+
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
-        uint32_t* dst
+        uint32_t* dst,
+        int first_row,
+        int end_row
     ) const override;
 
 };
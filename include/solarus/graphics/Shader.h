@@ -72,19 +72,35 @@ class Shader : public DrawProxy, public ExportableToLua {
     virtual std::string default_vertex_source() const = 0;
     virtual std::string default_fragment_source() const = 0;
 
+    virtual int get_uniform_handle(const std::string& uniform_name);  // TODO make pure virtual
+
+    void set_uniform_1b(
+        const std::string& uniform_name, bool value);
+    void set_uniform_1i(
+        const std::string& uniform_name, int value);
+    void set_uniform_1f(
+        const std::string& uniform_name, float value);
+    void set_uniform_2f(
+        const std::string& uniform_name, float value_1, float value_2);
+    void set_uniform_3f(
+        const std::string& uniform_name, float value_1, float value_2, float value_3);
+    void set_uniform_4f(
+        const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4);
+    bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value);
+
     virtual void set_uniform_1b(
-        const std::string& uniform_name, bool value);  // TODO make pure virtual
+        int uniform_handle, bool value);  // TODO make pure virtual
     virtual void set_uniform_1i(
-        const std::string& uniform_name, int value);
+        int uniform_handle, int value);
     virtual void set_uniform_1f(
-        const std::string& uniform_name, float value);
+        int uniform_handle, float value);
     virtual void set_uniform_2f(
-        const std::string& uniform_name, float value_1, float value_2);
+        int uniform_handle, float value_1, float value_2);
     virtual void set_uniform_3f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3);
+        int uniform_handle, float value_1, float value_2, float value_3);
     virtual void set_uniform_4f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4);
-    virtual bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value);
+        int uniform_handle, float value_1, float value_2, float value_3, float value_4);
+    virtual bool set_uniform_texture(int uniform_handle, const SurfacePtr& value);
 
     void render(const Surface &surface, const Rectangle &region, const Size &dst_size, const Point &dst_position = Point(), bool flip_y = false);
     virtual void draw(Surface& dst_surface, const Surface &src_surface, const DrawInfos &infos) const override;
@@ -105,6 +121,7 @@ class Shader : public DrawProxy, public ExportableToLua {
     void set_error(const std::string& error);
     void set_data(const ShaderData& data);
     virtual void load();  // TODO make pure virtual
+    void resolve_builtin_uniforms();
     static VertexArray screen_quad; /**< The quad used to draw surfaces with shaders*/
 
   private:
@@ -113,6 +130,10 @@ class Shader : public DrawProxy, public ExportableToLua {
     ShaderData data;              /**< The loaded shader data file. */
     bool valid;                   /**< \c true if the compilation succedeed. */
     std::string error;            /**< Error message of the last operation if any. */
+    int time_handle;              /**< Handle of the time uniform or -1. */
+    int output_size_handle;       /**< Handle of the output size uniform or -1. */
+    int input_size_handle;        /**< Handle of the input size uniform or -1. */
+    int opacity_handle;           /**< Handle of the opacity uniform or -1. */
 };
 
 }
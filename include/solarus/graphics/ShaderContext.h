@@ -24,6 +24,8 @@
 
 namespace Solarus {
 
+class GlShader;
+
 /**
  * \brief Shader context management.
  *
@@ -36,11 +38,14 @@ class ShaderContext {
     static bool initialize();
     static void quit();
 
+    static bool is_shader_supported();
+
     static const std::string& get_opengl_version();
     static const std::string& get_shading_language_version();
     static void make_current();
 
     static ShaderPtr create_shader(const std::string& shader_id);
+    static std::unique_ptr<GlShader> create_batch_shader();
 
   private:
 
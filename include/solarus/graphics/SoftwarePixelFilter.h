@@ -43,6 +43,10 @@ class SoftwarePixelFilter {
 
     /**
      * \brief Applies the algorithm on a rectangle of pixels.
+     *
+     * The rectangle is split into horizontal bands that are filtered in
+     * parallel if several threads are allowed.
+     *
      * \param src The rectangle of pixels in RGBA format.
      * Must be a buffer of size src_width * dst_width.
      * \param src_width Width of the rectangle.
@@ -51,11 +55,47 @@ class SoftwarePixelFilter {
      * Must be a buffer of size
      * src_width * dst_width * get_scaling_factor().
      */
-    virtual void filter(
+    void filter(
         const uint32_t* src,
         int src_width,
         int src_height,
         uint32_t* dst
+    ) const;
+
+    static int get_num_threads();
+    static void set_num_threads(int num_threads);
+
+  protected:
+
+    /**
+     * \brief Called from the main thread before filtering a rectangle.
+     *
+     * Redefine this function to perform initializations that cannot be
+     * done concurrently by filter_rows().
+     */
+    virtual void prepare_filter() const;
+
+    /**
+     * \brief Applies the algorithm on some rows of a rectangle of pixels.
+     *
+     * Rows outside the range may be read as neighbors but only the
+     * destination pixels of rows in the range are written, so this function
+     * can be called concurrently on disjoint ranges.
+     *
+     * \param src The whole rectangle of pixels in RGBA format.
+     * \param src_width Width of the rectangle.
+     * \param src_height Height of the whole rectangle.
+     * \param dst The whole destination rectangle.
+     * \param first_row First source row to filter.
+     * \param end_row Source row after the last one to filter.
+     */
+    virtual void filter_rows(
+        const uint32_t* src,
+        int src_width,
+        int src_height,
+        uint32_t* dst,
+        int first_row,
+        int end_row
     ) const = 0;
 
 };
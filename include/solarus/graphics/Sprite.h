@@ -23,6 +23,7 @@
 #include "solarus/graphics/SpritePtr.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include <map>
+#include <set>
 #include <string>
 
 namespace Solarus {
@@ -30,6 +31,7 @@ namespace Solarus {
 class Size;
 class SpriteAnimation;
 class SpriteAnimationSet;
+class SpriteData;
 class Tileset;
 
 /**
@@ -52,6 +54,8 @@ class Sprite: public Drawable {
     // initialization
     static void initialize();
     static void quit();
+    static std::set<std::string> get_loaded_animation_set_ids();
+    static void add_animation_set(const std::string& id, const SpriteData& data);
 
     // creation and destruction
     explicit Sprite(const std::string& id);
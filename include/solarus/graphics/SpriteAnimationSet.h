@@ -29,6 +29,7 @@ namespace Solarus {
 
 class SpriteAnimation;
 class SpriteAnimationData;
+class SpriteData;
 class Tileset;
 
 /**
@@ -44,6 +45,7 @@ class SpriteAnimationSet {
   public:
 
     explicit SpriteAnimationSet(const std::string& id);
+    SpriteAnimationSet(const std::string& id, const SpriteData& data);
 
     void set_tileset(const Tileset& tileset);
 
@@ -60,6 +62,7 @@ class SpriteAnimationSet {
   private:
 
     void load();
+    void load(const SpriteData& data);
 
     void add_animation(const std::string& animation_name,
         const SpriteAnimationData& animation_data);
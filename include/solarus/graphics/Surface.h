@@ -81,6 +81,15 @@ class Surface: public Drawable {
     static SurfacePtr create(const std::string& file_name,
         ImageDirectory base_directory = DIR_SPRITES, bool premultiplied = false);
 
+    static SDL_Surface_UniquePtr decode_image_file(
+        const std::string& file_name,
+        ImageDirectory base_directory = DIR_SPRITES);
+    static void add_decoded_image(
+        const std::string& file_name,
+        ImageDirectory base_directory,
+        SDL_Surface_UniquePtr surface);
+    static void clear_decoded_images();
+
     int get_width() const;
     int get_height() const;
     virtual Size get_size() const override;
@@ -96,7 +105,7 @@ class Surface: public Drawable {
 
     bool is_pixel_transparent(int index) const;
 
-    std::string get_pixels() const;
+    std::string get_pixels(bool previous_frame = false) const;
     void set_pixels(const std::string& buffer);
 
     void render(SDL_Renderer *&renderer);
@@ -34,6 +34,17 @@ public:
      */
     virtual SDL_Surface* get_surface() const = 0;
 
+    /**
+     * @brief get the pixels as they were at the end of the previous frame
+     *
+     * For callers that can accept one frame of latency, this avoids
+     * waiting for the GPU in the middle of a frame. Surfaces that do
+     * not change return the same pixels as get_surface().
+     *
+     * @return a valid SDL_Surface
+     */
+    virtual SDL_Surface* get_previous_surface() const;
+
     /**
      * @brief get texture width
      * @return width
@@ -65,6 +76,14 @@ public:
      */
     virtual  RenderTexture* to_render_texture() = 0;
 
+    /**
+     * @brief tells if the pixels only change through upload_surface()
+     *
+     * Immutable textures can be copied into a TextureAtlas page.
+     * @return true if nothing is ever drawn on this texture
+     */
+    virtual bool is_immutable() const;
+
     bool is_premultiplied() const;
     void set_premultiplied(bool a_premultiplied);
 private:
@@ -19,10 +19,13 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/Drawable.h"
 #include <map>
 #include <string>
+#include <vector>
 #include <SDL_ttf.h>
 
 namespace Solarus {
@@ -116,9 +119,22 @@ class TextSurface: public Drawable {
 
   private:
 
+    /**
+     * A character of the text, drawn from a glyph atlas.
+     */
+    struct GlyphQuad {
+      SurfacePtr atlas;                               /**< Surface containing the glyph. */
+      Rectangle src_rect;                             /**< Region of the glyph in the atlas. */
+      Point dst_position;                             /**< Position of the glyph relative to the text. */
+    };
+
     void rebuild();
     void rebuild_bitmap();
     void rebuild_ttf();
+    void set_quad(size_t index, const SurfacePtr& atlas,
+        const Rectangle& src_rect, const Point& dst_position);
+    void update_text_position();
+    Surface& get_intermediate_surface() const;
 
     std::string font_id;                              /**< id of the font of the current text surface */
     HorizontalAlignment horizontal_alignment;         /**< horizontal alignment of the current text surface */
@@ -130,8 +146,13 @@ class TextSurface: public Drawable {
     int x;                                            /**< x coordinate of where the text is aligned */
     int y;                                            /**< y coordinate of where the text is aligned */
 
-    SurfacePtr surface;                               /**< the surface to draw */
-    Point text_position;                              /**< position of the top-left corner of the surface on the screen */
+    std::vector<GlyphQuad> quads;                     /**< the characters to draw */
+    mutable SurfacePtr intermediate_surface;          /**< the characters drawn together, used when
+                                                       * they cannot be drawn one by one */
+    mutable bool intermediate_surface_up_to_date = false; /**< whether intermediate_surface shows
+                                                       * the current quads */
+    Size size;                                        /**< size of the text */
+    Point text_position;                              /**< position of the top-left corner of the text on the screen */
 
     std::string text;                                 /**< the string to draw (only one line) */
 
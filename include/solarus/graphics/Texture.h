@@ -14,6 +14,7 @@ class Texture : public SurfaceImpl
 {
 public:
     Texture(SDL_Surface* surface);
+    ~Texture();
     SDL_Texture* get_texture() const override;
     SDL_Surface* get_surface() const override;
 
@@ -21,6 +22,7 @@ public:
     int get_height() const override;
 
     RenderTexture* to_render_texture() override;
+    bool is_immutable() const override;
 private:
     mutable SDL_Surface_UniquePtr surface; /**< cpu side pixels data */
     mutable SDL_Texture_UniquePtr texture; /**< gpu side pixels data */
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "solarus/core/Point.h"
+#include "solarus/graphics/SDLPtrs.h"
+#include "solarus/third_party/shelf-pack.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+class SurfaceImpl;
+
+/**
+ * @brief Shared pages where immutable textures are copied
+ *
+ * Sprite sheets, tilesets and other images loaded from files are packed
+ * in a few large pages with shelf-pack, so that draws from different images
+ * can use the same texture and be submitted as a single vertex stream.
+ *
+ * The original textures are kept: only batched draws sample the pages.
+ * An image is copied into a page the first time it is needed, and its
+ * space is given back when the image is destroyed or its pixels change.
+ */
+class TextureAtlas
+{
+public:
+    static bool find_or_add(const SurfaceImpl& texture, SDL_Texture*& page, Point& position);
+    static void remove(const SurfaceImpl& texture);
+    static void quit();
+
+    static constexpr int page_size = 2048;        /**< width and height of each page */
+    static constexpr int max_image_size = 512;    /**< bigger images keep their own texture */
+    static constexpr size_t max_num_pages = 4;    /**< pages are never created beyond this */
+private:
+    /**
+     * @brief A page texture and the allocator of its space
+     */
+    struct Page {
+      SDL_Texture_UniquePtr texture;  /**< gpu side pixels of all images of the page */
+      mapbox::ShelfPack packer;       /**< free and used regions of the page */
+    };
+
+    /**
+     * @brief Where an image was copied
+     */
+    struct Entry {
+      Page* page;        /**< page of the image */
+      mapbox::Bin* bin;  /**< region of the image in the page */
+    };
+
+    static Page* create_page();
+
+    static std::vector<std::unique_ptr<Page>> pages;             /**< all pages created so far */
+    static std::unordered_map<const SurfaceImpl*, Entry> entries;  /**< images copied in pages */
+};
+
+}
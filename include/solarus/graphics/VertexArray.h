@@ -7,6 +7,7 @@
 #include "solarus/graphics/VertexArrayPtr.h"
 
 #include <memory>
+#include <utility>
 #include <vector>
 #include <glm/vec2.hpp>
 
@@ -95,21 +96,42 @@ public:
     static VertexArrayPtr create(PrimitiveType type,size_t vertex_count);
     void set_primitive_type(PrimitiveType type);
     PrimitiveType get_primitive_type() const;
+    bool is_streaming() const;
+    void set_streaming(bool streaming);
     Vertex* data();
     const Vertex* data() const;
     void add_vertex(const Vertex& v);
+    void clear();
     VerticeView add_quad(const Rectangle& rect, const Rectangle& uvs, const Color &color);
     VerticeView make_view(size_t size);
     size_t vertex_count() const;
     Vertex& operator [](size_t index);
     const Vertex& operator [](size_t index) const;
 private:
+    /**
+     * @brief A buffer object in GPU memory and the number of vertices it can hold
+     */
+    struct Buffer {
+      GLuint id = 0; /**< buffer object, or 0 if not created yet*/
+      size_t capacity = 0; /**< number of vertices allocated in the buffer object*/
+    };
+
+    using Range = std::pair<size_t, size_t>; /**< range of vertex indices [first, second)*/
+
+    static constexpr size_t max_dirty_ranges = 8; /**< above this, dirty ranges are merged into one*/
+
+    void mark_dirty(size_t begin, size_t end) const;
+    Buffer& get_buffer_to_draw() const;
+    bool grow_buffer(Buffer& buffer) const;
+    GLenum get_buffer_usage() const;
+
     std::vector <Vertex> vertices; /**< actual vertices storage*/
-    mutable GLuint vertex_buffer; /**< buffer object where vertices are uploaded in GPU*/
     PrimitiveType type; /**< Primitive type the VertexArray should be drawn with*/
-    mutable bool buffer_dirty = true; /**< dirty bit stating that array needs to be reuploaded*/
+    bool streaming = false; /**< whether vertices change every frame and are uploaded to alternate buffers*/
+    mutable Buffer buffers[2]; /**< buffer objects where vertices are uploaded in GPU, only the first one is used unless streaming*/
+    mutable int current_buffer = 0; /**< index of the buffer drawn last*/
+    mutable std::vector<Range> dirty_ranges; /**< vertices that need to be reuploaded, sorted by modification time*/
 };
 
 
-
 }
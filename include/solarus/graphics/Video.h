@@ -21,10 +21,13 @@
 #include "solarus/core/Point.h"
 #include "solarus/graphics/ShaderPtr.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include <cstdint>
 #include <vector>
 #include <string>
+#include <SDL_blendmode.h>
 
 struct SDL_PixelFormat;
+struct SDL_Rect;
 struct SDL_Renderer;
 struct SDL_Window;
 struct SDL_Renderer;
@@ -34,6 +37,7 @@ struct SDL_PixelFormat;
 namespace Solarus {
 
 class Arguments;
+class Color;
 class Rectangle;
 class Size;
 class SoftwareVideoMode;
@@ -102,6 +106,19 @@ namespace Video {
 
     void render(const SurfacePtr& quest_surface);
 
+    // Renderer state cache.
+    void set_render_target(SDL_Texture* target);
+    void set_render_draw_color(const Color& color);
+    bool set_render_draw_blend_mode(SDL_BlendMode blend_mode);
+    void set_texture_blend_mode(SDL_Texture* texture, SDL_BlendMode blend_mode);
+    void set_texture_alpha_mod(SDL_Texture* texture, uint8_t alpha_mod);
+    void set_texture_color_mod(SDL_Texture* texture, const Color& color_mod);
+    int render_copy(SDL_Texture* texture, const SDL_Rect* src_rect, const SDL_Rect* dst_rect);
+    void notify_texture_destroyed(SDL_Texture* texture);
+    void invalidate_render_state();
+    int get_num_render_target_switches();
+    int get_num_render_copies();
+
 }  // namespace Video
 
 }  // namespace Solarus
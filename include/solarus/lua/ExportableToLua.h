@@ -18,6 +18,7 @@
 #define SOLARUS_EXPORTABLE_TO_LUA_H
 
 #include "solarus/core/Common.h"
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -45,6 +46,8 @@ class ExportableToLua:
     void set_known_to_lua(bool known_to_lua);
     bool is_with_lua_table() const;
     void set_with_lua_table(bool with_lua_table);
+    uint32_t get_event_mask() const;
+    void set_event_mask(uint32_t event_mask);
 
     /**
      * \brief Returns the name identifying this type in Lua.
@@ -61,6 +64,9 @@ class ExportableToLua:
                                   * at least once. */
     bool with_lua_table;         /**< Whether a Lua table was created to make
                                   * this userdata indexable like a table. */
+    uint32_t event_mask;         /**< Engine events defined in the table of
+                                  * this userdata (one bit per
+                                  * LuaContext::TrackedEvent). */
 
 };
 
@@ -37,11 +37,14 @@
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include <lua.hpp>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
+#include <queue>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Solarus {
@@ -138,6 +141,25 @@ class LuaContext {
     static const std::string movement_jump_module_name;
     static const std::string movement_pixel_module_name;
 
+    /**
+     * \brief Engine events that are called very often.
+     *
+     * Whether they are defined on each userdata and on each type metatable
+     * is tracked with bitmasks, so that trying to call them when they are
+     * not defined costs no Lua lookup.
+     */
+    enum class TrackedEvent {
+      ON_UPDATE,
+      ON_SUSPENDED,
+      ON_PRE_DRAW,
+      ON_POST_DRAW,
+      ON_POSITION_CHANGED,
+      ON_OBSTACLE_REACHED,
+      ON_MOVEMENT_CHANGED,
+      ON_FRAME_CHANGED,
+      ON_GROUND_BELOW_CHANGED
+    };
+
     explicit LuaContext(MainLoop& main_loop);
     ~LuaContext();
 
@@ -187,6 +209,8 @@ class LuaContext {
     static bool load_file(lua_State* l, const std::string& script_name);
     static void do_file(lua_State* l, const std::string& script_name);
     static bool do_file_if_exists(lua_State* l, const std::string& script_name);
+    static bool load_compiled_file(lua_State* l, const std::string& script_name);
+    void invalidate_compiled_file(const std::string& script_name);
 
     // Calling Lua functions.
     bool call_function(
@@ -203,6 +227,10 @@ class LuaContext {
         const ExportableToLua& userdata,
         const std::string& key
     ) const;
+    bool userdata_has_field(
+        const ExportableToLua& userdata,
+        TrackedEvent event
+    ) const;
     void notify_userdata_destroyed(ExportableToLua& userdata);
     void userdata_close_lua();
 
@@ -457,12 +485,19 @@ class LuaContext {
       main_api_get_type,
       main_api_get_metatable,
       main_api_get_os,
+      main_api_is_profiler_enabled,
+      main_api_set_profiler_enabled,
+      main_api_get_profile,
+      main_api_save_profile,
+      main_api_get_script_cache_stats,
 
       // Audio API.
       audio_api_get_sound_volume,
       audio_api_set_sound_volume,
       audio_api_play_sound,
       audio_api_preload_sounds,
+      audio_api_get_sound_cache_size,
+      audio_api_set_sound_cache_size,
       audio_api_get_music_volume,
       audio_api_set_music_volume,
       audio_api_play_music,
@@ -493,6 +528,8 @@ class LuaContext {
       video_api_reset_window_size,
       video_api_get_shader,
       video_api_set_shader,
+      video_api_get_tile_cache_size,
+      video_api_set_tile_cache_size,
 
       // Input API.
       input_api_is_joypad_enabled,
@@ -621,6 +658,7 @@ class LuaContext {
       shader_api_get_id,
       shader_api_get_vertex_file,
       shader_api_get_fragment_file,
+      shader_api_get_uniform_handle,
       shader_api_set_uniform,
 
       // Movement API.
@@ -669,6 +707,8 @@ class LuaContext {
       path_finding_movement_api_get_speed,
       path_finding_movement_api_set_speed,
       path_finding_movement_api_get_angle,
+      path_finding_movement_api_get_max_expanded_nodes,
+      path_finding_movement_api_set_max_expanded_nodes,
       circle_movement_api_set_center,
       circle_movement_api_get_radius,
       circle_movement_api_set_radius,
@@ -719,6 +759,7 @@ class LuaContext {
       game_api_start_game_over,
       game_api_stop_game_over,
       game_api_get_map,
+      game_api_preload_map,
       game_api_get_hero,
       game_api_get_value,
       game_api_set_value,
@@ -832,6 +873,9 @@ class LuaContext {
       map_api_get_hero,
       map_api_set_entities_enabled,
       map_api_remove_entities,
+      map_api_is_collision_broad_phase_enabled,
+      map_api_set_collision_broad_phase_enabled,
+      map_api_get_tile_cache_stats,
       map_api_create_entity,  // Same function used for all entity types.
 
       // Map entity API.
@@ -1048,6 +1092,8 @@ class LuaContext {
       userdata_meta_gc,
       userdata_meta_newindex_as_table,
       userdata_meta_index_as_table,
+      // available to all type metatables
+      metatable_meta_newindex,
       // Lua backtrace error function
       l_backtrace;
   private:
@@ -1074,11 +1120,36 @@ class LuaContext {
     struct LuaTimerData {
       ScopedLuaRef callback_ref;  /**< Lua ref of the function to call after the timer. */
       const void* context;        /**< Lua table or userdata the timer is attached to. */
+      bool scheduled;             /**< Whether the timer has an up-to-date entry
+                                   * in the timer schedule. */
+      uint32_t scheduled_date;    /**< Date of this entry. */
+      uint32_t scheduled_order;   /**< Order of this entry. */
     };
 
+    /**
+     * \brief Entry of the timer schedule.
+     */
+    struct ScheduledTimer {
+      uint32_t date;              /**< Date when the timer needs to be updated. */
+      uint32_t order;             /**< Order between entries of the same date. */
+      TimerPtr timer;             /**< The timer to update. */
+
+      bool operator>(const ScheduledTimer& other) const {
+        return date > other.date || (date == other.date && order > other.order);
+      }
+    };
+
+    // Timers.
+    const void* get_timer_context(int context_index) const;
+    void schedule_timer(const TimerPtr& timer);
+    void rebuild_timer_schedule();
+
     // Executing Lua code.
     bool userdata_has_metafield(
         const ExportableToLua& userdata, const char* key) const;
+    void track_metatable_changes();
+    void notify_metatable_field_set(lua_State* l);
+    void notify_metatable_replaced(lua_State* l);
     bool find_method(int index, const char* function_name);
     bool find_method(const char* function_name);
     void print_stack(lua_State* l);
@@ -1341,6 +1412,8 @@ class LuaContext {
     static FunctionExportedToLua
       l_panic,
       l_loader,
+      l_rawset,
+      l_setmetatable,
       l_get_map_entity_or_global,
       l_entity_iterator_next,
       l_named_sprite_iterator_next,
@@ -1384,6 +1457,18 @@ class LuaContext {
                                         * their context and callback. */
     std::list<TimerPtr>
         timers_to_remove;              /**< Timers to be removed at the next cycle. */
+    std::priority_queue<
+        ScheduledTimer,
+        std::vector<ScheduledTimer>,
+        std::greater<ScheduledTimer>
+    > timer_schedule;                  /**< Running timers ordered by the date
+                                        * when they need to be updated.
+                                        * Obsolete entries are skipped. */
+    uint32_t timer_schedule_order;     /**< Order of the next entry
+                                        * added to the timer schedule. */
+    std::unordered_map<const void*, std::vector<TimerPtr>>
+        timers_by_context;             /**< The timers currently running
+                                        * in each context. */
 
     std::set<DrawablePtr>
         drawables;                     /**< All drawable objects created by
@@ -1396,6 +1481,23 @@ class LuaContext {
                                         * userdata with our __newindex. This is
                                         * only for performance, to avoid Lua
                                         * lookups for callbacks like on_update. */
+    std::unordered_map<std::string, uint32_t>
+        metatable_event_masks;         /**< Tracked events that may be defined
+                                        * in each type metatable, by type name.
+                                        * A bit can be set even if the event
+                                        * was removed since. */
+    uint32_t metatable_event_mask;     /**< Tracked events that may be defined
+                                        * in at least one type metatable. */
+    std::unordered_map<std::string, std::string>
+        compiled_chunks;               /**< Bytecode of scripts already compiled,
+                                        * by script name. */
+    int compiled_chunk_hits;           /**< Number of scripts loaded from
+                                        * compiled_chunks. */
+    int compiled_chunk_misses;         /**< Number of scripts compiled from
+                                        * their source file. */
+    uint64_t compiled_chunk_load_time; /**< Time spent loading scripts
+                                        * with load_compiled_file(),
+                                        * in microseconds. */
     std::set<std::string>
         warning_deprecated_functions;  /**< Names of deprecated functions of
                                         * the API for which a warning was emitted. */
@@ -27,6 +27,10 @@ namespace Solarus {
 
 /**
  * \brief Abstract class for data the can be loaded and optionally saved as Lua.
+ *
+ * Some data types can also be stored in a binary format that is faster to
+ * load. When loading a quest file, its binary version is preferred
+ * if it exists.
  */
 class SOLARUS_API LuaData {
 
@@ -37,6 +41,8 @@ class SOLARUS_API LuaData {
 
     virtual bool import_from_lua(lua_State* l) = 0;
     virtual bool export_to_lua(std::ostream& out) const;  // Optional.
+    virtual bool import_from_binary(const std::string& buffer);  // Optional.
+    virtual bool export_to_binary(std::string& buffer) const;  // Optional.
 
     bool import_from_buffer(const std::string& buffer, const std::string& file_name);
     bool import_from_file(const std::string& file_name);
@@ -47,6 +53,9 @@ class SOLARUS_API LuaData {
 
     bool export_to_buffer(std::string& buffer) const;
     bool export_to_file(const std::string& file_name) const;
+    bool export_to_binary_file(const std::string& file_name) const;
+
+    static std::string get_binary_file_name(const std::string& file_name);
 
     static std::string escape_string(std::string value);
     static std::string escape_multiline_string(std::string value);
@@ -58,6 +58,13 @@ bool do_string(
     const std::string& code,
     const std::string& chunk_name
 );
+std::string get_compiled_file_name(const std::string& file_name);
+int load_quest_file(
+    lua_State* l,
+    const std::string& file_name,
+    const std::string& chunk_name,
+    bool language_specific = false
+);
 
 // Error handling.
 template<typename Callable>
@@ -19,9 +19,11 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Point.h"
-#include <list>
-#include <map>
+#include "solarus/entities/EntityPtr.h"
+#include <cstdint>
+#include <queue>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -35,49 +37,61 @@ class Rectangle;
  * In the current implementation, the computed path always corresponds to a
  * shape of 16*16. If the entity to move is bigger, some obstacles may prevent
  * it from following the computed path.
+ *
+ * The search is limited to a square area around the target,
+ * and to a maximum number of expanded nodes.
  */
 class SOLARUS_API PathFinding {
 
   public:
 
+    static constexpr int
+        default_max_expanded_nodes = 1024;  /**< Default search budget. */
+
     PathFinding(
         Map& map,
         Entity& source_entity,
         Entity& target_entity);
 
+    int get_max_expanded_nodes() const;
+    void set_max_expanded_nodes(int max_expanded_nodes);
+
     std::string compute_path();
     std::string compute_path(const Point& offset);
 
   private:
 
     /**
-     * \brief Represents a node in the path to compute.
+     * \brief Entry of the open list.
      *
-     * A node is the location of a 16*16 square of the map.
+     * A node is the location of a 16*16 square of the map, aligned on the
+     * 8*8 grid.
      * The algorithm tries to find the best sequence of nodes leading to the target.
      */
-    class Node {
-
-     public:
-
-      Point location;     /**< location of this node on the map */
-      int index;          /**< index of this node's square on the map (depends on the location) */
+    struct OpenNode {
+      int total_cost;     /**< cost of the best path to this node plus the estimated remaining cost */
+      int order;          /**< insertion order, to prefer recent nodes in case of equal costs */
+      int index;          /**< index of this node's square in the search area */
 
-      // total_cost = previous_cost + heuristic
-      int previous_cost;  /**< cost of the best path that leads to this node */
-      int heuristic;      /**< estimation of the remaining cost to the target */
-      int total_cost;     /**< total cost of this node */
-
-      int parent_index;   /**< index of the square containing the best node leading to this node */
-      char direction;     /**< direction from the parent node to this node (0 to 7) */
+      bool operator<(const OpenNode& other) const;
+    };
 
-      bool operator<(const Node& other) const;
+    /**
+     * \brief Whether the terrain of a square is an obstacle for the entity.
+     */
+    enum class Terrain : uint8_t {
+      UNKNOWN,            /**< not computed yet */
+      TRAVERSABLE,        /**< no obstacle */
+      OBSTACLE,           /**< obstacle */
+      DIAGONAL_WALL       /**< depends on the exact position */
     };
 
+    void initialize_search_area(const Point& target);
     int get_square_index(const Point& location) const;
-    bool is_node_transition_valid(const Node& node, int direction) const;
-    void add_index_sorted(Node* node);
-    std::string rebuild_path(const Node* final_node);
+    Point get_square_location(int index) const;
+    Terrain get_terrain(int index);
+    bool is_node_transition_valid(const Point& location, int direction);
+    std::string rebuild_path(int final_index) const;
 
     static const Point neighbours_locations[];
     static const Rectangle transition_collision_boxes[];
@@ -85,10 +99,22 @@ class SOLARUS_API PathFinding {
     Map& map;                          /**< the map */
     Entity& source_entity;             /**< the entity to move */
     Entity& target_entity;             /**< the target point */
-
-    std::map<int, Node> closed_list;   /**< the closed list, indexed by the node locations on the map */
-    std::map<int, Node> open_list;     /**< the open list, indexed by the node locations on the map */
-    std::list<int> open_list_indices;  /**< indices of the open list elements, sorted by priority */
+    int max_expanded_nodes;            /**< maximum number of nodes to expand before giving up */
+
+    Point search_area_origin;          /**< top-left corner of the search area */
+    std::vector<int> costs;            /**< for each square of the search area, cost of the best path
+                                        * found to it, or -1 */
+    std::vector<char> directions;      /**< for each square, direction from the previous node ('0' to '7'),
+                                        * or ' ' for the starting node */
+    std::vector<bool> closed;          /**< for each square, whether its node is in the closed list */
+    std::vector<Terrain> terrain;      /**< for each square, obstacles of the terrain for the entity */
+    std::vector<bool> entities_squares;/**< for each square, whether it overlaps an entity
+                                        * that may be an obstacle */
+    std::vector<EntityPtr>
+        obstacle_candidates;           /**< entities of the search area that may be obstacles */
+    std::priority_queue<OpenNode>
+        open_list;                     /**< the open list, best node first (may contain
+                                        * obsolete entries of closed nodes) */
 
 };
 
@@ -25,6 +25,23 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HQX_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+/* The AVX2 version is also compiled when GCC or Clang can target AVX2 for a
+ * single function, so that it can be checked against the other versions. */
+#if defined(__AVX2__)
+#define HQX_HAVE_AVX2
+#define HQX_AVX2_TARGET
+#include <immintrin.h>
+#elif defined(HQX_HAVE_SSE2) && defined(__GNUC__)
+#define HQX_HAVE_AVX2
+#define HQX_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
 #define MASK_2     0x0000FF00
 #define MASK_13    0x00FF00FF
 #define MASK_RGB   0x00FFFFFF
@@ -48,9 +65,9 @@ static inline uint32_t rgb_to_yuv(uint32_t c)
 
 /* Test if there is difference in color */
 static inline int yuv_diff(uint32_t yuv1, uint32_t yuv2) {
-    return (( abs((yuv1 & Ymask) - (yuv2 & Ymask)) > trY ) ||
-            ( abs((yuv1 & Umask) - (yuv2 & Umask)) > trU ) ||
-            ( abs((yuv1 & Vmask) - (yuv2 & Vmask)) > trV ) );
+    return (( abs((int) (yuv1 & Ymask) - (int) (yuv2 & Ymask)) > trY ) ||
+            ( abs((int) (yuv1 & Umask) - (int) (yuv2 & Umask)) > trU ) ||
+            ( abs((int) (yuv1 & Vmask) - (int) (yuv2 & Vmask)) > trV ) );
 }
 
 static inline int Diff(uint32_t c1, uint32_t c2)
@@ -58,6 +75,108 @@ static inline int Diff(uint32_t c1, uint32_t c2)
     return yuv_diff(rgb_to_yuv(c1), rgb_to_yuv(c2));
 }
 
+/* Compute the pattern of the 3x3 block w[1..9]: one bit per neighbor of w[5]
+ * (in the order 1, 2, 3, 4, 6, 7, 8, 9) that differs from it in color.
+ * All versions give the same result. The SIMD ones compare the 8 neighbors
+ * at once. yuv_table is RGBtoYUV except when testing. */
+static inline int hqx_pattern_scalar(const uint32_t *yuv_table, const uint32_t *w)
+{
+    int pattern = 0;
+    int flag = 1;
+    int k;
+    const uint32_t yuv1 = yuv_table[MASK_RGB & w[5]];
+
+    for (k=1; k<=9; k++)
+    {
+        if (k==5) continue;
+
+        if ( w[k] != w[5] )
+        {
+            if (yuv_diff(yuv1, yuv_table[MASK_RGB & w[k]]))
+                pattern |= flag;
+        }
+        flag <<= 1;
+    }
+    return pattern;
+}
+
+#if defined(HQX_HAVE_SSE2)
+/* SSE2 has no _mm_abs_epi32. */
+static inline __m128i hqx_abs_sub_epi32(__m128i a, __m128i b)
+{
+    const __m128i d = _mm_sub_epi32(a, b);
+    const __m128i sign = _mm_srai_epi32(d, 31);
+    return _mm_sub_epi32(_mm_xor_si128(d, sign), sign);
+}
+
+static inline int hqx_diff_mask(__m128i yuv1, __m128i yuv2)
+{
+    const __m128i y_mask = _mm_set1_epi32(Ymask);
+    const __m128i u_mask = _mm_set1_epi32(Umask);
+    const __m128i v_mask = _mm_set1_epi32(Vmask);
+    const __m128i dy = hqx_abs_sub_epi32(_mm_and_si128(yuv1, y_mask), _mm_and_si128(yuv2, y_mask));
+    const __m128i du = hqx_abs_sub_epi32(_mm_and_si128(yuv1, u_mask), _mm_and_si128(yuv2, u_mask));
+    const __m128i dv = hqx_abs_sub_epi32(_mm_and_si128(yuv1, v_mask), _mm_and_si128(yuv2, v_mask));
+    const __m128i diff = _mm_or_si128(
+            _mm_cmpgt_epi32(dy, _mm_set1_epi32(trY)),
+            _mm_or_si128(_mm_cmpgt_epi32(du, _mm_set1_epi32(trU)),
+                         _mm_cmpgt_epi32(dv, _mm_set1_epi32(trV))));
+    return _mm_movemask_ps(_mm_castsi128_ps(diff));
+}
+
+static inline int hqx_pattern_sse2(const uint32_t *yuv_table, const uint32_t *w)
+{
+    /* Neighbors equal to the center (flat areas) don't need a lookup. */
+    const uint32_t yuv5 = yuv_table[MASK_RGB & w[5]];
+#define HQX_YUV(k) (int) (w[k] == w[5] ? yuv5 : yuv_table[MASK_RGB & w[k]])
+    const __m128i yuv1 = _mm_set1_epi32((int) yuv5);
+    const __m128i yuv_low = _mm_setr_epi32(HQX_YUV(1), HQX_YUV(2), HQX_YUV(3), HQX_YUV(4));
+    const __m128i yuv_high = _mm_setr_epi32(HQX_YUV(6), HQX_YUV(7), HQX_YUV(8), HQX_YUV(9));
+#undef HQX_YUV
+    return hqx_diff_mask(yuv1, yuv_low) | (hqx_diff_mask(yuv1, yuv_high) << 4);
+}
+#endif
+
+#if defined(HQX_HAVE_AVX2)
+/* Only call this one if the CPU supports AVX2. */
+static inline HQX_AVX2_TARGET int hqx_pattern_avx2(const uint32_t *yuv_table, const uint32_t *w)
+{
+    const __m256i yuv1 = _mm256_set1_epi32((int) yuv_table[MASK_RGB & w[5]]);
+    const __m256i rgb = _mm256_and_si256(
+            _mm256_setr_epi32((int) w[1], (int) w[2], (int) w[3], (int) w[4],
+                              (int) w[6], (int) w[7], (int) w[8], (int) w[9]),
+            _mm256_set1_epi32(MASK_RGB));
+    const __m256i yuv2 = _mm256_i32gather_epi32((const int *) yuv_table, rgb, 4);
+
+    const __m256i y_mask = _mm256_set1_epi32(Ymask);
+    const __m256i u_mask = _mm256_set1_epi32(Umask);
+    const __m256i v_mask = _mm256_set1_epi32(Vmask);
+    const __m256i dy = _mm256_abs_epi32(_mm256_sub_epi32(
+            _mm256_and_si256(yuv1, y_mask), _mm256_and_si256(yuv2, y_mask)));
+    const __m256i du = _mm256_abs_epi32(_mm256_sub_epi32(
+            _mm256_and_si256(yuv1, u_mask), _mm256_and_si256(yuv2, u_mask)));
+    const __m256i dv = _mm256_abs_epi32(_mm256_sub_epi32(
+            _mm256_and_si256(yuv1, v_mask), _mm256_and_si256(yuv2, v_mask)));
+    const __m256i diff = _mm256_or_si256(
+            _mm256_cmpgt_epi32(dy, _mm256_set1_epi32(trY)),
+            _mm256_or_si256(_mm256_cmpgt_epi32(du, _mm256_set1_epi32(trU)),
+                            _mm256_cmpgt_epi32(dv, _mm256_set1_epi32(trV))));
+    return _mm256_movemask_ps(_mm256_castsi256_ps(diff));
+}
+#endif
+
+/* The version used by the filters is chosen at compile time. */
+static inline int hqx_pattern(const uint32_t *w)
+{
+#if defined(__AVX2__)
+    return hqx_pattern_avx2(RGBtoYUV, w);
+#elif defined(HQX_HAVE_SSE2)
+    return hqx_pattern_sse2(RGBtoYUV, w);
+#else
+    return hqx_pattern_scalar(RGBtoYUV, w);
+#endif
+}
+
 /* Interpolate functions */
 static inline uint32_t Interpolate_2(uint32_t c1, int w1, uint32_t c2, int w2, int s)
 {
@@ -33,6 +33,7 @@ constexpr int Music::nb_buffers;
 std::unique_ptr<SpcDecoder> Music::spc_decoder = nullptr;
 std::unique_ptr<ItDecoder> Music::it_decoder = nullptr;
 std::unique_ptr<OggDecoder> Music::ogg_decoder = nullptr;
+std::mutex Music::decoder_mutex;
 float Music::volume = 1.0;
 std::unique_ptr<Music> Music::current_music = nullptr;
 
@@ -57,7 +58,11 @@ Music::Music():
   format(NO_FORMAT),
   loop(false),
   callback_ref(),
-  source(AL_NONE) {
+  source(AL_NONE),
+  first_ready_chunk(0),
+  nb_ready_chunks(0),
+  end_of_stream(false),
+  decoding_stopped(false) {
 
   for (int i = 0; i < nb_buffers; i++) {
     buffers[i] = AL_NONE;
@@ -80,7 +85,11 @@ Music::Music(
   format(OGG),
   loop(loop),
   callback_ref(callback_ref),
-  source(AL_NONE) {
+  source(AL_NONE),
+  first_ready_chunk(0),
+  nb_ready_chunks(0),
+  end_of_stream(false),
+  decoding_stopped(false) {
 
   Debug::check_assertion(!loop || callback_ref.is_empty(),
       "Attempt to set both a loop and a callback to music"
@@ -91,6 +100,16 @@ Music::Music(
   }
 }
 
+/**
+ * \brief Destroys this music.
+ *
+ * Waits for the decoding thread if it is still running.
+ */
+Music::~Music() {
+
+  stop_decoding_thread();
+}
+
 /**
  * \brief Initializes the music system.
  */
@@ -175,6 +194,7 @@ int Music::get_num_channels() {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   return it_decoder->get_num_channels();
 }
 
@@ -191,6 +211,7 @@ int Music::get_channel_volume(int channel) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   return it_decoder->get_channel_volume(channel);
 }
 
@@ -207,6 +228,7 @@ void Music::set_channel_volume(int channel, int volume) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   it_decoder->set_channel_volume(channel, volume);
 }
 
@@ -222,6 +244,7 @@ int Music::get_tempo() {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   return it_decoder->get_tempo();
 }
 
@@ -237,6 +260,7 @@ void Music::set_tempo(int tempo) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   it_decoder->set_tempo(tempo);
 }
 
@@ -384,7 +408,9 @@ void Music::update() {
 /**
  * \brief Updates this music when it is playing.
  *
- * This function handles the double buffering.
+ * This function handles the streaming: buffers already played are given
+ * back the chunks decoded in the meantime by the decoding thread.
+ * No decoding happens here.
  *
  * \return \c true if the music keeps playing, \c false if the end is reached.
  */
@@ -393,106 +419,209 @@ bool Music::update_playing() {
   // Get the empty buffers.
   ALint nb_empty;
   alGetSourcei(source, AL_BUFFERS_PROCESSED, &nb_empty);
-
-  // Refill them.
   for (int i = 0; i < nb_empty; i++) {
     ALuint buffer;
     alSourceUnqueueBuffers(source, 1, &buffer);  // Unqueue the buffer.
+    free_buffers.push_back(buffer);
+  }
 
-    // Fill it by decoding more data.
-    switch (format) {
-
-      case SPC:
-        decode_spc(buffer, 16384);
-        break;
-
-      case IT:
-        decode_it(buffer, 16384);
-        break;
-
-      case OGG:
-        decode_ogg(buffer, 16384);
-        break;
-
-      case NO_FORMAT:
-        Debug::die("Invalid music format");
-        break;
-    }
-
-    alSourceQueueBuffers(source, 1, &buffer);  // Queue it again.
+  // Refill them with the data decoded so far.
+  while (!free_buffers.empty() && queue_decoded_chunk(free_buffers.back())) {
+    free_buffers.pop_back();
   }
 
   // Check whether there is still something playing.
+  ALint nb_queued;
+  alGetSourcei(source, AL_BUFFERS_QUEUED, &nb_queued);
   ALint status;
   alGetSourcei(source, AL_SOURCE_STATE, &status);
-  if (status != AL_PLAYING) {
-    // The end of the file is reached, or we need to decode more data.
+  if (status == AL_PLAYING) {
+    return true;
+  }
+
+  if (nb_queued > 0) {
+    // The decoding thread was late: resume now that there is data.
     alSourcePlay(source);
+    return true;
   }
 
-  alGetSourcei(source, AL_SOURCE_STATE, &status);
-  return status == AL_PLAYING;
+  // Nothing left to play: this is the end if the decoding is finished too.
+  return !end_of_stream;
 }
 
 /**
- * \brief Decodes a chunk of SPC data into PCM data for the current music.
- * \param destination_buffer the destination buffer to write
- * \param nb_samples number of samples to write
+ * \brief Gives the oldest decoded chunk to an OpenAL buffer and queues it.
+ *
+ * Must be called from the main thread.
+ *
+ * \param buffer The OpenAL buffer to fill.
+ * \return \c true if the buffer was filled and queued, \c false if
+ * there is no decoded chunk ready or if the end of the music is reached.
  */
-void Music::decode_spc(ALuint destination_buffer, ALsizei nb_samples) {
+bool Music::queue_decoded_chunk(ALuint buffer) {
 
-  // decode the SPC data
-  std::vector<ALushort> raw_data(nb_samples);
-  spc_decoder->decode((int16_t*) raw_data.data(), nb_samples);
+  std::lock_guard<std::mutex> lock(chunks_mutex);
 
-  // put this decoded data into the buffer
-  alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), nb_samples * 2, 32000);
+  if (nb_ready_chunks == 0) {
+    return false;
+  }
 
+  DecodedChunk& chunk = decoded_chunks[first_ready_chunk];
+  if (!chunk.error.empty()) {
+    Debug::error("Error in music file '" + file_name + "': " + chunk.error);
+    chunk.error.clear();
+  }
+  if (chunk.size == 0) {
+    // The decoding thread stopped after this chunk.
+    end_of_stream = true;
+    return false;
+  }
+
+  // Put this decoded data into the buffer.
+  alBufferData(buffer, chunk.al_format, chunk.data.data(), chunk.size, chunk.frequency);
   int error = alGetError();
   if (error != AL_NO_ERROR) {
     std::ostringstream oss;
-    oss << "Failed to fill the audio buffer with decoded SPC data for music file '"
-      << file_name << ": error " << error;
+    oss << "Failed to fill the audio buffer with decoded data for music file '"
+        << file_name << "': error " << error;
     Debug::error(oss.str());
   }
+
+  first_ready_chunk = (first_ready_chunk + 1) % nb_decoded_chunks;
+  --nb_ready_chunks;
+  chunks_condition.notify_one();
+
+  alSourceQueueBuffers(source, 1, &buffer);
+  return true;
 }
 
 /**
- * \brief Decodes a chunk of IT data into PCM data for the current music.
- * \param destination_buffer the destination buffer to write
- * \param nb_samples number of samples to write
+ * \brief Starts the thread that decodes this music in advance.
+ *
+ * The decoder of the music format must already be loaded.
  */
-void Music::decode_it(ALuint destination_buffer, ALsizei nb_samples) {
+void Music::start_decoding_thread() {
+
+  first_ready_chunk = 0;
+  nb_ready_chunks = 0;
+  end_of_stream = false;
+  decoding_stopped = false;
+  decoding_thread = std::thread([this]() {
+    decoding_thread_loop();
+  });
+}
 
-  // Decode the IT data.
-  std::vector<ALushort> raw_data(nb_samples);
-  int bytes_read = it_decoder->decode(raw_data.data(), nb_samples);
+/**
+ * \brief Stops the decoding thread if it is running and waits for it.
+ */
+void Music::stop_decoding_thread() {
 
-  if (bytes_read == 0) {
-    // End of file.
-    alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), 0, 44100);
+  if (!decoding_thread.joinable()) {
+    return;
   }
-  else {
-    // Put this decoded data into the buffer.
-    alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), nb_samples, 44100);
+
+  {
+    std::lock_guard<std::mutex> lock(chunks_mutex);
+    decoding_stopped = true;
   }
-  int error = alGetError();
-  if (error != AL_NO_ERROR) {
-    std::ostringstream oss;
-    oss << "Failed to fill the audio buffer with decoded IT data for music file '"
-        << file_name << ": error " << error;
-    Debug::error(oss.str());
+  chunks_condition.notify_one();
+  decoding_thread.join();
+}
+
+/**
+ * \brief Body of the decoding thread.
+ *
+ * Fills the free chunks of the ring until the end of the music is reached
+ * or until the thread is asked to stop.
+ * Does not call OpenAL or Lua, and errors are reported later by the main
+ * thread.
+ */
+void Music::decoding_thread_loop() {
+
+  std::unique_lock<std::mutex> lock(chunks_mutex);
+  while (true) {
+    chunks_condition.wait(lock, [this]() {
+      return decoding_stopped || nb_ready_chunks < nb_decoded_chunks;
+    });
+    if (decoding_stopped) {
+      return;
+    }
+
+    // The free chunk after the ready ones is only accessed by this thread.
+    DecodedChunk& chunk = decoded_chunks[(first_ready_chunk + nb_ready_chunks) % nb_decoded_chunks];
+    lock.unlock();
+
+    {
+      std::lock_guard<std::mutex> decoder_lock(decoder_mutex);
+      switch (format) {
+
+        case SPC:
+          decode_spc(chunk, 16384);
+          break;
+
+        case IT:
+          decode_it(chunk, 16384);
+          break;
+
+        case OGG:
+          decode_ogg(chunk, 16384);
+          break;
+
+        case NO_FORMAT:
+          chunk.size = 0;
+          break;
+      }
+    }
+
+    lock.lock();
+    ++nb_ready_chunks;
+    if (chunk.size == 0) {
+      // End of the music.
+      return;
+    }
   }
 }
 
+/**
+ * \brief Decodes a chunk of SPC data into PCM data for the current music.
+ * \param chunk The chunk to fill.
+ * \param nb_samples number of samples to write
+ */
+void Music::decode_spc(DecodedChunk& chunk, ALsizei nb_samples) {
+
+  chunk.data.resize(nb_samples);
+  spc_decoder->decode(chunk.data.data(), nb_samples);
+  chunk.size = nb_samples * 2;
+  chunk.al_format = AL_FORMAT_STEREO16;
+  chunk.frequency = 32000;
+}
+
+/**
+ * \brief Decodes a chunk of IT data into PCM data for the current music.
+ * \param chunk The chunk to fill.
+ * \param nb_samples number of samples to write
+ */
+void Music::decode_it(DecodedChunk& chunk, ALsizei nb_samples) {
+
+  chunk.data.resize(nb_samples);
+  int bytes_read = it_decoder->decode(chunk.data.data(), nb_samples);
+
+  // 0 bytes read means the end of file.
+  chunk.size = bytes_read == 0 ? 0 : nb_samples;
+  chunk.al_format = AL_FORMAT_STEREO16;
+  chunk.frequency = 44100;
+}
+
 /**
  * \brief Decodes a chunk of OGG data into PCM data for the current music.
- * \param destination_buffer The destination buffer to write.
+ * \param chunk The chunk to fill.
  * \param nb_samples Number of samples to write.
  */
-void Music::decode_ogg(ALuint destination_buffer, ALsizei nb_samples) {
+void Music::decode_ogg(DecodedChunk& chunk, ALsizei nb_samples) {
 
-  ogg_decoder->decode(destination_buffer, nb_samples);
+  chunk.size = ogg_decoder->decode(chunk.data, nb_samples, chunk.error);
+  chunk.al_format = ogg_decoder->get_al_format();
+  chunk.frequency = ogg_decoder->get_sample_rate();
 }
 
 /**
@@ -538,9 +667,6 @@ bool Music::start() {
       // Give the SPC data into the SPC decoder.
       spc_decoder->load((int16_t*) sound_buffer.data(), sound_buffer.size());
 
-      for (int i = 0; i < nb_buffers; i++) {
-        decode_spc(buffers[i], 16384);
-      }
       break;
 
     case IT:
@@ -550,9 +676,6 @@ bool Music::start() {
       // Give the IT data to the IT decoder
       it_decoder->load(sound_buffer);
 
-      for (int i = 0; i < nb_buffers; i++) {
-        decode_it(buffers[i], 16384);
-      }
       break;
 
     case OGG:
@@ -561,11 +684,6 @@ bool Music::start() {
 
       // Give the OGG data to the OGG decoder.
       success = ogg_decoder->load(std::move(sound_buffer), this->loop);
-      if (success) {
-        for (int i = 0; i < nb_buffers; i++) {
-          decode_ogg(buffers[i], 16384);
-        }
-      }
       break;
 
     case NO_FORMAT:
@@ -577,8 +695,6 @@ bool Music::start() {
     Debug::error("Cannot load music file '" + file_name + "'");
   }
 
-  // start the streaming
-  alSourceQueueBuffers(source, nb_buffers, buffers);
   int error = alGetError();
   if (error != AL_NO_ERROR) {
     std::ostringstream oss;
@@ -588,9 +704,12 @@ bool Music::start() {
     success = false;
   }
 
-  alSourcePlay(source);
-
-  // The update() function will then take care of filling the buffers
+  if (success) {
+    // Start the streaming: the decoding thread fills the chunks and the
+    // update() function gives them to the buffers and starts the source.
+    free_buffers.assign(buffers, buffers + nb_buffers);
+    start_decoding_thread();
+  }
 
   return success;
 }
@@ -609,6 +728,9 @@ void Music::stop() {
   // Release the callback if any.
   callback_ref.clear();
 
+  // Stop decoding before touching the decoder.
+  stop_decoding_thread();
+
   // empty the source
   alSourceStop(source);
 
@@ -625,6 +747,7 @@ void Music::stop() {
 
   // delete the buffers
   alDeleteBuffers(nb_buffers, buffers);
+  free_buffers.clear();
 
   switch (format) {
 
@@ -110,32 +110,67 @@ void OggDecoder::unload() {
 }
 
 /**
- * \brief Decodes a chunk of the previously loaded OGG data into PCM data
- * and plays it.
- * \param decoded_data Pointer to where you want the decoded data to be written.
+ * \brief Returns the OpenAL format of the decoded data.
+ * \return The OpenAL format, or AL_NONE if no supported music is loaded.
+ */
+ALenum OggDecoder::get_al_format() const {
+
+  if (ogg_info == nullptr) {
+    return AL_NONE;
+  }
+
+  if (ogg_info->channels == 1) {
+    return AL_FORMAT_MONO16;
+  }
+  if (ogg_info->channels == 2) {
+    return AL_FORMAT_STEREO16;
+  }
+  return AL_NONE;
+}
+
+/**
+ * \brief Returns the sample rate of the decoded data.
+ * \return The sample rate in Hz, or 0 if no music is loaded.
+ */
+ALsizei OggDecoder::get_sample_rate() const {
+
+  if (ogg_info == nullptr) {
+    return 0;
+  }
+
+  return ALsizei(ogg_info->rate);
+}
+
+/**
+ * \brief Decodes a chunk of the previously loaded OGG data into PCM data.
+ *
+ * This function does not use OpenAL and does not report errors itself,
+ * so that it can be called from the music decoding thread.
+ *
+ * \param decoded_data Where to write the decoded data.
+ * It is resized if necessary.
  * \param nb_samples Number of samples to write.
+ * \param error Set to an error message in case of error.
+ * \return Number of bytes decoded. 0 means the end of the music
+ * or an error.
  */
-void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
+ALsizei OggDecoder::decode(
+    std::vector<ALshort>& decoded_data,
+    ALsizei nb_samples,
+    std::string& error
+) {
 
   if (ogg_info == nullptr) {
-    return;
+    return 0;
   }
 
   // Read the encoded music properties.
   const int num_channels = ogg_info->channels;
-  ALsizei sample_rate = ALsizei(ogg_info->rate);
-  ALenum al_format = AL_NONE;
-  if (num_channels == 1) {
-    al_format = AL_FORMAT_MONO16;
-  }
-  else if (num_channels == 2) {
-    al_format = AL_FORMAT_STEREO16;
-  }
 
   const ogg_int64_t loop_end_byte = loop_end_pcm * num_channels * sizeof(ALshort);
 
   // Decode the OGG data.
-  std::vector<ALshort> raw_data(nb_samples * num_channels);
+  decoded_data.resize(nb_samples * num_channels);
   int bitstream = 0;
   long bytes_read = 0;
   long total_bytes_read = 0;
@@ -154,7 +189,7 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
 
     bytes_read = ov_read(
         ogg_file.get(),
-        ((char*) raw_data.data()) + total_bytes_read,
+        ((char*) decoded_data.data()) + total_bytes_read,
         max_bytes_to_read,
         0,
         2,
@@ -166,8 +201,8 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
       if (bytes_read != OV_HOLE) { // OV_HOLE is normal when the music loops
         std::ostringstream oss;
         oss << "Error while decoding ogg chunk: " << bytes_read;
-        Debug::error(oss.str());
-        return;
+        error = oss.str();
+        return 0;
       }
     }
     else {
@@ -180,26 +215,18 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
       if (loop_end_pcm != -1 &&
           loop_start_pcm != -1 &&
           current_pcm == loop_end_pcm) {
-        int error = ov_pcm_seek(ogg_file.get(), loop_start_pcm);
-        if (error != 0) {
+        int seek_error = ov_pcm_seek(ogg_file.get(), loop_start_pcm);
+        if (seek_error != 0) {
           std::ostringstream oss;
-          oss << "Failed to loop in OGG file: error " << error;
-          Debug::error(oss.str());
+          oss << "Failed to loop in OGG file: error " << seek_error;
+          error = oss.str();
         }
       }
     }
   }
   while (remaining_bytes > 0 && bytes_read > 0);
 
-  // Put this decoded data into the buffer.
-  alBufferData(destination_buffer, al_format, raw_data.data(), ALsizei(total_bytes_read), sample_rate);
-
-  int error = alGetError();
-  if (error != AL_NO_ERROR) {
-    std::ostringstream oss;
-    oss << "Failed to fill the audio buffer with decoded OGG data: error " << error;
-    Debug::error(oss.str());
-  }
+  return ALsizei(total_bytes_read);
 }
 
 }
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <cstring>  // memcpy
 #include <sstream>
+#include <thread>
 #include "solarus/core/Arguments.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
@@ -36,6 +37,9 @@ bool Sound::sounds_preloaded = false;
 float Sound::volume = 1.0;
 std::list<Sound*> Sound::current_sounds;
 std::map<std::string, Sound> Sound::all_sounds;
+constexpr int Sound::default_cache_size;
+SoundCache Sound::cache(Sound::default_cache_size);
+SoundDecoder Sound::decoder;
 
 namespace {
 
@@ -147,7 +151,10 @@ Sound::Sound():
  */
 Sound::Sound(const std::string& sound_id):
   id(sound_id),
-  buffer(AL_NONE) {
+  buffer(AL_NONE),
+  buffer_size(0),
+  loading_state(LoadingState::UNLOADED),
+  play_when_loaded(false) {
 
 }
 
@@ -156,16 +163,8 @@ Sound::Sound(const std::string& sound_id):
  */
 Sound::~Sound() {
 
-  if (is_initialized() && buffer != AL_NONE) {
-
-    // stop the sources where this buffer is attached
-    for (ALuint source: sources) {
-      alSourceStop(source);
-      alSourcei(source, AL_BUFFER, 0);
-      alDeleteSources(1, &source);
-    }
-    alDeleteBuffers(1, &buffer);
-    current_sounds.remove(this);
+  if (is_initialized()) {
+    unload();
   }
 }
 
@@ -212,6 +211,8 @@ void Sound::initialize(const Arguments& args) {
 
   initialized = true;
   set_volume(100);
+  const int num_threads = int(std::max(1u, std::min(2u, std::thread::hardware_concurrency() / 2)));
+  decoder.start(num_threads);
 
   // initialize the music system
   Music::initialize();
@@ -230,6 +231,7 @@ void Sound::quit() {
     Music::quit();
 
     // clear the sounds
+    decoder.stop();
     all_sounds.clear();
 
     // uninitialize OpenAL
@@ -254,7 +256,10 @@ bool Sound::is_initialized() {
 }
 
 /**
- * \brief Loads and decodes all sounds listed in the game database.
+ * \brief Starts decoding all sounds listed in the game database.
+ *
+ * Sounds are decoded in the background and are subject to the size of the
+ * cache: if they don't fit, the least recently played ones are unloaded.
  */
 void Sound::load_all() {
 
@@ -263,16 +268,34 @@ void Sound::load_all() {
     const std::map<std::string, std::string>& sound_elements =
         CurrentQuest::get_resources(ResourceType::SOUND);
     for (const auto& kvp: sound_elements) {
-      const std::string& sound_id = kvp.first;
-
-      all_sounds[sound_id] = Sound(sound_id);
-      all_sounds[sound_id].load();
+      preload(kvp.first);
     }
 
     sounds_preloaded = true;
   }
 }
 
+/**
+ * \brief Starts decoding a sound in the background if it is not decoded yet.
+ *
+ * Use this function before playing a sound for the first time to avoid
+ * a delay.
+ *
+ * \param sound_id Id of the sound to decode.
+ */
+void Sound::preload(const std::string& sound_id) {
+
+  if (!is_initialized()) {
+    return;
+  }
+
+  if (all_sounds.find(sound_id) == all_sounds.end()) {
+    all_sounds[sound_id] = Sound(sound_id);
+  }
+
+  all_sounds[sound_id].load();
+}
+
 /**
  * \brief Returns whether a sound exists.
  * \param sound_id id of the sound to test
@@ -318,6 +341,31 @@ void Sound::set_volume(int volume) {
   Logger::info(std::string("Sound volume: ") + String::to_string(get_volume()));
 }
 
+/**
+ * \brief Returns the maximum size of decoded sounds kept in memory.
+ * \return The size of the sound cache in bytes.
+ */
+int Sound::get_cache_size() {
+
+  return int(cache.get_max_size());
+}
+
+/**
+ * \brief Sets the maximum size of decoded sounds kept in memory.
+ *
+ * When the cache is full, the least recently played sounds are unloaded.
+ * Sounds currently playing are never unloaded.
+ *
+ * \param cache_size The size of the sound cache in bytes.
+ */
+void Sound::set_cache_size(int cache_size) {
+
+  Debug::check_assertion(cache_size >= 0, "Invalid sound cache size");
+
+  cache.set_max_size(size_t(cache_size));
+  shrink_cache();
+}
+
 /**
  * \brief Updates the audio (music and sound) system.
  *
@@ -337,6 +385,9 @@ void Sound::update() {
     current_sounds.remove(sound);
   }
 
+  // Give the sounds decoded in the meantime to OpenAL.
+  update_decoded_sounds();
+
   // also update the music
   Music::update();
 }
@@ -366,185 +417,224 @@ bool Sound::update_playing() {
 }
 
 /**
- * \brief Loads and decodes the sound into memory.
+ * \brief Starts decoding this sound in the background.
+ *
+ * Does nothing if the sound is already decoded or being decoded.
  */
 void Sound::load() {
 
-  if (alGetError() != AL_NONE) {
-    Debug::error("Previous audio error not cleaned");
+  if (!is_initialized() || loading_state != LoadingState::UNLOADED) {
+    return;
+  }
+
+  loading_state = LoadingState::LOADING;
+  decoder.request(id, false);
+}
+
+/**
+ * \brief Unloads the decoded data of this sound.
+ *
+ * The sources playing it are stopped.
+ */
+void Sound::unload() {
+
+  if (loading_state != LoadingState::LOADED) {
+    return;
   }
 
-  std::string file_name = std::string("sounds/" + id);
-  if (id.find(".") == std::string::npos) {
-    file_name += ".ogg";
+  // stop the sources where this buffer is attached
+  for (ALuint source: sources) {
+    alSourceStop(source);
+    alSourcei(source, AL_BUFFER, 0);
+    alDeleteSources(1, &source);
   }
+  sources.clear();
+  current_sounds.remove(this);
 
-  // Create an OpenAL buffer with the sound decoded by the library.
-  buffer = decode_file(file_name);
+  alDeleteBuffers(1, &buffer);
+  buffer = AL_NONE;
 
-  // buffer is now AL_NONE if there was an error.
+  cache.remove(id);
+  buffer_size = 0;
+  loading_state = LoadingState::UNLOADED;
+}
+
+/**
+ * \brief Marks this sound as the most recently played one of the cache.
+ */
+void Sound::touch() {
+
+  if (loading_state == LoadingState::LOADED) {
+    cache.touch(id);
+  }
 }
 
 /**
  * \brief Plays the sound.
- * \return true if the sound was loaded successfully, false otherwise
+ *
+ * If the sound is not decoded yet, it is decoded in priority and played
+ * as soon as it is ready.
+ *
+ * \return true if the sound was played or will be played, false otherwise
  */
 bool Sound::start() {
 
+  if (!is_initialized()) {
+    return false;
+  }
+
+  if (loading_state == LoadingState::LOADED) {
+    return play_source();
+  }
+
+  play_when_loaded = true;
+  if (loading_state == LoadingState::UNLOADED) {
+    loading_state = LoadingState::LOADING;
+    decoder.request(id, true);
+  }
+  else {
+    // Already waiting: move it to the front of the queue.
+    decoder.make_urgent(id);
+  }
+  return true;
+}
+
+/**
+ * \brief Plays the decoded data of this sound in a new source.
+ * \return true if the sound is playing, false in case of error.
+ */
+bool Sound::play_source() {
+
   bool success = false;
 
-  if (is_initialized()) {
+  // create a source
+  ALuint source;
+  alGenSources(1, &source);
+  alSourcei(source, AL_BUFFER, buffer);
+  alSourcef(source, AL_GAIN, volume);
 
-    if (buffer == AL_NONE) { // first time: load and decode the file
-      load();
+  // play the sound
+  int error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::ostringstream oss;
+    oss << "Cannot attach buffer " << buffer
+        << " to the source to play sound '" << id << "': error " << error;
+    Debug::error(oss.str());
+    alDeleteSources(1, &source);
+  }
+  else {
+    sources.push_back(source);
+    current_sounds.remove(this); // to avoid duplicates
+    current_sounds.push_back(this);
+    touch();
+    alSourcePlay(source);
+    error = alGetError();
+    if (error != AL_NO_ERROR) {
+      std::ostringstream oss;
+      oss << "Cannot play sound '" << id << "': error " << error;
+      Debug::error(oss.str());
     }
-
-    if (buffer != AL_NONE) {
-
-      // create a source
-      ALuint source;
-      alGenSources(1, &source);
-      alSourcei(source, AL_BUFFER, buffer);
-      alSourcef(source, AL_GAIN, volume);
-
-      // play the sound
-      int error = alGetError();
-      if (error != AL_NO_ERROR) {
-        std::ostringstream oss;
-        oss << "Cannot attach buffer " << buffer
-            << " to the source to play sound '" << id << "': error " << error;
-        Debug::error(oss.str());
-        alDeleteSources(1, &source);
-      }
-      else {
-        sources.push_back(source);
-        current_sounds.remove(this); // to avoid duplicates
-        current_sounds.push_back(this);
-        alSourcePlay(source);
-        error = alGetError();
-        if (error != AL_NO_ERROR) {
-          std::ostringstream oss;
-          oss << "Cannot play sound '" << id << "': error " << error;
-          Debug::error(oss.str());
-        }
-        else {
-          success = true;
-        }
-      }
+    else {
+      success = true;
     }
   }
   return success;
 }
 
 /**
- * \brief Loads the specified sound file and decodes its content into an OpenAL buffer.
- * \param file_name name of the file to open
- * \return the buffer created, or AL_NONE if the sound could not be loaded
+ * \brief Copies the data decoded by a decoding thread into an OpenAL buffer.
+ *
+ * Plays the sound if it was requested in the meantime.
+ *
+ * \param decoded_sound The decoded data of this sound.
  */
-ALuint Sound::decode_file(const std::string& file_name) {
-
-  ALuint buffer = AL_NONE;
+void Sound::set_decoded_data(const SoundDecoder::DecodedSound& decoded_sound) {
 
-  if (!QuestFiles::data_file_exists(file_name)) {
-    Debug::error(std::string("Cannot find sound file '") + file_name + "'");
-    return AL_NONE;
+  if (loading_state != LoadingState::LOADING) {
+    return;
   }
 
-  // load the sound file
-  SoundFromMemory mem;
-  mem.loop = false;
-  mem.position = 0;
-  mem.data = QuestFiles::data_file_read(file_name);
+  loading_state = LoadingState::UNLOADED;
+  const bool play = play_when_loaded;
+  play_when_loaded = false;
 
-  OggVorbis_File file;
-  int error = ov_open_callbacks(&mem, &file, nullptr, 0, ogg_callbacks);
+  if (!decoded_sound.error.empty()) {
+    Debug::error(decoded_sound.error);
+    return;
+  }
 
-  if (error) {
+  if (alGetError() != AL_NONE) {
+    Debug::error("Previous audio error not cleaned");
+  }
+
+  // copy the samples into an OpenAL buffer
+  alGenBuffers(1, &buffer);
+  if (alGetError() != AL_NO_ERROR) {
+    Debug::error("Failed to generate audio buffer");
+  }
+  alBufferData(buffer,
+      AL_FORMAT_STEREO16,
+      reinterpret_cast<const ALshort*>(decoded_sound.samples.data()),
+      ALsizei(decoded_sound.samples.size()),
+      decoded_sound.sample_rate);
+  ALenum error = alGetError();
+  if (error != AL_NO_ERROR) {
     std::ostringstream oss;
-    oss << "Cannot load sound file '" << file_name
-        << "' from memory: error " << error;
+    oss << "Cannot copy the sound samples of '"
+        << id << "' into buffer " << buffer
+        << ": error " << error;
     Debug::error(oss.str());
+    alDeleteBuffers(1, &buffer);
+    buffer = AL_NONE;
+    return;
   }
-  else {
 
-    // read the encoded sound properties
-    vorbis_info* info = ov_info(&file, -1);
-    ALsizei sample_rate = ALsizei(info->rate);
+  loading_state = LoadingState::LOADED;
+  buffer_size = decoded_sound.samples.size();
+  cache.add(id, buffer_size);
 
-    ALenum format = AL_NONE;
-    if (info->channels == 1) {
-      format = AL_FORMAT_MONO16;
-    }
-    else if (info->channels == 2) {
-      format = AL_FORMAT_STEREO16;
-    }
+  if (play) {
+    play_source();
+  }
+}
 
-    if (format == AL_NONE) {
-      Debug::error(std::string("Invalid audio format for sound file '")
-          + file_name + "'");
-    }
-    else {
-      // decode the sound with vorbisfile
-      std::vector<char> samples;
-      int bitstream;
-      long bytes_read;
-      long total_bytes_read = 0;
-      const int buffer_size = 16384;
-      char samples_buffer[buffer_size];
-      do {
-        bytes_read = ov_read(&file, samples_buffer, buffer_size, 0, 2, 1, &bitstream);
-        if (bytes_read < 0) {
-          std::ostringstream oss;
-          oss << "Error while decoding ogg chunk in sound file '"
-              << file_name << "': " << bytes_read;
-          Debug::error(oss.str());
-        }
-        else {
-          total_bytes_read += bytes_read;
-          if (format == AL_FORMAT_STEREO16) {
-            samples.insert(samples.end(), samples_buffer, samples_buffer + bytes_read);
-          }
-          else {
-            // mono sound files make no sound on some machines
-            // workaround: convert them on-the-fly into stereo sounds
-            // TODO find a better solution
-            for (int i = 0; i < bytes_read; i += 2) {
-              samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
-              samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
-            }
-            total_bytes_read += bytes_read;
-          }
-        }
-      }
-      while (bytes_read > 0);
-
-      // copy the samples into an OpenAL buffer
-      alGenBuffers(1, &buffer);
-      if (alGetError() != AL_NO_ERROR) {
-          Debug::error("Failed to generate audio buffer");
-      }
-      alBufferData(buffer,
-          AL_FORMAT_STEREO16,
-          reinterpret_cast<ALshort*>(samples.data()),
-          ALsizei(total_bytes_read),
-          sample_rate);
-      ALenum error = alGetError();
-      if (error != AL_NO_ERROR) {
-        std::ostringstream oss;
-        oss << "Cannot copy the sound samples of '"
-            << file_name << "' into buffer " << buffer
-            << ": error " << error;
-        Debug::error(oss.str());
-        buffer = AL_NONE;
-      }
-    }
-    ov_clear(&file);
+/**
+ * \brief Gives the sounds decoded by the decoding threads to OpenAL.
+ *
+ * Must be called from the main thread.
+ */
+void Sound::update_decoded_sounds() {
+
+  const std::vector<SoundDecoder::DecodedSound>& sounds = decoder.take_decoded_sounds();
+  if (sounds.empty()) {
+    return;
   }
 
-  mem.data.clear();
+  for (const SoundDecoder::DecodedSound& decoded_sound: sounds) {
+    const auto it = all_sounds.find(decoded_sound.id);
+    if (it != all_sounds.end()) {
+      it->second.set_decoded_data(decoded_sound);
+    }
+  }
 
-  return buffer;
+  shrink_cache();
 }
 
+/**
+ * \brief Unloads the least recently played sounds until the cache
+ * fits in its maximum size.
+ *
+ * Sounds currently playing are kept.
+ */
+void Sound::shrink_cache() {
+
+  const std::vector<std::string>& evicted_sounds = cache.shrink(
+      [](const std::string& sound_id) {
+    return all_sounds[sound_id].sources.empty();
+  });
+  for (const std::string& sound_id: evicted_sounds) {
+    all_sounds[sound_id].unload();
+  }
 }
 
+}
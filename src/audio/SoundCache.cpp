@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/SoundCache.h"
+#include "solarus/core/Debug.h"
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty sound cache.
+ * \param max_size Maximum total size of the sounds in bytes.
+ */
+SoundCache::SoundCache(size_t max_size):
+  max_size(max_size),
+  size(0),
+  entries(),
+  sounds_by_use() {
+
+}
+
+/**
+ * \brief Returns the maximum total size of the sounds.
+ * \return The maximum size in bytes.
+ */
+size_t SoundCache::get_max_size() const {
+  return max_size;
+}
+
+/**
+ * \brief Sets the maximum total size of the sounds.
+ *
+ * Call shrink() afterwards to evict sounds that no longer fit.
+ *
+ * \param max_size The maximum size in bytes.
+ */
+void SoundCache::set_max_size(size_t max_size) {
+  this->max_size = max_size;
+}
+
+/**
+ * \brief Returns the total size of the sounds in the cache.
+ * \return The size in bytes.
+ */
+size_t SoundCache::get_size() const {
+  return size;
+}
+
+/**
+ * \brief Returns the number of sounds in the cache.
+ * \return The number of sounds.
+ */
+size_t SoundCache::get_num_sounds() const {
+  return entries.size();
+}
+
+/**
+ * \brief Returns whether a sound is in the cache.
+ * \param sound_id Id of a sound.
+ * \return \c true if the sound is in the cache.
+ */
+bool SoundCache::contains(const std::string& sound_id) const {
+  return entries.find(sound_id) != entries.end();
+}
+
+/**
+ * \brief Adds a sound as the most recently used one.
+ * \param sound_id Id of a sound that is not in the cache.
+ * \param size Size of its decoded data in bytes.
+ */
+void SoundCache::add(const std::string& sound_id, size_t size) {
+
+  Debug::check_assertion(!contains(sound_id),
+      std::string("Sound already in the cache: '") + sound_id + "'");
+
+  const auto position = sounds_by_use.insert(sounds_by_use.end(), sound_id);
+  entries.emplace(sound_id, Entry{ size, position });
+  this->size += size;
+}
+
+/**
+ * \brief Removes a sound from the cache.
+ *
+ * Does nothing if the sound is not in the cache.
+ *
+ * \param sound_id Id of a sound.
+ */
+void SoundCache::remove(const std::string& sound_id) {
+
+  const auto it = entries.find(sound_id);
+  if (it == entries.end()) {
+    return;
+  }
+
+  size -= it->second.size;
+  sounds_by_use.erase(it->second.position);
+  entries.erase(it);
+}
+
+/**
+ * \brief Marks a sound as the most recently used one.
+ *
+ * Does nothing if the sound is not in the cache.
+ *
+ * \param sound_id Id of a sound.
+ */
+void SoundCache::touch(const std::string& sound_id) {
+
+  const auto it = entries.find(sound_id);
+  if (it == entries.end()) {
+    return;
+  }
+
+  sounds_by_use.splice(sounds_by_use.end(), sounds_by_use, it->second.position);
+}
+
+/**
+ * \brief Removes the least recently used sounds until the cache fits in
+ * its maximum size.
+ *
+ * Sounds that cannot be evicted are kept, so the cache may still be too big
+ * afterwards.
+ *
+ * \param can_evict Tells whether a sound can be evicted,
+ * for example because it is not playing.
+ * \return The ids of the removed sounds, from the least recently used one.
+ */
+std::vector<std::string> SoundCache::shrink(
+    const std::function<bool (const std::string&)>& can_evict
+) {
+  std::vector<std::string> evicted_sounds;
+  auto it = sounds_by_use.begin();
+  while (size > max_size && it != sounds_by_use.end()) {
+    const std::string sound_id = *it;
+    ++it;
+    if (can_evict(sound_id)) {
+      remove(sound_id);
+      evicted_sounds.push_back(sound_id);
+    }
+  }
+  return evicted_sounds;
+}
+
+}
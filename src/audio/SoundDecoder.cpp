@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/Sound.h"
+#include "solarus/audio/SoundDecoder.h"
+#include "solarus/core/QuestFiles.h"
+#include <algorithm>
+#include <sstream>
+
+namespace Solarus {
+
+/**
+ * \brief Creates a sound decoder with no thread.
+ */
+SoundDecoder::SoundDecoder():
+  threads(),
+  queue(),
+  decoded_sounds(),
+  mutex(),
+  condition(),
+  stopped(false) {
+
+}
+
+/**
+ * \brief Destroys the sound decoder after stopping its threads.
+ */
+SoundDecoder::~SoundDecoder() {
+
+  stop();
+}
+
+/**
+ * \brief Starts the threads that decode sounds.
+ * \param num_threads Number of threads to start.
+ */
+void SoundDecoder::start(int num_threads) {
+
+  stop();
+  stopped = false;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(&SoundDecoder::thread_loop, this);
+  }
+}
+
+/**
+ * \brief Stops the threads and waits for them.
+ *
+ * Sounds not decoded or not taken yet are discarded.
+ */
+void SoundDecoder::stop() {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  condition.notify_all();
+  for (std::thread& thread: threads) {
+    thread.join();
+  }
+  threads.clear();
+  queue.clear();
+  decoded_sounds.clear();
+}
+
+/**
+ * \brief Returns whether decoding threads are running.
+ * \return \c true if start() was called and not stop().
+ */
+bool SoundDecoder::is_started() const {
+  return !threads.empty();
+}
+
+/**
+ * \brief Adds a sound to the queue of sounds to decode.
+ * \param sound_id Id of the sound to decode.
+ * \param urgent \c true to decode it before the other ones.
+ */
+void SoundDecoder::request(const std::string& sound_id, bool urgent) {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (urgent) {
+      queue.push_front(sound_id);
+    }
+    else {
+      queue.push_back(sound_id);
+    }
+  }
+  condition.notify_one();
+}
+
+/**
+ * \brief Moves a sound waiting in the queue to the front.
+ *
+ * Does nothing if the sound is not waiting, for example because it is
+ * being decoded.
+ *
+ * \param sound_id Id of a sound requested before.
+ */
+void SoundDecoder::make_urgent(const std::string& sound_id) {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto it = std::find(queue.begin(), queue.end(), sound_id);
+  if (it != queue.end()) {
+    queue.erase(it);
+    queue.push_front(sound_id);
+  }
+}
+
+/**
+ * \brief Returns the sounds decoded since the previous call.
+ * \return The decoded sounds, including the ones that failed.
+ */
+std::vector<SoundDecoder::DecodedSound> SoundDecoder::take_decoded_sounds() {
+
+  std::vector<DecodedSound> sounds;
+  std::lock_guard<std::mutex> lock(mutex);
+  sounds.swap(decoded_sounds);
+  return sounds;
+}
+
+/**
+ * \brief Body of a decoding thread.
+ *
+ * Decodes the sounds of the queue into PCM data.
+ */
+void SoundDecoder::thread_loop() {
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    condition.wait(lock, [this]() {
+      return stopped || !queue.empty();
+    });
+    if (stopped) {
+      return;
+    }
+
+    DecodedSound decoded_sound;
+    decoded_sound.id = queue.front();
+    queue.pop_front();
+    lock.unlock();
+
+    std::string file_name = std::string("sounds/" + decoded_sound.id);
+    if (decoded_sound.id.find(".") == std::string::npos) {
+      file_name += ".ogg";
+    }
+    decode_file(file_name, decoded_sound);
+
+    lock.lock();
+    decoded_sounds.push_back(std::move(decoded_sound));
+  }
+}
+
+/**
+ * \brief Loads the specified sound file and decodes its content into PCM data.
+ *
+ * This function does not use OpenAL and can be called from any thread.
+ *
+ * \param file_name name of the file to open
+ * \param decoded_sound Where to store the decoded data or the error message.
+ */
+void SoundDecoder::decode_file(const std::string& file_name, DecodedSound& decoded_sound) {
+
+  if (!QuestFiles::data_file_exists(file_name)) {
+    decoded_sound.error = std::string("Cannot find sound file '") + file_name + "'";
+    return;
+  }
+
+  // load the sound file
+  Sound::SoundFromMemory mem;
+  mem.loop = false;
+  mem.position = 0;
+  mem.data = QuestFiles::data_file_read(file_name);
+
+  OggVorbis_File file;
+  int error = ov_open_callbacks(&mem, &file, nullptr, 0, Sound::ogg_callbacks);
+
+  if (error) {
+    std::ostringstream oss;
+    oss << "Cannot load sound file '" << file_name
+        << "' from memory: error " << error;
+    decoded_sound.error = oss.str();
+  }
+  else {
+
+    // read the encoded sound properties
+    vorbis_info* info = ov_info(&file, -1);
+    decoded_sound.sample_rate = int(info->rate);
+
+    if (info->channels != 1 && info->channels != 2) {
+      decoded_sound.error = std::string("Invalid audio format for sound file '")
+          + file_name + "'";
+    }
+    else {
+      // decode the sound with vorbisfile
+      std::vector<char>& samples = decoded_sound.samples;
+      int bitstream;
+      long bytes_read;
+      const int buffer_size = 16384;
+      char samples_buffer[buffer_size];
+      do {
+        bytes_read = ov_read(&file, samples_buffer, buffer_size, 0, 2, 1, &bitstream);
+        if (bytes_read < 0) {
+          std::ostringstream oss;
+          oss << "Error while decoding ogg chunk in sound file '"
+              << file_name << "': " << bytes_read;
+          decoded_sound.error = oss.str();
+        }
+        else {
+          if (info->channels == 2) {
+            samples.insert(samples.end(), samples_buffer, samples_buffer + bytes_read);
+          }
+          else {
+            // mono sound files make no sound on some machines
+            // workaround: convert them on-the-fly into stereo sounds
+            // TODO find a better solution
+            for (int i = 0; i < bytes_read; i += 2) {
+              samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
+              samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
+            }
+          }
+        }
+      }
+      while (bytes_read > 0);
+    }
+    ov_clear(&file);
+  }
+}
+
+}
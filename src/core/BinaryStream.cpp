@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/BinaryStream.h"
+
+namespace Solarus {
+
+/**
+ * \brief Creates a binary writer.
+ * \param buffer The buffer where to append values.
+ */
+BinaryWriter::BinaryWriter(std::string& buffer):
+  buffer(buffer) {
+
+}
+
+/**
+ * \brief Writes the header identifying a binary file format.
+ * \param format_name Name of the format.
+ * \param format_version Version of the format.
+ */
+void BinaryWriter::write_header(const std::string& format_name, int format_version) {
+
+  write_string(format_name);
+  write_int(format_version);
+}
+
+/**
+ * \brief Writes a byte.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_uint8(uint8_t value) {
+
+  buffer.push_back(static_cast<char>(value));
+}
+
+/**
+ * \brief Writes a 32-bit signed integer.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_int(int value) {
+
+  const uint32_t bits = static_cast<uint32_t>(value);
+  buffer.push_back(static_cast<char>(bits & 0xFF));
+  buffer.push_back(static_cast<char>((bits >> 8) & 0xFF));
+  buffer.push_back(static_cast<char>((bits >> 16) & 0xFF));
+  buffer.push_back(static_cast<char>((bits >> 24) & 0xFF));
+}
+
+/**
+ * \brief Writes a boolean.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_bool(bool value) {
+
+  write_uint8(value ? 1 : 0);
+}
+
+/**
+ * \brief Writes a string.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_string(const std::string& value) {
+
+  write_int(static_cast<int>(value.size()));
+  buffer.append(value);
+}
+
+/**
+ * \brief Creates a binary reader.
+ * \param buffer The buffer to read. It must live as long as the reader.
+ */
+BinaryReader::BinaryReader(const std::string& buffer):
+  buffer(buffer),
+  position(0),
+  valid(true) {
+
+}
+
+/**
+ * \brief Returns whether all reads succeeded so far.
+ * \return \c true if the data read is valid.
+ */
+bool BinaryReader::is_valid() const {
+  return valid;
+}
+
+/**
+ * \brief Marks the data read as invalid.
+ *
+ * Call this function when a value read is not acceptable.
+ * Next reads will return default values.
+ */
+void BinaryReader::set_invalid() {
+  valid = false;
+}
+
+/**
+ * \brief Returns whether the whole buffer was read.
+ * \return \c true if there is nothing more to read.
+ */
+bool BinaryReader::is_at_end() const {
+  return position == buffer.size();
+}
+
+/**
+ * \brief Reads the header identifying a binary file format and checks it.
+ * \param format_name Expected name of the format.
+ * \param format_version Expected version of the format.
+ * \return \c true if the header matches.
+ */
+bool BinaryReader::read_header(const std::string& format_name, int format_version) {
+
+  if (read_string() != format_name || read_int() != format_version) {
+    set_invalid();
+  }
+  return is_valid();
+}
+
+/**
+ * \brief Reads a byte.
+ * \return The value read, or 0 in case of error.
+ */
+uint8_t BinaryReader::read_uint8() {
+
+  if (!can_read(1)) {
+    return 0;
+  }
+  return static_cast<uint8_t>(buffer[position++]);
+}
+
+/**
+ * \brief Reads a 32-bit signed integer.
+ * \return The value read, or 0 in case of error.
+ */
+int BinaryReader::read_int() {
+
+  if (!can_read(4)) {
+    return 0;
+  }
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&buffer[position]);
+  const uint32_t bits = bytes[0] |
+      (bytes[1] << 8) |
+      (bytes[2] << 16) |
+      (static_cast<uint32_t>(bytes[3]) << 24);
+  position += 4;
+  return static_cast<int>(bits);
+}
+
+/**
+ * \brief Reads a boolean.
+ * \return The value read, or \c false in case of error.
+ */
+bool BinaryReader::read_bool() {
+
+  const uint8_t value = read_uint8();
+  if (value > 1) {
+    set_invalid();
+    return false;
+  }
+  return value == 1;
+}
+
+/**
+ * \brief Reads a string.
+ * \return The value read, or an empty string in case of error.
+ */
+std::string BinaryReader::read_string() {
+
+  const int size = read_int();
+  if (size < 0) {
+    set_invalid();
+    return std::string();
+  }
+  if (!can_read(size)) {
+    return std::string();
+  }
+  std::string value(buffer, position, size);
+  position += size;
+  return value;
+}
+
+/**
+ * \brief Reads a number of elements that follow in the buffer.
+ *
+ * The number is checked against the size of the remaining data
+ * so that corrupted files cannot make the caller allocate huge amounts
+ * of memory.
+ *
+ * \param min_element_size Minimum size in bytes of each element.
+ * \return The number of elements, or 0 in case of error.
+ */
+int BinaryReader::read_count(int min_element_size) {
+
+  const int count = read_int();
+  if (count < 0 ||
+      (min_element_size > 0 &&
+       static_cast<size_t>(count) > (buffer.size() - position) / min_element_size)) {
+    set_invalid();
+    return 0;
+  }
+  return count;
+}
+
+/**
+ * \brief Returns whether some bytes can be read.
+ *
+ * Marks the reader as invalid if they cannot.
+ *
+ * \param size Number of bytes to read.
+ * \return \c true if the buffer is valid and has these bytes remaining.
+ */
+bool BinaryReader::can_read(size_t size) {
+
+  if (!valid || buffer.size() - position < size) {
+    valid = false;
+    return false;
+  }
+  return true;
+}
+
+}
+
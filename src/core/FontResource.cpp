@@ -18,14 +18,67 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/FontResource.h"
 #include "solarus/core/QuestFiles.h"
+#include "solarus/graphics/Color.h"
 #include "solarus/graphics/Surface.h"
+#include <algorithm>
+#include <tuple>
 #include <utility>
 
 namespace Solarus {
 
+constexpr int FontResource::glyph_atlas_page_size;
+constexpr size_t FontResource::max_glyph_atlases;
+
 bool FontResource::fonts_loaded = false;
+uint64_t FontResource::glyph_atlas_clock = 0;
 std::map<std::string, FontResource::FontFile> FontResource::fonts;
 
+namespace {
+
+/**
+ * \brief Decodes a UTF-8 character.
+ * \param character The bytes of a single UTF-8 character.
+ * \return The Unicode code point of this character.
+ */
+uint32_t get_code_point(const std::string& character) {
+
+  const uint8_t first_byte = static_cast<uint8_t>(character[0]);
+  uint32_t code_point = 0;
+  size_t length = 1;
+  if ((first_byte & 0x80) == 0x00) {
+    return first_byte;
+  }
+  else if ((first_byte & 0xE0) == 0xC0) {
+    code_point = first_byte & 0x1F;
+    length = 2;
+  }
+  else if ((first_byte & 0xF0) == 0xE0) {
+    code_point = first_byte & 0x0F;
+    length = 3;
+  }
+  else {
+    code_point = first_byte & 0x07;
+    length = 4;
+  }
+
+  for (size_t i = 1; i < length && i < character.size(); ++i) {
+    code_point = (code_point << 6) | (static_cast<uint8_t>(character[i]) & 0x3F);
+  }
+  return code_point;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Compares two glyph atlas keys.
+ * \param other Another key.
+ * \return \c true if this key is before the other one.
+ */
+bool FontResource::GlyphAtlasKey::operator<(const GlyphAtlasKey& other) const {
+  return std::tie(size, antialiasing, color) <
+      std::tie(other.size, other.antialiasing, other.color);
+}
+
 /**
  * \brief Initializes the font system.
  */
@@ -218,5 +271,160 @@ TTF_Font& FontResource::get_outline_font(const std::string& font_id, int size) {
   return *outline_fonts.at(size).outline_font;
 }
 
+/**
+ * \brief Returns a character of an outline font rendered in a glyph atlas.
+ *
+ * The character is rendered the first time it is requested with these
+ * settings and then kept in the atlas.
+ * When there are too many atlases for this font, the least recently used
+ * one is removed. Texts that still draw from its pages keep them alive
+ * until they are laid out again.
+ *
+ * \param font_id Id of the outline font to use. It must exist.
+ * \param size Font size to use.
+ * \param antialiasing Whether the character is drawn with antialiasing.
+ * \param color Color of the character.
+ * \param character Bytes of a single UTF-8 character.
+ * \return The glyph. It remains valid until the next call.
+ */
+const FontResource::Glyph& FontResource::get_outline_glyph(
+    const std::string& font_id,
+    int size,
+    bool antialiasing,
+    const Color& color,
+    const std::string& character
+) {
+  TTF_Font& outline_font = get_outline_font(font_id, size);
+  FontFile& font = fonts.at(font_id);
+
+  uint8_t r, g, b, a;
+  color.get_components(r, g, b, a);
+  const GlyphAtlasKey key = {
+      size,
+      antialiasing,
+      static_cast<uint32_t>((r << 24) | (g << 16) | (b << 8) | a)
+  };
+  GlyphAtlas& atlas = font.glyph_atlases[key];
+  atlas.last_use = ++glyph_atlas_clock;
+  if (font.glyph_atlases.size() > max_glyph_atlases) {
+    remove_least_recently_used_atlas(font, key);
+  }
+
+  const auto& it = atlas.glyphs.find(character);
+  if (it != atlas.glyphs.end()) {
+    return it->second;
+  }
+
+  // First time we want this character with these settings.
+  Glyph glyph = render_glyph(outline_font, color, antialiasing, character, atlas);
+  return atlas.glyphs.emplace(character, std::move(glyph)).first->second;
+}
+
+/**
+ * \brief Removes the glyph atlas of a font that was used the longest time ago.
+ * \param font The font.
+ * \param key_in_use Settings of an atlas that must be kept.
+ */
+void FontResource::remove_least_recently_used_atlas(
+    FontFile& font,
+    const GlyphAtlasKey& key_in_use
+) {
+  auto oldest = font.glyph_atlases.end();
+  for (auto it = font.glyph_atlases.begin(); it != font.glyph_atlases.end(); ++it) {
+    if (!(it->first < key_in_use) && !(key_in_use < it->first)) {
+      continue;
+    }
+    if (oldest == font.glyph_atlases.end() ||
+        it->second.last_use < oldest->second.last_use) {
+      oldest = it;
+    }
+  }
+  if (oldest != font.glyph_atlases.end()) {
+    font.glyph_atlases.erase(oldest);
+  }
 }
 
+/**
+ * \brief Renders a character of an outline font into a glyph atlas.
+ * \param outline_font The outline font.
+ * \param color Color of the character.
+ * \param antialiasing Whether the character is drawn with antialiasing.
+ * \param character Bytes of a single UTF-8 character.
+ * \param atlas The atlas where to put the glyph.
+ * \return The glyph created.
+ */
+FontResource::Glyph FontResource::render_glyph(
+    TTF_Font& outline_font,
+    const Color& color,
+    bool antialiasing,
+    const std::string& character,
+    GlyphAtlas& atlas
+) {
+  Glyph glyph;
+  glyph.atlas = nullptr;
+  glyph.code_point = get_code_point(character);
+
+  // Place the glyph like TTF_RenderUTF8_*() would place it in a string.
+  int min_x = 0, max_x = 0, min_y = 0, max_y = 0, advance = 0;
+  if (glyph.code_point <= 0xFFFF &&
+      TTF_GlyphMetrics(&outline_font, static_cast<Uint16>(glyph.code_point),
+          &min_x, &max_x, &min_y, &max_y, &advance) == 0) {
+    glyph.x_offset = std::min(min_x, 0);
+    glyph.advance = advance;
+  }
+  else {
+    int width = 0;
+    TTF_SizeUTF8(&outline_font, character.c_str(), &width, nullptr);
+    glyph.x_offset = 0;
+    glyph.advance = width;
+  }
+
+  // Some fonts make TTF_Font fail if the string contains only whitespaces.
+  if (character.find_first_not_of(" \t\n\r") == std::string::npos) {
+    return glyph;
+  }
+
+  SDL_Color internal_color;
+  color.get_components(
+      internal_color.r, internal_color.g, internal_color.b, internal_color.a);
+  SDL_Surface* internal_surface = antialiasing ?
+      TTF_RenderUTF8_Blended(&outline_font, character.c_str(), internal_color) :
+      TTF_RenderUTF8_Solid(&outline_font, character.c_str(), internal_color);
+  Debug::check_assertion(internal_surface != nullptr,
+      std::string("Cannot render character '") + character + "': "
+      + SDL_GetError()
+  );
+  const SurfacePtr glyph_surface = std::make_shared<Surface>(internal_surface);
+  const Size& glyph_size = glyph_surface->get_size();
+
+  // Find a place in the atlas, leaving a pixel between glyphs.
+  const int padded_width = glyph_size.width + 1;
+  const int padded_height = glyph_size.height + 1;
+  if (!atlas.pages.empty() &&
+      atlas.next_position.x + padded_width > atlas.pages.back()->get_width()) {
+    // New row.
+    atlas.next_position = { 0, atlas.next_position.y + atlas.row_height };
+    atlas.row_height = 0;
+  }
+  if (atlas.pages.empty() ||
+      atlas.next_position.y + padded_height > atlas.pages.back()->get_height()) {
+    // New page.
+    atlas.pages.push_back(Surface::create(
+        std::max(glyph_atlas_page_size, padded_width),
+        std::max(glyph_atlas_page_size, padded_height)
+    ));
+    atlas.next_position = { 0, 0 };
+    atlas.row_height = 0;
+  }
+
+  glyph_surface->set_blend_mode(BlendMode::NONE);
+  glyph_surface->draw(atlas.pages.back(), atlas.next_position);
+
+  glyph.atlas = atlas.pages.back();
+  glyph.src_rect = Rectangle(atlas.next_position, glyph_size);
+  atlas.next_position.x += padded_width;
+  atlas.row_height = std::max(atlas.row_height, padded_height);
+  return glyph;
+}
+
+}
@@ -22,6 +22,7 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/Savegame.h"
 #include "solarus/core/Treasure.h"
 #include "solarus/entities/Destination.h"
@@ -352,6 +353,8 @@ void Game::notify_command_released(GameCommand command) {
  */
 void Game::update() {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::GAME_UPDATE);
+
   // Update the transitions between maps.
   update_transitions();
 
@@ -418,6 +421,11 @@ void Game::update_transitions() {
     }
     else if (transition_direction == Transition::Direction::CLOSING) {
 
+      if (!next_map->is_loaded()) {
+        next_map->load(*this);
+        next_map->check_suspended();
+      }
+
       bool world_changed = next_map != current_map &&
           (!next_map->has_world() || next_map->get_world() != current_map->get_world());
 
@@ -636,12 +644,18 @@ void Game::set_current_map(
   }
 
   // prepare the next map
-  if (current_map == nullptr || map_id != current_map->get_id()) {
-    // another map
+  if (current_map == nullptr) {
+    // first map: no transition to wait for
     next_map = std::make_shared<Map>(map_id);
     next_map->load(*this);
     next_map->check_suspended();
   }
+  else if (map_id != current_map->get_id()) {
+    // another map: prepare its resources during the closing transition
+    // and load it when the transition is finished
+    next_map = std::make_shared<Map>(map_id);
+    get_resource_provider().preload_map(map_id);
+  }
   else {
     // same map
     next_map = current_map;
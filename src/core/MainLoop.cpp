@@ -21,6 +21,7 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/MainLoop.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestProperties.h"
 #include "solarus/core/Savegame.h"
@@ -171,6 +172,7 @@ MainLoop::MainLoop(const Arguments& args):
   // Do this after the creation of the window, but before showing the window,
   // because Lua might change the video mode initially.
   lua_context = std::unique_ptr<LuaContext>(new LuaContext(*this));
+  resource_provider.set_lua_context(lua_context.get());
   Video::show_window();
   lua_context->initialize();
   Video::hide_window();
@@ -202,6 +204,9 @@ MainLoop::MainLoop(const Arguments& args):
  */
 MainLoop::~MainLoop() {
 
+  // The preloading thread may still be reading quest files.
+  resource_provider.quit();
+
   if (game != nullptr) {
     game->stop();
     game.reset();  // While deleting the game, the Lua world must still exist.
@@ -406,6 +411,8 @@ void MainLoop::run() {
  */
 void MainLoop::step() {
 
+  Profiler::begin_frame();
+
   if (game != nullptr) {
     game->update();
   }
@@ -493,15 +500,21 @@ void MainLoop::notify_input(const InputEvent& event) {
  * \brief Redraws the current screen.
  *
  * This function is called repeatedly by the main loop.
+ * Like step(), you can also call it yourself to simulate step by step.
  */
 void MainLoop::draw() {
 
-  root_surface->clear();
+  {
+    SOLARUS_PROFILE_ZONE(ProfilerZone::DRAW);
+    root_surface->clear();
 
-  if (game != nullptr) {
-    game->draw(root_surface);
+    if (game != nullptr) {
+      game->draw(root_surface);
+    }
+    lua_context->main_on_draw(root_surface);
   }
-  lua_context->main_on_draw(root_surface);
+
+  SOLARUS_PROFILE_ZONE(ProfilerZone::RENDER);
   Video::render(root_surface);
 }
 
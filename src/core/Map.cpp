@@ -18,6 +18,7 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Savegame.h"
@@ -56,7 +57,9 @@ Map::Map(const std::string& id):
   started(false),
   destination_name(""),
   entities(nullptr),
-  suspended(false) {
+  suspended(false),
+  entities_nearby_buffers(),
+  num_entities_nearby_buffers_used(0) {
 
 }
 
@@ -285,20 +288,22 @@ void Map::load(Game& game) {
       Video::get_quest_size()
   );
 
-  // Read the map data file.
+  // Read the map data file, unless it was prepared in advance.
   MapData data;
-  const std::string& file_name = std::string("maps/") + get_id() + ".dat";
-  bool success = data.import_from_quest_file(file_name);
+  ResourceProvider& resource_provider = game.get_resource_provider();
+  if (!resource_provider.get_preloaded_map_data(get_id(), data)) {
+    const std::string& file_name = std::string("maps/") + get_id() + ".dat";
+    bool success = data.import_from_quest_file(file_name);
 
-  if (!success) {
-    Debug::die("Failed to load map data file '" + file_name + "'");
+    if (!success) {
+      Debug::die("Failed to load map data file '" + file_name + "'");
+    }
   }
 
   // Initialize the map from the data just read.
   this->game = &game;
   this->savegame = std::static_pointer_cast<Savegame>(
         game.get_savegame().shared_from_this());  // TODO make Game::get_savegame() return a shared_ptr.
-  ResourceProvider& resource_provider = game.get_resource_provider();
   location.set_xy(data.get_location());
   location.set_size(data.get_size());
   width8 = data.get_size().width / 8;
@@ -888,9 +893,9 @@ bool Map::test_collision_with_entities(
     return false;
   }
 
-  EntityVector entities_nearby;
-  get_entities().get_entities_in_rectangle(collision_box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  EntitiesNearby entities_nearby(*this);
+  get_entities().get_entities_in_rectangle(collision_box, entities_nearby.get());
+  for (const EntityPtr& entity_nearby: entities_nearby.get()) {
 
     if (entity_nearby->overlaps(collision_box) &&
         (entity_nearby->get_layer() == layer || entity_nearby->has_layer_independent_collisions()) &&
@@ -1111,35 +1116,45 @@ Ground Map::get_ground(
     return Ground::EMPTY;
   }
 
+  if (!entities->is_ground_modified(layer, xy.x, xy.y)) {
+    // No dynamic entity changes the ground here: return the ground defined
+    // by static tiles (this is very fast).
+    return entities->get_tile_ground(layer, xy.x, xy.y);
+  }
+
   // See if a dynamic entity changes the ground.
+  // If several ones do, the highest one in Z order wins.
   const Rectangle box(xy, Size(1, 1));
-  ConstEntityVector entities_nearby;
-  get_entities().get_entities_in_rectangle_sorted(box, entities_nearby);
-
-  const auto& rend = entities_nearby.rend();
-  for (auto it = entities_nearby.rbegin(); it != rend; ++it) {
-    const Entity& entity_nearby = *(*it);
-
-    const Ground ground = entity_nearby.get_modified_ground();
+  const Entity* highest_entity = nullptr;
+  int highest_z = 0;
+  get_entities().visit_entities_in_rectangle(box, [&](const EntityPtr& entity_nearby) {
 
-    if (&entity_nearby == entity_to_check) {
+    if (entity_nearby.get() == entity_to_check) {
       // Skip the entity itself.
-      continue;
+      return;
     }
     // TODO also skip entities above?
 
-    if (ground == Ground::EMPTY) {
+    if (entity_nearby->get_modified_ground() == Ground::EMPTY) {
       // The entity has no influence on the ground.
-      continue;
+      return;
     }
 
-    if (entity_nearby.overlaps(xy) &&
-        entity_nearby.get_layer() == layer &&
-        entity_nearby.is_enabled() &&
-        !entity_nearby.is_being_removed()
+    if (entity_nearby->overlaps(xy) &&
+        entity_nearby->get_layer() == layer &&
+        entity_nearby->is_enabled() &&
+        !entity_nearby->is_being_removed()
     ) {
-      return get_ground_from_entity(entity_nearby, xy);
+      const int z = get_entities().get_entity_relative_z_order(entity_nearby);
+      if (highest_entity == nullptr || z > highest_z) {
+        highest_entity = entity_nearby.get();
+        highest_z = z;
+      }
     }
+  });
+
+  if (highest_entity != nullptr) {
+    return get_ground_from_entity(*highest_entity, xy);
   }
 
   // Otherwise, return the ground defined by static tiles (this is very fast).
@@ -1297,6 +1312,8 @@ Ground Map::get_ground_from_entity(const Entity& entity, const Point& xy) const
  */
 void Map::check_collision_with_detectors(Entity& entity) {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::COLLISIONS);
+
   if (suspended) {
     return;
   }
@@ -1306,13 +1323,18 @@ void Map::check_collision_with_detectors(Entity& entity) {
     return;
   }
 
+  if (entities->defer_collision_check(entity, false)) {
+    // Will be checked later with other entities.
+    return;
+  }
+
   // Check this entity with each detector.
 
   // Extend the box because some collision tests work without overlapping.
   Rectangle box = entity.get_extended_bounding_box(8);
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  EntitiesNearby entities_nearby(*this);
+  entities->get_entities_in_rectangle(box, entities_nearby.get());
+  for (const EntityPtr& entity_nearby: entities_nearby.get()) {
 
     if (entity.is_being_removed()) {
       return;
@@ -1342,6 +1364,8 @@ void Map::check_collision_with_detectors(Entity& entity) {
  */
 void Map::check_collision_from_detector(Entity& detector) {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::COLLISIONS);
+
   if (suspended) {
     return;
   }
@@ -1351,14 +1375,19 @@ void Map::check_collision_from_detector(Entity& detector) {
     return;
   }
 
+  if (entities->defer_collision_check(detector, true)) {
+    // Will be checked later with other entities.
+    return;
+  }
+
   // First check the hero.
   detector.check_collision(get_entities().get_hero());
 
   // Check each entity with this detector.
   Rectangle box = detector.get_extended_bounding_box(8);
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  EntitiesNearby entities_nearby(*this);
+  entities->get_entities_in_rectangle(box, entities_nearby.get());
+  for (const EntityPtr& entity_nearby: entities_nearby.get()) {
 
     if (detector.is_being_removed()) {
       return;
@@ -1388,6 +1417,8 @@ void Map::check_collision_from_detector(Entity& detector) {
  */
 void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprite) {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::COLLISIONS);
+
   if (suspended) {
     return;
   }
@@ -1402,9 +1433,9 @@ void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprit
 
   // Check each entity with this detector.
   Rectangle box = detector.get_max_bounding_box();
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  EntitiesNearby entities_nearby(*this);
+  entities->get_entities_in_rectangle(box, entities_nearby.get());
+  for (const EntityPtr& entity_nearby: entities_nearby.get()) {
 
     if (detector.is_being_removed()) {
       return;
@@ -1435,6 +1466,8 @@ void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprit
  */
 void Map::check_collision_with_detectors(Entity& entity, Sprite& sprite) {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::COLLISIONS);
+
   if (suspended) {
     return;
   }
@@ -1445,9 +1478,9 @@ void Map::check_collision_with_detectors(Entity& entity, Sprite& sprite) {
 
   // Check each detector.
   Rectangle box = entity.get_max_bounding_box();
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  EntitiesNearby entities_nearby(*this);
+  entities->get_entities_in_rectangle(box, entities_nearby.get());
+  for (const EntityPtr& entity_nearby: entities_nearby.get()) {
 
     if (entity.is_being_removed()) {
       return;
@@ -1465,6 +1498,62 @@ void Map::check_collision_with_detectors(Entity& entity, Sprite& sprite) {
   }
 }
 
+/**
+ * \brief Borrows a vector of entities from the map.
+ * \param map The map.
+ */
+Map::EntitiesNearby::EntitiesNearby(Map& map):
+  map(map),
+  entities(map.borrow_entities_nearby_buffer()) {
+
+}
+
+/**
+ * \brief Gives the vector back to the map.
+ *
+ * The vector is cleared but keeps its capacity for the next query.
+ */
+Map::EntitiesNearby::~EntitiesNearby() {
+
+  entities.clear();
+  map.give_back_entities_nearby_buffer();
+}
+
+/**
+ * \brief Returns the borrowed vector.
+ * \return The vector of entities.
+ */
+EntityVector& Map::EntitiesNearby::get() {
+  return entities;
+}
+
+/**
+ * \brief Returns an unused vector of entities for a spatial query.
+ *
+ * Use EntitiesNearby instead of calling this function directly.
+ *
+ * \return An empty vector that must be given back with
+ * give_back_entities_nearby_buffer() when no longer needed.
+ */
+EntityVector& Map::borrow_entities_nearby_buffer() {
+
+  if (num_entities_nearby_buffers_used == entities_nearby_buffers.size()) {
+    entities_nearby_buffers.emplace_back();
+  }
+  return entities_nearby_buffers[num_entities_nearby_buffers_used++];
+}
+
+/**
+ * \brief Gives back the last vector obtained with
+ * borrow_entities_nearby_buffer().
+ */
+void Map::give_back_entities_nearby_buffer() {
+
+  Debug::check_assertion(num_entities_nearby_buffers_used > 0,
+      "No entities nearby buffer to give back");
+  --num_entities_nearby_buffers_used;
+}
+
 /**
  * \brief Returns the name identifying this type in Lua.
  * \return The name identifying this type in Lua.
@@ -14,15 +14,24 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryStream.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/MapData.h"
 #include "solarus/entities/EntityTypeInfo.h"
 #include "solarus/lua/LuaTools.h"
 #include <ostream>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
+namespace {
+
+const std::string binary_format_name = "map";  /**< Header of binary map files. */
+constexpr int binary_format_version = 1;       /**< Version of binary map files. */
+
+}
+
 /**
  * \brief Creates an empty map data object.
  */
@@ -939,5 +948,82 @@ bool MapData::export_to_lua(std::ostream& out) const {
   return true;
 }
 
-}  // namespace Solarus
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool MapData::import_from_binary(const std::string& buffer) {
+
+  BinaryReader reader(buffer);
+  if (!reader.read_header(binary_format_name, binary_format_version)) {
+    return false;
+  }
 
+  // Read into a separate object to leave this one unchanged in case of failure.
+  MapData map;
+  const int x = reader.read_int();
+  const int y = reader.read_int();
+  map.set_location({ x, y });
+  const int width = reader.read_int();
+  const int height = reader.read_int();
+  map.set_size({ width, height });
+  const int min_layer = reader.read_int();
+  const int max_layer = reader.read_int();
+  if (min_layer > 0 || max_layer < 0) {
+    return false;
+  }
+  map.set_min_layer(min_layer);
+  map.set_max_layer(max_layer);
+  map.set_world(reader.read_string());
+  map.set_floor(reader.read_int());
+  map.set_tileset_id(reader.read_string());
+  map.set_music_id(reader.read_string());
+
+  const int num_entities = reader.read_count(28);
+  for (int i = 0; i < num_entities && reader.is_valid(); ++i) {
+    EntityData entity;
+    if (!entity.read_binary(reader) ||
+        !map.add_entity(entity).is_valid()) {
+      return false;
+    }
+  }
+
+  if (!reader.is_valid() || !reader.is_at_end()) {
+    return false;
+  }
+
+  *this = std::move(map);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool MapData::export_to_binary(std::string& buffer) const {
+
+  BinaryWriter writer(buffer);
+  writer.write_header(binary_format_name, binary_format_version);
+  writer.write_int(get_location().x);
+  writer.write_int(get_location().y);
+  writer.write_int(get_size().width);
+  writer.write_int(get_size().height);
+  writer.write_int(get_min_layer());
+  writer.write_int(get_max_layer());
+  writer.write_string(get_world());
+  writer.write_int(get_floor());
+  writer.write_string(get_tileset_id());
+  writer.write_string(get_music_id());
+
+  // Entities in the same order as in the Lua format,
+  // so that they get the same index when read back.
+  writer.write_int(get_num_entities());
+  for (const auto& kvp : entities) {
+    const EntityDataList& layer_entities = kvp.second;
+    for (const EntityData& entity_data : layer_entities.entities) {
+      entity_data.write_binary(writer);
+    }
+  }
+
+  return true;
+}
+
+}  // namespace Solarus
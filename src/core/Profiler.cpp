@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ostream>
+#include <unordered_map>
+
+namespace Solarus {
+
+const std::string EnumInfoTraits<ProfilerZone>::pretty_name = "profiler zone";
+
+const EnumInfo<ProfilerZone>::names_type EnumInfoTraits<ProfilerZone>::names = {
+    { ProfilerZone::GAME_UPDATE, "game_update" },
+    { ProfilerZone::LUA_UPDATE, "lua_update" },
+    { ProfilerZone::LUA_TIMERS, "lua_timers" },
+    { ProfilerZone::LUA_MOVEMENTS, "lua_movements" },
+    { ProfilerZone::LUA_MENUS, "lua_menus" },
+    { ProfilerZone::ENTITIES_UPDATE, "entities_update" },
+    { ProfilerZone::ENTITIES_DRAW, "entities_draw" },
+    { ProfilerZone::COLLISIONS, "collisions" },
+    { ProfilerZone::DRAW, "draw" },
+    { ProfilerZone::RENDER, "render" },
+};
+
+constexpr int Profiler::default_max_frames;
+bool Profiler::enabled = false;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * \brief Measurement state of a zone.
+ */
+struct ZoneState {
+  int depth = 0;                  /**< Number of nested activations. */
+  uint64_t start = 0;             /**< When the outermost activation started. */
+};
+
+/**
+ * \brief One activation of a zone.
+ */
+struct ZoneEvent {
+  int zone_id;                    /**< The zone. */
+  uint64_t start;                 /**< Start date in nanoseconds. */
+  uint64_t duration;              /**< Duration in nanoseconds. */
+};
+
+/**
+ * \brief Time spent in a zone during a frame.
+ */
+struct ZoneTotal {
+  uint64_t time = 0;              /**< Total time in nanoseconds. */
+  int count = 0;                  /**< Number of activations. */
+};
+
+/**
+ * \brief Everything recorded during a frame.
+ */
+struct FrameProfile {
+  uint64_t start = 0;             /**< Start date in nanoseconds. */
+  uint64_t duration = 0;          /**< Duration in nanoseconds. */
+  std::vector<ZoneEvent> events;  /**< Zone activations in the order they ended. */
+  std::vector<ZoneTotal> totals;  /**< Total per zone, indexed by zone id. */
+};
+
+Clock::time_point epoch;                    /**< Origin of dates. */
+std::vector<std::string> zone_names;        /**< Name of each zone, indexed by zone id. */
+std::unordered_map<std::string, int>
+    zone_ids_by_name;                       /**< Zone id of each named zone. */
+std::unordered_map<const char*, int>
+    zone_ids_by_pointer;                    /**< Zone ids of name pointers already seen,
+                                             * to avoid building strings. */
+std::vector<ZoneState> zone_states;         /**< State of each zone, indexed by zone id. */
+std::vector<FrameProfile> frames;           /**< Ring buffer of recorded frames. */
+int frame_capacity = Profiler::default_max_frames;  /**< Capacity of the ring buffer. */
+int current_frame_index = 0;                /**< Index of the frame being recorded. */
+int num_frames = 0;                         /**< Number of frames recorded including the current one. */
+
+/**
+ * \brief Returns the current date relative to the epoch.
+ * \return The date in nanoseconds.
+ */
+uint64_t get_date() {
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - epoch
+  ).count();
+}
+
+/**
+ * \brief Makes sure that the zones of ProfilerZone exist.
+ */
+void initialize_zones() {
+
+  if (!zone_names.empty()) {
+    return;
+  }
+
+  for (ProfilerZone zone : EnumInfo<ProfilerZone>::enums()) {
+    Debug::check_assertion(static_cast<size_t>(zone) == zone_names.size(),
+        "Wrong profiler zone order");
+    zone_names.push_back(enum_to_name(zone));
+    zone_ids_by_name[zone_names.back()] = static_cast<int>(zone);
+  }
+  zone_states.resize(zone_names.size());
+}
+
+/**
+ * \brief Starts recording a frame in the current slot of the ring buffer.
+ */
+void start_frame() {
+
+  FrameProfile& frame = frames[current_frame_index];
+  frame.start = get_date();
+  frame.duration = 0;
+  frame.events.clear();
+  frame.totals.assign(zone_names.size(), ZoneTotal());
+}
+
+/**
+ * \brief Calls a function on each recorded frame, from the oldest one.
+ * \param function The function to call.
+ */
+template<typename F>
+void for_each_frame(F&& function) {
+
+  const int first_index = (current_frame_index - num_frames + 1 + frame_capacity) % frame_capacity;
+  for (int i = 0; i < num_frames; ++i) {
+    function(frames[(first_index + i) % frame_capacity]);
+  }
+}
+
+/**
+ * \brief Writes a string as a JSON string literal.
+ * \param out The stream to write.
+ * \param value The string to write.
+ */
+void write_json_string(std::ostream& out, const std::string& value) {
+
+  out << '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20) {
+      out << ' ';
+    }
+    else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Enables or disables the profiler.
+ *
+ * Recorded frames are discarded.
+ *
+ * \param enabled \c true to measure zones.
+ */
+void Profiler::set_enabled(bool enabled) {
+
+  initialize_zones();
+  for (ZoneState& state : zone_states) {
+    state = ZoneState();
+  }
+
+  Profiler::enabled = enabled;
+  frames.clear();
+  num_frames = 0;
+  current_frame_index = 0;
+  if (enabled) {
+    epoch = Clock::now();
+    frames.resize(frame_capacity);
+    start_frame();
+    num_frames = 1;
+  }
+}
+
+/**
+ * \brief Returns the number of frames kept by the profiler.
+ * \return The capacity of the ring buffer of frames.
+ */
+int Profiler::get_max_frames() {
+  return frame_capacity;
+}
+
+/**
+ * \brief Sets the number of frames kept by the profiler.
+ *
+ * Recorded frames are discarded.
+ *
+ * \param max_frames The capacity of the ring buffer of frames.
+ */
+void Profiler::set_max_frames(int max_frames) {
+
+  Debug::check_assertion(max_frames > 0, "Invalid number of profiler frames");
+
+  frame_capacity = max_frames;
+  set_enabled(enabled);
+}
+
+/**
+ * \brief Ends the current frame and starts a new one.
+ *
+ * Called at each simulation step.
+ * The oldest frame is discarded if the ring buffer is full.
+ */
+void Profiler::begin_frame() {
+
+  if (!enabled) {
+    return;
+  }
+
+  FrameProfile& frame = frames[current_frame_index];
+  frame.duration = get_date() - frame.start;
+
+  current_frame_index = (current_frame_index + 1) % frame_capacity;
+  num_frames = std::min(num_frames + 1, frame_capacity);
+  start_frame();
+}
+
+/**
+ * \brief Returns the id of a zone from its name.
+ *
+ * The zone is created if it does not exist yet.
+ *
+ * \param zone_name Name of a zone.
+ * \return The zone id.
+ */
+int Profiler::get_zone_id(const char* zone_name) {
+
+  // Names are usually string literals: try the address first.
+  // The name is still compared in case the address was reused.
+  const auto it = zone_ids_by_pointer.find(zone_name);
+  if (it != zone_ids_by_pointer.end() &&
+      std::strcmp(zone_names[it->second].c_str(), zone_name) == 0) {
+    return it->second;
+  }
+
+  initialize_zones();
+  int zone_id;
+  const auto name_it = zone_ids_by_name.find(zone_name);
+  if (name_it != zone_ids_by_name.end()) {
+    zone_id = name_it->second;
+  }
+  else {
+    zone_id = static_cast<int>(zone_names.size());
+    zone_names.emplace_back(zone_name);
+    zone_ids_by_name[zone_names.back()] = zone_id;
+    zone_states.emplace_back();
+  }
+  if (zone_ids_by_pointer.size() >= 1024) {
+    // Temporary strings: don't let the cache grow forever.
+    zone_ids_by_pointer.clear();
+  }
+  zone_ids_by_pointer[zone_name] = zone_id;
+  return zone_id;
+}
+
+/**
+ * \brief Starts measuring a zone.
+ *
+ * Prefer SOLARUS_PROFILE_ZONE() to calling this function directly.
+ *
+ * \param zone_id The zone entered.
+ */
+void Profiler::begin_zone(int zone_id) {
+
+  initialize_zones();
+  ZoneState& state = zone_states[zone_id];
+  if (state.depth++ == 0) {
+    state.start = get_date();
+  }
+}
+
+/**
+ * \brief Stops measuring a zone and records it in the current frame.
+ * \param zone_id The zone left.
+ */
+void Profiler::end_zone(int zone_id) {
+
+  if (!enabled) {
+    // The profiler was disabled inside the zone.
+    return;
+  }
+
+  ZoneState& state = zone_states[zone_id];
+  if (state.depth == 0) {
+    // The profiler was enabled inside the zone.
+    return;
+  }
+
+  if (--state.depth > 0) {
+    return;
+  }
+
+  const uint64_t duration = get_date() - state.start;
+  FrameProfile& frame = frames[current_frame_index];
+  frame.events.push_back({ zone_id, state.start, duration });
+  if (static_cast<size_t>(zone_id) >= frame.totals.size()) {
+    // New zone created during this frame.
+    frame.totals.resize(zone_names.size());
+  }
+  ZoneTotal& total = frame.totals[zone_id];
+  total.time += duration;
+  ++total.count;
+}
+
+/**
+ * \brief Returns the time spent in a zone during the current frame.
+ * \param zone A zone.
+ * \return The time in nanoseconds.
+ */
+uint64_t Profiler::get_zone_time(ProfilerZone zone) {
+
+  if (num_frames == 0) {
+    return 0;
+  }
+
+  const FrameProfile& frame = frames[current_frame_index];
+  const size_t zone_id = static_cast<size_t>(zone);
+  return zone_id < frame.totals.size() ? frame.totals[zone_id].time : 0;
+}
+
+/**
+ * \brief Returns the number of frames recorded.
+ * \return The number of frames in the ring buffer, including the current one.
+ */
+int Profiler::get_num_frames() {
+  return num_frames;
+}
+
+/**
+ * \brief Returns the time spent in each zone during the recorded frames.
+ * \return Statistics of each zone that was activated at least once.
+ */
+std::vector<Profiler::ZoneStatistics> Profiler::get_statistics() {
+
+  std::vector<ZoneStatistics> statistics(zone_names.size());
+  for (size_t i = 0; i < zone_names.size(); ++i) {
+    statistics[i] = { zone_names[i], 0, 0, 0 };
+  }
+
+  for_each_frame([&statistics](const FrameProfile& frame) {
+    for (size_t i = 0; i < frame.totals.size(); ++i) {
+      const ZoneTotal& total = frame.totals[i];
+      statistics[i].total_time += total.time;
+      statistics[i].max_time = std::max(statistics[i].max_time, total.time);
+      statistics[i].count += total.count;
+    }
+  });
+
+  statistics.erase(std::remove_if(statistics.begin(), statistics.end(),
+      [](const ZoneStatistics& zone_statistics) {
+    return zone_statistics.count == 0;
+  }), statistics.end());
+  return statistics;
+}
+
+/**
+ * \brief Writes the recorded frames in the Chrome trace event format.
+ *
+ * The result can be opened in chrome://tracing or similar tools.
+ *
+ * \param out The stream to write.
+ */
+void Profiler::write_chrome_trace(std::ostream& out) {
+
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  const auto write_event = [&out, &first](
+      const std::string& name,
+      int thread,
+      uint64_t start,
+      uint64_t duration
+  ) {
+    out << (first ? "\n" : ",\n")
+        << "{\"name\":";
+    write_json_string(out, name);
+    out << ",\"cat\":\"solarus\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+        << ",\"ts\":" << start / 1000 << "." << (start % 1000) / 100
+        << ",\"dur\":" << duration / 1000 << "." << (duration % 1000) / 100
+        << "}";
+    first = false;
+  };
+
+  for_each_frame([&write_event](const FrameProfile& frame) {
+    if (frame.duration > 0) {
+      write_event("frame", 0, frame.start, frame.duration);
+    }
+    for (const ZoneEvent& event : frame.events) {
+      write_event(zone_names[event.zone_id], 1, event.start, event.duration);
+    }
+  });
+
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+}
+
@@ -280,6 +280,41 @@ SOLARUS_API bool data_file_exists(const std::string& file_name,
   return stats.filetype != PHYSFS_FILETYPE_DIRECTORY;
 }
 
+/**
+ * \brief Returns whether two data files are in the same place of the
+ * search path.
+ *
+ * This is useful to check that a file generated from another one
+ * (like a precompiled or binary version) is not a stale file coming
+ * from another directory or archive.
+ *
+ * \param file_name Name of a data file.
+ * \param other_file_name Name of another data file.
+ * \param language_specific \c true if the files are relative to the current
+ * language directory.
+ * \return \c true if both files exist in the same directory or archive.
+ */
+SOLARUS_API bool data_files_have_same_location(
+    const std::string& file_name,
+    const std::string& other_file_name,
+    bool language_specific) {
+
+  std::string prefix;
+  if (language_specific) {
+    if (CurrentQuest::get_language().empty()) {
+      return false;
+    }
+    prefix = std::string("languages/") + CurrentQuest::get_language() + "/";
+  }
+
+  const char* path = PHYSFS_getRealDir((prefix + file_name).c_str());
+  const char* other_path = PHYSFS_getRealDir((prefix + other_file_name).c_str());
+  if (path == nullptr || other_path == nullptr) {
+    return false;
+  }
+  return std::string(path) == other_path;
+}
+
 /**
  * \brief Opens a data file an loads its content into memory.
  * \param file_name Name of the file to open.
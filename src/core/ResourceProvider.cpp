@@ -14,14 +14,118 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/MapData.h"
+#include "solarus/core/QuestFiles.h"
 #include "solarus/core/ResourceProvider.h"
+#include "solarus/entities/TilesetData.h"
+#include "solarus/graphics/Sprite.h"
+#include "solarus/graphics/SpriteData.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaData.h"
+#include <exception>
+#include <utility>
+#include <vector>
 
 namespace Solarus {
 
+/**
+ * \brief A map to prepare in the background.
+ */
+struct ResourceProvider::PreloadRequest {
+  std::string map_id;                            /**< Id of the map to prepare. */
+  std::set<std::string> loaded_tileset_ids;      /**< Tilesets already in the cache. */
+  std::set<std::string> loaded_sprite_ids;       /**< Sprite animation sets already loaded. */
+};
+
+/**
+ * \brief Resources of a map prepared in the background.
+ */
+struct ResourceProvider::PreloadedMap {
+
+  /**
+   * \brief An image file decoded in the background.
+   */
+  struct DecodedImage {
+    std::string file_name;                       /**< Name of the image file. */
+    Surface::ImageDirectory base_directory;      /**< Base directory of the image file. */
+    SDL_Surface_UniquePtr surface;               /**< The pixels decoded. */
+  };
+
+  std::string map_id;                            /**< Id of the map. */
+  bool map_data_loaded = false;                  /**< Whether the map data file was successfully read. */
+  MapData map_data;                              /**< Content of the map data file. */
+  std::string tileset_id;                        /**< Tileset prepared or an empty string. */
+  TilesetData tileset_data;                      /**< Content of its data file. */
+  std::map<std::string, SpriteData> sprites;     /**< Sprite animation sets prepared, by id. */
+  std::vector<DecodedImage> images;              /**< Images of the tileset and sprites. */
+  std::exception_ptr error;                      /**< Exception raised while preparing the map if any. */
+};
+
+namespace {
+
+/**
+ * \brief Returns whether a data file exists in its text or binary version.
+ * \param file_name Name of a data file.
+ * \return \c true if it exists.
+ */
+bool data_file_exists(const std::string& file_name) {
+
+  return QuestFiles::data_file_exists(file_name) ||
+      QuestFiles::data_file_exists(LuaData::get_binary_file_name(file_name));
+}
+
+}
+
 /**
  * \brief Creates a resource provider.
  */
-ResourceProvider::ResourceProvider() {
+ResourceProvider::ResourceProvider() :
+  lua_context(nullptr),
+  preloading_stopped(false) {
+}
+
+/**
+ * \brief Destroys the resource provider.
+ */
+ResourceProvider::~ResourceProvider() {
+
+  quit();
+}
+
+/**
+ * \brief Stops the preloading thread if it was started.
+ *
+ * This must be called before quest files and system subsystems are closed,
+ * because the preloading thread uses them.
+ * No map can be preloaded anymore after this call.
+ */
+void ResourceProvider::quit() {
+
+  {
+    std::lock_guard<std::mutex> lock(preloading_mutex);
+    preloading_stopped = true;
+    preloading_map_id.clear();
+    preload_request = nullptr;
+  }
+  preloading_condition.notify_all();
+
+  if (preloading_thread.joinable()) {
+    preloading_thread.join();
+  }
+  preloaded_map = nullptr;
+}
+
+/**
+ * \brief Sets the Lua world that uses scripts of resource elements.
+ *
+ * Compiled scripts of enemies, custom entities and items are then
+ * invalidated together with their resource element.
+ *
+ * \param lua_context The Lua context or nullptr.
+ */
+void ResourceProvider::set_lua_context(LuaContext* lua_context) {
+  this->lua_context = lua_context;
 }
 
 /**
@@ -61,6 +165,30 @@ void ResourceProvider::invalidate_resource_element(
 
   case ResourceType::TILESET:
     tileset_cache.erase(element_id);
+    cancel_preloading();
+    break;
+
+  case ResourceType::MAP:
+  case ResourceType::SPRITE:
+    cancel_preloading();
+    break;
+
+  case ResourceType::ITEM:
+    if (lua_context != nullptr) {
+      lua_context->invalidate_compiled_file("items/" + element_id);
+    }
+    break;
+
+  case ResourceType::ENEMY:
+    if (lua_context != nullptr) {
+      lua_context->invalidate_compiled_file("enemies/" + element_id);
+    }
+    break;
+
+  case ResourceType::ENTITY:
+    if (lua_context != nullptr) {
+      lua_context->invalidate_compiled_file("entities/" + element_id);
+    }
     break;
 
   default:
@@ -68,4 +196,250 @@ void ResourceProvider::invalidate_resource_element(
   }
 }
 
+/**
+ * \brief Starts preparing the resources of a map in the background.
+ *
+ * The data file of the map, its tileset and the sprites of its entities
+ * are read and decoded by a background thread.
+ * Call get_preloaded_map_data() to get the result when loading the map.
+ *
+ * Only one map is prepared at a time: preloading a map discards
+ * any other map preloaded before.
+ *
+ * \param map_id Id of the map to prepare.
+ */
+void ResourceProvider::preload_map(const std::string& map_id) {
+
+  std::unique_ptr<PreloadRequest> request(new PreloadRequest());
+  request->map_id = map_id;
+  for (const auto& kvp : tileset_cache) {
+    request->loaded_tileset_ids.insert(kvp.first);
+  }
+  request->loaded_sprite_ids = Sprite::get_loaded_animation_set_ids();
+
+  std::unique_ptr<PreloadedMap> discarded_map;
+  {
+    std::lock_guard<std::mutex> lock(preloading_mutex);
+    if (preloading_stopped) {
+      return;
+    }
+    if (map_id == preloading_map_id) {
+      // Already preloading it.
+      return;
+    }
+    preloading_map_id = map_id;
+    preload_request = std::move(request);
+    discarded_map = std::move(preloaded_map);
+  }
+
+  if (!preloading_thread.joinable()) {
+    preloading_thread = std::thread([this]() {
+      preloading_thread_loop();
+    });
+  }
+  preloading_condition.notify_all();
+}
+
+/**
+ * \brief Returns the data of a map prepared by preload_map().
+ *
+ * Waits for the background thread if it has not finished preparing the map.
+ * The tileset and sprites prepared with the map are added to the caches,
+ * so that creating the map entities does not read any file again.
+ *
+ * \param[in] map_id Id of the map to get.
+ * \param[out] map_data The map data if it was preloaded.
+ * \return \c true if the map was preloaded, \c false if it has to be loaded
+ * normally.
+ */
+bool ResourceProvider::get_preloaded_map_data(
+    const std::string& map_id,
+    MapData& map_data) {
+
+  std::unique_ptr<PreloadedMap> result;
+  {
+    std::unique_lock<std::mutex> lock(preloading_mutex);
+    if (map_id.empty() || map_id != preloading_map_id) {
+      return false;
+    }
+    preloading_condition.wait(lock, [this]() {
+      return preloaded_map != nullptr;
+    });
+    result = std::move(preloaded_map);
+    preloading_map_id.clear();
+  }
+
+  if (result->error != nullptr) {
+    // Same error as if the map was loaded normally.
+    std::rethrow_exception(result->error);
+  }
+
+  if (!result->map_data_loaded) {
+    return false;
+  }
+
+  // Create textures and animation sets from the decoded files.
+  for (PreloadedMap::DecodedImage& image : result->images) {
+    Surface::add_decoded_image(image.file_name, image.base_directory, std::move(image.surface));
+  }
+
+  if (!result->tileset_id.empty() &&
+      tileset_cache.find(result->tileset_id) == tileset_cache.end()) {
+    std::unique_ptr<Tileset> tileset(new Tileset(result->tileset_id));
+    tileset->load(result->tileset_data);
+    tileset_cache.emplace(result->tileset_id, std::move(tileset));
+  }
+
+  for (const auto& kvp : result->sprites) {
+    Sprite::add_animation_set(kvp.first, kvp.second);
+  }
+
+  Surface::clear_decoded_images();
+
+  map_data = std::move(result->map_data);
+  return true;
+}
+
+/**
+ * \brief Discards the map being preloaded if any.
+ */
+void ResourceProvider::cancel_preloading() {
+
+  std::unique_ptr<PreloadedMap> discarded_map;
+  {
+    std::lock_guard<std::mutex> lock(preloading_mutex);
+    preloading_map_id.clear();
+    preload_request = nullptr;
+    discarded_map = std::move(preloaded_map);
+  }
+}
+
+/**
+ * \brief Body of the preloading thread.
+ *
+ * Waits for requests and prepares the corresponding maps.
+ */
+void ResourceProvider::preloading_thread_loop() {
+
+  std::unique_lock<std::mutex> lock(preloading_mutex);
+  while (true) {
+    preloading_condition.wait(lock, [this]() {
+      return preloading_stopped || preload_request != nullptr;
+    });
+    if (preloading_stopped) {
+      return;
+    }
+
+    std::unique_ptr<PreloadRequest> request = std::move(preload_request);
+    lock.unlock();
+    std::unique_ptr<PreloadedMap> result = preload_map_resources(*request);
+    lock.lock();
+
+    if (request->map_id == preloading_map_id && preload_request == nullptr) {
+      preloaded_map = std::move(result);
+      preloading_condition.notify_all();
+    }
+  }
+}
+
+/**
+ * \brief Reads and decodes the resources of a map.
+ *
+ * This function is called by the preloading thread: it does not
+ * create any texture and does not touch the resource caches.
+ * It gives up between two files if the thread is being stopped.
+ *
+ * \param request The map to prepare.
+ * \return The resources prepared.
+ */
+std::unique_ptr<ResourceProvider::PreloadedMap> ResourceProvider::preload_map_resources(
+    const PreloadRequest& request) const {
+
+  std::unique_ptr<PreloadedMap> result(new PreloadedMap());
+  result->map_id = request.map_id;
+
+  try {
+    // Map data file.
+    result->map_data_loaded = result->map_data.import_from_quest_file(
+        "maps/" + request.map_id + ".dat"
+    );
+    if (!result->map_data_loaded || preloading_stopped) {
+      return result;
+    }
+
+    // Tileset.
+    const std::string& tileset_id = result->map_data.get_tileset_id();
+    if (request.loaded_tileset_ids.find(tileset_id) == request.loaded_tileset_ids.end()) {
+      result->tileset_id = tileset_id;
+      if (!result->tileset_data.import_from_quest_file("tilesets/" + tileset_id + ".dat")) {
+        result->tileset_data = TilesetData();
+      }
+      for (const char* suffix : { ".tiles.png", ".entities.png" }) {
+        if (preloading_stopped) {
+          return result;
+        }
+        const std::string& file_name = "tilesets/" + tileset_id + suffix;
+        result->images.push_back({
+            file_name,
+            Surface::DIR_DATA,
+            Surface::decode_image_file(file_name, Surface::DIR_DATA)
+        });
+      }
+    }
+
+    // Sprites of entities.
+    std::set<std::string> sprite_ids;
+    const MapData& map_data = result->map_data;
+    for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
+      for (int i = 0; i < map_data.get_num_entities(layer); ++i) {
+        const EntityData& entity = map_data.get_entity({ layer, i });
+        if (entity.is_string("sprite") && !entity.get_string("sprite").empty()) {
+          sprite_ids.insert(entity.get_string("sprite"));
+        }
+      }
+    }
+
+    std::set<std::string> sprite_images;
+    for (const std::string& sprite_id : sprite_ids) {
+      if (preloading_stopped) {
+        return result;
+      }
+      const std::string& file_name = "sprites/" + sprite_id + ".dat";
+      if (request.loaded_sprite_ids.find(sprite_id) != request.loaded_sprite_ids.end() ||
+          !data_file_exists(file_name)) {
+        // Already loaded, or errors will be reported when creating the sprite.
+        continue;
+      }
+
+      SpriteData& sprite_data = result->sprites[sprite_id];
+      if (!sprite_data.import_from_quest_file(file_name)) {
+        sprite_data = SpriteData();
+        continue;
+      }
+      for (const auto& kvp : sprite_data.get_animations()) {
+        const SpriteAnimationData& animation = kvp.second;
+        if (!animation.src_image_is_tileset()) {
+          sprite_images.insert(animation.get_src_image());
+        }
+      }
+    }
+
+    for (const std::string& file_name : sprite_images) {
+      if (preloading_stopped) {
+        return result;
+      }
+      result->images.push_back({
+          file_name,
+          Surface::DIR_SPRITES,
+          Surface::decode_image_file(file_name, Surface::DIR_SPRITES)
+      });
+    }
+  }
+  catch (...) {
+    result->error = std::current_exception();
+  }
+
+  return result;
+}
+
 }
@@ -149,6 +149,23 @@ void Timer::set_expiration_date(uint32_t expiration_date) {
   this->finished = System::now() >= this->expiration_date;
 }
 
+/**
+ * \brief Returns the date when this timer needs to be updated next time.
+ *
+ * Calling update() before this date has no effect.
+ * This is the expiration date, or the date of the next clock sound if
+ * the timer plays a sound and this is earlier.
+ *
+ * \return The date of the next update.
+ */
+uint32_t Timer::get_next_update_date() const {
+
+  if (is_with_sound() && next_sound_date < expiration_date) {
+    return next_sound_date;
+  }
+  return expiration_date;
+}
+
 /**
  * \brief Updates the timer.
  */
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/WorkerPool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief The worker threads and the current job.
+ */
+class Workers {
+
+  public:
+
+    ~Workers();
+
+    void run(int num_items, int max_threads, const std::function<void(int)>& job);
+
+  private:
+
+    void work(int worker_index);
+
+    std::mutex mutex;                           /**< Lock for the fields below. */
+    std::condition_variable work_available;     /**< Signals a new job or the end. */
+    std::condition_variable work_done;          /**< Signals that all items are done. */
+    std::vector<std::thread> threads;           /**< The worker threads. */
+    const std::function<void(int)>* job = nullptr;  /**< Processes an item, or nullptr. */
+    int num_workers_allowed = 0;                /**< Number of worker threads that may
+                                                 * help with the current job. */
+    int num_items = 0;                          /**< Number of items of the current job. */
+    int next_item = 0;                          /**< Next item nobody took yet. */
+    int num_items_done = 0;                     /**< Number of items finished. */
+    bool stopping = false;                      /**< Whether the threads should stop. */
+};
+
+/**
+ * \brief Stops and joins the worker threads.
+ */
+Workers::~Workers() {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_available.notify_all();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+/**
+ * \copydoc WorkerPool::run
+ */
+void Workers::run(int num_items, int max_threads, const std::function<void(int)>& job) {
+
+  std::unique_lock<std::mutex> lock(mutex);
+  const int num_workers = std::min(num_items, max_threads) - 1;
+  while (static_cast<int>(threads.size()) < num_workers) {
+    const int worker_index = threads.size();
+    threads.emplace_back([this, worker_index]() { work(worker_index); });
+  }
+
+  this->job = &job;
+  this->num_items = num_items;
+  num_workers_allowed = num_workers;
+  next_item = 0;
+  num_items_done = 0;
+  lock.unlock();
+  work_available.notify_all();
+
+  lock.lock();
+  while (next_item < num_items) {
+    const int item = next_item++;
+    lock.unlock();
+    job(item);
+    lock.lock();
+    ++num_items_done;
+  }
+  work_done.wait(lock, [this]() { return num_items_done == this->num_items; });
+  this->job = nullptr;
+}
+
+/**
+ * \brief Main function of a worker thread.
+ * \param worker_index Index of this thread in the pool.
+ */
+void Workers::work(int worker_index) {
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    work_available.wait(lock, [this, worker_index]() {
+      return stopping ||
+          (job != nullptr && next_item < num_items && worker_index < num_workers_allowed);
+    });
+    if (stopping) {
+      return;
+    }
+
+    const std::function<void(int)>& current_job = *job;
+    const int item = next_item++;
+    lock.unlock();
+    current_job(item);
+    lock.lock();
+    ++num_items_done;
+    if (num_items_done == num_items) {
+      work_done.notify_one();
+    }
+  }
+}
+
+/**
+ * \brief Returns the worker threads.
+ */
+Workers& get_workers() {
+
+  static Workers workers;
+  return workers;
+}
+
+}
+
+/**
+ * \brief Processes items in parallel and returns when all of them are done.
+ *
+ * The calling thread processes items too.
+ * This function must only be called from the main thread.
+ *
+ * \param num_items Number of items.
+ * \param max_threads Maximum number of threads processing the items,
+ * including the calling one. 1 means processing them in the calling thread
+ * only.
+ * \param job Function to call with the index of each item.
+ */
+void WorkerPool::run(
+    int num_items,
+    int max_threads,
+    const std::function<void(int)>& job
+) {
+  if (num_items <= 0) {
+    return;
+  }
+
+  if (num_items == 1 || max_threads <= 1) {
+    for (int i = 0; i < num_items; ++i) {
+      job(i);
+    }
+    return;
+  }
+
+  get_workers().run(num_items, max_threads, job);
+}
+
+/**
+ * \brief Returns a reasonable number of threads to process items.
+ * \return The number of cores, up to 4.
+ */
+int WorkerPool::get_default_num_threads() {
+
+  const int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+  return std::max(1, std::min(num_cores, 4));
+}
+
+}
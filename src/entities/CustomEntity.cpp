@@ -1177,7 +1177,7 @@ void CustomEntity::update_ground_observer() {
   // If there is no on_ground_below_changed() event, don't bother
   // determine the ground below.
   bool ground_observer = get_lua_context()->userdata_has_field(
-      *this, "on_ground_below_changed"
+      *this, LuaContext::TrackedEvent::ON_GROUND_BELOW_CHANGED
   );
   if (ground_observer != this->ground_observer) {
     this->ground_observer = ground_observer;
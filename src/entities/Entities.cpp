@@ -18,6 +18,7 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/entities/Boomerang.h"
 #include "solarus/entities/CrystalBlock.h"
 #include "solarus/entities/Destination.h"
@@ -34,7 +35,11 @@
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/lua/LuaContext.h"
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
 #include <sstream>
+#include <tuple>
 #include <lua.hpp>
 
 namespace Solarus {
@@ -84,52 +89,6 @@ class ZOrderComparator {
 
 };
 
-/**
- * \brief Comparator that sorts entities in drawing order.
- * on the map (layer and then Z index).
- */
-class DrawingOrderComparator {
-
-  public:
-
-    /**
-     * \brief Compares two entities.
-     * \param first An entity.
-     * \param second Another entity.
-     * \return \c true if the first entity should be drawn before the secone one.
-     */
-    bool operator()(const EntityPtr& first, const EntityPtr& second) const {
-
-      if (first->get_layer() < second->get_layer()) {
-        return true;
-      }
-
-      if (first->get_layer() > second->get_layer()) {
-        return false;
-      }
-
-      // Same layer.
-      // All entities displayed in Z order are displayed before entities displayed in Y order.
-      if (!first->is_drawn_in_y_order() && second->is_drawn_in_y_order()) {
-        return true;
-      }
-
-      if (first->is_drawn_in_y_order() && !second->is_drawn_in_y_order()) {
-        return false;
-      }
-
-      if (first->is_drawn_in_y_order()) {
-        // Both entities are displayed in Y order.
-        return first->get_y() < second->get_y();
-      }
-
-      // Both entities are displayed in Z order.
-      const Entities& entities = first->get_entities();
-      return entities.get_entity_relative_z_order(first) < entities.get_entity_relative_z_order(second);
-    }
-
-};
-
 }  // Anonymous namespace.
 
 /**
@@ -144,6 +103,8 @@ Entities::Entities(Game& game, Map& map):
   map_height8(0),
   tiles_grid_size(0),
   tiles_ground(),
+  ground_modifiers_grid(),
+  ground_modifiers(),
   non_animated_regions(),
   tiles_in_animated_regions(),
   hero(game.get_hero()),
@@ -153,8 +114,19 @@ Entities::Entities(Game& game, Map& map):
   quadtree(),
   z_caches(),
   entities_drawn_not_at_their_position(),
-  entities_to_draw(),
+  draw_lists(),
+  draw_list_infos(),
+  draw_region(),
+  draw_region_camera_size(),
+  num_draw_list_changes(0),
+  num_draw_list_changes_last_draw(0),
+  drawing_entities(false),
+  entities_changed_while_drawing(),
   entities_to_remove(),
+  collision_broad_phase_enabled(false),
+  collision_checks_deferred(false),
+  deferred_collision_checks(),
+  deferred_collision_check_indices(),
   default_destination(nullptr) {
 
   // Initialize the size.
@@ -166,6 +138,7 @@ Entities::Entities(Game& game, Map& map):
 
     Ground initial_ground = (layer == map.get_min_layer()) ? Ground::TRAVERSABLE : Ground::EMPTY;
     tiles_ground[layer].assign(tiles_grid_size, initial_ground);
+    ground_modifiers_grid[layer].assign(tiles_grid_size, 0);
 
     non_animated_regions[layer] = std::unique_ptr<NonAnimatedRegions>(
         new NonAnimatedRegions(map, layer)
@@ -430,22 +403,22 @@ void Entities::get_entities_in_rectangle(
     const Rectangle& rectangle, ConstEntityVector& result
 ) const {
 
-  EntityVector non_const_result = quadtree.get_elements(rectangle);
-
-  result.reserve(non_const_result.size());
-  for (const ConstEntityPtr& entity : non_const_result) {
-      result.push_back(entity);
-  }
+  quadtree.visit_elements(rectangle, [&result](const EntityPtr& entity) {
+    result.push_back(entity);
+  });
 }
 
 /**
  * \overload Non-const version.
+ *
+ * The result vector is cleared first and keeps its capacity,
+ * so reusing the same vector avoids memory allocations.
  */
 void Entities::get_entities_in_rectangle(
     const Rectangle& rectangle, EntityVector& result
 ) {
 
-  result = quadtree.get_elements(rectangle);
+  quadtree.get_elements(rectangle, result);
 }
 
 /**
@@ -674,6 +647,7 @@ void Entities::bring_to_front(Entity& entity) {
   const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
   int layer = entity.get_layer();
   z_caches.at(layer).bring_to_front(shared_entity);
+  update_draw_list(entity);
 }
 
 /**
@@ -685,6 +659,7 @@ void Entities::bring_to_back(Entity& entity) {
   const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
   int layer = entity.get_layer();
   z_caches.at(layer).bring_to_back(shared_entity);
+  update_draw_list(entity);
 }
 
 /**
@@ -764,9 +739,11 @@ void Entities::initialize_layers() {
 
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
     tiles_ground[layer] = std::vector<Ground>();
+    ground_modifiers_grid[layer] = std::vector<int>();
     non_animated_regions[layer] = std::unique_ptr<NonAnimatedRegions>();
     tiles_in_animated_regions[layer] = std::vector<TilePtr>();
     z_caches[layer] = ZCache();
+    draw_lists[layer] = DrawList();
   }
 }
 
@@ -967,6 +944,11 @@ void Entities::add_entity(const EntityPtr& entity) {
     // Update the quadtree.
     quadtree.add(entity, entity->get_max_bounding_box());
 
+    // Update the ground modifiers grid.
+    if (entity->is_ground_modifier()) {
+      add_ground_modifier(*entity);
+    }
+
     // Update the specific entities lists.
     switch (entity->get_type()) {
 
@@ -1009,6 +991,9 @@ void Entities::add_entity(const EntityPtr& entity) {
     if (type != EntityType::HERO) {
       all_entities.push_back(entity);
     }
+
+    // Insert it in the draw list of its layer if it is visible.
+    update_draw_list(*entity);
   }
 
   // Rename the entity if there is already an entity with the same name.
@@ -1111,9 +1096,13 @@ void Entities::remove_marked_entities() {
     const EntityType type = entity->get_type();
     const int layer = entity->get_layer();
 
-    // Remove it from the quadtree.
+    // Remove it from the draw lists and from the quadtree.
+    remove_from_draw_list(*entity);
     quadtree.remove(entity);
 
+    // Remove it from the ground modifiers grid.
+    remove_ground_modifier(*entity);
+
     // Remove it from the whole list.
     all_entities.remove(entity);
     const std::string& name = entity->get_name();
@@ -1175,12 +1164,15 @@ void Entities::set_suspended(bool suspended) {
  */
 void Entities::update() {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::ENTITIES_UPDATE);
+
   Debug::check_assertion(map.is_started(), "The map is not started");
 
   // First update the hero.
   hero->update();
 
   // Update the dynamic entities.
+  collision_checks_deferred = collision_broad_phase_enabled;
   for (const EntityPtr& entity: all_entities) {
 
     if (
@@ -1190,10 +1182,10 @@ void Entities::update() {
       entity->update();
     }
   }
+  check_deferred_collisions();
 
   // Update the camera after everyone else.
   camera->update();
-  entities_to_draw.clear();  // Invalidate entities to draw.
 
   // Remove the entities that have to be removed now.
   remove_marked_entities();
@@ -1204,6 +1196,8 @@ void Entities::update() {
  */
 void Entities::draw() {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::ENTITIES_DRAW);
+
   const CameraPtr& camera = get_camera();
   if (camera == nullptr) {
     return;
@@ -1211,49 +1205,12 @@ void Entities::draw() {
 
   const SurfacePtr& camera_surface = camera->get_surface();
 
-  // Lazily build the list of entities to draw.
-  if (entities_to_draw.empty()) {
-
-    // Add entities in the camera,
-    // or nearby because of possible
-    // on_pre_draw()/on_draw()/on_post_draw() reimplementations.
-    // TODO it would probably be better to detect entities with
-    // such events and make their is_drawn_at_its_position()
-    // method return false.
-    EntityVector entities_in_camera;
-    Rectangle around_camera(
-        Point(
-            camera->get_x() - camera->get_size().width,
-            camera->get_y() - camera->get_size().height
-        ),
-        camera->get_size() * 3
-    );
-    get_entities_in_rectangle(around_camera, entities_in_camera);
-
-    for (const EntityPtr& entity : entities_in_camera) {
-      int layer = entity->get_layer();
-      Debug::check_assertion(map.is_valid_layer(layer), "Invalid layer");
-      entities_to_draw[layer].push_back(entity);
-    }
-
-    // Add entities displayed even when out of the camera.
-    for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-      for (const EntityPtr& entity : entities_drawn_not_at_their_position[layer]) {
-        entities_to_draw[layer].push_back(entity);
-      }
-
-      // Sort them and remove duplicates.
-      // Duplicate drawings are a problem for entities with semi-transparency.
-      // Using an std::set would be slower because duplicates are rare:
-      // there are not often a lot of dynamic entities displayed out of the camera.
-      std::sort(entities_to_draw[layer].begin(), entities_to_draw[layer].end(), DrawingOrderComparator());
-      entities_to_draw[layer].erase(
-            std::unique(entities_to_draw[layer].begin(), entities_to_draw[layer].end()),
-            entities_to_draw[layer].end()
-      );
-    }
-
-  }
+  // Entities already in the draw lists were kept up to date
+  // since the last draw: only recompute them if the camera went too far.
+  update_draw_region();
+  refresh_draw_list_keys();
+  num_draw_list_changes_last_draw = num_draw_list_changes;
+  num_draw_list_changes = 0;
 
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
 
@@ -1273,13 +1230,24 @@ void Entities::draw() {
     non_animated_regions[layer]->draw_on_map();
 
     // Draw dynamic entities, ordered by their data structure.
-    for (const EntityPtr& entity: entities_to_draw[layer]) {
+    // Draw lists are not modified while iterating them:
+    // changes made by drawing events are applied after.
+    drawing_entities = true;
+    for (const DrawListEntry& entry: draw_lists[layer]) {
+      const EntityPtr& entity = entry.entity;
       if (!entity->is_being_removed() &&
           entity->is_enabled() &&
           entity->is_visible()) {
         entity->draw_on_map();
       }
     }
+    drawing_entities = false;
+  }
+
+  EntityVector entities_changed;
+  entities_changed.swap(entities_changed_while_drawing);
+  for (const EntityPtr& entity : entities_changed) {
+    update_draw_list(*entity);
   }
 
   if (EntityTree::debug_quadtrees) {
@@ -1316,6 +1284,14 @@ void Entities::set_entity_layer(Entity& entity, int layer) {
 
     // Update the entity after the lists because this function might be called again.
     entity.set_layer(layer);
+
+    // Move it to the draw list of its new layer.
+    update_draw_list(entity);
+
+    // Update the ground modifiers grid if this entity is registered there.
+    if (ground_modifiers.find(&entity) != ground_modifiers.end()) {
+      notify_entity_ground_changed(entity);
+    }
   }
 }
 
@@ -1332,6 +1308,122 @@ void Entities::notify_entity_bounding_box_changed(Entity& entity) {
   // (i.e. not managed by MapEntities) this does nothing.
   EntityPtr shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
   quadtree.move(shared_entity, shared_entity->get_max_bounding_box());
+
+  // Update the draw list: the entity may have entered or left the drawn area,
+  // or changed its Y coordinate.
+  update_draw_list(entity);
+
+  // Update the ground modifiers grid if this entity is registered there.
+  if (ground_modifiers.find(&entity) != ground_modifiers.end()) {
+    notify_entity_ground_changed(entity);
+  }
+}
+
+/**
+ * \brief This function should be called whenever the ground defined by an
+ * entity may have changed.
+ *
+ * Entities that start modifying the ground are registered in the ground
+ * modifiers grid.
+ * Once registered, an entity stays there until it is removed from the map,
+ * even if it stops modifying the ground, because some entities
+ * (like destructibles that regenerate) restore their ground without
+ * notification.
+ * This is not a problem: the grid only tells where the ground needs to be
+ * computed more carefully.
+ *
+ * \param entity The entity whose ground may have changed.
+ */
+void Entities::notify_entity_ground_changed(Entity& entity) {
+
+  const auto& it = ground_modifiers.find(&entity);
+  if (it == ground_modifiers.end()) {
+    // Not registered yet.
+    if (entity.get_type() != EntityType::TILE &&
+        !entity.is_being_removed() &&
+        entity.is_ground_modifier()) {
+      add_ground_modifier(entity);
+    }
+    return;
+  }
+
+  // Already registered: see if its area has changed.
+  const GroundModifierInfo& info = it->second;
+  if (info.layer == entity.get_layer() &&
+      info.box == entity.get_max_bounding_box()) {
+    return;
+  }
+
+  remove_ground_modifier(entity);
+  add_ground_modifier(entity);
+}
+
+/**
+ * \brief Registers an entity in the ground modifiers grid.
+ *
+ * The entity is registered on its current layer and on the 8x8 squares
+ * overlapped by its max bounding box, which is also the box used by the
+ * quadtree.
+ *
+ * \param entity An entity that modifies the ground.
+ * It must not be registered already.
+ */
+void Entities::add_ground_modifier(const Entity& entity) {
+
+  GroundModifierInfo info = { entity.get_layer(), entity.get_max_bounding_box() };
+  ground_modifiers.emplace(&entity, info);
+  update_ground_modifiers_grid(info.layer, info.box, 1);
+}
+
+/**
+ * \brief Unregisters an entity from the ground modifiers grid.
+ *
+ * Nothing happens if the entity was not registered.
+ *
+ * \param entity The entity to unregister.
+ */
+void Entities::remove_ground_modifier(const Entity& entity) {
+
+  const auto& it = ground_modifiers.find(&entity);
+  if (it == ground_modifiers.end()) {
+    return;
+  }
+
+  const GroundModifierInfo info = it->second;
+  ground_modifiers.erase(it);
+  update_ground_modifiers_grid(info.layer, info.box, -1);
+}
+
+/**
+ * \brief Updates the number of ground modifiers of 8x8 squares.
+ *
+ * Parts of the box outside the map are ignored.
+ *
+ * \param layer Layer of the squares.
+ * \param box Area whose 8x8 squares should be updated.
+ * \param delta Number of ground modifiers to add to each square.
+ */
+void Entities::update_ground_modifiers_grid(int layer, const Rectangle& box, int delta) {
+
+  if (box.get_width() <= 0 || box.get_height() <= 0 ||
+      !box.overlaps(Rectangle(map.get_size()))) {
+    // Nothing on the map.
+    return;
+  }
+
+  std::vector<int>& grid = ground_modifiers_grid.at(layer);
+  const int x8_1 = std::max(0, box.get_left()) / 8;
+  const int x8_2 = std::min(map_width8 - 1, (box.get_right() - 1) / 8);
+  const int y8_1 = std::max(0, box.get_top()) / 8;
+  const int y8_2 = std::min(map_height8 - 1, (box.get_bottom() - 1) / 8);
+
+  for (int y8 = y8_1; y8 <= y8_2; ++y8) {
+    int index = y8 * map_width8 + x8_1;
+    for (int x8 = x8_1; x8 <= x8_2; ++x8) {
+      grid[index] += delta;
+      ++index;
+    }
+  }
 }
 
 /**
@@ -1342,25 +1434,578 @@ void Entities::notify_entity_bounding_box_changed(Entity& entity) {
  */
 bool Entities::overlaps_raised_blocks(int layer, const Rectangle& rectangle) {
 
-  EntityVector entities_nearby;
-  get_entities_in_rectangle(rectangle, entities_nearby);
-  for (const EntityPtr& entity : entities_nearby) {
+  bool found = false;
+  visit_entities_in_rectangle(rectangle, [&](const EntityPtr& entity) {
+
+    if (found) {
+      return;
+    }
 
     if (entity->get_type() != EntityType::CRYSTAL_BLOCK) {
-      continue;
+      return;
     }
 
     if (entity->get_layer() != layer) {
-      continue;
+      return;
     }
 
     const CrystalBlock& crystal_block = static_cast<CrystalBlock&>(*entity);
     if (crystal_block.is_raised()) {
-      return true;
+      found = true;
+    }
+  });
+
+  return found;
+}
+
+/**
+ * \brief Returns whether the collision broad phase is enabled.
+ * \return \c true if simple collision checks are done together at the end of
+ * each update.
+ */
+bool Entities::is_collision_broad_phase_enabled() const {
+  return collision_broad_phase_enabled;
+}
+
+/**
+ * \brief Sets whether the collision broad phase is enabled.
+ *
+ * When enabled, simple collision checks requested while entities other than
+ * the hero are updated are not done right away.
+ * They are gathered and done together at the end of the update,
+ * with only one spatial query for all of them.
+ * Each pair of entities is then checked at most once per cycle,
+ * with the final positions of entities.
+ *
+ * This is faster for maps with a lot of moving entities,
+ * but an entity that moves several times in a cycle is only checked
+ * at its final position.
+ *
+ * \param enabled \c true to enable the broad phase.
+ */
+void Entities::set_collision_broad_phase_enabled(bool enabled) {
+  collision_broad_phase_enabled = enabled;
+}
+
+/**
+ * \brief Returns the number of cells of non-animated tiles currently built.
+ * \return The number of resident cells in all layers.
+ */
+int Entities::get_num_resident_tile_cells() const {
+
+  int num_cells = 0;
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    if (non_animated_regions.at(layer) != nullptr) {
+      num_cells += non_animated_regions.at(layer)->get_num_resident_cells();
     }
   }
+  return num_cells;
+}
 
-  return false;
+/**
+ * \brief Returns the number of cells of non-animated tiles built during the
+ * last draw of the map.
+ * \return The number of cells built in all layers during the last draw.
+ */
+int Entities::get_num_tile_cells_built_last_draw() const {
+
+  int num_cells = 0;
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    if (non_animated_regions.at(layer) != nullptr) {
+      num_cells += non_animated_regions.at(layer)->get_num_cells_built_last_draw();
+    }
+  }
+  return num_cells;
+}
+
+/**
+ * \brief Returns the non-animated tiles of a layer.
+ * \param layer A layer of the map.
+ * \return The non-animated regions of this layer, or nullptr if they are not
+ * created yet.
+ */
+const NonAnimatedRegions* Entities::get_non_animated_regions(int layer) const {
+
+  Debug::check_assertion(map.is_valid_layer(layer), "Invalid layer");
+
+  return non_animated_regions.at(layer).get();
+}
+
+/**
+ * \brief Returns the number of entities inserted in or removed from the
+ * draw lists before the last draw of the map.
+ *
+ * Moving an entity in the drawing order counts as a removal and an insertion.
+ *
+ * \return The number of draw list changes.
+ */
+int Entities::get_num_draw_list_changes_last_draw() const {
+  return num_draw_list_changes_last_draw;
+}
+
+/**
+ * \brief Returns the current position of an entity in the drawing order of
+ * its layer.
+ * \param entity An entity of the map.
+ * \return Its drawing order key.
+ */
+Entities::DrawOrderKey Entities::get_draw_order_key(const Entity& entity) const {
+
+  const ConstEntityPtr& shared_entity = std::static_pointer_cast<const Entity>(entity.shared_from_this());
+  const bool y_order = entity.is_drawn_in_y_order();
+  return {
+    y_order,
+    y_order ? entity.get_y() : 0,
+    get_entity_relative_z_order(shared_entity)
+  };
+}
+
+/**
+ * \brief Returns whether an entity should be in the draw lists.
+ *
+ * This is the case of entities overlapping the draw region
+ * and of entities that are not drawn at their position.
+ *
+ * \param entity An entity of the map.
+ * \return \c true if the entity may be visible.
+ */
+bool Entities::is_in_draw_region(const Entity& entity) const {
+
+  if (!entity.is_drawn_at_its_position()) {
+    return true;
+  }
+
+  // Like quadtree queries, ignore entities outside the quadtree space.
+  const Rectangle& box = entity.get_max_bounding_box();
+  return box.overlaps(draw_region) && box.overlaps(quadtree.get_space());
+}
+
+/**
+ * \brief Recomputes the draw region and the draw lists if the camera
+ * went too far from the center of the draw region.
+ *
+ * The draw region has a margin of at least the camera size around
+ * the camera because entities nearby may draw into the camera from
+ * on_pre_draw()/on_draw()/on_post_draw() reimplementations.
+ * TODO it would probably be better to detect entities with
+ * such events and make their is_drawn_at_its_position()
+ * method return false.
+ */
+void Entities::update_draw_region() {
+
+  const Size& camera_size = camera->get_size();
+  if (!draw_region.is_flat() && camera_size == draw_region_camera_size) {
+    const Point offset = camera->get_center_point() - draw_region.get_center();
+    if (std::abs(offset.x) <= camera_size.width / 2 &&
+        std::abs(offset.y) <= camera_size.height / 2) {
+      // The camera is still far enough from the edges.
+      return;
+    }
+  }
+
+  draw_region = Rectangle(
+      camera->get_center_point() - Point(camera_size.width * 2, camera_size.height * 2),
+      camera_size * 4
+  );
+  draw_region_camera_size = camera_size;
+  rebuild_draw_lists();
+}
+
+/**
+ * \brief Rebuilds the draw lists from scratch.
+ *
+ * This happens when the draw region changes.
+ * The rest of the time, draw lists are updated incrementally.
+ */
+void Entities::rebuild_draw_lists() {
+
+  for (auto& kvp : draw_lists) {
+    num_draw_list_changes += static_cast<int>(kvp.second.size());
+    kvp.second.clear();
+  }
+  draw_list_infos.clear();
+
+  const auto& add_entry = [&](const EntityPtr& entity) {
+    const int layer = entity->get_layer();
+    Debug::check_assertion(map.is_valid_layer(layer), "Invalid layer");
+    const DrawListEntry entry = { get_draw_order_key(*entity), entity };
+    if (draw_list_infos.emplace(entity.get(), DrawListInfo{ layer, entry.key }).second) {
+      draw_lists[layer].push_back(entry);
+    }
+  };
+
+  // Add entities in the draw region.
+  visit_entities_in_rectangle(draw_region, [&](const EntityPtr& entity) {
+    if (is_in_draw_region(*entity)) {
+      add_entry(entity);
+    }
+  });
+
+  // Add entities displayed even when out of the camera.
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    for (const EntityPtr& entity : entities_drawn_not_at_their_position[layer]) {
+      if (quadtree.contains(entity)) {
+        add_entry(entity);
+      }
+    }
+  }
+
+  // Sort them once. Keys are unique in a layer.
+  for (auto& kvp : draw_lists) {
+    std::sort(kvp.second.begin(), kvp.second.end());
+    num_draw_list_changes += static_cast<int>(kvp.second.size());
+  }
+}
+
+/**
+ * \brief Moves in the drawing order the entities whose Y coordinate or
+ * Y order setting changed without notification.
+ *
+ * Most of the time, nothing changes here and no entity is moved.
+ */
+void Entities::refresh_draw_list_keys() {
+
+  std::vector<Entity*> moved_entities;
+  for (const auto& kvp : draw_lists) {
+    for (const DrawListEntry& entry : kvp.second) {
+      const Entity& entity = *entry.entity;
+      if (entity.is_drawn_in_y_order() != entry.key.y_order ||
+          (entry.key.y_order && entity.get_y() != entry.key.y)) {
+        moved_entities.push_back(entry.entity.get());
+      }
+    }
+  }
+
+  for (Entity* entity : moved_entities) {
+    update_draw_list(*entity);
+  }
+}
+
+/**
+ * \brief Inserts, moves or removes an entity in the draw lists
+ * if its drawing order or its position changed.
+ *
+ * Nothing happens before the first draw.
+ * During the draw, the update is postponed after all entities are drawn.
+ *
+ * \param entity An entity of the map.
+ */
+void Entities::update_draw_list(Entity& entity) {
+
+  if (draw_region.is_flat()) {
+    // Draw lists are not built yet.
+    return;
+  }
+
+  const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
+  if (drawing_entities) {
+    entities_changed_while_drawing.push_back(shared_entity);
+    return;
+  }
+
+  const auto& it = draw_list_infos.find(&entity);
+  if (it != draw_list_infos.end()) {
+    const DrawListInfo& info = it->second;
+    if (is_in_draw_region(entity) &&
+        info.layer == entity.get_layer() &&
+        info.key == get_draw_order_key(entity)) {
+      // Unchanged.
+      return;
+    }
+    remove_from_draw_list(entity);
+  }
+  else if (!quadtree.contains(shared_entity)) {
+    // Not managed here.
+    return;
+  }
+
+  if (is_in_draw_region(entity)) {
+    add_to_draw_list(shared_entity);
+  }
+}
+
+/**
+ * \brief Inserts an entity at its place in the draw list of its layer.
+ * \param entity An entity of the map. It must not be in the draw lists.
+ */
+void Entities::add_to_draw_list(const EntityPtr& entity) {
+
+  const int layer = entity->get_layer();
+  const DrawListEntry entry = { get_draw_order_key(*entity), entity };
+  DrawList& draw_list = draw_lists.at(layer);
+  draw_list.insert(std::upper_bound(draw_list.begin(), draw_list.end(), entry), entry);
+  draw_list_infos.emplace(entity.get(), DrawListInfo{ layer, entry.key });
+  ++num_draw_list_changes;
+}
+
+/**
+ * \brief Removes an entity from the draw lists.
+ *
+ * Nothing happens if the entity is not in the draw lists.
+ *
+ * \param entity An entity of the map.
+ */
+void Entities::remove_from_draw_list(const Entity& entity) {
+
+  const auto& it = draw_list_infos.find(&entity);
+  if (it == draw_list_infos.end()) {
+    return;
+  }
+
+  const DrawListInfo& info = it->second;
+  DrawList& draw_list = draw_lists.at(info.layer);
+  const auto& entry_it = std::lower_bound(
+      draw_list.begin(),
+      draw_list.end(),
+      info.key,
+      [](const DrawListEntry& entry, const DrawOrderKey& key) {
+    return entry.key < key;
+  });
+  Debug::check_assertion(entry_it != draw_list.end() && entry_it->entity.get() == &entity,
+      "Entity not found in its draw list");
+  draw_list.erase(entry_it);
+  draw_list_infos.erase(it);
+  ++num_draw_list_changes;
+}
+
+/**
+ * \brief Compares two drawing order keys.
+ * \param other Another key.
+ * \return \c true if both keys are equal.
+ */
+bool Entities::DrawOrderKey::operator==(const DrawOrderKey& other) const {
+  return y_order == other.y_order && y == other.y && z == other.z;
+}
+
+/**
+ * \brief Compares two drawing order keys.
+ *
+ * Entities drawn in Z order are drawn before entities drawn in Y order.
+ *
+ * \param other Another key.
+ * \return \c true if this key is drawn before the other one.
+ */
+bool Entities::DrawOrderKey::operator<(const DrawOrderKey& other) const {
+  return std::tie(y_order, y, z) < std::tie(other.y_order, other.y, other.z);
+}
+
+/**
+ * \brief Compares two draw list entries by their drawing order key.
+ * \param other Another entry.
+ * \return \c true if this entry is drawn before the other one.
+ */
+bool Entities::DrawListEntry::operator<(const DrawListEntry& other) const {
+  return key < other.key;
+}
+
+/**
+ * \brief Defers the simple collision checks of an entity to the broad phase
+ * if the broad phase is running.
+ * \param entity An entity that has just moved or changed.
+ * \param from_detector \c true to check entities with this detector,
+ * \c false to check this entity with detectors.
+ * \return \c true if the check is deferred, \c false if the caller should
+ * do it now.
+ */
+bool Entities::defer_collision_check(Entity& entity, bool from_detector) {
+
+  if (!collision_checks_deferred) {
+    return false;
+  }
+
+  if (&entity == hero.get()) {
+    // The hero is always checked right away.
+    return false;
+  }
+
+  const auto& it = deferred_collision_check_indices.find(&entity);
+  size_t index = 0;
+  if (it != deferred_collision_check_indices.end()) {
+    index = it->second;
+  }
+  else {
+    index = deferred_collision_checks.size();
+    deferred_collision_check_indices.emplace(&entity, index);
+    const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
+    deferred_collision_checks.push_back({ shared_entity, false, false });
+  }
+
+  DeferredCollisionCheck& check = deferred_collision_checks[index];
+  if (from_detector) {
+    check.from_detector = true;
+  }
+  else {
+    check.with_detectors = true;
+  }
+  return true;
+}
+
+/**
+ * \brief Does the simple collision checks deferred during the update.
+ *
+ * A single spatial query and a sort and sweep pass on the x axis find
+ * the candidate pairs of all checks.
+ * Then checks are done in the order they were requested,
+ * like Map::check_collision_from_detector() and
+ * Map::check_collision_with_detectors() would have done them,
+ * except that a pair already checked from its other entity is skipped.
+ */
+void Entities::check_deferred_collisions() {
+
+  SOLARUS_PROFILE_ZONE(ProfilerZone::COLLISIONS);
+
+  collision_checks_deferred = false;
+  if (deferred_collision_checks.empty()) {
+    return;
+  }
+
+  // Get all entities near the ones to check with one query.
+  const size_t num_checks = deferred_collision_checks.size();
+  std::vector<Rectangle> boxes;
+  boxes.reserve(num_checks);
+  Rectangle region;
+  for (const DeferredCollisionCheck& check : deferred_collision_checks) {
+    // Extend the box because some collision tests work without overlapping.
+    const Rectangle& box = check.entity->get_extended_bounding_box(8);
+    region = boxes.empty() ? box : (region | box);
+    boxes.push_back(box);
+  }
+
+  EntityVector candidates;
+  get_entities_in_rectangle(region, candidates);
+  const size_t num_candidates = candidates.size();
+  std::vector<Rectangle> candidate_boxes;
+  candidate_boxes.reserve(num_candidates);
+  for (const EntityPtr& candidate : candidates) {
+    candidate_boxes.push_back(candidate->get_max_bounding_box());
+  }
+
+  // Sort and sweep on the x axis to find overlapping pairs.
+  std::vector<size_t> sorted_checks(num_checks);
+  std::iota(sorted_checks.begin(), sorted_checks.end(), 0);
+  std::sort(sorted_checks.begin(), sorted_checks.end(), [&boxes](size_t a, size_t b) {
+    return boxes[a].get_x() < boxes[b].get_x();
+  });
+  std::vector<size_t> sorted_candidates(num_candidates);
+  std::iota(sorted_candidates.begin(), sorted_candidates.end(), 0);
+  std::sort(sorted_candidates.begin(), sorted_candidates.end(), [&candidate_boxes](size_t a, size_t b) {
+    return candidate_boxes[a].get_x() < candidate_boxes[b].get_x();
+  });
+
+  std::vector<std::pair<size_t, size_t>> pairs;  // Check index and candidate index.
+  std::vector<size_t> active_candidates;
+  size_t next_candidate = 0;
+  for (size_t check_index : sorted_checks) {
+    const Rectangle& box = boxes[check_index];
+
+    // Candidates that start before the end of this box become active.
+    while (next_candidate < num_candidates &&
+        candidate_boxes[sorted_candidates[next_candidate]].get_x() < box.get_x() + box.get_width()) {
+      active_candidates.push_back(sorted_candidates[next_candidate]);
+      ++next_candidate;
+    }
+
+    // Candidates that end before the start of this box cannot overlap
+    // the next boxes either.
+    active_candidates.erase(std::remove_if(
+        active_candidates.begin(),
+        active_candidates.end(),
+        [&](size_t candidate_index) {
+          const Rectangle& candidate_box = candidate_boxes[candidate_index];
+          return candidate_box.get_x() + candidate_box.get_width() <= box.get_x();
+        }
+    ), active_candidates.end());
+
+    for (size_t candidate_index : active_candidates) {
+      if (candidate_boxes[candidate_index].overlaps(box)) {
+        pairs.emplace_back(check_index, candidate_index);
+      }
+    }
+  }
+
+  // Keep the order of requests, and for each request the order of the query.
+  std::sort(pairs.begin(), pairs.end());
+
+  // Returns whether a pair was already checked when checking its other entity.
+  const auto& already_checked = [&](const Entity& other, size_t check_index, bool other_as_detector) {
+    const auto& it = deferred_collision_check_indices.find(&other);
+    if (it == deferred_collision_check_indices.end() || it->second >= check_index) {
+      return false;
+    }
+    const DeferredCollisionCheck& other_check = deferred_collision_checks[it->second];
+    return other_as_detector ? other_check.from_detector : other_check.with_detectors;
+  };
+
+  // Now do the checks, like Map::check_collision_from_detector() and
+  // Map::check_collision_with_detectors().
+  // Checks requested from now on are done right away.
+  size_t pair_index = 0;
+  for (size_t check_index = 0; check_index < num_checks; ++check_index) {
+
+    const size_t first_pair = pair_index;
+    while (pair_index < pairs.size() && pairs[pair_index].first == check_index) {
+      ++pair_index;
+    }
+    const size_t end_pair = pair_index;
+
+    if (map.is_suspended()) {
+      break;
+    }
+
+    const DeferredCollisionCheck& check = deferred_collision_checks[check_index];
+    Entity& entity = *check.entity;
+    if (entity.is_being_removed() || !entity.is_enabled()) {
+      continue;
+    }
+
+    if (check.from_detector) {
+      // First check the hero.
+      entity.check_collision(*hero);
+
+      for (size_t i = first_pair; i < end_pair; ++i) {
+
+        if (entity.is_being_removed()) {
+          break;
+        }
+
+        Entity& entity_nearby = *candidates[pairs[i].second];
+        if (entity_nearby.is_enabled() &&
+            !entity_nearby.is_suspended() &&
+            !entity_nearby.is_being_removed() &&
+            &entity_nearby != &entity &&
+            &entity_nearby != hero.get() &&
+            !already_checked(entity_nearby, check_index, false)
+        ) {
+          entity.check_collision(entity_nearby);
+        }
+      }
+    }
+
+    if (check.with_detectors) {
+      for (size_t i = first_pair; i < end_pair; ++i) {
+
+        if (entity.is_being_removed()) {
+          break;
+        }
+
+        Entity& entity_nearby = *candidates[pairs[i].second];
+        if (!entity_nearby.is_detector()) {
+          continue;
+        }
+
+        if (entity_nearby.is_enabled() &&
+            !entity_nearby.is_suspended() &&
+            !entity_nearby.is_being_removed() &&
+            !already_checked(entity_nearby, check_index, true)
+        ) {
+          entity_nearby.check_collision(entity);
+        }
+      }
+    }
+  }
+
+  deferred_collision_checks.clear();
+  deferred_collision_check_indices.clear();
 }
 
 /**
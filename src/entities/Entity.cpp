@@ -170,6 +170,9 @@ Ground Entity::get_modified_ground() const {
  */
 void Entity::update_ground_observers() {
 
+  // Keep the map informed of where the ground may be modified.
+  get_entities().notify_entity_ground_changed(*this);
+
   // Update overlapping entities that are sensible to their ground.
   const Rectangle& box = get_bounding_box();
   std::vector<EntityPtr> entities_nearby;
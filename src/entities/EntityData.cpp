@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryStream.h"
 #include "solarus/core/Debug.h"
 #include "solarus/entities/EntityData.h"
 #include "solarus/entities/EntityTypeInfo.h"
@@ -658,7 +659,7 @@ const std::map<std::string, FieldValue>& EntityData::get_specific_properties() c
  */
 FieldValue EntityData::get_specific_property(const std::string& key) const {
 
-  const auto& it = specific_properties.find(key);
+  const auto it = specific_properties.find(key);
   if (it == specific_properties.end()) {
     return FieldValue();
   }
@@ -1056,6 +1057,129 @@ bool EntityData::export_to_lua(std::ostream& out) const {
   return true;
 }
 
+/**
+ * \brief Writes this entity in binary format.
+ *
+ * This is used by MapData::export_to_binary().
+ *
+ * \param writer The binary writer.
+ */
+void EntityData::write_binary(BinaryWriter& writer) const {
+
+  writer.write_string(get_type_name());
+  writer.write_string(get_name());
+  writer.write_int(get_layer());
+  writer.write_int(get_xy().x);
+  writer.write_int(get_xy().y);
+
+  // User-defined properties.
+  writer.write_int(get_user_property_count());
+  for (const UserProperty& user_property : user_properties) {
+    writer.write_string(user_property.first);
+    writer.write_string(user_property.second);
+  }
+
+  // Properties specific to the type of entity.
+  writer.write_int(static_cast<int>(specific_properties.size()));
+  for (const auto& kvp : specific_properties) {
+    const std::string& key = kvp.first;
+    const FieldValue& value = kvp.second;
+    writer.write_string(key);
+    writer.write_uint8(static_cast<uint8_t>(value.value_type));
+    switch (value.value_type) {
+
+      case EntityFieldType::STRING:
+        writer.write_string(value.string_value);
+        break;
+
+      case EntityFieldType::INTEGER:
+        writer.write_int(value.int_value);
+        break;
+
+      case EntityFieldType::BOOLEAN:
+        writer.write_bool(value.int_value != 0);
+        break;
+
+      case EntityFieldType::NIL:
+        Debug::die("Nil entity field");
+        break;
+    }
+  }
+}
+
+/**
+ * \brief Reads this entity from binary format.
+ *
+ * This is used by MapData::import_from_binary().
+ *
+ * \param reader The binary reader.
+ * \return \c true in case of success, \c false if the data is invalid.
+ * In case of failure, the entity is left in an unspecified state.
+ */
+bool EntityData::read_binary(BinaryReader& reader) {
+
+  bool success = false;
+  const EntityType type = name_to_enum(reader.read_string(), EntityType::TILE, success);
+  if (!success || !EntityTypeInfo::can_be_stored_in_map_file(type)) {
+    reader.set_invalid();
+    return false;
+  }
+  this->type = type;
+  initialize_specific_properties();
+  set_name(reader.read_string());
+  set_layer(reader.read_int());
+  const int x = reader.read_int();
+  const int y = reader.read_int();
+  set_xy({ x, y });
+
+  // User-defined properties.
+  user_properties.clear();
+  const int num_user_properties = reader.read_count(8);
+  for (int i = 0; i < num_user_properties && reader.is_valid(); ++i) {
+    const std::string& key = reader.read_string();
+    const std::string& value = reader.read_string();
+    if (!is_user_property_key_valid(key) || has_user_property(key)) {
+      reader.set_invalid();
+      return false;
+    }
+    add_user_property(std::make_pair(key, value));
+  }
+
+  // Properties specific to the type of entity.
+  const int num_specific_properties = reader.read_count(5);
+  for (int i = 0; i < num_specific_properties && reader.is_valid(); ++i) {
+    const std::string& key = reader.read_string();
+    const uint8_t value_type = reader.read_uint8();
+    const auto& it = specific_properties.find(key);
+    if (it == specific_properties.end() ||
+        value_type != static_cast<uint8_t>(it->second.value_type)) {
+      reader.set_invalid();
+      return false;
+    }
+    FieldValue& value = it->second;
+    switch (value.value_type) {
+
+      case EntityFieldType::STRING:
+        value.string_value = reader.read_string();
+        break;
+
+      case EntityFieldType::INTEGER:
+        value.int_value = reader.read_int();
+        break;
+
+      case EntityFieldType::BOOLEAN:
+        value.int_value = reader.read_bool() ? 1 : 0;
+        break;
+
+      case EntityFieldType::NIL:
+        reader.set_invalid();
+        return false;
+    }
+  }
+
+  return reader.is_valid();
+}
+
 /**
  * \brief Exports the user-defined properties to a stream.
  * \param out Output stream to write.
@@ -16,13 +16,222 @@
  */
 #include "solarus/core/Debug.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/WorkerPool.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/entities/Tileset.h"
+#include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/SDLPtrs.h"
 #include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief A tile pattern to copy on the CPU when building a cell.
+ */
+struct TileCopy {
+  const SDL_Surface* tileset_image;  /**< Pixels of the tileset. */
+  Rectangle region;                  /**< Region of the pattern in the tileset image. */
+  Rectangle dst_box;                 /**< Box of the tile relative to the cell. */
+};
+
+/**
+ * \brief Everything needed to compose the pixels of a cell on the CPU.
+ *
+ * It is prepared in the main thread and then composed by a worker thread.
+ */
+struct CellPixels {
+  int cell_index;                        /**< Index of the cell. */
+  std::vector<TileCopy> tiles;           /**< Tiles to draw, in order. */
+  std::vector<Rectangle> erased_squares; /**< Squares to make transparent. */
+  SDL_Surface_UniquePtr pixels;          /**< The pixels to compose. */
+};
+
+/**
+ * \brief Blends a straight alpha pixel on a premultiplied alpha pixel.
+ *
+ * This is what the renderer does when drawing a tileset image on a cell.
+ *
+ * \param src The pixel to draw.
+ * \param dst The pixel to draw on.
+ * \param alpha_shift Position of the alpha channel in both pixels.
+ * \return The resulting pixel.
+ */
+inline uint32_t blend_on_premultiplied(uint32_t src, uint32_t dst, int alpha_shift) {
+
+  const uint32_t alpha = (src >> alpha_shift) & 0xFF;
+  if (alpha == 0xFF) {
+    return src;
+  }
+  if (alpha == 0) {
+    return dst;
+  }
+
+  const uint32_t inverse_alpha = 0xFF - alpha;
+  uint32_t result = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    const uint32_t src_channel = (src >> shift) & 0xFF;
+    const uint32_t dst_channel = (dst >> shift) & 0xFF;
+    const uint32_t channel = (shift == alpha_shift) ?
+        src_channel * 0xFF + dst_channel * inverse_alpha :
+        src_channel * alpha + dst_channel * inverse_alpha;
+    result |= ((channel + 127) / 255) << shift;
+  }
+  return result;
+}
+
+/**
+ * \brief Draws a region of a tileset image on the pixels of a cell.
+ * \param src The tileset image.
+ * \param region The region to draw. It is clipped to the tileset image.
+ * \param dst The pixels of the cell.
+ * \param dst_xy Where to draw the region on the cell.
+ */
+void copy_region(
+    const SDL_Surface& src,
+    const Rectangle& region,
+    SDL_Surface& dst,
+    const Point& dst_xy
+) {
+  int src_x = region.get_x();
+  int src_y = region.get_y();
+  int dst_x = dst_xy.x;
+  int dst_y = dst_xy.y;
+  int width = region.get_width();
+  int height = region.get_height();
+
+  // Clip to the source and to the destination.
+  const int left_clip = std::max(std::max(0, -src_x), -dst_x);
+  const int top_clip = std::max(std::max(0, -src_y), -dst_y);
+  src_x += left_clip;
+  dst_x += left_clip;
+  width -= left_clip;
+  src_y += top_clip;
+  dst_y += top_clip;
+  height -= top_clip;
+  width = std::min(width, std::min(src.w - src_x, dst.w - dst_x));
+  height = std::min(height, std::min(src.h - src_y, dst.h - dst_y));
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+
+  const int alpha_shift = src.format->Ashift;
+  for (int y = 0; y < height; ++y) {
+    const uint32_t* src_row = reinterpret_cast<const uint32_t*>(
+        static_cast<const uint8_t*>(src.pixels) + (src_y + y) * src.pitch) + src_x;
+    uint32_t* dst_row = reinterpret_cast<uint32_t*>(
+        static_cast<uint8_t*>(dst.pixels) + (dst_y + y) * dst.pitch) + dst_x;
+    for (int x = 0; x < width; ++x) {
+      dst_row[x] = blend_on_premultiplied(src_row[x], dst_row[x], alpha_shift);
+    }
+  }
+}
+
+/**
+ * \brief Composes the pixels of a cell.
+ *
+ * This function runs in worker threads.
+ *
+ * \param cell The cell to compose. Its pixels must be initially transparent.
+ */
+void compose_cell_pixels(CellPixels& cell) {
+
+  SDL_Surface& dst = *cell.pixels;
+  for (const TileCopy& tile: cell.tiles) {
+    // Repeat the pattern like TilePattern::fill_surface() does.
+    const Rectangle& box = tile.dst_box;
+    const int limit_x = box.get_x() + box.get_width();
+    const int limit_y = box.get_y() + box.get_height();
+    for (int y = box.get_y(); y < limit_y; y += tile.region.get_height()) {
+      for (int x = box.get_x(); x < limit_x; x += tile.region.get_width()) {
+        copy_region(*tile.tileset_image, tile.region, dst, Point(x, y));
+      }
+    }
+  }
+
+  for (const Rectangle& square: cell.erased_squares) {
+    for (int y = square.get_y(); y < square.get_y() + square.get_height(); ++y) {
+      uint32_t* row = reinterpret_cast<uint32_t*>(
+          static_cast<uint8_t*>(dst.pixels) + y * dst.pitch);
+      std::fill(row + square.get_x(), row + square.get_x() + square.get_width(), 0);
+    }
+  }
+}
+
+/**
+ * \brief Prepares the tiles of a cell to be composed on the CPU.
+ * \param tiles The tiles of the cell.
+ * \param cell_xy Position of the cell on the map.
+ * \param[out] copies The tiles to draw.
+ * \return \c false if some tiles cannot be drawn on the CPU.
+ */
+bool get_tile_copies(
+    const std::vector<TileInfo>& tiles,
+    const Point& cell_xy,
+    std::vector<TileCopy>& copies
+) {
+  const Uint32 format = Video::get_rgba_format()->format;
+  for (const TileInfo& tile: tiles) {
+    Rectangle region;
+    if (tile.tileset == nullptr || !tile.pattern->get_static_region(region) ||
+        region.is_flat()) {
+      return false;
+    }
+
+    const SDL_Surface* tileset_image =
+        tile.tileset->get_tiles_image()->get_internal_surface().get_surface();
+    if (tileset_image == nullptr ||
+        tileset_image->format->format != format ||
+        SDL_MUSTLOCK(tileset_image)) {
+      return false;
+    }
+
+    copies.push_back({
+        tileset_image,
+        region,
+        Rectangle(tile.box.get_xy() - cell_xy, tile.box.get_size())
+    });
+  }
+  return true;
+}
+
+/**
+ * \brief Prepares a cell to be composed on the CPU.
+ * \param tiles The tiles of the cell.
+ * \param cell_box Position and size of the cell on the map.
+ * \param[out] cell The cell to prepare: its tiles and transparent pixels
+ * are set.
+ * \return \c false if the cell cannot be composed on the CPU.
+ */
+bool prepare_cell_pixels(
+    const std::vector<TileInfo>& tiles,
+    const Rectangle& cell_box,
+    CellPixels& cell
+) {
+  if (!get_tile_copies(tiles, cell_box.get_xy(), cell.tiles)) {
+    return false;
+  }
+
+  cell.pixels.reset(SDL_CreateRGBSurfaceWithFormat(
+      0, cell_box.get_width(), cell_box.get_height(), 32,
+      Video::get_rgba_format()->format));
+  return cell.pixels != nullptr;
+}
+
+}
+
+constexpr int NonAnimatedRegions::default_cache_size;
+constexpr int NonAnimatedRegions::prebuild_time_budget;
+
+int NonAnimatedRegions::cache_size = NonAnimatedRegions::default_cache_size;
+int NonAnimatedRegions::cache_memory = 0;
+
 /**
  * \brief Constructor.
  * \param map The map. Its size must be known.
@@ -31,10 +240,22 @@ namespace Solarus {
 NonAnimatedRegions::NonAnimatedRegions(Map& map, int layer):
   map(map),
   layer(layer),
-  non_animated_tiles(map.get_size(), Size(512, 256)) {
+  non_animated_tiles(map.get_size(), Size(512, 256)),
+  num_resident_cells(0),
+  num_cells_built_last_draw(0),
+  previous_camera_xy(),
+  camera_direction() {
 
 }
 
+/**
+ * \brief Destructor.
+ */
+NonAnimatedRegions::~NonAnimatedRegions() {
+
+  cache_memory -= num_resident_cells * get_cell_memory();
+}
+
 /**
  * \brief Adds a tile to the list of tiles.
  */
@@ -119,8 +340,10 @@ void NonAnimatedRegions::build(std::vector<TileInfo>& rejected_tiles) {
  */
 void NonAnimatedRegions::notify_tileset_changed() {
 
-  for (unsigned i = 0; i < non_animated_tiles.get_num_cells(); ++i) {
-    optimized_tiles_surfaces[i] = nullptr;
+  for (unsigned i = 0; i < optimized_tiles_surfaces.size(); ++i) {
+    if (optimized_tiles_surfaces[i] != nullptr) {
+      unload_cell(i);
+    }
   }
   // Everything will be redrawn when necessary.
 }
@@ -158,22 +381,208 @@ bool NonAnimatedRegions::overlaps_animated_tile(const TileInfo& tile) const {
   return false;
 }
 
+/**
+ * \brief Returns the number of cells whose surface is currently built.
+ * \return The number of resident cells.
+ */
+int NonAnimatedRegions::get_num_resident_cells() const {
+  return num_resident_cells;
+}
+
+/**
+ * \brief Returns the number of cells built during the last draw.
+ *
+ * This includes cells that became visible and cells built in advance.
+ *
+ * \return The number of cells built by the last call to draw_on_map().
+ */
+int NonAnimatedRegions::get_num_cells_built_last_draw() const {
+  return num_cells_built_last_draw;
+}
+
+/**
+ * \brief Returns the number of cells of the grid, built or not.
+ * \return The number of cells of this layer.
+ */
+int NonAnimatedRegions::get_num_cells() const {
+  return non_animated_tiles.get_num_cells();
+}
+
+/**
+ * \brief Composes the pixels of a cell on the CPU, like build_cells() does
+ * for cells whose tiles allow it.
+ *
+ * The cell cache is not affected. This is useful to check the CPU
+ * composition against render_cell().
+ *
+ * \param cell_index Index of a cell.
+ * \return A new surface with the pixels of the cell,
+ * or nullptr if this cell cannot be composed on the CPU.
+ */
+SurfacePtr NonAnimatedRegions::compose_cell(int cell_index) const {
+
+  Debug::check_assertion(
+      cell_index >= 0 && (size_t) cell_index < non_animated_tiles.get_num_cells(),
+      "Wrong cell index"
+  );
+
+  const Rectangle& cell_box = get_cell_box(cell_index);
+  CellPixels cell_pixels;
+  cell_pixels.cell_index = cell_index;
+  if (!prepare_cell_pixels(
+        non_animated_tiles.get_elements(cell_index),
+        cell_box,
+        cell_pixels
+  )) {
+    return nullptr;
+  }
+  cell_pixels.erased_squares = get_animated_squares(cell_index);
+  compose_cell_pixels(cell_pixels);
+
+  SurfacePtr cell_surface = Surface::create(cell_box.get_size(), true);
+  cell_surface->request_render().replace_pixels(*cell_pixels.pixels);
+  return cell_surface;
+}
+
+/**
+ * \brief Draws a cell tile by tile with the renderer.
+ *
+ * The cell cache is not affected.
+ *
+ * \param cell_index Index of a cell.
+ * \return A new surface with the pixels of the cell.
+ */
+SurfacePtr NonAnimatedRegions::render_cell(int cell_index) const {
+
+  Debug::check_assertion(
+      cell_index >= 0 && (size_t) cell_index < non_animated_tiles.get_num_cells(),
+      "Wrong cell index"
+  );
+
+  SurfacePtr cell_surface = Surface::create(non_animated_tiles.get_cell_size(), true);
+  draw_cell(cell_index, cell_surface);
+  return cell_surface;
+}
+
+/**
+ * \brief Returns the maximum size of the cells kept in memory.
+ * \return The size of the cell cache in bytes, for all layers of all maps.
+ */
+int NonAnimatedRegions::get_cache_size() {
+  return cache_size;
+}
+
+/**
+ * \brief Sets the maximum size of the cells kept in memory.
+ *
+ * When the cache is full, the cells farthest from the camera are unloaded
+ * at the next draw. Visible cells are never unloaded, so the cache may
+ * temporarily exceed this size.
+ *
+ * \param cache_size The size of the cell cache in bytes.
+ */
+void NonAnimatedRegions::set_cache_size(int cache_size) {
+
+  Debug::check_assertion(cache_size >= 0, "Invalid tile cache size");
+
+  NonAnimatedRegions::cache_size = cache_size;
+}
+
+/**
+ * \brief Returns the size of the cells currently kept in memory.
+ * \return The size of all resident cells in bytes, for all layers of all maps.
+ */
+int NonAnimatedRegions::get_cache_memory() {
+  return cache_memory;
+}
+
+/**
+ * \brief Returns the rectangle of the map covered by a cell.
+ * \param cell_index Index of a cell.
+ * \return The position and size of this cell on the map.
+ */
+Rectangle NonAnimatedRegions::get_cell_box(int cell_index) const {
+
+  const int num_columns = non_animated_tiles.get_num_columns();
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  return Rectangle(
+      (cell_index % num_columns) * cell_size.width,
+      (cell_index / num_columns) * cell_size.height,
+      cell_size.width,
+      cell_size.height
+  );
+}
+
+/**
+ * \brief Returns the size in memory of the surface of a cell.
+ * \return The size in bytes of a built cell.
+ */
+int NonAnimatedRegions::get_cell_memory() const {
+
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  return cell_size.width * cell_size.height * 4;
+}
+
+/**
+ * \brief Returns the region of the map whose cells should be built.
+ *
+ * This is the camera rectangle extended by one cell in the direction
+ * where the camera was moving last.
+ *
+ * \param camera_position The current camera rectangle.
+ * \return The region to build.
+ */
+Rectangle NonAnimatedRegions::get_prebuild_box(const Rectangle& camera_position) const {
+
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  Rectangle prebuild_box = camera_position;
+
+  if (camera_direction.x < 0) {
+    prebuild_box.set_x(prebuild_box.get_x() - cell_size.width);
+  }
+  if (camera_direction.y < 0) {
+    prebuild_box.set_y(prebuild_box.get_y() - cell_size.height);
+  }
+  prebuild_box.set_width(prebuild_box.get_width() + std::abs(camera_direction.x) * cell_size.width);
+  prebuild_box.set_height(prebuild_box.get_height() + std::abs(camera_direction.y) * cell_size.height);
+
+  return prebuild_box;
+}
+
 /**
  * \brief Draws a layer of non-animated regions of tiles on the current map.
+ *
+ * Cells that overlap the camera are built if necessary. Then, cells that
+ * will soon be visible are built in advance if there is time left in the
+ * budget of this frame, and far cells are unloaded if the cache is full.
  */
 void NonAnimatedRegions::draw_on_map() {
 
+  num_cells_built_last_draw = 0;
+
   const CameraPtr& camera = map.get_camera();
   if (camera == nullptr) {
     return;
   }
 
+  const Clock::time_point start_time = Clock::now();
+
   // Check all grid cells that overlap the camera.
   const int num_rows = non_animated_tiles.get_num_rows();
   const int num_columns = non_animated_tiles.get_num_columns();
   const Size& cell_size = non_animated_tiles.get_cell_size();
   const Rectangle& camera_position = camera->get_bounding_box();
 
+  // Remember where the camera is going.
+  const Point camera_move = camera_position.get_xy() - previous_camera_xy;
+  if (camera_move.x != 0 || camera_move.y != 0) {
+    camera_direction = {
+        (camera_move.x > 0) - (camera_move.x < 0),
+        (camera_move.y > 0) - (camera_move.y < 0)
+    };
+    previous_camera_xy = camera_position.get_xy();
+  }
+
   const int row1 = camera_position.get_y() / cell_size.height;
   const int row2 = (camera_position.get_y() + camera_position.get_height()) / cell_size.height;
   const int column1 = camera_position.get_x() / cell_size.width;
@@ -184,6 +593,20 @@ void NonAnimatedRegions::draw_on_map() {
     return;
   }
 
+  // Lazily build the visible cells, all at once.
+  std::vector<int> cells_to_build;
+  for (int i = std::max(0, row1); i <= std::min(num_rows - 1, row2); ++i) {
+    for (int j = std::max(0, column1); j <= std::min(num_columns - 1, column2); ++j) {
+      const int cell_index = i * num_columns + j;
+      if (optimized_tiles_surfaces[cell_index] == nullptr) {
+        cells_to_build.push_back(cell_index);
+      }
+    }
+  }
+  if (!cells_to_build.empty()) {
+    build_cells(cells_to_build);
+  }
+
   for (int i = row1; i <= row2; ++i) {
     if (i < 0 || i >= num_rows) {
       continue;
@@ -194,13 +617,7 @@ void NonAnimatedRegions::draw_on_map() {
         continue;
       }
 
-      // Make sure this cell is built.
       int cell_index = i * num_columns + j;
-      if (optimized_tiles_surfaces[cell_index] == nullptr) {
-        // Lazily build the cell.
-        build_cell(cell_index);
-      }
-
       const Point cell_xy = {
           j * cell_size.width,
           i * cell_size.height
@@ -212,36 +629,179 @@ void NonAnimatedRegions::draw_on_map() {
       );
     }
   }
+
+  const Rectangle& prebuild_box = get_prebuild_box(camera_position);
+  const Point& camera_center = camera_position.get_center();
+  prebuild_cells(prebuild_box, camera_center, start_time);
+  shrink_cache(prebuild_box, camera_center);
 }
 
 /**
- * \brief Draws all non-animated tiles of a cell on its surface.
- * \param cell_index Index of the cell to draw.
+ * \brief Builds cells of a region in advance, closest ones first,
+ * until the time budget of this frame is exhausted.
+ * \param prebuild_box The region whose cells should be built.
+ * \param camera_center Center of the camera on the map.
+ * \param start_time Date when the drawing of this frame started.
  */
-void NonAnimatedRegions::build_cell(int cell_index) {
+void NonAnimatedRegions::prebuild_cells(
+    const Rectangle& prebuild_box,
+    const Point& camera_center,
+    const Clock::time_point& start_time
+) {
+  const std::chrono::microseconds budget(prebuild_time_budget);
+  if (Clock::now() - start_time >= budget) {
+    return;
+  }
 
-  Debug::check_assertion(
-      cell_index >= 0 && (size_t) cell_index < non_animated_tiles.get_num_cells(),
-      "Wrong cell index"
-  );
-  Debug::check_assertion(optimized_tiles_surfaces[cell_index] == nullptr,
-      "This cell is already built"
-  );
+  const int num_rows = non_animated_tiles.get_num_rows();
+  const int num_columns = non_animated_tiles.get_num_columns();
+  const Size& cell_size = non_animated_tiles.get_cell_size();
 
-  const int row = cell_index / non_animated_tiles.get_num_columns();
-  const int column = cell_index % non_animated_tiles.get_num_columns();
+  const int row1 = std::max(0, prebuild_box.get_y() / cell_size.height);
+  const int row2 = std::min(num_rows - 1, (prebuild_box.get_y() + prebuild_box.get_height()) / cell_size.height);
+  const int column1 = std::max(0, prebuild_box.get_x() / cell_size.width);
+  const int column2 = std::min(num_columns - 1, (prebuild_box.get_x() + prebuild_box.get_width()) / cell_size.width);
+
+  // Cells not built yet, with their square distance to the camera.
+  std::vector<std::pair<int, int>> cells_to_build;
+  for (int i = row1; i <= row2; ++i) {
+    for (int j = column1; j <= column2; ++j) {
+      const int cell_index = i * num_columns + j;
+      if (optimized_tiles_surfaces[cell_index] == nullptr) {
+        const Point& cell_center = get_cell_box(cell_index).get_center();
+        const int dx = cell_center.x - camera_center.x;
+        const int dy = cell_center.y - camera_center.y;
+        cells_to_build.emplace_back(dx * dx + dy * dy, cell_index);
+      }
+    }
+  }
+  std::sort(cells_to_build.begin(), cells_to_build.end());
+
+  // Build them by groups that worker threads can compose in parallel.
+  const size_t group_size = WorkerPool::get_default_num_threads();
+  std::vector<int> group;
+  for (size_t i = 0; i < cells_to_build.size(); i += group_size) {
+    if (Clock::now() - start_time >= budget) {
+      // Continue at the next frame.
+      return;
+    }
+    group.clear();
+    for (size_t j = i; j < std::min(i + group_size, cells_to_build.size()); ++j) {
+      group.push_back(cells_to_build[j].second);
+    }
+    build_cells(group);
+  }
+}
+
+/**
+ * \brief Unloads cells farthest from the camera while the cache is full.
+ *
+ * Cells in the region to build are never unloaded.
+ *
+ * \param prebuild_box The region whose cells should stay built.
+ * \param camera_center Center of the camera on the map.
+ */
+void NonAnimatedRegions::shrink_cache(
+    const Rectangle& prebuild_box,
+    const Point& camera_center
+) {
+  while (cache_memory > cache_size) {
+
+    int farthest_cell_index = -1;
+    int farthest_distance = -1;
+    for (size_t i = 0; i < optimized_tiles_surfaces.size(); ++i) {
+      if (optimized_tiles_surfaces[i] == nullptr) {
+        continue;
+      }
+      const Rectangle& cell_box = get_cell_box(i);
+      if (cell_box.overlaps(prebuild_box)) {
+        continue;
+      }
+      const int dx = cell_box.get_center().x - camera_center.x;
+      const int dy = cell_box.get_center().y - camera_center.y;
+      const int distance = dx * dx + dy * dy;
+      if (distance > farthest_distance) {
+        farthest_distance = distance;
+        farthest_cell_index = i;
+      }
+    }
+
+    if (farthest_cell_index == -1) {
+      // Nothing more to unload in this layer.
+      return;
+    }
+    unload_cell(farthest_cell_index);
+  }
+}
+
+/**
+ * \brief Builds the surface of some cells.
+ *
+ * Cells whose tiles are plain copies of tileset regions are composed on the
+ * CPU in parallel and then uploaded at once. Other cells are drawn tile by
+ * tile by the renderer.
+ *
+ * \param cell_indices Indexes of the cells to build. They must not be built yet.
+ */
+void NonAnimatedRegions::build_cells(const std::vector<int>& cell_indices) {
 
-  // Position of this cell on the map.
   const Size cell_size = non_animated_tiles.get_cell_size();
-  const Point cell_xy = {
-      column * cell_size.width,
-      row * cell_size.height
-  };
+  std::vector<CellPixels> cells_pixels;
+
+  for (int cell_index: cell_indices) {
+
+    Debug::check_assertion(
+        cell_index >= 0 && (size_t) cell_index < non_animated_tiles.get_num_cells(),
+        "Wrong cell index"
+    );
+    Debug::check_assertion(optimized_tiles_surfaces[cell_index] == nullptr,
+        "This cell is already built"
+    );
+
+    optimized_tiles_surfaces[cell_index] = Surface::create(cell_size, true);
+    ++num_resident_cells;
+    ++num_cells_built_last_draw;
+    cache_memory += get_cell_memory();
+    // Let this surface as a software destination because it is built only
+    // once (here) and never changes later.
+
+    CellPixels cell_pixels;
+    cell_pixels.cell_index = cell_index;
+    if (!prepare_cell_pixels(
+          non_animated_tiles.get_elements(cell_index),
+          get_cell_box(cell_index),
+          cell_pixels
+    )) {
+      draw_cell(cell_index, optimized_tiles_surfaces[cell_index]);
+      continue;
+    }
+    cell_pixels.erased_squares = get_animated_squares(cell_index);
+    cells_pixels.push_back(std::move(cell_pixels));
+  }
+
+  // Compose the pixels in parallel and upload each cell at once.
+  WorkerPool::run(cells_pixels.size(), WorkerPool::get_default_num_threads(),
+      [&cells_pixels](int i) {
+        compose_cell_pixels(cells_pixels[i]);
+      }
+  );
 
-  SurfacePtr cell_surface = Surface::create(cell_size,true);
-  optimized_tiles_surfaces[cell_index] = cell_surface;
-  // Let this surface as a software destination because it is built only
-  // once (here) and never changes later.
+  for (const CellPixels& cell_pixels: cells_pixels) {
+    optimized_tiles_surfaces[cell_pixels.cell_index]->request_render().replace_pixels(
+        *cell_pixels.pixels
+    );
+  }
+}
+
+/**
+ * \brief Draws all non-animated tiles of a cell on a surface with the
+ * renderer.
+ * \param cell_index Index of the cell to draw.
+ * \param cell_surface The surface to draw on. It must be initially transparent.
+ */
+void NonAnimatedRegions::draw_cell(int cell_index, const SurfacePtr& cell_surface) const {
+
+  const Point& cell_xy = get_cell_box(cell_index).get_xy();
 
   const std::vector<TileInfo>& tiles_in_cell =
       non_animated_tiles.get_elements(cell_index);
@@ -263,15 +823,31 @@ void NonAnimatedRegions::build_cell(int cell_index) {
     );
   }
 
-  // Remember that non-animated tiles are drawn after animated ones.
-  // We may have drawn too much.
-  // We have to make sure we don't exceed the non-animated regions.
-  // Erase 8x8 squares that contain animated tiles.
-  for (int y = cell_xy.y; y < cell_xy.y + cell_size.height; y += 8) {
+  for (const Rectangle& animated_square: get_animated_squares(cell_index)) {
+    cell_surface->clear(animated_square);
+  }
+}
+
+/**
+ * \brief Returns the 8x8 squares of a cell that contain animated tiles.
+ *
+ * Non-animated tiles are drawn after animated ones, so cells must not cover
+ * these squares: they have to be erased after drawing the tiles of the cell.
+ *
+ * \param cell_index Index of a cell.
+ * \return The animated squares, relative to the cell.
+ */
+std::vector<Rectangle> NonAnimatedRegions::get_animated_squares(int cell_index) const {
+
+  std::vector<Rectangle> animated_squares;
+  const Rectangle& cell_box = get_cell_box(cell_index);
+  const int cell_x = cell_box.get_x();
+  const int cell_y = cell_box.get_y();
+  for (int y = cell_y; y < cell_y + cell_box.get_height(); y += 8) {
     if (y >= map.get_height()) {  // The last cell might exceed the map border.
       continue;
     }
-    for (int x = cell_xy.x; x < cell_xy.x + cell_size.width; x += 8) {
+    for (int x = cell_x; x < cell_x + cell_box.get_width(); x += 8) {
       if (x >= map.get_width()) {
         continue;
       }
@@ -279,16 +855,34 @@ void NonAnimatedRegions::build_cell(int cell_index) {
       int square_index = (y / 8) * map.get_width8() + (x / 8);
 
       if (are_squares_animated[square_index]) {
-        Rectangle animated_square(
-            x - cell_xy.x,
-            y - cell_xy.y,
+        animated_squares.emplace_back(
+            x - cell_x,
+            y - cell_y,
             8,
             8
         );
-        cell_surface->clear(animated_square);
       }
     }
   }
+  return animated_squares;
+}
+
+/**
+ * \brief Frees the surface of a cell.
+ *
+ * It will be built again when necessary.
+ *
+ * \param cell_index Index of the cell to unload.
+ */
+void NonAnimatedRegions::unload_cell(int cell_index) {
+
+  Debug::check_assertion(optimized_tiles_surfaces[cell_index] != nullptr,
+      "This cell is not built"
+  );
+
+  optimized_tiles_surfaces[cell_index] = nullptr;
+  --num_resident_cells;
+  cache_memory -= get_cell_memory();
 }
 
 }
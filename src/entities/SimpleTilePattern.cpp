@@ -64,5 +64,18 @@ bool SimpleTilePattern::is_animated() const {
   return false;
 }
 
+/**
+ * \copydoc TilePattern::get_static_region
+ */
+bool SimpleTilePattern::get_static_region(Rectangle& region) const {
+
+  if (is_animated()) {
+    // Subclasses that scroll redefine draw().
+    return false;
+  }
+  region = position_in_tileset;
+  return true;
+}
+
 }
 
@@ -143,6 +143,21 @@ bool TilePattern::is_drawn_at_its_position() const {
   return true;
 }
 
+/**
+ * \brief Returns whether this tile pattern is always drawn by copying the
+ * same region of the tileset image.
+ *
+ * When this is the case, tiles can be drawn without calling draw(),
+ * for example by copying pixels on the CPU.
+ * Returns false by default.
+ *
+ * \param[out] region The region of the tileset image to copy, if any.
+ * \return \c true if this tile pattern is a plain copy of a region.
+ */
+bool TilePattern::get_static_region(Rectangle& /* region */) const {
+  return false;
+}
+
 /**
  * \brief Fills a rectangle by repeating this tile pattern.
  * \param dst_surface The destination surface.
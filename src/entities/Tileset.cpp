@@ -138,16 +138,30 @@ void Tileset::load() {
   std::string file_name = std::string("tilesets/") + id + ".dat";
   TilesetData data;
   bool success = data.import_from_quest_file(file_name);
-  if (success) {
-    // Get the imported data.
-    this->background_color = data.get_background_color();
-    for (const auto& kvp : data.get_patterns()) {
-      add_tile_pattern(kvp.first, kvp.second);
-    }
+  if (!success) {
+    data = TilesetData();
+  }
+
+  load(data);
+}
+
+/**
+ * \brief Loads this tileset from data already read.
+ *
+ * The tileset images are loaded from their files.
+ *
+ * \param data The content of the tileset data file.
+ */
+void Tileset::load(const TilesetData& data) {
+
+  // Get the imported data.
+  this->background_color = data.get_background_color();
+  for (const auto& kvp : data.get_patterns()) {
+    add_tile_pattern(kvp.first, kvp.second);
   }
 
   // Load the tileset images.
-  file_name = std::string("tilesets/") + id + ".tiles.png";
+  std::string file_name = std::string("tilesets/") + id + ".tiles.png";
   tiles_image = Surface::create(file_name, Surface::DIR_DATA);
   if (tiles_image == nullptr) {
     Debug::error(std::string("Missing tiles image for tileset '") + id + "': " + file_name);
@@ -14,15 +14,24 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryStream.h"
 #include "solarus/core/Debug.h"
 #include "solarus/entities/GroundInfo.h"
 #include "solarus/entities/TilesetData.h"
 #include "solarus/lua/LuaTools.h"
 #include <ostream>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
+namespace {
+
+const std::string binary_format_name = "tileset";  /**< Header of binary tileset files. */
+constexpr int binary_format_version = 1;           /**< Version of binary tileset files. */
+
+}
+
 const std::string EnumInfoTraits<TileScrolling>::pretty_name = "tile scrolling";
 
 const EnumInfo<TileScrolling>::names_type EnumInfoTraits<TileScrolling>::names = {
@@ -717,4 +726,143 @@ bool TilesetData::export_to_lua(std::ostream& out) const {
   return true;
 }
 
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool TilesetData::import_from_binary(const std::string& buffer) {
+
+  BinaryReader reader(buffer);
+  if (!reader.read_header(binary_format_name, binary_format_version)) {
+    return false;
+  }
+
+  // Read into a separate object to leave this one unchanged in case of failure.
+  TilesetData tileset;
+  const int r = reader.read_uint8();
+  const int g = reader.read_uint8();
+  const int b = reader.read_uint8();
+  const int a = reader.read_uint8();
+  tileset.set_background_color(Color(r, g, b, a));
+
+  // Tile patterns.
+  const int num_patterns = reader.read_count(29);
+  for (int i = 0; i < num_patterns && reader.is_valid(); ++i) {
+    const std::string& id = reader.read_string();
+    TilePatternData pattern;
+
+    bool success = false;
+    pattern.set_ground(name_to_enum(reader.read_string(), Ground::TRAVERSABLE, success));
+    if (!success) {
+      return false;
+    }
+    pattern.set_default_layer(reader.read_int());
+    pattern.set_scrolling(name_to_enum(reader.read_string(), TileScrolling::NONE, success));
+    if (!success) {
+      return false;
+    }
+    pattern.set_repeat_mode(name_to_enum(reader.read_string(), TilePatternRepeatMode::ALL, success));
+    if (!success) {
+      return false;
+    }
+
+    const int num_frames = reader.read_count(16);
+    if (num_frames != 1 && num_frames != 3 && num_frames != 4) {
+      return false;
+    }
+    std::vector<Rectangle> frames;
+    for (int j = 0; j < num_frames; ++j) {
+      const int x = reader.read_int();
+      const int y = reader.read_int();
+      const int width = reader.read_int();
+      const int height = reader.read_int();
+      frames.emplace_back(x, y, width, height);
+    }
+    pattern.set_frames(frames);
+
+    if (!reader.is_valid() || !tileset.add_pattern(id, pattern)) {
+      return false;
+    }
+  }
+
+  // Border sets.
+  const int num_border_sets = reader.read_count(9);
+  for (int i = 0; i < num_border_sets && reader.is_valid(); ++i) {
+    const std::string& id = reader.read_string();
+    BorderSet border_set;
+    border_set.set_inner(reader.read_bool());
+
+    const int num_border_patterns = reader.read_count(8);
+    for (int j = 0; j < num_border_patterns; ++j) {
+      const int border_kind = reader.read_int();
+      const std::string& pattern_id = reader.read_string();
+      if (border_kind < 0 || border_kind >= 12 || pattern_id.empty()) {
+        return false;
+      }
+      border_set.set_pattern(static_cast<BorderKind>(border_kind), pattern_id);
+    }
+
+    if (!reader.is_valid() || !tileset.add_border_set(id, border_set)) {
+      return false;
+    }
+  }
+
+  if (!reader.is_valid() || !reader.is_at_end()) {
+    return false;
+  }
+
+  *this = std::move(tileset);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool TilesetData::export_to_binary(std::string& buffer) const {
+
+  BinaryWriter writer(buffer);
+  writer.write_header(binary_format_name, binary_format_version);
+
+  // Background color.
+  uint8_t r, g, b, a;
+  background_color.get_components(r, g, b, a);
+  writer.write_uint8(r);
+  writer.write_uint8(g);
+  writer.write_uint8(b);
+  writer.write_uint8(a);
+
+  // Tile patterns.
+  writer.write_int(get_num_patterns());
+  for (const auto& kvp : patterns) {
+    const TilePatternData& pattern = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_string(enum_to_name(pattern.get_ground()));
+    writer.write_int(pattern.get_default_layer());
+    writer.write_string(enum_to_name(pattern.get_scrolling()));
+    writer.write_string(enum_to_name(pattern.get_repeat_mode()));
+    writer.write_int(pattern.get_num_frames());
+    for (const Rectangle& frame : pattern.get_frames()) {
+      writer.write_int(frame.get_x());
+      writer.write_int(frame.get_y());
+      writer.write_int(frame.get_width());
+      writer.write_int(frame.get_height());
+    }
+  }
+
+  // Border sets.
+  writer.write_int(get_num_border_sets());
+  for (const auto& kvp : border_sets) {
+    const BorderSet& border_set = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_bool(border_set.is_inner());
+    const std::map<BorderKind, std::string>& border_patterns = border_set.get_patterns();
+    writer.write_int(static_cast<int>(border_patterns.size()));
+    for (const auto& border_pattern : border_patterns) {
+      writer.write_int(static_cast<int>(border_pattern.first));
+      writer.write_string(border_pattern.second);
+    }
+  }
+
+  return true;
+}
+
 }
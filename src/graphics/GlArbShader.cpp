@@ -121,6 +121,7 @@ PFNGLUNIFORMMATRIX3FVARBPROC  glUniformMatrix3fvARB;
 PFNGLGENBUFFERSARBPROC glGenBuffersARB;
 PFNGLBINDBUFFERARBPROC glBindBufferARB;
 PFNGLBUFFERDATAARBPROC glBufferDataARB;
+PFNGLBUFFERSUBDATAARBPROC glBufferSubDataARB;
 
 PFNGLVERTEXATTRIBPOINTERARBPROC glVertexAttribPointerARB;
 PFNGLENABLEVERTEXATTRIBARRAYARBPROC glEnableVertexAttribArrayARB;
@@ -190,6 +191,7 @@ bool GlArbShader::initialize() {
     glGenBuffersARB = get_proc_address_cast<PFNGLGENBUFFERSARBPROC>(SDL_GL_GetProcAddress("glGenBuffersARB"));
     glBindBufferARB = get_proc_address_cast<PFNGLBINDBUFFERARBPROC>(SDL_GL_GetProcAddress("glBindBufferARB"));
     glBufferDataARB = get_proc_address_cast<PFNGLBUFFERDATAARBPROC>(SDL_GL_GetProcAddress("glBufferDataARB"));
+    glBufferSubDataARB = get_proc_address_cast<PFNGLBUFFERSUBDATAARBPROC>(SDL_GL_GetProcAddress("glBufferSubDataARB"));
     glVertexAttribPointerARB = get_proc_address_cast<PFNGLVERTEXATTRIBPOINTERARBPROC>(SDL_GL_GetProcAddress("glVertexAttribPointerARB"));
     glEnableVertexAttribArrayARB = get_proc_address_cast<PFNGLENABLEVERTEXATTRIBARRAYARBPROC>(SDL_GL_GetProcAddress("glEnableVertexAttribArrayARB"));
     glGetAttribLocationARB = get_proc_address_cast<PFNGLGETATTRIBLOCATIONARBPROC>(SDL_GL_GetProcAddress("glGetAttribLocationARB"));
@@ -216,6 +218,7 @@ bool GlArbShader::initialize() {
         glGenBuffersARB &&
         glBindBufferARB &&
         glBufferDataARB &&
+        glBufferSubDataARB &&
         glVertexAttribPointerARB &&
         glEnableVertexAttribArrayARB &&
         glGetAttribLocationARB
@@ -341,7 +344,10 @@ void GlArbShader::load() {
     set_error(std::string("Failed to link shader ") + get_id() + std::string(" :\n") + info);
     set_valid(false);
     SDL_stack_free(info);
+    return;
   }
+
+  resolve_builtin_uniforms();
 }
 
 /**
@@ -381,16 +387,20 @@ GLhandleARB GlArbShader::create_shader(unsigned int type, const char* source) {
  * \copydoc Shader::render
  */
 void GlArbShader::render(const VertexArray& array, const Surface& texture, const glm::mat4 &mvp_matrix, const glm::mat3 &uv_matrix) {
-  if(array.vertex_buffer == 0) {
+  VertexArray::Buffer& buffer = array.get_buffer_to_draw();
+  if(buffer.id == 0) {
     //Generate vertex-buffer
-    glGenBuffersARB(1,&array.vertex_buffer);
+    glGenBuffersARB(1,&buffer.id);
   }
-  glBindBufferARB(GL_ARRAY_BUFFER,array.vertex_buffer);
-  if(array.buffer_dirty) {
-    //Upload vertex buffer //TODO use glSubData if array size <= previous size
-    glBufferDataARB(GL_ARRAY_BUFFER,array.vertex_count()*sizeof(Vertex),array.data(),GL_DYNAMIC_DRAW);
-    array.buffer_dirty = false;
+  glBindBufferARB(GL_ARRAY_BUFFER,buffer.id);
+  if(array.grow_buffer(buffer)) {
+    glBufferDataARB(GL_ARRAY_BUFFER,buffer.capacity*sizeof(Vertex),nullptr,array.get_buffer_usage());
   }
+  //Upload modified vertices only
+  for(const VertexArray::Range& range : array.dirty_ranges) {
+    glBufferSubDataARB(GL_ARRAY_BUFFER,range.first*sizeof(Vertex),(range.second-range.first)*sizeof(Vertex),array.data()+range.first);
+  }
+  array.dirty_ranges.clear();
   GLhandleARB previous_program = glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
   glUseProgramObjectARB(program);
 
@@ -448,11 +458,20 @@ GLint GlArbShader::get_uniform_location(const std::string& uniform_name) const {
 }
 
 /**
- * \copydoc Shader::set_uniform1f
+ * \copydoc Shader::get_uniform_handle
+ *
+ * Handles of this class are uniform locations.
+ */
+int GlArbShader::get_uniform_handle(const std::string& uniform_name) {
+  return get_uniform_location(uniform_name);
+}
+
+/**
+ * \copydoc Shader::set_uniform_1b
  */
-void GlArbShader::set_uniform_1b(const std::string& uniform_name, bool value) {
+void GlArbShader::set_uniform_1b(int uniform_handle, bool value) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = uniform_handle;
   if (location == -1) {
     return;
   }
@@ -466,9 +485,9 @@ void GlArbShader::set_uniform_1b(const std::string& uniform_name, bool value) {
 /**
  * \copydoc Shader::set_uniform_1i
  */
-void GlArbShader::set_uniform_1i(const std::string& uniform_name, int value) {
+void GlArbShader::set_uniform_1i(int uniform_handle, int value) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = uniform_handle;
   if (location == -1) {
     return;
   }
@@ -482,9 +501,9 @@ void GlArbShader::set_uniform_1i(const std::string& uniform_name, int value) {
 /**
  * \copydoc Shader::set_uniform_1f
  */
-void GlArbShader::set_uniform_1f(const std::string& uniform_name, float value) {
+void GlArbShader::set_uniform_1f(int uniform_handle, float value) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = uniform_handle;
   if (location == -1) {
     return;
   }
@@ -498,9 +517,9 @@ void GlArbShader::set_uniform_1f(const std::string& uniform_name, float value) {
 /**
  * \copydoc Shader::set_uniform_2f
  */
-void GlArbShader::set_uniform_2f(const std::string& uniform_name, float value_1, float value_2) {
+void GlArbShader::set_uniform_2f(int uniform_handle, float value_1, float value_2) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = uniform_handle;
   if (location == -1) {
     return;
   }
@@ -515,9 +534,9 @@ void GlArbShader::set_uniform_2f(const std::string& uniform_name, float value_1,
  * \copydoc Shader::set_uniform_3f
  */
 void GlArbShader::set_uniform_3f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3) {
+    int uniform_handle, float value_1, float value_2, float value_3) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = uniform_handle;
   if (location == -1) {
     return;
   }
@@ -532,9 +551,9 @@ void GlArbShader::set_uniform_3f(
  * \copydoc Shader::set_uniform_4f
  */
 void GlArbShader::set_uniform_4f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) {
+    int uniform_handle, float value_1, float value_2, float value_3, float value_4) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = uniform_handle;
   if (location == -1) {
     return;
   }
@@ -548,15 +567,15 @@ void GlArbShader::set_uniform_4f(
 /**
  * \copydoc Shader::set_uniform_texture
  */
-bool GlArbShader::set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) {
-  const GLint location = get_uniform_location(uniform_name);
+bool GlArbShader::set_uniform_texture(int uniform_handle, const SurfacePtr& value) {
+  const GLint location = uniform_handle;
 
   if (location == -1) {
     // Not an error.
     return true;
   }
 
-  auto it = uniform_textures.find(uniform_name);
+  auto it = uniform_textures.find(location);
   if(it != uniform_textures.end()) {
     it->second.surface = value;
     return true; //Nothing else to do
@@ -567,7 +586,7 @@ bool GlArbShader::set_uniform_texture(const std::string& uniform_name, const Sur
   glUseProgramObjectARB(program);
 
   int texture_unit = ++current_texture_unit;
-  uniform_textures[uniform_name] = TextureUniform{value,(GLuint)texture_unit};
+  uniform_textures[location] = TextureUniform{value,(GLuint)texture_unit};
 
   glUniform1iARB(location, texture_unit);
 
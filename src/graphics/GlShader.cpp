@@ -29,6 +29,7 @@
 #include "solarus/third_party/glm/gtc/type_ptr.hpp"
 #include "solarus/third_party/glm/gtx/transform.hpp"
 #include "solarus/third_party/glm/gtx/matrix_transform_2d.hpp"
+#include <algorithm>
 
 
 namespace Solarus {
@@ -101,6 +102,8 @@ struct GlContext {
 
 namespace {
 GlContext ctx;
+std::unordered_map<GLuint, GLint>
+    renderer_attribute_states;  // Enabled state of each vertex attribute array outside shaders.
 }
 
 /**
@@ -123,6 +126,7 @@ bool GlShader::initialize() {
 #include "gles2funcs.h"
 #undef SDL_PROC
 
+  renderer_attribute_states.clear();
 
   //Init screen quad
   screen_quad.add_quad(Rectangle(0,0,1,1),Rectangle(0,1,1,-1),Color::white);
@@ -140,34 +144,24 @@ GlShader::GlShader(const std::string& shader_id):
   Shader(shader_id),
   program(0),
   vertex_shader(0),
-  fragment_shader(0) {
-
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+  fragment_shader(0),
+  position_location(-1),
+  tex_coord_location(-1),
+  color_location(-1),
+  mvp_matrix_location(-1),
+  uv_matrix_location(-1) {
 
   ctx.glGetError();
 
   // Load the shader.
   load();
 
-  ctx.glUseProgram(program);
   // Set up constant uniform variables.
-  GLint location = ctx.glGetUniformLocation(program, TEXTURE_NAME);
-  if (location >= 0) {
-    ctx.glUniform1i(location, 0);
-  }
+  // They are uploaded the first time the program is used.
+  set_uniform_1i(TEXTURE_NAME, 0);
 
   const Size& quest_size = Video::get_quest_size();
-  location = ctx.glGetUniformLocation(program, INPUT_SIZE_NAME);
-  if (location >= 0) {
-    ctx.glUniform2f(location, quest_size.width, quest_size.height);
-  }
-
-  position_location = ctx.glGetAttribLocation(program,POSITION_NAME);
-  tex_coord_location = ctx.glGetAttribLocation(program,TEXCOORD_NAME);
-  color_location = ctx.glGetAttribLocation(program,COLOR_NAME);
-
-  ctx.glUseProgram(previous_program);
+  set_uniform_2f(INPUT_SIZE_NAME, quest_size.width, quest_size.height);
 }
 
 /**
@@ -187,17 +181,20 @@ void GlShader::load() {
   GLint linked;
 
   // Load the shader data file.
-  const std::string shader_file_name =
-      "shaders/" + get_id() + ".dat";
+  // A shader without id uses the default sources.
+  if (!get_id().empty()) {
+    const std::string shader_file_name =
+        "shaders/" + get_id() + ".dat";
+
+    ShaderData data;
+    bool success = data.import_from_quest_file(shader_file_name);
+    if (!success) {
+      return;
+    }
 
-  ShaderData data;
-  bool success = data.import_from_quest_file(shader_file_name);
-  if (!success) {
-    return;
+    set_data(data);
   }
 
-  set_data(data);
-
   // Create the vertex and fragment shaders.
   vertex_shader = create_shader(GL_VERTEX_SHADER, get_vertex_source().c_str());
   fragment_shader = create_shader(GL_FRAGMENT_SHADER, get_fragment_source().c_str());
@@ -206,6 +203,7 @@ void GlShader::load() {
   program = ctx.glCreateProgram();
   if (program == 0) {
     Logger::error(std::string("Could not create OpenGL program"));
+    set_valid(false);
     return;
   }
 
@@ -229,7 +227,57 @@ void GlShader::load() {
     }
 
     ctx.glDeleteProgram(program);
+    program = 0;
+    set_valid(false);
+    set_error("Failed to link shader '" + get_id() + "'");
+    return;
+  }
+
+  resolve_locations();
+}
+
+/**
+ * \brief Finds the locations of all attributes and uniforms of the program.
+ *
+ * This is done once after linking so that rendering and setting uniforms
+ * never need to query the program.
+ */
+void GlShader::resolve_locations() {
+
+  position_location = ctx.glGetAttribLocation(program, POSITION_NAME);
+  tex_coord_location = ctx.glGetAttribLocation(program, TEXCOORD_NAME);
+  color_location = ctx.glGetAttribLocation(program, COLOR_NAME);
+  mvp_matrix_location = ctx.glGetUniformLocation(program, MVP_MATRIX_NAME);
+  uv_matrix_location = ctx.glGetUniformLocation(program, UV_MATRIX_NAME);
+
+  GLint num_uniforms = 0;
+  GLint max_name_length = 0;
+  ctx.glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+  ctx.glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+  std::vector<GLchar> name_buffer(std::max(max_name_length, 1));
+
+  for (GLint i = 0; i < num_uniforms; ++i) {
+    GLsizei name_length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    ctx.glGetActiveUniform(program, i, name_buffer.size(), &name_length, &size, &type, name_buffer.data());
+    const std::string uniform_name(name_buffer.data(), name_length);
+    const GLint location = ctx.glGetUniformLocation(program, uniform_name.c_str());
+    if (location == -1) {
+      // Built-in uniform.
+      continue;
+    }
+    const int handle = add_uniform(uniform_name, location, type);
+
+    // Arrays are listed as "name[0]" but can also be set as "name".
+    const std::string array_suffix = "[0]";
+    if (uniform_name.size() > array_suffix.size() &&
+        uniform_name.compare(uniform_name.size() - array_suffix.size(), array_suffix.size(), array_suffix) == 0) {
+      uniform_handles.emplace(uniform_name.substr(0, uniform_name.size() - array_suffix.size()), handle);
+    }
   }
+
+  resolve_builtin_uniforms();
 }
 
 /**
@@ -320,35 +368,53 @@ std::string GlShader::default_fragment_source() const {
  * \copydoc Shader::render
  */
 void GlShader::render(const VertexArray& array, const Surface& texture, const glm::mat4 &mvp_matrix, const glm::mat3 &uv_matrix) {
+  render_vertices(array, texture.get_internal_surface().get_texture(), mvp_matrix, uv_matrix);
+}
+
+/**
+ * \brief Renders a vertex array with this shader, sampling an SDL texture.
+ *
+ * This allows to draw textures that are not owned by a surface,
+ * like texture atlas pages.
+ * \param array The vertices to draw.
+ * \param texture The texture bound to texture unit 0.
+ * \param mvp_matrix The model-view-projection matrix.
+ * \param uv_matrix The texture coordinates matrix.
+ */
+void GlShader::render_vertices(const VertexArray& array, SDL_Texture* texture, const glm::mat4 &mvp_matrix, const glm::mat3 &uv_matrix) {
+  // The SDL renderer remembers which program it uses: restore it afterwards.
   GLint previous_program;
   ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
   ctx.glUseProgram(program);
+  upload_uniforms();
 
   ctx.glDisable(GL_CULL_FACE);
 
-  if(array.vertex_buffer == 0) {
+  VertexArray::Buffer& buffer = array.get_buffer_to_draw();
+  if(buffer.id == 0) {
     //Generate vertex-buffer
-    ctx.glGenBuffers(1,&array.vertex_buffer);
+    ctx.glGenBuffers(1,&buffer.id);
+  }
+  ctx.glBindBuffer(GL_ARRAY_BUFFER,buffer.id);
+  if(array.grow_buffer(buffer)) {
+    ctx.glBufferData(GL_ARRAY_BUFFER,buffer.capacity*sizeof(Vertex),nullptr,array.get_buffer_usage());
   }
-  GLint previous_buffer;
-  ctx.glGetIntegerv(GL_ARRAY_BUFFER_BINDING,&previous_buffer);
-  ctx.glBindBuffer(GL_ARRAY_BUFFER,array.vertex_buffer);
-  if(array.buffer_dirty) {
-    //Upload vertex buffer //TODO use glSubData if array size <= previous size
-    ctx.glBufferData(GL_ARRAY_BUFFER,array.vertex_count()*sizeof(Vertex),array.data(),GL_DYNAMIC_DRAW);
-    array.buffer_dirty = false;
+  //Upload modified vertices only
+  for(const VertexArray::Range& range : array.dirty_ranges) {
+    ctx.glBufferSubData(GL_ARRAY_BUFFER,range.first*sizeof(Vertex),(range.second-range.first)*sizeof(Vertex),array.data()+range.first);
   }
-  ctx.glUniformMatrix4fv(get_uniform_location(Shader::MVP_MATRIX_NAME),1,GL_FALSE,glm::value_ptr(mvp_matrix));
+  array.dirty_ranges.clear();
+  ctx.glUniformMatrix4fv(mvp_matrix_location,1,GL_FALSE,glm::value_ptr(mvp_matrix));
 
   glm::mat3 uvm = uv_matrix;
-  ctx.glUniformMatrix3fv(get_uniform_location(Shader::UV_MATRIX_NAME),1,GL_FALSE,glm::value_ptr(uvm));
+  ctx.glUniformMatrix3fv(uv_matrix_location,1,GL_FALSE,glm::value_ptr(uvm));
 
   enable_attribute(position_location, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
   enable_attribute(tex_coord_location, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texcoords));
   enable_attribute(color_location, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
 
   ctx.glActiveTexture(GL_TEXTURE0 + 0);  // Texture unit 0.
-  SDL_GL_BindTexture(texture.get_internal_surface().get_texture(), nullptr, nullptr);
+  SDL_GL_BindTexture(texture, nullptr, nullptr);
 
   for (const auto& kvp : uniform_textures) {
     const GLuint texture_unit = kvp.second.unit;
@@ -371,166 +437,272 @@ void GlShader::render(const VertexArray& array, const Surface& texture, const gl
 
   ctx.glActiveTexture(GL_TEXTURE0);
 
-  ctx.glBindBuffer(GL_ARRAY_BUFFER,previous_buffer);
+  // The SDL renderer binds its own buffers before using them.
+  ctx.glBindBuffer(GL_ARRAY_BUFFER,0);
   ctx.glUseProgram(previous_program);
 }
 
 
 
 /**
- * \brief Returns the location of a uniform value in the shader program.
- * \param uniform_name Name of the uniform to find.
- * \return The uniform location or \c -1.
+ * \copydoc Shader::get_uniform_handle
  */
-GLint GlShader::get_uniform_location(const std::string& uniform_name) const {
-  const auto& it = uniform_locations.find(uniform_name);
-  if (it != uniform_locations.end()) {
+int GlShader::get_uniform_handle(const std::string& uniform_name) {
+
+  const auto it = uniform_handles.find(uniform_name);
+  if (it != uniform_handles.end()) {
     return it->second;
   }
 
+  // Not an active uniform name, but maybe an element of an array.
   const GLint location = ctx.glGetUniformLocation(program, uniform_name.c_str());
-  uniform_locations.insert(std::make_pair(uniform_name, location));
-  return location;
+  if (location == -1) {
+    uniform_handles.emplace(uniform_name, -1);
+    return -1;
+  }
+  return add_uniform(uniform_name, location, 0);
 }
 
 /**
- * \copydoc Shader::set_uniform1f
+ * \brief Registers a uniform of the program.
+ * \param uniform_name Name of the uniform.
+ * \param location Location of the uniform in the program.
+ * \param type GL type of the uniform, or 0 if unknown.
+ * \return The handle of the new uniform.
  */
-void GlShader::set_uniform_1b(const std::string& uniform_name, bool value) {
+int GlShader::add_uniform(const std::string& uniform_name, GLint location, GLenum type) {
+
+  Uniform uniform;
+  uniform.location = location;
+  uniform.type = type;
+  uniform.dirty = false;
+  uniform.integer = false;
+  uniform.num_components = 0;
+  uniform.int_value = 0;
+  std::fill(uniform.float_values, uniform.float_values + 4, 0.0f);
+
+  const int handle = uniforms.size();
+  uniforms.push_back(uniform);
+  uniform_handles.emplace(uniform_name, handle);
+  return handle;
+}
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
+/**
+ * \brief Returns the uniform with the given handle.
+ * \param uniform_handle A uniform handle.
+ * \return The uniform, or nullptr if the handle is -1.
+ */
+GlShader::Uniform* GlShader::get_uniform(int uniform_handle) {
+
+  if (uniform_handle < 0 || uniform_handle >= static_cast<int>(uniforms.size())) {
+    return nullptr;
+  }
+  return &uniforms[uniform_handle];
+}
+
+/**
+ * \brief Stores an integer value to upload to a uniform.
+ *
+ * Nothing is uploaded if the value has not changed.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value The integer value.
+ */
+void GlShader::set_uniform_int(int uniform_handle, GLint value) {
+
+  Uniform* uniform = get_uniform(uniform_handle);
+  if (uniform == nullptr) {
     return;
   }
 
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform1i(location, (value ? 1 : 0));
-  ctx.glUseProgram(previous_program);
+  if (uniform->integer && uniform->int_value == value) {
+    return;
+  }
+
+  uniform->integer = true;
+  uniform->num_components = 1;
+  uniform->int_value = value;
+  if (!uniform->dirty) {
+    uniform->dirty = true;
+    dirty_uniforms.push_back(uniform_handle);
+  }
 }
 
 /**
- * \copydoc Shader::set_uniform_1i
+ * \brief Stores a float vector value to upload to a uniform.
+ *
+ * Nothing is uploaded if the value has not changed.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param num_components Number of floats of the value (1 to 4).
+ * \param values The float values.
  */
-void GlShader::set_uniform_1i(const std::string& uniform_name, int value) {
+void GlShader::set_uniform_floats(int uniform_handle, int num_components, const GLfloat* values) {
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
+  Uniform* uniform = get_uniform(uniform_handle);
+  if (uniform == nullptr) {
     return;
   }
 
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform1i(location, value);
-  ctx.glUseProgram(previous_program);
+  if (!uniform->integer &&
+      uniform->num_components == num_components &&
+      std::equal(values, values + num_components, uniform->float_values)) {
+    return;
+  }
+
+  uniform->integer = false;
+  uniform->num_components = num_components;
+  std::copy(values, values + num_components, uniform->float_values);
+  if (!uniform->dirty) {
+    uniform->dirty = true;
+    dirty_uniforms.push_back(uniform_handle);
+  }
 }
 
 /**
- * \copydoc Shader::set_uniform_1f
+ * \brief Uploads the uniform values that changed since the last rendering.
+ *
+ * The program must be in use.
  */
-void GlShader::set_uniform_1f(const std::string& uniform_name, float value) {
+void GlShader::upload_uniforms() {
+
+  for (int uniform_handle : dirty_uniforms) {
+    Uniform& uniform = uniforms[uniform_handle];
+    uniform.dirty = false;
+    if (uniform.integer) {
+      ctx.glUniform1i(uniform.location, uniform.int_value);
+      continue;
+    }
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
+    const GLfloat* values = uniform.float_values;
+    switch (uniform.num_components) {
+
+    case 1:
+      ctx.glUniform1f(uniform.location, values[0]);
+      break;
+
+    case 2:
+      ctx.glUniform2f(uniform.location, values[0], values[1]);
+      break;
+
+    case 3:
+      ctx.glUniform3f(uniform.location, values[0], values[1], values[2]);
+      break;
+
+    case 4:
+      ctx.glUniform4f(uniform.location, values[0], values[1], values[2], values[3]);
+      break;
+    }
   }
+  dirty_uniforms.clear();
+}
 
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform1f(location, value);
-  ctx.glUseProgram(previous_program);
+/**
+ * \copydoc Shader::set_uniform_1b
+ */
+void GlShader::set_uniform_1b(int uniform_handle, bool value) {
+
+  set_uniform_1i(uniform_handle, value ? 1 : 0);
 }
 
 /**
- * \copydoc Shader::set_uniform_2f
+ * \copydoc Shader::set_uniform_1i
  */
-void GlShader::set_uniform_2f(const std::string& uniform_name, float value_1, float value_2) {
+void GlShader::set_uniform_1i(int uniform_handle, int value) {
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
+  const Uniform* uniform = get_uniform(uniform_handle);
+  if (uniform == nullptr) {
     return;
   }
 
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform2f(location, value_1, value_2);
-  ctx.glUseProgram(previous_program);
+  if (uniform->type == GL_FLOAT) {
+    const GLfloat float_value = value;
+    set_uniform_floats(uniform_handle, 1, &float_value);
+    return;
+  }
+  set_uniform_int(uniform_handle, value);
 }
 
 /**
- * \copydoc Shader::set_uniform_3f
+ * \copydoc Shader::set_uniform_1f
  */
-void GlShader::set_uniform_3f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3) {
+void GlShader::set_uniform_1f(int uniform_handle, float value) {
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
+  const Uniform* uniform = get_uniform(uniform_handle);
+  if (uniform == nullptr) {
     return;
   }
 
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform3f(location, value_1, value_2, value_3);
-  ctx.glUseProgram(previous_program);
+  if (uniform->type == GL_INT ||
+      uniform->type == GL_BOOL ||
+      uniform->type == GL_SAMPLER_2D) {
+    set_uniform_int(uniform_handle, static_cast<GLint>(value));
+    return;
+  }
+  set_uniform_floats(uniform_handle, 1, &value);
+}
+
+/**
+ * \copydoc Shader::set_uniform_2f
+ */
+void GlShader::set_uniform_2f(int uniform_handle, float value_1, float value_2) {
+
+  const GLfloat values[] = { value_1, value_2 };
+  set_uniform_floats(uniform_handle, 2, values);
+}
+
+/**
+ * \copydoc Shader::set_uniform_3f
+ */
+void GlShader::set_uniform_3f(
+    int uniform_handle, float value_1, float value_2, float value_3) {
+
+  const GLfloat values[] = { value_1, value_2, value_3 };
+  set_uniform_floats(uniform_handle, 3, values);
 }
 
 /**
  * \copydoc Shader::set_uniform_4f
  */
 void GlShader::set_uniform_4f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) {
+    int uniform_handle, float value_1, float value_2, float value_3, float value_4) {
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
-
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform4f(location, value_1, value_2, value_3, value_4);
-  ctx.glUseProgram(previous_program);
+  const GLfloat values[] = { value_1, value_2, value_3, value_4 };
+  set_uniform_floats(uniform_handle, 4, values);
 }
 
 /**
  * \copydoc Shader::set_uniform_texture
  */
-bool GlShader::set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) {
-  const GLint location = get_uniform_location(uniform_name);
+bool GlShader::set_uniform_texture(int uniform_handle, const SurfacePtr& value) {
 
-  if (location == -1) {
+  if (get_uniform(uniform_handle) == nullptr) {
     // Not an error.
     return true;
   }
 
-  auto it = uniform_textures.find(uniform_name);
+  auto it = uniform_textures.find(uniform_handle);
   if(it != uniform_textures.end()) {
     it->second.surface = value;
     return true; //Nothing else to do
   }
   //else find a new texture unit
 
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-
   int texture_unit = ++current_texture_unit;
-  uniform_textures[uniform_name] = TextureUniform{value,(GLuint)texture_unit};
+  uniform_textures[uniform_handle] = TextureUniform{value,(GLuint)texture_unit};
 
-  ctx.glUniform1i(location, texture_unit);
-
-  ctx.glUseProgram(previous_program);
+  set_uniform_int(uniform_handle, texture_unit);
   return true;
 }
 
 /**
- * \brief Enable the attribute and keep trace of the old state.
- * \param index The index of the vertex attribute.
+ * \brief Enables a vertex attribute array for the next draw.
+ *
+ * The state the renderer expects outside of shaders is queried only the
+ * first time an attribute index is used.
+ * Arrays that were disabled are disabled again by restore_attribute_states().
+ * \param index The index of the vertex attribute, or -1 if the program does
+ * not use it.
  * \param size The number of components per vertex attribute.
  * \param type The data type of each component in the array.
  * \param normalized Specifies whether fixed-point data values should be normalized.
@@ -539,26 +711,36 @@ bool GlShader::set_uniform_texture(const std::string& uniform_name, const Surfac
  * vertex attribute in the array in the data store of the buffer currently bound
  * to the GL_ARRAY_BUFFER target.
  */
-void GlShader::enable_attribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer) {
-
-  GLint previous_state;
-  // TODO Check if the get step can be done once at the initialization time.
-  ctx.glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &previous_state);
-  ctx.glEnableVertexAttribArray(index);
-  ctx.glVertexAttribPointer(index, size, type, normalized, stride, pointer);
-  attribute_states.insert(std::make_pair(index, previous_state));
+void GlShader::enable_attribute(GLint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer) {
+
+  if (index < 0) {
+    return;
+  }
+
+  const GLuint attribute = static_cast<GLuint>(index);
+  auto it = renderer_attribute_states.find(attribute);
+  if (it == renderer_attribute_states.end()) {
+    GLint renderer_state = GL_FALSE;
+    ctx.glGetVertexAttribiv(attribute, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &renderer_state);
+    it = renderer_attribute_states.emplace(attribute, renderer_state).first;
+  }
+
+  if (!it->second) {
+    ctx.glEnableVertexAttribArray(attribute);
+    enabled_attributes.push_back(attribute);
+  }
+  ctx.glVertexAttribPointer(attribute, size, type, normalized, stride, pointer);
 }
 
 /**
- * \brief Restore previous attrib states.
+ * \brief Disables the vertex attribute arrays enabled for the last draw.
  */
 void GlShader::restore_attribute_states() {
 
-  for (const auto& attrib : attribute_states) {
-    if(!attrib.second)
-      ctx.glDisableVertexAttribArray(attrib.first);
+  for (GLuint attribute : enabled_attributes) {
+    ctx.glDisableVertexAttribArray(attribute);
   }
-  attribute_states.clear();
+  enabled_attributes.clear();
 }
 
 }
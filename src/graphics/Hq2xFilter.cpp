@@ -35,18 +35,28 @@ int Hq2xFilter::get_scaling_factor() const {
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::prepare_filter
  */
-void Hq2xFilter::filter(
-    const uint32_t* src,
-    int src_width,
-    int src_height,
-    uint32_t* dst) const {
+void Hq2xFilter::prepare_filter() const {
 
   // Make sure hqx is initialized.
   Hq4xFilter::initialize_hqx();
+}
+
+/**
+ * \copydoc SoftwarePixelFilter::filter_rows
+ */
+void Hq2xFilter::filter_rows(
+    const uint32_t* src,
+    int src_width,
+    int src_height,
+    uint32_t* dst,
+    int first_row,
+    int end_row) const {
 
-  hq2x_32(const_cast<uint32_t*>(src), dst, src_width, src_height);
+  const uint32_t row_bytes = src_width * 4;
+  hq2x_32_rb_rows(const_cast<uint32_t*>(src), row_bytes, dst, row_bytes * 2,
+      src_width, src_height, first_row, end_row);
 }
 
 }
@@ -38,18 +38,28 @@ int Hq4xFilter::get_scaling_factor() const {
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::prepare_filter
  */
-void Hq4xFilter::filter(
-    const uint32_t* src,
-    int src_width,
-    int src_height,
-    uint32_t* dst) const {
+void Hq4xFilter::prepare_filter() const {
 
   // Make sure hqx is initialized.
   initialize_hqx();
+}
+
+/**
+ * \copydoc SoftwarePixelFilter::filter_rows
+ */
+void Hq4xFilter::filter_rows(
+    const uint32_t* src,
+    int src_width,
+    int src_height,
+    uint32_t* dst,
+    int first_row,
+    int end_row) const {
 
-  hq4x_32(const_cast<uint32_t*>(src), dst, src_width, src_height);
+  const uint32_t row_bytes = src_width * 4;
+  hq4x_32_rb_rows(const_cast<uint32_t*>(src), row_bytes, dst, row_bytes * 4,
+      src_width, src_height, first_row, end_row);
 }
 
 /**
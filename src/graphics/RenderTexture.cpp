@@ -1,10 +1,25 @@
 #include "solarus/graphics/RenderTexture.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Shader.h"
+#include "solarus/graphics/ShaderContext.h"
+#include "solarus/graphics/GlShader.h"
+#include "solarus/graphics/TextureAtlas.h"
+#include "solarus/graphics/VertexArray.h"
+#include "solarus/third_party/glm/gtx/transform.hpp"
+#include "solarus/third_party/glm/gtx/matrix_transform_2d.hpp"
+#include <algorithm>
+#include <cstring>
 
 namespace Solarus {
 
 //RenderTargetAtlas RenderTexture::render_atlas;
+const RenderTexture* RenderTexture::batch_target = nullptr;
+std::vector<RenderTexture::BatchedDraw> RenderTexture::batch;
+std::unique_ptr<GlShader> RenderTexture::batch_shader;
+VertexArray RenderTexture::batch_vertices;
+std::vector<RenderTexture::BatchedSource> RenderTexture::batch_sources;
+std::vector<const RenderTexture*> RenderTexture::previous_surface_textures;
+
 /**
  * @brief RenderTexture::RenderTexture
  * @param width width of the render texture
@@ -36,6 +51,27 @@ RenderTexture::RenderTexture(int width, int height)
   clear();
 }
 
+/**
+ * @brief Destructor.
+ *
+ * Pending draws that use this texture are flushed first.
+ */
+RenderTexture::~RenderTexture() {
+  if (previous_surface != nullptr) {
+    previous_surface_textures.erase(std::find(
+        previous_surface_textures.begin(),
+        previous_surface_textures.end(),
+        this
+    ));
+  }
+  if (batch_target == this) {
+    // Nobody will see these draws.
+    batch.clear();
+    batch_target = nullptr;
+  }
+  flush_batch();
+}
+
 /**
  * \copydoc SurfaceImpl::get_width
  */
@@ -54,43 +90,262 @@ int RenderTexture::get_height() const {
  * \copydoc SurfaceImpl::get_texture
  */
 SDL_Texture* RenderTexture::get_texture() const {
+  if (batch_target == this) {
+    flush_batch();
+  }
   return target.get();
 }
 
 /**
  * @brief draw other surface impl on this one using given infos
+ *
+ * The draw is only queued: it is done when the batch is flushed.
+ *
  * @param texture the surface to draw here
  * @param infos draw info bundle
  */
 void RenderTexture::draw_other(const SurfaceImpl& texture, const DrawInfos& infos) {
-  with_target([&](SDL_Renderer* renderer){
-    Rectangle dst_rect(infos.dst_position,infos.region.get_size());
-    SDL_BlendMode mode = Surface::make_sdl_blend_mode(*this,texture,infos.blend_mode);
-    SOLARUS_CHECK_SDL_HIGHER(SDL_SetTextureBlendMode(texture.get_texture(),mode),-1);
-    SOLARUS_CHECK_SDL(SDL_SetTextureAlphaMod(texture.get_texture(),infos.opacity));
-    SOLARUS_CHECK_SDL(SDL_RenderCopy(renderer,texture.get_texture(),infos.region,dst_rect));
+  if (batch_target != this) {
+    flush_batch();
+    batch_target = this;
+  }
+  const Rectangle dst_rect(infos.dst_position,infos.region.get_size());
+  mark_dirty(dst_rect);
+  batch.push_back({
+    &texture,
+    infos.region,
+    dst_rect,
+    Surface::make_sdl_blend_mode(*this,texture,infos.blend_mode),
+    infos.opacity
   });
 }
 
+/**
+ * @brief prepare the vertex stream path of batches if GLSL shaders are supported
+ *
+ * Must be called once the shader context is initialized.
+ */
+void RenderTexture::initialize() {
+  batch_shader = ShaderContext::create_batch_shader();
+  // Uploaded once per group of draws: each upload orphans the previous storage.
+  batch_vertices.set_streaming(true);
+}
+
+/**
+ * @brief flush pending draws and free the resources of batches
+ *
+ * Must be called before the shader context and the renderer are destroyed.
+ */
+void RenderTexture::quit() {
+  flush_batch();
+  batch_shader = nullptr;
+  TextureAtlas::quit();
+}
+
+/**
+ * @brief do all pending draws
+ *
+ * The render target is switched once for the whole batch.
+ * After this call, the render target of the renderer is the one of the batch.
+ */
+void RenderTexture::flush_batch() {
+  if (batch.empty()) {
+    batch_target = nullptr;
+    return;
+  }
+
+  // Take the batch first: getting textures below must not flush again.
+  std::vector<BatchedDraw> draws;
+  draws.swap(batch);
+  const RenderTexture* target = batch_target;
+  batch_target = nullptr;
+
+  if (batch_shader != nullptr) {
+    render_batch_vertices(*target,draws);
+  }
+  else {
+    Video::set_render_target(target->target.get());
+    for (const BatchedDraw& draw : draws) {
+      SDL_Texture* texture = draw.texture->get_texture();
+      Video::set_texture_blend_mode(texture,draw.blend_mode);
+      Video::set_texture_alpha_mod(texture,draw.opacity);
+      Video::set_texture_color_mod(texture,get_modulation_color(draw));
+      SOLARUS_CHECK_SDL(Video::render_copy(texture,draw.region,draw.dst_rect));
+    }
+  }
+
+  // Give the storage back to avoid reallocating at each batch.
+  draws.clear();
+  if (batch.empty()) {
+    batch.swap(draws);
+  }
+}
+
+/**
+ * @brief draw a batch as vertex streams with the batch shader
+ *
+ * Immutable images are read from texture atlas pages, so that consecutive
+ * draws of different sprites and tiles can share a single draw call.
+ * Draws are only merged with their neighbours: the drawing order is kept.
+ *
+ * @param target the render texture to draw on
+ * @param draws the draws of the batch, in drawing order
+ */
+void RenderTexture::render_batch_vertices(const RenderTexture& target, const std::vector<BatchedDraw>& draws) {
+  // Find all sources first: copying an image to the atlas changes the render target.
+  batch_sources.clear();
+  for (const BatchedDraw& draw : draws) {
+    SDL_Texture* page = nullptr;
+    Point position;
+    if (draw.texture->is_immutable() &&
+        TextureAtlas::find_or_add(*draw.texture,page,position)) {
+      Rectangle region = draw.region;
+      region.add_xy(position);
+      batch_sources.push_back({
+        page,
+        region,
+        Size(TextureAtlas::page_size,TextureAtlas::page_size)
+      });
+    }
+    else {
+      batch_sources.push_back({
+        draw.texture->get_texture(),
+        draw.region,
+        Size(draw.texture->get_width(),draw.texture->get_height())
+      });
+    }
+  }
+
+  Video::set_render_target(target.target.get());
+  const glm::mat4 mvp_matrix = glm::ortho<float>(0,target.get_width(),0,target.get_height());
+  size_t first = 0;
+  while (first < draws.size()) {
+    const BatchedSource& source = batch_sources[first];
+    const SDL_BlendMode blend_mode = draws[first].blend_mode;
+
+    batch_vertices.clear();
+    size_t last = first;
+    while (last < draws.size() &&
+           batch_sources[last].texture == source.texture &&
+           draws[last].blend_mode == blend_mode) {
+      batch_vertices.add_quad(draws[last].dst_rect,
+                              batch_sources[last].region,
+                              get_modulation_color(draws[last]));
+      ++last;
+    }
+
+    // Draw a point offscreen to make SDL apply the blend mode to OpenGL.
+    Video::set_render_draw_blend_mode(blend_mode);
+    SDL_RenderDrawPoint(Video::get_renderer(),-100,-100);
+
+    // Texture coordinates are in pixels.
+    const glm::mat3 uv_matrix = glm::scale(
+          glm::mat3(1),
+          glm::vec2(1.f/source.size.width,1.f/source.size.height)
+          );
+    batch_shader->render_vertices(batch_vertices,source.texture,mvp_matrix,uv_matrix);
+    first = last;
+  }
+}
+
+/**
+ * @brief get the color to multiply the pixels of a draw with
+ *
+ * The color components of premultiplied surfaces are faded like the alpha.
+ * @param draw a batched draw
+ * @return the modulation color
+ */
+Color RenderTexture::get_modulation_color(const BatchedDraw& draw) {
+  if (draw.texture->is_premultiplied()) {
+    return Color(draw.opacity,draw.opacity,draw.opacity,draw.opacity);
+  }
+  return Color(255,255,255,draw.opacity);
+}
+
+/**
+ * @brief remember that a region of the texture was modified
+ * @param where the modified region
+ */
+void RenderTexture::mark_dirty(const Rectangle& where) const {
+  dirty_region |= where & Rectangle(0,0,get_width(),get_height());
+}
+
 /**
  * \copydoc SurfaceImpl::get_surface
+ *
+ * Only the region modified since the last call is read back from the GPU.
  */
 SDL_Surface *RenderTexture::get_surface() const {
-  if (surface_dirty) {
-    with_target([&](SDL_Renderer* renderer){
-      Rectangle rect(0,0,get_width(),get_height());
-      SOLARUS_CHECK_SDL(SDL_RenderReadPixels(renderer,
-                           rect,
-                           Video::get_rgba_format()->format,
-                           surface->pixels,
-                           surface->pitch
-                           ));
-    });
-    surface_dirty = false;
+  if (batch_target == this) {
+    flush_batch();
+  }
+  if (!dirty_region.is_flat()) {
+    Video::set_render_target(target.get());
+    const int bytes_per_pixel = surface->format->BytesPerPixel;
+    uint8_t* pixels = static_cast<uint8_t*>(surface->pixels)
+        + dirty_region.get_y() * surface->pitch
+        + dirty_region.get_x() * bytes_per_pixel;
+    SOLARUS_CHECK_SDL(SDL_RenderReadPixels(Video::get_renderer(),
+                         dirty_region,
+                         Video::get_rgba_format()->format,
+                         pixels,
+                         surface->pitch
+                         ));
+    dirty_region = Rectangle();
   }
   return surface.get();
 }
 
+/**
+ * \copydoc SurfaceImpl::get_previous_surface
+ *
+ * The first call reads back the current pixels. After that, the pixels are
+ * copied at the end of each frame as long as this function is called during
+ * the frame.
+ */
+SDL_Surface* RenderTexture::get_previous_surface() const {
+  if (previous_surface == nullptr) {
+    const SDL_Surface* current = get_surface();
+    SDL_Surface* copy = SDL_CreateRGBSurface(0,
+                                             current->w,
+                                             current->h,
+                                             current->format->BitsPerPixel,
+                                             current->format->Rmask,
+                                             current->format->Gmask,
+                                             current->format->Bmask,
+                                             current->format->Amask);
+    Debug::check_assertion(copy != nullptr,
+                           std::string("Failed to create previous surface ") + SDL_GetError());
+    std::memcpy(copy->pixels,current->pixels,current->pitch * current->h);
+    previous_surface.reset(copy);
+    previous_surface_textures.push_back(this);
+  }
+  previous_surface_used = true;
+  return previous_surface.get();
+}
+
+/**
+ * @brief copy the pixels of render textures at the end of a frame
+ *
+ * This is done for render textures whose previous surface was used during
+ * the frame. The other ones stop keeping a previous surface.
+ */
+void RenderTexture::update_previous_surfaces() {
+  std::vector<const RenderTexture*> still_used;
+  for (const RenderTexture* render_texture : previous_surface_textures) {
+    if (!render_texture->previous_surface_used) {
+      render_texture->previous_surface = nullptr;
+      continue;
+    }
+    render_texture->previous_surface_used = false;
+    const SDL_Surface* current = render_texture->get_surface();
+    SDL_Surface* previous = render_texture->previous_surface.get();
+    std::memcpy(previous->pixels,current->pixels,current->pitch * current->h);
+    still_used.push_back(render_texture);
+  }
+  previous_surface_textures.swap(still_used);
+}
+
 /**
  * \copydoc SurfaceImpl::to_render_texture
  */
@@ -106,11 +361,9 @@ RenderTexture* RenderTexture::to_render_texture() {
  */
 void RenderTexture::fill_with_color(const Color& color, const Rectangle& where, SDL_BlendMode mode) {
   const SDL_Rect* rect = where;
-  with_target([&](SDL_Renderer* renderer){
-    Uint8 r,g,b,a;
-    color.get_components(r,g,b,a);
-    SOLARUS_CHECK_SDL(SDL_SetRenderDrawColor(renderer,r,g,b,a));
-    SOLARUS_CHECK_SDL(SDL_SetRenderDrawBlendMode(renderer,mode));
+  with_target(where,[&](SDL_Renderer* renderer){
+    Video::set_render_draw_color(color);
+    Video::set_render_draw_blend_mode(mode);
     SOLARUS_CHECK_SDL(SDL_RenderFillRect(renderer,rect));
   });
 }
@@ -120,8 +373,8 @@ void RenderTexture::fill_with_color(const Color& color, const Rectangle& where,
  */
 void RenderTexture::clear() {
   with_target([&](SDL_Renderer* renderer){
-    SOLARUS_CHECK_SDL(SDL_SetRenderDrawColor(renderer,0,0,0,0));
-    SOLARUS_CHECK_SDL(SDL_SetTextureBlendMode(target.get(),SDL_BLENDMODE_BLEND));
+    Video::set_render_draw_color(Color::transparent);
+    Video::set_texture_blend_mode(target.get(),SDL_BLENDMODE_BLEND);
     SOLARUS_CHECK_SDL(SDL_RenderClear(renderer));
   });
 }
@@ -134,4 +387,32 @@ void RenderTexture::clear(const Rectangle& where) {
   fill_with_color(Color::transparent,where,SDL_BLENDMODE_NONE);
 }
 
+/**
+ * @brief replaces all pixels by pixels computed on the CPU
+ *
+ * They are uploaded at once and will not need to be read back.
+ *
+ * @param pixels surface of the same size and format as this one
+ */
+void RenderTexture::replace_pixels(const SDL_Surface& pixels) {
+  Debug::check_assertion(pixels.w == get_width() && pixels.h == get_height() &&
+                         pixels.format->format == surface->format->format,
+                         "Wrong size or format of the replacement pixels");
+
+  // Pending draws must use the previous pixels.
+  flush_batch();
+
+  const int row_size = get_width() * surface->format->BytesPerPixel;
+  for (int y = 0; y < get_height(); ++y) {
+    std::memcpy(static_cast<uint8_t*>(surface->pixels) + y * surface->pitch,
+                static_cast<const uint8_t*>(pixels.pixels) + y * pixels.pitch,
+                row_size);
+  }
+  SOLARUS_CHECK_SDL(SDL_UpdateTexture(target.get(),
+                                      nullptr,
+                                      surface->pixels,
+                                      surface->pitch));
+  dirty_region = Rectangle();
+}
+
 }
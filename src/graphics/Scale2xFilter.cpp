@@ -16,8 +16,85 @@
  */
 #include "solarus/graphics/Scale2xFilter.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOLARUS_SCALE2X_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Applies Scale2x on one pixel.
+ * \param b The pixel above.
+ * \param d The pixel on the left.
+ * \param e The pixel to scale.
+ * \param f The pixel on the right.
+ * \param h The pixel below.
+ * \param dst_top Where to write the two upper destination pixels.
+ * \param dst_bottom Where to write the two lower destination pixels.
+ */
+inline void scale2x_pixel(
+    uint32_t b, uint32_t d, uint32_t e, uint32_t f, uint32_t h,
+    uint32_t* dst_top, uint32_t* dst_bottom) {
+
+  if (b != h && d != f) {
+    dst_top[0] = (d == b) ? d : e;
+    dst_top[1] = (b == f) ? f : e;
+    dst_bottom[0] = (d == h) ? d : e;
+    dst_bottom[1] = (h == f) ? f : e;
+  }
+  else {
+    dst_top[0] = dst_top[1] = dst_bottom[0] = dst_bottom[1] = e;
+  }
+}
+
+#ifdef SOLARUS_SCALE2X_SSE2
+/**
+ * \brief Returns a where mask is set and b elsewhere.
+ */
+inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/**
+ * \brief Applies Scale2x on 4 consecutive pixels that are not on the left
+ * or right border.
+ * \param above The 4 pixels above.
+ * \param line The 4 pixels to scale.
+ * \param below The 4 pixels below.
+ * \param dst_top Where to write the 8 upper destination pixels.
+ * \param dst_bottom Where to write the 8 lower destination pixels.
+ */
+inline void scale2x_4_pixels(
+    const uint32_t* above, const uint32_t* line, const uint32_t* below,
+    uint32_t* dst_top, uint32_t* dst_bottom) {
+
+  const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above));
+  const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line - 1));
+  const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line));
+  const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + 1));
+  const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below));
+
+  // Lanes where b != h and d != f.
+  const __m128i same = _mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f));
+  const __m128i changed = _mm_andnot_si128(same, _mm_set1_epi32(-1));
+
+  const __m128i e1 = select(_mm_and_si128(changed, _mm_cmpeq_epi32(d, b)), d, e);
+  const __m128i e2 = select(_mm_and_si128(changed, _mm_cmpeq_epi32(b, f)), f, e);
+  const __m128i e3 = select(_mm_and_si128(changed, _mm_cmpeq_epi32(d, h)), d, e);
+  const __m128i e4 = select(_mm_and_si128(changed, _mm_cmpeq_epi32(h, f)), f, e);
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_top), _mm_unpacklo_epi32(e1, e2));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_top + 4), _mm_unpackhi_epi32(e1, e2));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_bottom), _mm_unpacklo_epi32(e3, e4));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_bottom + 4), _mm_unpackhi_epi32(e3, e4));
+}
+#endif
+
+}
+
 /**
  * \brief Constructor.
  */
@@ -33,64 +110,49 @@ int Scale2xFilter::get_scaling_factor() const {
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::filter_rows
  */
-void Scale2xFilter::filter(
+void Scale2xFilter::filter_rows(
     const uint32_t* src,
     int src_width,
     int src_height,
-    uint32_t* dst) const {
+    uint32_t* dst,
+    int first_row,
+    int end_row) const {
 
   const int dst_width = src_width * 2;
 
-  int e1 = 0;
-  int e2, e3, e4;
-  int b, d, e = 0, f,  h;
-  for (int row = 0; row < src_height; row++) {
-    for (int col = 0; col < src_width; col++) {
-
-      // compute a to i
-
-      b = e - src_width;
-      d = e - 1;
-      f = e + 1;
-      h = e + src_width;
-
-      if (row == 0) {
-        b = e;
-      }
-      if (row == src_height - 1) {
-        h = e;
-      }
-      if (col == 0) {
-        d = e;
-      }
-      if (col == src_width - 1) {
-        f = e;
-      }
-
-      // compute e1 to e4
-      e2 = e1 + 1;
-      e3 = e1 + dst_width;
-      e4 = e3 + 1;
-
-      // compute the color
-
-      if (src[b] != src[h] && src[d] != src[f]) {
-        dst[e1] = src[(src[d] == src[b]) ? d : e];
-        dst[e2] = src[(src[b] == src[f]) ? f : e];
-        dst[e3] = src[(src[d] == src[h]) ? d : e];
-        dst[e4] = src[(src[h] == src[f]) ? f : e];
-      }
-      else {
-        dst[e1] = dst[e2] = dst[e3] = dst[e4] = src[e];
-      }
-      e1 += 2;
-      e++;
+  for (int row = first_row; row < end_row; ++row) {
+
+    const uint32_t* line = &src[row * src_width];
+    const uint32_t* above = (row == 0) ? line : line - src_width;
+    const uint32_t* below = (row == src_height - 1) ? line : line + src_width;
+    uint32_t* dst_top = &dst[row * 2 * dst_width];
+    uint32_t* dst_bottom = dst_top + dst_width;
+
+    int col = 0;
+    if (src_width > 0) {
+      // First column: the left neighbor is the pixel itself.
+      scale2x_pixel(above[0], line[0], line[0],
+          line[src_width > 1 ? 1 : 0], below[0],
+          dst_top, dst_bottom);
+      col = 1;
     }
-    e1 += dst_width;
-  }
 
+#ifdef SOLARUS_SCALE2X_SSE2
+    // Inner columns 4 by 4, as long as the right neighbor exists.
+    for (; col + 4 < src_width; col += 4) {
+      scale2x_4_pixels(&above[col], &line[col], &below[col],
+          &dst_top[col * 2], &dst_bottom[col * 2]);
+    }
+#endif
+
+    for (; col < src_width; ++col) {
+      const uint32_t right = (col == src_width - 1) ? line[col] : line[col + 1];
+      scale2x_pixel(above[col], line[col - 1], line[col], right, below[col],
+          &dst_top[col * 2], &dst_bottom[col * 2]);
+    }
+  }
 }
 
 }
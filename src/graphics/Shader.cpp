@@ -41,7 +41,11 @@ Shader::Shader(const std::string& shader_id):
     shader_id(shader_id),
     data(),
     valid(true),
-    error() {
+    error(),
+    time_handle(-1),
+    output_size_handle(-1),
+    input_size_handle(-1),
+    opacity_handle(-1) {
 }
 
 /**
@@ -109,7 +113,7 @@ const ShaderData& Shader::get_data() const {
 std::string Shader::get_vertex_source() const {
 
   const std::string& file_name = "shaders/" + get_data().get_vertex_file();
-  if (file_name != "") {
+  if (!get_data().get_vertex_file().empty()) {
     if (QuestFiles::data_file_exists(file_name)) {
       return QuestFiles::data_file_read(file_name);
     }
@@ -125,7 +129,7 @@ std::string Shader::get_vertex_source() const {
 std::string Shader::get_fragment_source() const {
 
   const std::string& file_name = "shaders/" + get_data().get_fragment_file();
-  if (file_name != "") {
+  if (!get_data().get_fragment_file().empty()) {
     if (QuestFiles::data_file_exists(file_name)) {
       return QuestFiles::data_file_read(file_name);
     }
@@ -143,7 +147,21 @@ void Shader::set_data(const ShaderData& data) {
 }
 
 /**
- * \fn Shader::set_uniform_1b
+ * \fn Shader::get_uniform_handle
+ * \brief Returns a handle to a uniform of this shader program.
+ *
+ * Setting a uniform by handle is faster than by name.
+ *
+ * \param uniform_name Name of a uniform.
+ * \return The handle of this uniform, or -1 if there is no such uniform
+ * in the shader program.
+ */
+int Shader::get_uniform_handle(const std::string&) {
+  // TODO make pure virtual
+  return -1;
+}
+
+/**
  * \brief Uploads a boolean uniform value to this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
@@ -151,12 +169,11 @@ void Shader::set_data(const ShaderData& data) {
  * \param uniform_name Name of the uniform to set.
  * \param value The boolean value to set.
  */
-void Shader::set_uniform_1b(const std::string&, bool) {
-  // TODO make pure virtual
+void Shader::set_uniform_1b(const std::string& uniform_name, bool value) {
+  set_uniform_1b(get_uniform_handle(uniform_name), value);
 }
 
 /**
- * \fn Shader::set_uniform_1i
  * \brief Uploads an integer uniform value to this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
@@ -164,12 +181,11 @@ void Shader::set_uniform_1b(const std::string&, bool) {
  * \param uniform_name Name of the uniform to set.
  * \param value The integer value to set.
  */
-void Shader::set_uniform_1i(const std::string&, int) {
-  // TODO make pure virtual
+void Shader::set_uniform_1i(const std::string& uniform_name, int value) {
+  set_uniform_1i(get_uniform_handle(uniform_name), value);
 }
 
 /**
- * \fn Shader::set_uniform_1f
  * \brief Uploads a float uniform value to this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
@@ -177,12 +193,11 @@ void Shader::set_uniform_1i(const std::string&, int) {
  * \param uniform_name Name of the uniform to set.
  * \param value The float value to set.
  */
-void Shader::set_uniform_1f(const std::string&, float) {
-  // TODO make pure virtual
+void Shader::set_uniform_1f(const std::string& uniform_name, float value) {
+  set_uniform_1f(get_uniform_handle(uniform_name), value);
 }
 
 /**
- * \fn Shader::set_uniform_2f
  * \brief Uploads a vec2 uniform value to this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
@@ -191,27 +206,26 @@ void Shader::set_uniform_1f(const std::string&, float) {
  * \param value_1 The first float value to set.
  * \param value_2 The second float value to set.
  */
-void Shader::set_uniform_2f(const std::string&, float, float) {
-  // TODO make pure virtual
+void Shader::set_uniform_2f(const std::string& uniform_name, float value_1, float value_2) {
+  set_uniform_2f(get_uniform_handle(uniform_name), value_1, value_2);
 }
 
 /**
- * \fn Shader::set_uniform_3f
  * \brief Uploads a vec3 uniform value to this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
  *
  * \param uniform_name Name of the uniform to set.
  * \param value_1 The first float value to set.
- * \param value_2 The third float value to set.
- * \param value_3 The second float value to set.
+ * \param value_2 The second float value to set.
+ * \param value_3 The third float value to set.
  */
-void Shader::set_uniform_3f(const std::string&, float, float, float) {
-  // TODO make pure virtual
+void Shader::set_uniform_3f(
+    const std::string& uniform_name, float value_1, float value_2, float value_3) {
+  set_uniform_3f(get_uniform_handle(uniform_name), value_1, value_2, value_3);
 }
 
 /**
- * \fn Shader::set_uniform_4f
  * \brief Uploads a vec4 uniform value to this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
@@ -222,12 +236,12 @@ void Shader::set_uniform_3f(const std::string&, float, float, float) {
  * \param value_3 The third float value to set.
  * \param value_4 The fourth float value to set.
  */
-void Shader::set_uniform_4f(const std::string&, float, float, float, float) {
-  // TODO make pure virtual
+void Shader::set_uniform_4f(
+    const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) {
+  set_uniform_4f(get_uniform_handle(uniform_name), value_1, value_2, value_3, value_4);
 }
 
 /**
- * \fn Shader::set_uniform_texture
  * \brief Uploads a 2D texture uniform value to this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
@@ -236,11 +250,122 @@ void Shader::set_uniform_4f(const std::string&, float, float, float, float) {
  * \param value The 2D texture value value to set.
  * \return \c true in case of success.
  */
-bool Shader::set_uniform_texture(const std::string&, const SurfacePtr&) {
+bool Shader::set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) {
+  return set_uniform_texture(get_uniform_handle(uniform_name), value);
+}
+
+/**
+ * \fn Shader::set_uniform_1b
+ * \brief Uploads a boolean uniform value to this shader program.
+ *
+ * Does nothing if the handle is -1.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value The boolean value to set.
+ */
+void Shader::set_uniform_1b(int, bool) {
+  // TODO make pure virtual
+}
+
+/**
+ * \fn Shader::set_uniform_1i
+ * \brief Uploads an integer uniform value to this shader program.
+ *
+ * Does nothing if the handle is -1.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value The integer value to set.
+ */
+void Shader::set_uniform_1i(int, int) {
+  // TODO make pure virtual
+}
+
+/**
+ * \fn Shader::set_uniform_1f
+ * \brief Uploads a float uniform value to this shader program.
+ *
+ * Does nothing if the handle is -1.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value The float value to set.
+ */
+void Shader::set_uniform_1f(int, float) {
+  // TODO make pure virtual
+}
+
+/**
+ * \fn Shader::set_uniform_2f
+ * \brief Uploads a vec2 uniform value to this shader program.
+ *
+ * Does nothing if the handle is -1.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value_1 The first float value to set.
+ * \param value_2 The second float value to set.
+ */
+void Shader::set_uniform_2f(int, float, float) {
+  // TODO make pure virtual
+}
+
+/**
+ * \fn Shader::set_uniform_3f
+ * \brief Uploads a vec3 uniform value to this shader program.
+ *
+ * Does nothing if the handle is -1.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value_1 The first float value to set.
+ * \param value_2 The second float value to set.
+ * \param value_3 The third float value to set.
+ */
+void Shader::set_uniform_3f(int, float, float, float) {
+  // TODO make pure virtual
+}
+
+/**
+ * \fn Shader::set_uniform_4f
+ * \brief Uploads a vec4 uniform value to this shader program.
+ *
+ * Does nothing if the handle is -1.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value_1 The first float value to set.
+ * \param value_2 The second float value to set.
+ * \param value_3 The third float value to set.
+ * \param value_4 The fourth float value to set.
+ */
+void Shader::set_uniform_4f(int, float, float, float, float) {
+  // TODO make pure virtual
+}
+
+/**
+ * \fn Shader::set_uniform_texture
+ * \brief Uploads a 2D texture uniform value to this shader program.
+ *
+ * Does nothing if the handle is -1.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value The 2D texture value value to set.
+ * \return \c true in case of success.
+ */
+bool Shader::set_uniform_texture(int, const SurfacePtr&) {
   // TODO make pure virtual
   return false;
 }
 
+/**
+ * \brief Finds the handles of the uniforms set by the engine at each draw.
+ *
+ * Subclasses should call this function once the program is loaded.
+ */
+void Shader::resolve_builtin_uniforms() {
+
+  time_handle = get_uniform_handle(TIME_NAME);
+  output_size_handle = get_uniform_handle(OUTPUT_SIZE_NAME);
+  input_size_handle = get_uniform_handle(INPUT_SIZE_NAME);
+  opacity_handle = get_uniform_handle(OPACITY_NAME);
+}
+
 /**
  * @brief Render given surface on currently bound rendertarget
  * @param surface surface to draw
@@ -273,26 +398,24 @@ void Shader::render(const Surface& surface, const Rectangle& region, const Size&
   }
   //Set input size
   const Size& size = flip_y ? Video::get_output_size() : dst_size;
-  set_uniform_1i(Shader::TIME_NAME, System::now());
-  set_uniform_2f(Shader::OUTPUT_SIZE_NAME, size.width, size.height);
-  set_uniform_2f(Shader::INPUT_SIZE_NAME, region.get_width(), region.get_height());
+  set_uniform_1i(time_handle, System::now());
+  set_uniform_2f(output_size_handle, size.width, size.height);
+  set_uniform_2f(input_size_handle, region.get_width(), region.get_height());
   render(screen_quad,surface,viewport*dst*scale,uvm);
 }
 
 void Shader::draw(Surface& dst_surface, const Surface &src_surface, const DrawInfos &infos) const {
-    dst_surface.request_render().with_target([&](SDL_Renderer* r){
+    const Rectangle dst_rect(infos.dst_position,infos.region.get_size());
+    dst_surface.request_render().with_target(dst_rect,[&](SDL_Renderer* r){
       SDL_BlendMode target = Surface::make_sdl_blend_mode(dst_surface.get_internal_surface(),
                                                           src_surface.get_internal_surface(),
                                                           infos.blend_mode); //TODO fix alpha premult here
-      SDL_BlendMode current;
-      SDL_GetRenderDrawBlendMode(r,&current);
-      if(target != current) { //Blend mode need change
-        SDL_SetRenderDrawBlendMode(r,target);
+      if(Video::set_render_draw_blend_mode(target)) { //Blend mode need change
         SDL_RenderDrawPoint(r,-100,-100); //Draw a point offscreen to force blendmode change
       }
       //TODO fix this ugliness
       Shader* that = const_cast<Shader*>(this);
-      that->set_uniform_1f(OPACITY_NAME,src_surface.get_opacity()/256.f);
+      that->set_uniform_1f(opacity_handle,src_surface.get_opacity()/256.f);
       that->Shader::render(src_surface,infos.region,dst_surface.get_size(),infos.dst_position);
     });
 }
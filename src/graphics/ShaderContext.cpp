@@ -33,6 +33,8 @@ bool is_universal_shader_supported = false;
 
 }  // Anonymous namespace.
 
+bool ShaderContext::shader_supported = false;
+
 
 /**
  * \brief Initializes the shader system.
@@ -59,11 +61,17 @@ bool ShaderContext::initialize() {
 
   // Try to initialize a gl shader system, in order from the earlier to the older.
   is_universal_shader_supported = GlShader::initialize();
-  if (is_universal_shader_supported) {
-    return true;
-  }
+  shader_supported = is_universal_shader_supported || GlArbShader::initialize();
+  return shader_supported;
+}
 
-  return GlArbShader::initialize();
+/**
+ * \brief Returns whether shaders can be created.
+ * \return \c false if there is no OpenGL context or if it has no shader
+ * system.
+ */
+bool ShaderContext::is_shader_supported() {
+  return shader_supported;
 }
 
 /**
@@ -111,6 +119,24 @@ ShaderPtr ShaderContext::create_shader(const std::string& shader_id) {
   return shader;
 }
 
+/**
+ * \brief Creates a shader with the default sources to draw batches of quads.
+ * \return The created shader, or nullptr if GLSL shaders are not supported.
+ */
+std::unique_ptr<GlShader> ShaderContext::create_batch_shader() {
+
+  if (!is_universal_shader_supported) {
+    return nullptr;
+  }
+
+  std::unique_ptr<GlShader> shader(new GlShader(""));
+  if (!shader->is_valid()) {
+    Logger::info("Cannot create the batch shader: " + shader->get_error());
+    return nullptr;
+  }
+  return shader;
+}
+
 void ShaderContext::make_current() {
   SDL_GL_MakeCurrent(Video::get_window(),gl_context);
 }
@@ -14,10 +14,30 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/Debug.h"
+#include "solarus/core/WorkerPool.h"
 #include "solarus/graphics/SoftwarePixelFilter.h"
+#include <algorithm>
+#include <functional>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Minimum number of source rows of a band.
+ *
+ * Smaller bands would cost more in synchronization than they save.
+ */
+constexpr int min_rows_per_band = 16;
+
+/**
+ * \brief Maximum number of threads filtering a rectangle, including the main one.
+ */
+int num_filter_threads = WorkerPool::get_default_num_threads();
+
+}
+
 /**
  * \brief Constructor.
  */
@@ -30,5 +50,57 @@ SoftwarePixelFilter::SoftwarePixelFilter() {
 SoftwarePixelFilter::~SoftwarePixelFilter() {
 }
 
+/**
+ * \copydoc SoftwarePixelFilter::filter
+ */
+void SoftwarePixelFilter::filter(
+    const uint32_t* src,
+    int src_width,
+    int src_height,
+    uint32_t* dst) const {
+
+  prepare_filter();
+
+  const int num_bands = std::max(1, std::min(num_filter_threads, src_height / min_rows_per_band));
+  if (num_bands == 1) {
+    filter_rows(src, src_width, src_height, dst, 0, src_height);
+    return;
+  }
+
+  const std::function<void(int)> job = [&](int band) {
+    const int first_row = src_height * band / num_bands;
+    const int end_row = src_height * (band + 1) / num_bands;
+    filter_rows(src, src_width, src_height, dst, first_row, end_row);
+  };
+  WorkerPool::run(num_bands, num_bands, job);
 }
 
+/**
+ * \brief Returns the maximum number of threads used to filter a rectangle.
+ * \return The number of threads, including the main one.
+ */
+int SoftwarePixelFilter::get_num_threads() {
+  return num_filter_threads;
+}
+
+/**
+ * \brief Sets the maximum number of threads used to filter a rectangle.
+ *
+ * The default value depends on the number of cores, up to 4.
+ *
+ * \param num_threads The number of threads, including the main one.
+ * 1 means filtering in the main thread only.
+ */
+void SoftwarePixelFilter::set_num_threads(int num_threads) {
+
+  Debug::check_assertion(num_threads >= 1, "Invalid number of threads");
+  num_filter_threads = num_threads;
+}
+
+/**
+ * \brief Does nothing by default.
+ */
+void SoftwarePixelFilter::prepare_filter() const {
+}
+
+}
@@ -59,6 +59,37 @@ void Sprite::quit() {
   all_animation_sets.clear();
 }
 
+/**
+ * \brief Returns the ids of the animation sets already loaded.
+ * \return The ids of loaded animation sets.
+ */
+std::set<std::string> Sprite::get_loaded_animation_set_ids() {
+
+  std::set<std::string> ids;
+  for (const auto& kvp: all_animation_sets) {
+    ids.insert(kvp.first);
+  }
+  return ids;
+}
+
+/**
+ * \brief Creates an animation set from data already read.
+ *
+ * This allows to prepare sprites in advance.
+ * Does nothing if the animation set is already loaded.
+ *
+ * \param id Id of the animation set.
+ * \param data The content of its sprite data file.
+ */
+void Sprite::add_animation_set(const std::string& id, const SpriteData& data) {
+
+  if (all_animation_sets.find(id) != all_animation_sets.end()) {
+    return;
+  }
+
+  all_animation_sets[id] = new SpriteAnimationSet(id, data);
+}
+
 /**
  * \brief Returns the sprite animation set corresponding to the specified id.
  *
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryStream.h"
 #include "solarus/core/Debug.h"
 #include "solarus/graphics/SpriteData.h"
 #include "solarus/lua/LuaTools.h"
@@ -23,6 +24,13 @@
 
 namespace Solarus {
 
+namespace {
+
+const std::string binary_format_name = "sprite";  /**< Header of binary sprite files. */
+constexpr int binary_format_version = 1;          /**< Version of binary sprite files. */
+
+}
+
 /**
  * \brief Creates a default single-frame sprite animation direction.
  */
@@ -704,6 +712,104 @@ bool SpriteData::export_to_lua(std::ostream& out) const {
   return true;
 }
 
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool SpriteData::import_from_binary(const std::string& buffer) {
+
+  BinaryReader reader(buffer);
+  if (!reader.read_header(binary_format_name, binary_format_version)) {
+    return false;
+  }
+
+  // Read into a separate object to leave this one unchanged in case of failure.
+  SpriteData sprite;
+  const std::string& default_animation = reader.read_string();
+
+  const int num_animations = reader.read_count(16);
+  for (int i = 0; i < num_animations && reader.is_valid(); ++i) {
+    const std::string& animation_name = reader.read_string();
+    const std::string& src_image = reader.read_string();
+    const uint32_t frame_delay = static_cast<uint32_t>(reader.read_int());
+    const int frame_to_loop_on = reader.read_int();
+    if (frame_to_loop_on < -1) {
+      return false;
+    }
+
+    std::deque<SpriteAnimationDirectionData> directions;
+    const int num_directions = reader.read_count(32);
+    for (int j = 0; j < num_directions; ++j) {
+      const int x = reader.read_int();
+      const int y = reader.read_int();
+      const int frame_width = reader.read_int();
+      const int frame_height = reader.read_int();
+      const int origin_x = reader.read_int();
+      const int origin_y = reader.read_int();
+      const int num_frames = reader.read_int();
+      const int num_columns = reader.read_int();
+      if (num_columns < 1 ||
+          num_columns > num_frames ||
+          frame_to_loop_on >= num_frames) {
+        return false;
+      }
+      directions.emplace_back(
+            Point(x, y), Size(frame_width, frame_height),
+            Point(origin_x, origin_y), num_frames, num_columns);
+    }
+
+    if (!reader.is_valid() ||
+        !sprite.add_animation(animation_name,
+            SpriteAnimationData(src_image, directions, frame_delay, frame_to_loop_on))) {
+      return false;
+    }
+  }
+
+  if (!reader.is_valid() || !reader.is_at_end()) {
+    return false;
+  }
+
+  if (sprite.get_num_animations() > 0 &&
+      !sprite.set_default_animation_name(default_animation)) {
+    return false;
+  }
+
+  *this = std::move(sprite);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool SpriteData::export_to_binary(std::string& buffer) const {
+
+  BinaryWriter writer(buffer);
+  writer.write_header(binary_format_name, binary_format_version);
+  writer.write_string(default_animation_name);
+
+  writer.write_int(get_num_animations());
+  for (const auto& kvp : animations) {
+    const SpriteAnimationData& animation = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_string(animation.get_src_image());
+    writer.write_int(static_cast<int>(animation.get_frame_delay()));
+    writer.write_int(animation.get_loop_on_frame());
+
+    writer.write_int(animation.get_num_directions());
+    for (const SpriteAnimationDirectionData& direction : animation.get_directions()) {
+      writer.write_int(direction.get_xy().x);
+      writer.write_int(direction.get_xy().y);
+      writer.write_int(direction.get_size().width);
+      writer.write_int(direction.get_size().height);
+      writer.write_int(direction.get_origin().x);
+      writer.write_int(direction.get_origin().y);
+      writer.write_int(direction.get_num_frames());
+      writer.write_int(direction.get_num_columns());
+    }
+  }
+
+  return true;
+}
+
 /**
  * \brief Saves an animation data as Lua into a stream.
  * \param animation_name The name of animation to save.
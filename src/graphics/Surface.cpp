@@ -30,13 +30,76 @@
 
 #include <algorithm>
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <utility>
 
 #include <SDL_render.h>
 #include <SDL_image.h>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Images decoded in advance, indexed by base directory and file name.
+ */
+std::map<std::pair<Surface::ImageDirectory, std::string>, SDL_Surface_UniquePtr> decoded_images;
+
+/**
+ * \brief Returns the path of an image file relative to the data package.
+ * \param[in] file_name Name of the image file, relative to the base directory.
+ * \param[in] base_directory The base directory.
+ * \param[out] language_specific Whether the path is language-specific.
+ * \return The path to use with QuestFiles.
+ */
+std::string get_image_path(
+    const std::string& file_name,
+    Surface::ImageDirectory base_directory,
+    bool& language_specific) {
+
+  std::string prefix;
+  language_specific = false;
+
+  if (base_directory == Surface::DIR_SPRITES) {
+    prefix = "sprites/";
+  }
+  else if (base_directory == Surface::DIR_LANGUAGE) {
+    language_specific = true;
+    prefix = "images/";
+  }
+  return prefix + file_name;
+}
+
+/**
+ * \brief Decodes an image file into a software surface in the RGBA format.
+ * \param buffer Content of the image file.
+ * \return The surface decoded, or nullptr in case of error.
+ */
+SDL_Surface_UniquePtr decode_image(const std::string& buffer) {
+
+  SDL_RWops* rw = SDL_RWFromMem(const_cast<char*>(buffer.data()), (int) buffer.size());
+  SDL_Surface_UniquePtr surface(IMG_Load_RW(rw, 0));
+  SDL_RWclose(rw);
+
+  if (surface == nullptr) {
+    return nullptr;
+  }
+
+  SDL_PixelFormat* pixel_format = Video::get_rgba_format();
+  if (surface->format->format == pixel_format->format) {
+    return surface;
+  }
+
+  // Convert to the preferred pixel format.
+  return SDL_Surface_UniquePtr(SDL_ConvertSurface(
+        surface.get(),
+        pixel_format,
+        0
+  ));
+}
+
+}
 
 Surface::SurfaceDraw Surface::draw_proxy;
 
@@ -156,17 +219,18 @@ SurfaceImpl *Surface::get_surface_from_file(
     const std::string& file_name,
     ImageDirectory base_directory) {
 
-  std::string prefix;
-  bool language_specific = false;
-
-  if (base_directory == DIR_SPRITES) {
-    prefix = "sprites/";
-  }
-  else if (base_directory == DIR_LANGUAGE) {
-    language_specific = true;
-    prefix = "images/";
+  // Use the image decoded in advance if any.
+  const auto it = decoded_images.find(std::make_pair(base_directory, file_name));
+  if (it != decoded_images.end()) {
+    SDL_Surface* decoded_surface = it->second.get();
+    SDL_Surface* surface = SDL_ConvertSurface(decoded_surface, decoded_surface->format, 0);
+    if (surface != nullptr) {
+      return new Texture(surface);
+    }
   }
-  std::string prefixed_file_name = prefix + file_name;
+
+  bool language_specific = false;
+  const std::string& prefixed_file_name = get_image_path(file_name, base_directory, language_specific);
 
   if (!QuestFiles::data_file_exists(prefixed_file_name, language_specific)) {
     // File not found.
@@ -174,33 +238,67 @@ SurfaceImpl *Surface::get_surface_from_file(
   }
 
   const std::string& buffer = QuestFiles::data_file_read(prefixed_file_name, language_specific);
-  SDL_RWops* rw = SDL_RWFromMem(const_cast<char*>(buffer.data()), (int) buffer.size());
+  SDL_Surface_UniquePtr surface = decode_image(buffer);
 
-  SDL_Surface* surface = IMG_Load_RW(rw, 0);
+  Debug::check_assertion(surface != nullptr,
+                         std::string("Cannot load image '") + prefixed_file_name + "': " + SDL_GetError());
 
-  SDL_RWclose(rw);
+  return new Texture(surface.release());
+}
 
-  Debug::check_assertion(surface != nullptr,
-                         std::string("Cannot load image '") + prefixed_file_name + "'");
+/**
+ * \brief Decodes an image file into a software surface.
+ *
+ * Unlike create(), this function can be called from any thread:
+ * it does not create any texture and does not report errors.
+ * The result can then be given to add_decoded_image() by the main thread.
+ *
+ * \param file_name Name of the image file to load, relative to the base directory specified.
+ * \param base_directory The base directory to use.
+ * \return The surface decoded, or nullptr if the file could not be loaded.
+ */
+SDL_Surface_UniquePtr Surface::decode_image_file(
+    const std::string& file_name,
+    ImageDirectory base_directory) {
 
-  SDL_PixelFormat* pixel_format = Video::get_rgba_format();
-  if (surface->format->format == pixel_format->format) {
-    return new Texture(surface);
+  bool language_specific = false;
+  const std::string& prefixed_file_name = get_image_path(file_name, base_directory, language_specific);
+
+  if (!QuestFiles::data_file_exists(prefixed_file_name, language_specific)) {
+    return nullptr;
   }
 
-  // Convert to the preferred pixel format.
-  uint8_t opacity;
-  SDL_GetSurfaceAlphaMod(surface, &opacity);
-  SDL_Surface* converted_surface = SDL_ConvertSurface(
-        surface,
-        pixel_format,
-        0
-        );
-  Debug::check_assertion(converted_surface != nullptr,
-                         std::string("Failed to convert software surface: ") + SDL_GetError());
-  SDL_FreeSurface(surface);
+  return decode_image(QuestFiles::data_file_read(prefixed_file_name, language_specific));
+}
+
+/**
+ * \brief Provides an image decoded in advance.
+ *
+ * Next calls to create() with this image file get a copy of it instead of
+ * decoding the file again, until clear_decoded_images() is called.
+ *
+ * \param file_name Name of the image file, relative to the base directory specified.
+ * \param base_directory The base directory of the file.
+ * \param surface The decoded image, as returned by decode_image_file().
+ */
+void Surface::add_decoded_image(
+    const std::string& file_name,
+    ImageDirectory base_directory,
+    SDL_Surface_UniquePtr surface) {
 
-  return new Texture(converted_surface);
+  if (surface == nullptr) {
+    return;
+  }
+
+  decoded_images[std::make_pair(base_directory, file_name)] = std::move(surface);
+}
+
+/**
+ * \brief Frees the images provided by add_decoded_image().
+ */
+void Surface::clear_decoded_images() {
+
+  decoded_images.clear();
 }
 
 /**
@@ -248,11 +346,16 @@ const SurfaceImpl &Surface::get_internal_surface() const {
  *
  * Pixels returned have the RGBA 32-bit format.
  *
+ * \param previous_frame \c true to accept the pixels as they were at the end
+ * of the previous frame. This avoids reading them back from the GPU during
+ * the frame when the surface has changed.
  * \return The pixel buffer.
  */
-std::string Surface::get_pixels() const {
+std::string Surface::get_pixels(bool previous_frame) const {
   const int num_pixels = get_width() * get_height();
-  SDL_Surface* surface = internal_surface->get_surface();
+  SDL_Surface* surface = previous_frame ?
+      internal_surface->get_previous_surface() :
+      internal_surface->get_surface();
 
   if (surface->format->format == SDL_PIXELFORMAT_ABGR8888) {
     // No conversion needed.
@@ -574,8 +677,9 @@ SDL_BlendMode Surface::make_sdl_blend_mode(const SurfaceImpl& dst_surface, const
 /**
  * \brief Renders this surface onto a hardware texture.
  */
-void Surface::render(SDL_Renderer*& renderer) {
-  SDL_RenderCopy(renderer,internal_surface->get_texture(),NULL,NULL);
+void Surface::render(SDL_Renderer*& /* renderer */) {
+  // Go through Video to keep its renderer state and statistics correct.
+  SOLARUS_CHECK_SDL(Video::render_copy(internal_surface->get_texture(),nullptr,nullptr));
 }
 
 /**
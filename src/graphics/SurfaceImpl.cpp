@@ -1,8 +1,13 @@
 #include "solarus/graphics/SurfaceImpl.h"
+#include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/TextureAtlas.h"
 
 namespace Solarus {
 
 void SurfaceImpl::upload_surface() {
+  // Pending draws must use the previous pixels.
+  RenderTexture::flush_batch();
+  TextureAtlas::remove(*this);
   Rectangle rect(0,0,get_width(),get_height());
   SDL_Surface* surface = get_surface();
   SDL_UpdateTexture(get_texture(),
@@ -13,6 +18,14 @@ void SurfaceImpl::upload_surface() {
 }
 
 
+SDL_Surface* SurfaceImpl::get_previous_surface() const {
+  return get_surface();
+}
+
+bool SurfaceImpl::is_immutable() const {
+  return false;
+}
+
 SurfaceImpl::~SurfaceImpl() {
 
 }
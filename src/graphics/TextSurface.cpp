@@ -28,10 +28,35 @@
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
+#include <algorithm>
 #include <memory>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Returns the number of bytes of a UTF-8 character.
+ * \param first_byte The first byte of the character.
+ * \return The number of bytes of the character.
+ */
+size_t get_utf8_char_length(char first_byte) {
+
+  const uint8_t byte = static_cast<uint8_t>(first_byte);
+  if ((byte & 0xE0) == 0xC0) {
+    return 2;
+  }
+  if ((byte & 0xF0) == 0xE0) {
+    return 3;
+  }
+  if ((byte & 0xF8) == 0xF0) {
+    return 4;
+  }
+  return 1;
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Creates a text to draw with the default properties.
  *
@@ -70,7 +95,9 @@ TextSurface::TextSurface(int x, int y,
   font_size(11),
   x(x),
   y(y),
-  surface(nullptr),
+  quads(),
+  size(),
+  text_position(),
   text() {
 
   if (font_id.empty()) {
@@ -122,7 +149,7 @@ void TextSurface::set_horizontal_alignment(HorizontalAlignment horizontal_alignm
 
   this->horizontal_alignment = horizontal_alignment;
 
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -147,7 +174,7 @@ void TextSurface::set_vertical_alignment(VerticalAlignment vertical_alignment) {
 
   this->vertical_alignment = vertical_alignment;
 
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -168,7 +195,7 @@ void TextSurface::set_alignment(HorizontalAlignment horizontal_alignment,
   this->horizontal_alignment = horizontal_alignment;
   this->vertical_alignment = vertical_alignment;
 
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -250,7 +277,7 @@ void TextSurface::set_position(int x, int y) {
 
   this->x = x;
   this->y = y;
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -272,7 +299,7 @@ void TextSurface::set_x(int x) {
   }
 
   this->x = x;
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -294,7 +321,7 @@ void TextSurface::set_y(int y) {
   }
 
   this->y = y;
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -347,55 +374,44 @@ void TextSurface::add_char(char c) {
 }
 
 /**
- * \brief Returns the width of the surface containing the text.
+ * \brief Returns the width of the text.
  * \return the width in pixels
  */
 int TextSurface::get_width() const {
-
-  if (surface == nullptr) {
-    return 0;
-  }
-
-  return surface->get_width();
+  return size.width;
 }
 
 /**
- * \brief Returns the height of the surface containing the text.
+ * \brief Returns the height of the text.
  * \return the height in pixels
  */
 int TextSurface::get_height() const {
-
-  if (surface == nullptr) {
-    return 0;
-  }
-
-  return surface->get_height();
+  return size.height;
 }
 
 /**
- * \brief Returns the size of the surface containing the text.
- * \return the size of the surface
+ * \brief Returns the size of the text.
+ * \return the size of the text
  */
 Size TextSurface::get_size() const {
-  return { get_width(), get_height() };
+  return size;
 }
 
 /**
- * \brief Redraws the text surface.
+ * \brief Lays out the characters of the text.
  *
- * This function is called when there is a change.
+ * This function is called when the text or its appearance changes.
+ * Characters are placed into the existing quads so that only the ones
+ * that changed are rewritten.
  */
 void TextSurface::rebuild() {
 
-  surface = nullptr;
+  size = Size();
+  intermediate_surface_up_to_date = false;
 
-  if (font_id.empty()) {
-    return;
-  }
-
-  if (is_empty()) {
-    // Empty string or only whitespaces: no surface to create.
-    // Some fonts make TTF_Font fail if the string contains only whitespaces.
+  if (font_id.empty() || is_empty()) {
+    // Empty string or only whitespaces: nothing to draw.
+    quads.clear();
     return;
   }
 
@@ -410,69 +426,23 @@ void TextSurface::rebuild() {
     rebuild_ttf();
   }
 
-  // calculate the coordinates of the top-left corner
-  int x_left = 0, y_top = 0;
-
-  switch (horizontal_alignment) {
-
-  case HorizontalAlignment::LEFT:
-    x_left = x;
-    break;
-
-  case HorizontalAlignment::CENTER:
-    x_left = x - surface->get_width() / 2;
-    break;
-
-  case HorizontalAlignment::RIGHT:
-    x_left = x - surface->get_width();
-    break;
-  }
-
-  switch (vertical_alignment) {
-
-  case VerticalAlignment::TOP:
-    y_top = y;
-    break;
-
-  case VerticalAlignment::MIDDLE:
-    y_top = y - surface->get_height() / 2;
-    break;
-
-  case VerticalAlignment::BOTTOM:
-    y_top = y - surface->get_height();
-    break;
-  }
-
-  text_position = { x_left, y_top };
+  update_text_position();
 }
 
 /**
- * \brief Redraws the text surface in the case of a bitmap font.
+ * \brief Lays out the characters of the text in the case of a bitmap font.
  *
- * This function is called when there is a change.
+ * The bitmap of the font is used as the glyph atlas.
  */
 void TextSurface::rebuild_bitmap() {
 
-  // First count the number of characters in the UTF-8 string.
-  int num_chars = 0;
-  for (unsigned i = 0; i < text.size(); i++) {
-    char current_char = text[i];
-    if ((current_char & 0xE0) == 0xC0) {
-      // This character uses two bytes.
-      ++i;
-    }
-    ++num_chars;
-  }
-
   // Determine the letter size from the surface size.
   const SurfacePtr& bitmap = FontResource::get_bitmap_font(font_id);
   const Size& bitmap_size = bitmap->get_size();
   int char_width = bitmap_size.width / 128;
   int char_height = bitmap_size.height / 16;
 
-  surface = Surface::create((char_width - 1) * num_chars + 1, char_height);
-
-  // Traverse the string again to draw the characters.
+  size_t num_chars = 0;
   Point dst_position;
   for (unsigned i = 0; i < text.size(); i++) {
     char first_byte = text[i];
@@ -489,70 +459,236 @@ void TextSurface::rebuild_bitmap() {
       src_position.set_xy((code_point % 128) * char_width,
           (code_point / 128) * char_height);
     }
-    bitmap->draw_region(src_position, surface, dst_position);
+    set_quad(num_chars, bitmap, src_position, dst_position);
+    ++num_chars;
     dst_position.x += char_width - 1;
   }
+  quads.resize(num_chars);
+
+  size = Size((char_width - 1) * num_chars + 1, char_height);
 }
 
 /**
- * \brief Redraws the text surface in the case of a normal font.
+ * \brief Lays out the characters of the text in the case of a normal font.
  *
- * This function is called when there is a change.
+ * Characters are taken from the glyph atlas of the font and placed
+ * like TTF_RenderUTF8_Solid() and TTF_RenderUTF8_Blended() would.
  */
 void TextSurface::rebuild_ttf() {
 
-  // create the text surface
-
-  SDL_Surface* internal_surface = nullptr;
   TTF_Font& internal_font = FontResource::get_outline_font(font_id, font_size);
-  SDL_Color internal_color;
-  text_color.get_components(
-      internal_color.r, internal_color.g, internal_color.b, internal_color.a);
+  const bool antialiasing = (rendering_mode == RenderingMode::ANTIALIASING);
+
+  size_t num_quads = 0;
+  int pen_x = 0;
+  int min_x = 0;
+  int max_x = 0;
+  uint32_t previous_code_point = 0;
+  std::string character;
+  for (size_t i = 0; i < text.size(); i += character.size()) {
+    character.assign(text, i, get_utf8_char_length(text[i]));
+    const FontResource::Glyph& glyph = FontResource::get_outline_glyph(
+        font_id, font_size, antialiasing, text_color, character
+    );
+
+#if SDL_VERSIONNUM(SDL_TTF_MAJOR_VERSION, SDL_TTF_MINOR_VERSION, SDL_TTF_PATCHLEVEL) >= SDL_VERSIONNUM(2, 0, 14)
+    if (previous_code_point != 0 &&
+        previous_code_point <= 0xFFFF &&
+        glyph.code_point <= 0xFFFF) {
+      pen_x += TTF_GetFontKerningSizeGlyphs(
+          &internal_font, previous_code_point, glyph.code_point);
+    }
+#endif
+    previous_code_point = glyph.code_point;
+
+    if (glyph.atlas != nullptr) {
+      const Point dst_position(pen_x + glyph.x_offset, 0);
+      set_quad(num_quads, glyph.atlas, glyph.src_rect, dst_position);
+      ++num_quads;
+      min_x = std::min(min_x, dst_position.x);
+      max_x = std::max(max_x, dst_position.x + glyph.src_rect.get_width());
+    }
+    pen_x += glyph.advance;
+    max_x = std::max(max_x, pen_x);
+  }
+  quads.resize(num_quads);
 
-  switch (rendering_mode) {
+  if (min_x < 0) {
+    // The first pixels are on the left of the pen: shift the whole text.
+    for (GlyphQuad& quad : quads) {
+      quad.dst_position.x -= min_x;
+    }
+  }
 
-  case RenderingMode::SOLID:
-    internal_surface = TTF_RenderUTF8_Solid(&internal_font, text.c_str(), internal_color);
+  size = Size(max_x - min_x, TTF_FontHeight(&internal_font));
+}
+
+/**
+ * \brief Places a character of the text.
+ * \param index Index of the quad to set. It can be the number of quads
+ * to add a new one.
+ * \param atlas Surface containing the glyph.
+ * \param src_rect Region of the glyph in the atlas.
+ * \param dst_position Position of the glyph relative to the text.
+ */
+void TextSurface::set_quad(size_t index, const SurfacePtr& atlas,
+    const Rectangle& src_rect, const Point& dst_position) {
+
+  if (index == quads.size()) {
+    quads.push_back({ atlas, src_rect, dst_position });
+    return;
+  }
+
+  GlyphQuad& quad = quads[index];
+  if (quad.atlas != atlas) {
+    quad.atlas = atlas;
+  }
+  quad.src_rect = src_rect;
+  quad.dst_position = dst_position;
+}
+
+/**
+ * \brief Calculates the coordinates of the top-left corner of the text.
+ *
+ * This function is called when the position or the alignment changes,
+ * or when the size of the text changes.
+ */
+void TextSurface::update_text_position() {
+
+  int x_left = 0, y_top = 0;
+
+  switch (horizontal_alignment) {
+
+  case HorizontalAlignment::LEFT:
+    x_left = x;
     break;
 
-  case RenderingMode::ANTIALIASING:
-    internal_surface = TTF_RenderUTF8_Blended(&internal_font, text.c_str(), internal_color);
+  case HorizontalAlignment::CENTER:
+    x_left = x - size.width / 2;
+    break;
+
+  case HorizontalAlignment::RIGHT:
+    x_left = x - size.width;
     break;
   }
 
-  Debug::check_assertion(internal_surface != nullptr,
-      std::string("Cannot create the text surface for string '") + text + "': "
-      + SDL_GetError()
-  );
+  switch (vertical_alignment) {
+
+  case VerticalAlignment::TOP:
+    y_top = y;
+    break;
+
+  case VerticalAlignment::MIDDLE:
+    y_top = y - size.height / 2;
+    break;
+
+  case VerticalAlignment::BOTTOM:
+    y_top = y - size.height;
+    break;
+  }
+
+  text_position = { x_left, y_top };
+}
+
+/**
+ * \brief Returns a surface with all characters of the text.
+ *
+ * It is drawn again only when the text or its appearance changed.
+ *
+ * \return The intermediate surface, of the size of the text.
+ */
+Surface& TextSurface::get_intermediate_surface() const {
+
+  if (intermediate_surface == nullptr ||
+      intermediate_surface->get_size() != size) {
+    intermediate_surface = Surface::create(size, true);
+    intermediate_surface_up_to_date = false;
+  }
+  else if (!intermediate_surface_up_to_date) {
+    intermediate_surface->clear();
+  }
 
-  surface = std::make_shared<Surface>(internal_surface);
+  if (!intermediate_surface_up_to_date) {
+    for (const GlyphQuad& quad : quads) {
+      quad.atlas->raw_draw_region(
+          *intermediate_surface,
+          DrawInfos(quad.src_rect, quad.dst_position,
+                    BlendMode::BLEND, 255, Surface::draw_proxy));
+    }
+    intermediate_surface_up_to_date = true;
+  }
+  return *intermediate_surface;
 }
 
 /**
- * \brief Draws this text on the given surface
- * \param region The subrectangle to draw in this object.
+ * \brief Draws this text on the given surface.
+ *
+ * Characters are drawn one after the other from their glyph atlas.
+ * They end up in the same batch of the destination surface.
+ * With an opacity or a shader, they are first drawn together on an
+ * intermediate surface: overlapping characters must not be blended twice,
+ * and shaders expect the whole text as a single surface.
+ *
  * \param dst_surface The destination surface.
  * \param infos draw informations.
  */
 void TextSurface::raw_draw(Surface& dst_surface,const DrawInfos& infos) const {
-  if (surface != nullptr) {
-    surface->raw_draw(
+  if (quads.empty()) {
+    return;
+  }
+
+  if (infos.opacity != 255 || &infos.proxy != &Surface::draw_proxy) {
+    const Point dst_position = infos.dst_position + text_position;
+    get_intermediate_surface().raw_draw_region(
         dst_surface,
-        DrawInfos(infos,infos.dst_position + text_position));
+        DrawInfos(infos, infos.region, dst_position));
+    return;
+  }
+
+  for (const GlyphQuad& quad : quads) {
+    const Point dst_position = infos.dst_position + text_position + quad.dst_position;
+    quad.atlas->raw_draw_region(
+        dst_surface,
+        DrawInfos(infos, quad.src_rect, dst_position));
   }
 }
 
 /**
  * \brief Draws a subrectangle of this text surface on another surface.
- * \param region The subrectangle to draw in this object.
+ *
+ * Like raw_draw(), characters are drawn together first when there is an
+ * opacity or a shader.
+ *
  * \param dst_surface The destination surface.
  * \param infos drawing infos
  */
 void TextSurface::raw_draw_region(Surface& dst_surface,const DrawInfos& infos) const {
-  if (surface != nullptr) {
-    surface->raw_draw_region(
+  if (quads.empty()) {
+    return;
+  }
+
+  if (infos.opacity != 255 || &infos.proxy != &Surface::draw_proxy) {
+    const Point dst_position = infos.dst_position + text_position;
+    get_intermediate_surface().raw_draw_region(
+        dst_surface,
+        DrawInfos(infos, infos.region, dst_position));
+    return;
+  }
+
+  for (const GlyphQuad& quad : quads) {
+    const Rectangle quad_rect(quad.dst_position, quad.src_rect.get_size());
+    const Rectangle visible_rect = quad_rect & infos.region;
+    if (visible_rect.is_flat()) {
+      continue;
+    }
+    const Rectangle src_rect(
+        quad.src_rect.get_xy() + visible_rect.get_xy() - quad.dst_position,
+        visible_rect.get_size());
+    const Point dst_position = infos.dst_position + text_position
+        + visible_rect.get_xy() - infos.region.get_xy();
+    quad.atlas->raw_draw_region(
         dst_surface,
-        DrawInfos(infos,infos.dst_position + text_position));
+        DrawInfos(infos, src_rect, dst_position));
   }
 }
 
@@ -1,5 +1,6 @@
 #include "solarus/graphics/Texture.h"
 #include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/TextureAtlas.h"
 #include "solarus/core/Debug.h"
 #include "solarus/graphics/Surface.h"
 
@@ -18,6 +19,17 @@ Texture::Texture(SDL_Surface *surface)
   texture.reset(tex);
 }
 
+/**
+ * @brief Destructor.
+ *
+ * Pending draws that use this texture are flushed first,
+ * and its copy in the texture atlas is forgotten.
+ */
+Texture::~Texture() {
+  RenderTexture::flush_batch();
+  TextureAtlas::remove(*this);
+}
+
 /**
  * \copydoc SurfaceImpl::get_texture
  */
@@ -57,4 +69,11 @@ RenderTexture* Texture::to_render_texture() {
     return rt;
 }
 
+/**
+ * \copydoc SurfaceImpl::is_immutable
+ */
+bool Texture::is_immutable() const {
+    return true;
+}
+
 }
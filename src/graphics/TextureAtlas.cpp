@@ -0,0 +1,125 @@
+#include "solarus/graphics/TextureAtlas.h"
+#include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/SurfaceImpl.h"
+#include "solarus/graphics/Video.h"
+#include "solarus/core/Logger.h"
+
+namespace Solarus {
+
+std::vector<std::unique_ptr<TextureAtlas::Page>> TextureAtlas::pages;
+std::unordered_map<const SurfaceImpl*, TextureAtlas::Entry> TextureAtlas::entries;
+
+/**
+ * @brief get the page and the position of an image, copying it if needed
+ *
+ * Images bigger than max_image_size are never copied, and nothing is
+ * copied any more once all pages are full.
+ * The render target may be changed by this call.
+ *
+ * @param texture an immutable texture
+ * @param[out] page the page texture where the image is
+ * @param[out] position the position of the image in the page
+ * @return false if the image is not in any page
+ */
+bool TextureAtlas::find_or_add(const SurfaceImpl& texture, SDL_Texture*& page, Point& position) {
+  auto it = entries.find(&texture);
+  if (it == entries.end()) {
+    const int width = texture.get_width();
+    const int height = texture.get_height();
+    if (width > max_image_size || height > max_image_size) {
+      return false;
+    }
+
+    Page* destination = nullptr;
+    mapbox::Bin* bin = nullptr;
+    for (const std::unique_ptr<Page>& candidate : pages) {
+      bin = candidate->packer.packOne(-1,width,height);
+      if (bin != nullptr) {
+        destination = candidate.get();
+        break;
+      }
+    }
+    if (bin == nullptr) {
+      destination = create_page();
+      if (destination == nullptr) {
+        return false;
+      }
+      bin = destination->packer.packOne(-1,width,height);
+      if (bin == nullptr) {
+        return false;
+      }
+    }
+
+    // Copy the pixels as they are: blending happens when drawing from the page.
+    SDL_Texture* source = texture.get_texture();
+    Video::set_render_target(destination->texture.get());
+    Video::set_texture_blend_mode(source,SDL_BLENDMODE_NONE);
+    Video::set_texture_alpha_mod(source,255);
+    Video::set_texture_color_mod(source,Color::white);
+    SOLARUS_CHECK_SDL(Video::render_copy(source,
+                                         Rectangle(0,0,width,height),
+                                         Rectangle(bin->x,bin->y,width,height)));
+    it = entries.emplace(&texture,Entry{destination,bin}).first;
+  }
+
+  page = it->second.page->texture.get();
+  position = Point(it->second.bin->x,it->second.bin->y);
+  return true;
+}
+
+/**
+ * @brief forget an image and give its space back
+ *
+ * Does nothing if the image is not in any page.
+ * @param texture a texture being destroyed or modified
+ */
+void TextureAtlas::remove(const SurfaceImpl& texture) {
+  auto it = entries.find(&texture);
+  if (it == entries.end()) {
+    return;
+  }
+  it->second.page->packer.unref(*it->second.bin);
+  entries.erase(it);
+}
+
+/**
+ * @brief destroy all pages
+ *
+ * Must be called before the renderer is destroyed.
+ */
+void TextureAtlas::quit() {
+  entries.clear();
+  pages.clear();
+}
+
+/**
+ * @brief create a new empty page
+ * @return the page, or nullptr if max_num_pages is reached or if the
+ * renderer cannot create such a big texture
+ */
+TextureAtlas::Page* TextureAtlas::create_page() {
+  if (pages.size() >= max_num_pages) {
+    return nullptr;
+  }
+
+  SDL_Texture* texture = SDL_CreateTexture(Video::get_renderer(),
+                                           Video::get_rgba_format()->format,
+                                           SDL_TEXTUREACCESS_TARGET,
+                                           page_size,page_size);
+  if (texture == nullptr) {
+    Logger::info(std::string("Cannot create texture atlas page: ") + SDL_GetError());
+    return nullptr;
+  }
+
+  std::unique_ptr<Page> page(new Page{
+    SDL_Texture_UniquePtr(texture),
+    mapbox::ShelfPack(page_size,page_size)
+  });
+  Video::set_render_target(texture);
+  Video::set_render_draw_color(Color::transparent);
+  SOLARUS_CHECK_SDL(SDL_RenderClear(Video::get_renderer()));
+  pages.push_back(std::move(page));
+  return pages.back().get();
+}
+
+}
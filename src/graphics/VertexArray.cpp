@@ -3,6 +3,7 @@
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/RenderTexture.h"
 #include "solarus/core/Debug.h"
+#include <algorithm>
 #include <cstddef> //offsetof
 
 namespace Solarus {
@@ -13,7 +14,6 @@ namespace Solarus {
  * @return Vertex reference
  */
 Vertex& VerticeView::operator [](size_t index) {
-  array.buffer_dirty = true;
   return array[offset+index];
 }
 
@@ -125,7 +125,7 @@ VerticeView VerticeView::sub_view(off_t a_offset) const {
  * @param uvs new uv coordinates
  */
 void VerticeView::update_quad_uvs(const Rectangle& uvs) {
-  array.buffer_dirty = true;
+  array.mark_dirty(offset,offset+6);
   glm::vec2 u1 = uvs.get_top_left();
   glm::vec2 u2 = uvs.get_bottom_left();
   glm::vec2 u3 = uvs.get_bottom_right();
@@ -144,7 +144,7 @@ void VerticeView::update_quad_uvs(const Rectangle& uvs) {
  */
 void VerticeView::update_quad_positions(const Rectangle& pos)
 {
-  array.buffer_dirty = true;
+  array.mark_dirty(offset,offset+6);
   glm::vec2 v1 = pos.get_top_left();
   glm::vec2 v2 = pos.get_bottom_left();
   glm::vec2 v3 = pos.get_bottom_right();
@@ -162,7 +162,7 @@ void VerticeView::update_quad_positions(const Rectangle& pos)
  * @param position new position
  */
 void VerticeView::update_quad_position(const Point& position) {
-  array.buffer_dirty = true;
+  array.mark_dirty(offset,offset+6);
   glm::vec2 old = at(0).position;
   glm::vec2 diff = (glm::vec2)position - old;
   for(int i = 0; i < 6; i++) {
@@ -194,6 +194,7 @@ VertexArray::VertexArray(PrimitiveType type):
 VertexArray::VertexArray(PrimitiveType type,size_t vertex_count):
   vertices(vertex_count),type(type)
 {
+  mark_dirty(0,vertex_count);
 }
 
 /**
@@ -232,10 +233,34 @@ PrimitiveType VertexArray::get_primitive_type() const {
 }
 
 /**
- * @brief VertexArray::data
- * @return
+ * @brief tells if this array is drawn from alternate buffers
+ * @return true if the array is in streaming mode
+ */
+bool VertexArray::is_streaming() const {
+  return streaming;
+}
+
+/**
+ * @brief sets whether this array is drawn from alternate buffers
+ *
+ * Use it for geometry that is rebuilt every frame or several times per
+ * frame: the whole array is then uploaded to the buffer that was not used
+ * by the previous draw, after orphaning its storage, so that the upload
+ * never waits for the GPU to finish drawing.
+ * @param streaming true to enable the streaming mode
+ */
+void VertexArray::set_streaming(bool streaming) {
+  this->streaming = streaming;
+}
+
+/**
+ * @brief get pointer to data contiguous in memory
+ *
+ * The whole array is considered modified.
+ * @return pointer to vector storage
  */
 Vertex* VertexArray::data() {
+  mark_dirty(0,vertex_count());
   return vertices.data();
 }
 
@@ -247,7 +272,6 @@ Vertex* VertexArray::data() {
  * @return a vertice view to the quad
  */
 VerticeView VertexArray::add_quad(const Rectangle& rect, const Rectangle& uvs, const Color& color) {
-  buffer_dirty = true;
   Vertex v1(rect.get_top_left(),
             color,
             uvs.get_top_left());
@@ -292,6 +316,18 @@ const Vertex* VertexArray::data() const {
  */
 void VertexArray::add_vertex(const Vertex& v) {
   vertices.push_back(v);
+  mark_dirty(vertices.size()-1,vertices.size());
+}
+
+/**
+ * @brief remove all vertices
+ *
+ * The buffer objects keep their capacity, so that the array can be
+ * refilled every frame without reallocating them.
+ */
+void VertexArray::clear() {
+  vertices.clear();
+  dirty_ranges.clear();
 }
 
 /**
@@ -308,7 +344,9 @@ size_t VertexArray::vertex_count() const {
  * @return vertex reference
  */
 Vertex& VertexArray::operator [](size_t index) {
-  return vertices.at(index);
+  Vertex& vertex = vertices.at(index);
+  mark_dirty(index,index+1);
+  return vertex;
 }
 
 /**
@@ -320,4 +358,88 @@ const Vertex& VertexArray::operator [](size_t index) const {
   return vertices.at(index);
 }
 
+/**
+ * @brief remember that some vertices need to be reuploaded
+ *
+ * Consecutive modifications of neighbour vertices are merged
+ * into a single range.
+ * @param begin index of the first modified vertex
+ * @param end index after the last modified vertex
+ */
+void VertexArray::mark_dirty(size_t begin, size_t end) const {
+  if(begin >= end) {
+    return;
+  }
+
+  if(!dirty_ranges.empty()) {
+    Range& last = dirty_ranges.back();
+    if(begin <= last.second && end >= last.first) {
+      //Overlapping or contiguous with the last modification
+      last.first = std::min(last.first,begin);
+      last.second = std::max(last.second,end);
+      return;
+    }
+  }
+
+  if(dirty_ranges.size() == max_dirty_ranges) {
+    //Too many small uploads: upload everything between them at once
+    Range merged(begin,end);
+    for(const Range& range : dirty_ranges) {
+      merged.first = std::min(merged.first,range.first);
+      merged.second = std::max(merged.second,range.second);
+    }
+    dirty_ranges.clear();
+    dirty_ranges.push_back(merged);
+    return;
+  }
+  dirty_ranges.emplace_back(begin,end);
+}
+
+/**
+ * @brief get the buffer to upload modified vertices to and to draw from
+ *
+ * In streaming mode, a modified array switches to the other buffer,
+ * which is then entirely reuploaded.
+ * @return the buffer to draw from
+ */
+VertexArray::Buffer& VertexArray::get_buffer_to_draw() const {
+  if(streaming && !dirty_ranges.empty()) {
+    current_buffer = 1 - current_buffer;
+    dirty_ranges.clear();
+    mark_dirty(0,vertex_count());
+  }
+  return buffers[current_buffer];
+}
+
+/**
+ * @brief make sure that a buffer is large enough for all vertices
+ *
+ * The capacity grows geometrically so that adding vertices one frame after
+ * another does not reallocate the buffer each time.
+ * When the buffer grows, the whole array is considered modified.
+ *
+ * In streaming mode, a buffer about to be uploaded is also reallocated
+ * with the same capacity: this orphans its old storage, which the GPU
+ * may still be reading when there are more draws per frame than buffers.
+ * @param buffer a buffer of this array
+ * @return true if the buffer must be reallocated with its capacity
+ */
+bool VertexArray::grow_buffer(Buffer& buffer) const {
+  if(vertex_count() <= buffer.capacity) {
+    return streaming && !dirty_ranges.empty();
+  }
+  buffer.capacity = std::max(vertex_count(),buffer.capacity*2);
+  dirty_ranges.clear();
+  mark_dirty(0,vertex_count());
+  return true;
+}
+
+/**
+ * @brief get the usage hint of the buffers of this array
+ * @return GL_STREAM_DRAW in streaming mode, GL_DYNAMIC_DRAW otherwise
+ */
+GLenum VertexArray::get_buffer_usage() const {
+  return streaming ? GL_STREAM_DRAW : GL_DYNAMIC_DRAW;
+}
+
 }
@@ -25,6 +25,7 @@
 #include "solarus/graphics/Hq2xFilter.h"
 #include "solarus/graphics/Hq3xFilter.h"
 #include "solarus/graphics/Hq4xFilter.h"
+#include "solarus/graphics/RenderTexture.h"
 #include "solarus/graphics/Scale2xFilter.h"
 #include "solarus/graphics/ShaderContext.h"
 #include "solarus/graphics/SoftwareVideoMode.h"
@@ -32,6 +33,7 @@
 #include "solarus/graphics/Video.h"
 #include <memory>
 #include <sstream>
+#include <unordered_map>
 #include <utility>
 
 #include <SDL.h>
@@ -42,6 +44,36 @@ namespace Solarus {
 
 namespace {
 
+/**
+ * \brief Blend mode, alpha and color modulation last set on a texture.
+ */
+struct TextureState {
+  SDL_BlendMode blend_mode = SDL_BLENDMODE_INVALID;
+  int alpha_mod = -1;
+  int color_mod = -1;  // RGB components packed as 0xRRGGBB.
+};
+
+/**
+ * \brief Renderer state last set, to avoid redundant SDL calls.
+ *
+ * An unknown value is always set again.
+ */
+struct RenderState {
+  bool target_known = false;                /**< Whether target is known. */
+  SDL_Texture* target = nullptr;            /**< Current render target (nullptr for the screen). */
+  bool draw_color_known = false;            /**< Whether draw_color is known. */
+  SDL_Color draw_color = { 0, 0, 0, 0 };    /**< Current draw color. */
+  SDL_BlendMode draw_blend_mode =
+      SDL_BLENDMODE_INVALID;                /**< Current draw blend mode. */
+  std::unordered_map<SDL_Texture*, TextureState>
+      textures;                             /**< State set on each texture. */
+
+  int num_target_switches = 0;              /**< Render target changes since the last frame. */
+  int num_copies = 0;                       /**< Texture copies since the last frame. */
+  int last_frame_num_target_switches = 0;   /**< Render target changes during the last frame. */
+  int last_frame_num_copies = 0;            /**< Texture copies during the last frame. */
+};
+
 /**
  * \brief Wraps the current video context and settings.
  */
@@ -83,10 +115,25 @@ struct VideoContext {
       default_video_mode = nullptr;         /**< Default software video mode. */
   SurfacePtr scaled_surface = nullptr;      /**< The screen surface used with software-scaled modes. */
 
+  RenderState render_state;                 /**< Cache of the renderer state. */
+
 };
 
 VideoContext context;
 
+/**
+ * \brief Keeps the renderer call counts of the frame that has just ended
+ * and starts counting the next frame.
+ */
+void end_frame_statistics() {
+
+  RenderState& render_state = context.render_state;
+  render_state.last_frame_num_target_switches = render_state.num_target_switches;
+  render_state.last_frame_num_copies = render_state.num_copies;
+  render_state.num_target_switches = 0;
+  render_state.num_copies = 0;
+}
+
 /**
  * \brief Creates the window but does not show it.
  * \param args Command-line arguments.
@@ -156,6 +203,9 @@ void create_window() {
   // Decide whether we enable shaders.
   context.shaders_enabled = context.rendertarget_supported &&
       ShaderContext::initialize();
+  if (context.shaders_enabled) {
+    RenderTexture::initialize();
+  }
 }
 
 /**
@@ -265,6 +315,7 @@ void quit() {
     return;
   }
 
+  RenderTexture::quit();
   ShaderContext::quit();
 
   if (is_fullscreen()) {
@@ -371,7 +422,12 @@ void hide_window() {
  */
 void render(const SurfacePtr& quest_surface) {
 
+  // Finish the pending draws before switching to the screen.
+  RenderTexture::flush_batch();
+  RenderTexture::update_previous_surfaces();
+
   if (context.disable_window) {
+    end_frame_statistics();
     return;
   }
 
@@ -388,8 +444,8 @@ void render(const SurfacePtr& quest_surface) {
     surface_to_render = context.scaled_surface;
   }
 
-  SDL_SetRenderTarget(context.main_renderer,nullptr);
-  SDL_SetRenderDrawColor(context.main_renderer, 0, 0, 0, 255);
+  set_render_target(nullptr);
+  set_render_draw_color(Color::black);
   SDL_RenderSetClipRect(context.main_renderer, nullptr);
   SDL_RenderClear(context.main_renderer);
   if (context.current_shader != nullptr) {
@@ -400,10 +456,191 @@ void render(const SurfacePtr& quest_surface) {
   else {
     // SDL rendering.
     //Set blending mode to none to simply replace any on_screen material
-    SDL_SetTextureBlendMode(surface_to_render->get_internal_surface().get_texture(),SDL_BLENDMODE_NONE);
-    SDL_RenderCopy(context.main_renderer, surface_to_render->get_internal_surface().get_texture(), nullptr, nullptr);
+    SDL_Texture* texture = surface_to_render->get_internal_surface().get_texture();
+    set_texture_blend_mode(texture, SDL_BLENDMODE_NONE);
+    render_copy(texture, nullptr, nullptr);
     SDL_RenderPresent(context.main_renderer);
   }
+
+  end_frame_statistics();
+}
+
+/**
+ * \brief Sets the render target of the renderer unless it is already set.
+ * \param target The texture to render to, or nullptr for the screen.
+ */
+void set_render_target(SDL_Texture* target) {
+
+  RenderState& render_state = context.render_state;
+  if (render_state.target_known && target == render_state.target) {
+    return;
+  }
+
+  SOLARUS_CHECK_SDL(SDL_SetRenderTarget(context.main_renderer, target));
+  render_state.target = target;
+  render_state.target_known = true;
+  ++render_state.num_target_switches;
+}
+
+/**
+ * \brief Sets the draw color of the renderer unless it is already set.
+ * \param color The color to use for fill and clear operations.
+ */
+void set_render_draw_color(const Color& color) {
+
+  RenderState& render_state = context.render_state;
+  uint8_t r, g, b, a;
+  color.get_components(r, g, b, a);
+  if (render_state.draw_color_known &&
+      r == render_state.draw_color.r &&
+      g == render_state.draw_color.g &&
+      b == render_state.draw_color.b &&
+      a == render_state.draw_color.a) {
+    return;
+  }
+
+  SOLARUS_CHECK_SDL(SDL_SetRenderDrawColor(context.main_renderer, r, g, b, a));
+  render_state.draw_color = { r, g, b, a };
+  render_state.draw_color_known = true;
+}
+
+/**
+ * \brief Sets the draw blend mode of the renderer unless it is already set.
+ * \param blend_mode The blend mode to use for fill operations.
+ * \return \c true if the blend mode has changed.
+ */
+bool set_render_draw_blend_mode(SDL_BlendMode blend_mode) {
+
+  RenderState& render_state = context.render_state;
+  if (blend_mode == render_state.draw_blend_mode) {
+    return false;
+  }
+
+  SOLARUS_CHECK_SDL(SDL_SetRenderDrawBlendMode(context.main_renderer, blend_mode));
+  render_state.draw_blend_mode = blend_mode;
+  return true;
+}
+
+/**
+ * \brief Sets the blend mode of a texture unless it is already set.
+ * \param texture A texture.
+ * \param blend_mode The blend mode to use when copying this texture.
+ */
+void set_texture_blend_mode(SDL_Texture* texture, SDL_BlendMode blend_mode) {
+
+  TextureState& texture_state = context.render_state.textures[texture];
+  if (blend_mode == texture_state.blend_mode) {
+    return;
+  }
+
+  if (SDL_SetTextureBlendMode(texture, blend_mode) == 0) {
+    texture_state.blend_mode = blend_mode;
+  }
+  else {
+    // Not supported by the renderer: try again next time.
+    texture_state.blend_mode = SDL_BLENDMODE_INVALID;
+  }
+}
+
+/**
+ * \brief Sets the alpha modulation of a texture unless it is already set.
+ * \param texture A texture.
+ * \param alpha_mod The alpha value to multiply when copying this texture.
+ */
+void set_texture_alpha_mod(SDL_Texture* texture, uint8_t alpha_mod) {
+
+  TextureState& texture_state = context.render_state.textures[texture];
+  if (alpha_mod == texture_state.alpha_mod) {
+    return;
+  }
+
+  SOLARUS_CHECK_SDL(SDL_SetTextureAlphaMod(texture, alpha_mod));
+  texture_state.alpha_mod = alpha_mod;
+}
+
+/**
+ * \brief Sets the color modulation of a texture unless it is already set.
+ * \param texture A texture.
+ * \param color_mod The color to multiply when copying this texture.
+ * Its alpha component is ignored.
+ */
+void set_texture_color_mod(SDL_Texture* texture, const Color& color_mod) {
+
+  uint8_t r, g, b, a;
+  color_mod.get_components(r, g, b, a);
+  const int packed_color_mod = (r << 16) | (g << 8) | b;
+  TextureState& texture_state = context.render_state.textures[texture];
+  if (packed_color_mod == texture_state.color_mod) {
+    return;
+  }
+
+  SOLARUS_CHECK_SDL(SDL_SetTextureColorMod(texture, r, g, b));
+  texture_state.color_mod = packed_color_mod;
+}
+
+/**
+ * \brief Copies a texture to the current render target.
+ * \param texture The texture to copy.
+ * \param src_rect The region to copy or nullptr for the whole texture.
+ * \param dst_rect The destination or nullptr for the whole target.
+ * \return The result of SDL_RenderCopy().
+ */
+int render_copy(SDL_Texture* texture, const SDL_Rect* src_rect, const SDL_Rect* dst_rect) {
+
+  ++context.render_state.num_copies;
+  return SDL_RenderCopy(context.main_renderer, texture, src_rect, dst_rect);
+}
+
+/**
+ * \brief Forgets the state of a texture that is being destroyed.
+ *
+ * Another texture may be created later at the same address.
+ *
+ * \param texture The texture being destroyed.
+ */
+void notify_texture_destroyed(SDL_Texture* texture) {
+
+  if (context.main_renderer == nullptr) {
+    // Nothing is cached after Video::quit().
+    return;
+  }
+
+  RenderState& render_state = context.render_state;
+  render_state.textures.erase(texture);
+  if (render_state.target == texture) {
+    render_state.target_known = false;
+  }
+}
+
+/**
+ * \brief Forgets the renderer state so that everything is set again.
+ *
+ * Call this after doing something that may change the renderer state
+ * without going through the functions above.
+ */
+void invalidate_render_state() {
+
+  RenderState& render_state = context.render_state;
+  render_state.target_known = false;
+  render_state.draw_color_known = false;
+  render_state.draw_blend_mode = SDL_BLENDMODE_INVALID;
+  render_state.textures.clear();
+}
+
+/**
+ * \brief Returns the number of render target changes during the last frame.
+ * \return The number of calls to SDL_SetRenderTarget() in the last frame.
+ */
+int get_num_render_target_switches() {
+  return context.render_state.last_frame_num_target_switches;
+}
+
+/**
+ * \brief Returns the number of texture copies during the last frame.
+ * \return The number of calls to SDL_RenderCopy() in the last frame.
+ */
+int get_num_render_copies() {
+  return context.render_state.last_frame_num_copies;
 }
 
 /**
@@ -518,7 +755,7 @@ void set_quest_size_range(
       context.quest_size.width,
       context.quest_size.height
   );
-  SDL_SetTextureBlendMode(context.render_target, SDL_BLENDMODE_BLEND);
+  set_texture_blend_mode(context.render_target, SDL_BLENDMODE_BLEND);
 
   // We know the quest size: we can initialize legacy video modes.
   initialize_software_video_modes();
@@ -720,6 +957,7 @@ bool set_video_mode(const SoftwareVideoMode& mode) {
         context.main_renderer,
         render_size.width,
         render_size.height);
+    invalidate_render_state();  // The viewport of the current target has changed.
 
     if (mode_changed) {
       reset_window_size();
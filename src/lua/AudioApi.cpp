@@ -38,6 +38,8 @@ void LuaContext::register_audio_module() {
       { "set_sound_volume", audio_api_set_sound_volume },
       { "play_sound", audio_api_play_sound },
       { "preload_sounds", audio_api_preload_sounds },
+      { "get_sound_cache_size", audio_api_get_sound_cache_size },
+      { "set_sound_cache_size", audio_api_set_sound_cache_size },
       { "get_music_volume", audio_api_get_music_volume },
       { "set_music_volume", audio_api_set_music_volume },
       { "play_music", audio_api_play_music },
@@ -108,7 +110,57 @@ int LuaContext::audio_api_play_sound(lua_State* l) {
 int LuaContext::audio_api_preload_sounds(lua_State* l) {
 
   return LuaTools::exception_boundary_handle(l, [&] {
-    Sound::load_all();
+    if (lua_isnoneornil(l, 1)) {
+      Sound::load_all();
+      return 0;
+    }
+
+    LuaTools::check_type(l, 1, LUA_TTABLE);
+    std::vector<std::string> sound_ids;
+    lua_pushnil(l);
+    while (lua_next(l, 1) != 0) {
+      const std::string& sound_id = LuaTools::check_string(l, -1);
+      if (!Sound::exists(sound_id)) {
+        LuaTools::error(l, std::string("No such sound: '") + sound_id + "'");
+      }
+      sound_ids.push_back(sound_id);
+      lua_pop(l, 1);
+    }
+
+    for (const std::string& sound_id: sound_ids) {
+      Sound::preload(sound_id);
+    }
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.audio.get_sound_cache_size().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::audio_api_get_sound_cache_size(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    lua_pushinteger(l, Sound::get_cache_size());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.audio.set_sound_cache_size().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::audio_api_set_sound_cache_size(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    int cache_size = LuaTools::check_int(l, 1);
+    if (cache_size < 0) {
+      LuaTools::arg_error(l, 1, "Sound cache size cannot be negative");
+    }
+    Sound::set_cache_size(cache_size);
+
     return 0;
   });
 }
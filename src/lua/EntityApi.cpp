@@ -5775,10 +5775,7 @@ int LuaContext::custom_entity_api_set_modified_ground(lua_State* l) {
  */
 void LuaContext::entity_on_update(Entity& entity) {
 
-  // This particular method is tried so often that we want to optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (!userdata_has_field(entity, method_name)) {
+  if (!userdata_has_field(entity, TrackedEvent::ON_UPDATE)) {
     return;
   }
 
@@ -5797,7 +5794,7 @@ void LuaContext::entity_on_update(Entity& entity) {
  */
 void LuaContext::entity_on_suspended(Entity& entity, bool suspended) {
 
-  if (!userdata_has_field(entity, "on_suspended")) {
+  if (!userdata_has_field(entity, TrackedEvent::ON_SUSPENDED)) {
     return;
   }
 
@@ -5886,7 +5883,7 @@ void LuaContext::entity_on_disabled(Entity& entity) {
  */
 void LuaContext::entity_on_pre_draw(Entity& entity) {
 
-  if (!userdata_has_field(entity, "on_pre_draw")) {
+  if (!userdata_has_field(entity, TrackedEvent::ON_PRE_DRAW)) {
     return;
   }
 
@@ -5904,7 +5901,7 @@ void LuaContext::entity_on_pre_draw(Entity& entity) {
  */
 void LuaContext::entity_on_post_draw(Entity& entity) {
 
-  if (!userdata_has_field(entity, "on_post_draw")) {
+  if (!userdata_has_field(entity, TrackedEvent::ON_POST_DRAW)) {
     return;
   }
 
@@ -5925,7 +5922,7 @@ void LuaContext::entity_on_post_draw(Entity& entity) {
 void LuaContext::entity_on_position_changed(
     Entity& entity, const Point& xy, int layer) {
 
-  if (!userdata_has_field(entity, "on_position_changed")) {
+  if (!userdata_has_field(entity, TrackedEvent::ON_POSITION_CHANGED)) {
     return;
   }
 
@@ -5945,7 +5942,7 @@ void LuaContext::entity_on_position_changed(
 void LuaContext::entity_on_obstacle_reached(
     Entity& entity, Movement& movement) {
 
-  if (!userdata_has_field(entity, "on_obstacle_reached")) {
+  if (!userdata_has_field(entity, TrackedEvent::ON_OBSTACLE_REACHED)) {
     return;
   }
 
@@ -5984,7 +5981,7 @@ void LuaContext::entity_on_obstacle_reached(
 void LuaContext::entity_on_movement_changed(
     Entity& entity, Movement& movement) {
 
-  if (!userdata_has_field(entity, "on_movement_changed")) {
+  if (!userdata_has_field(entity, TrackedEvent::ON_MOVEMENT_CHANGED)) {
     return;
   }
 
@@ -26,7 +26,8 @@ namespace Solarus {
 ExportableToLua::ExportableToLua():
   lua_context(nullptr),
   known_to_lua(false),
-  with_lua_table(false) {
+  with_lua_table(false),
+  event_mask(0) {
 
 }
 
@@ -96,5 +97,24 @@ void ExportableToLua::set_with_lua_table(bool with_lua_table) {
   this->with_lua_table = with_lua_table;
 }
 
+/**
+ * \brief Returns the engine events defined in the Lua table of this userdata.
+ *
+ * Events defined in the metatable of the type are not included.
+ *
+ * \return A bitmask with one bit per LuaContext::TrackedEvent.
+ */
+uint32_t ExportableToLua::get_event_mask() const {
+  return event_mask;
+}
+
+/**
+ * \brief Sets the engine events defined in the Lua table of this userdata.
+ * \param event_mask A bitmask with one bit per LuaContext::TrackedEvent.
+ */
+void ExportableToLua::set_event_mask(uint32_t event_mask) {
+  this->event_mask = event_mask;
+}
+
 }
 
@@ -78,6 +78,9 @@ int LuaContext::file_api_open(lua_State* l) {
       }
 
       real_file_name = QuestFiles::get_full_quest_write_dir() + "/" + file_name;
+
+      // The file may now shadow a script already compiled.
+      get_lua_context(l).invalidate_compiled_file(file_name);
     }
     else {
       // Reading a file.
@@ -155,6 +158,7 @@ int LuaContext::file_api_remove(lua_State* l) {
     const std::string& file_name = LuaTools::check_string(l, 1);
 
     bool success = QuestFiles::data_file_delete(file_name);
+    get_lua_context(l).invalidate_compiled_file(file_name);
 
     if (!success) {
       lua_pushnil(l);
@@ -23,6 +23,7 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/QuestFiles.h"
+#include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Savegame.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
@@ -64,6 +65,7 @@ void LuaContext::register_game_module() {
       { "start_game_over", game_api_start_game_over },
       { "stop_game_over", game_api_stop_game_over },
       { "get_map", game_api_get_map },
+      { "preload_map", game_api_preload_map },
       { "get_hero", game_api_get_hero },
       { "get_value", game_api_get_value },
       { "set_value", game_api_set_value },
@@ -581,6 +583,27 @@ int LuaContext::game_api_get_map(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of game:preload_map().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::game_api_preload_map(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Savegame& savegame = *check_game(l, 1);
+    const std::string& map_id = LuaTools::check_string(l, 2);
+
+    if (!CurrentQuest::resource_exists(ResourceType::MAP, map_id)) {
+      LuaTools::arg_error(l, 2, std::string("No such map: '") + map_id + "'");
+    }
+
+    savegame.get_main_loop().get_resource_provider().preload_map(map_id);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of game:get_hero().
  * \param l The Lua context that is calling this function.
@@ -1596,10 +1619,7 @@ void LuaContext::game_on_finished(Game& game) {
 void LuaContext::game_on_update(Game& game) {
 
   push_game(l, game.get_savegame());
-  // This particular method is tried so often that we want to optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (userdata_has_field(game.get_savegame(), method_name)) {
+  if (userdata_has_field(game.get_savegame(), TrackedEvent::ON_UPDATE)) {
     on_update();
   }
   menus_on_update(-1);
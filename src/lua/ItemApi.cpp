@@ -799,10 +799,7 @@ void LuaContext::item_on_finished(EquipmentItem& item) {
  */
 void LuaContext::item_on_update(EquipmentItem& item) {
 
-  // This particular method is tried so often that we want to save optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (!userdata_has_field(item, method_name)) {
+  if (!userdata_has_field(item, TrackedEvent::ON_UPDATE)) {
     return;
   }
 
@@ -821,7 +818,7 @@ void LuaContext::item_on_update(EquipmentItem& item) {
  */
 void LuaContext::item_on_suspended(EquipmentItem& item, bool suspended) {
 
-  if (!userdata_has_field(item, "on_suspended")) {
+  if (!userdata_has_field(item, TrackedEvent::ON_SUSPENDED)) {
     return;
   }
 
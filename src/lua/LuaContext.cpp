@@ -21,6 +21,7 @@
 #include "solarus/core/EquipmentItem.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestProperties.h"
 #include "solarus/core/Timer.h"
@@ -41,10 +42,155 @@
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
+#include <chrono>
+#include <cstring>
 #include <sstream>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Lua writer function that appends a chunk of bytecode to a string.
+ * \param l The Lua state dumping a function.
+ * \param p The bytes to write.
+ * \param size Number of bytes to write.
+ * \param ud The std::string where to write.
+ * \return 0 in case of success.
+ */
+int bytecode_writer(lua_State* /* l */, const void* p, size_t size, void* ud) {
+
+  std::string& bytecode = *static_cast<std::string*>(ud);
+  bytecode.append(static_cast<const char*>(p), size);
+  return 0;
+}
+
+/**
+ * \brief Returns whether the bytecode of a script can be kept in the cache.
+ *
+ * Only scripts of the data directory or archive are cached:
+ * scripts of the quest write directory can be changed by the quest itself.
+ *
+ * \param script_name File name of the script with or without extension,
+ * relative to the data directory.
+ * \return \c true if the script can be cached.
+ */
+bool is_script_cacheable(const std::string& script_name) {
+
+  std::string file_name = script_name;
+  if (!QuestFiles::data_file_exists(file_name)) {
+    file_name += ".lua";
+  }
+
+  const QuestFiles::DataFileLocation location =
+      QuestFiles::data_file_get_location(file_name);
+  return location == QuestFiles::DataFileLocation::LOCATION_DATA_DIRECTORY ||
+      location == QuestFiles::DataFileLocation::LOCATION_DATA_ARCHIVE;
+}
+
+/**
+ * \brief Names of the events of LuaContext::TrackedEvent, in the same order.
+ */
+const char* const tracked_event_names[] = {
+    "on_update",
+    "on_suspended",
+    "on_pre_draw",
+    "on_post_draw",
+    "on_position_changed",
+    "on_obstacle_reached",
+    "on_movement_changed",
+    "on_frame_changed",
+    "on_ground_below_changed"
+};
+
+constexpr size_t num_tracked_events =
+    sizeof(tracked_event_names) / sizeof(tracked_event_names[0]);
+static_assert(num_tracked_events ==
+    static_cast<size_t>(LuaContext::TrackedEvent::ON_GROUND_BELOW_CHANGED) + 1,
+    "Missing names of tracked events");
+
+/**
+ * \brief Returns the bit of a tracked event in event masks.
+ * \param event A tracked event.
+ * \return The corresponding bit.
+ */
+uint32_t get_tracked_event_bit(LuaContext::TrackedEvent event) {
+  return 1u << static_cast<int>(event);
+}
+
+/**
+ * \brief Returns the bit of the tracked event with the given name if any.
+ * \param key A field name.
+ * \return The corresponding bit, or 0 if this is not a tracked event.
+ */
+uint32_t get_tracked_event_bit(const char* key) {
+
+  // All tracked events start with "on_".
+  if (key[0] != 'o' || key[1] != 'n' || key[2] != '_') {
+    return 0;
+  }
+
+  for (size_t i = 0; i < num_tracked_events; ++i) {
+    if (std::strcmp(key, tracked_event_names[i]) == 0) {
+      return 1u << i;
+    }
+  }
+  return 0;
+}
+
+/**
+ * \brief Returns the Solarus type of a table if it is a type metatable.
+ * \param l A Lua state.
+ * \param index Index of a value in the stack.
+ * \return The type name, or an empty string if the value is not
+ * the metatable of a Solarus type.
+ */
+std::string get_metatable_type_name(lua_State* l, int index) {
+
+  if (lua_type(l, index) != LUA_TTABLE) {
+    return "";
+  }
+
+  std::string type_name;
+  lua_pushstring(l, "__solarus_type");
+  lua_rawget(l, index);
+  if (lua_type(l, -1) == LUA_TSTRING) {
+    type_name = lua_tostring(l, -1);
+  }
+  lua_pop(l, 1);
+  return type_name;
+}
+
+/**
+ * \brief Returns the LuaContext stored as an upvalue of a C closure.
+ *
+ * Unlike LuaContext::get_lua_context(), this also works from coroutines.
+ *
+ * \param l The Lua state of the running C closure.
+ * \param upvalue Index of the upvalue.
+ * \return The Lua context.
+ */
+LuaContext& get_lua_context_upvalue(lua_State* l, int upvalue) {
+  return *static_cast<LuaContext*>(lua_touserdata(l, lua_upvalueindex(upvalue)));
+}
+
+/**
+ * \brief Calls the function stored as first upvalue of the running
+ * C closure with the same arguments.
+ * \param l The Lua state of the running C closure.
+ * \return Number of values returned by the function.
+ */
+int call_wrapped_function(lua_State* l) {
+
+  const int num_arguments = lua_gettop(l);
+  lua_pushvalue(l, lua_upvalueindex(1));
+  lua_insert(l, 1);
+  lua_call(l, num_arguments, LUA_MULTRET);
+  return lua_gettop(l);
+}
+
+}  // Anonymous namespace.
+
 std::map<lua_State*, LuaContext*> LuaContext::lua_contexts;
 
 /**
@@ -53,7 +199,12 @@ std::map<lua_State*, LuaContext*> LuaContext::lua_contexts;
  */
 LuaContext::LuaContext(MainLoop& main_loop):
   l(nullptr),
-  main_loop(main_loop) {
+  main_loop(main_loop),
+  timer_schedule_order(0),
+  metatable_event_mask(0),
+  compiled_chunk_hits(0),
+  compiled_chunk_misses(0),
+  compiled_chunk_load_time(0) {
 
 }
 
@@ -132,6 +283,10 @@ void LuaContext::initialize() {
   lua_setfield(l, LUA_REGISTRYINDEX, "sol.userdata_tables");
                                   // --
 
+  // Keep event masks of type metatables correct even with rawset()
+  // and setmetatable().
+  track_metatable_changes();
+
   // Create the sol table that will contain the whole Solarus API.
   lua_newtable(l);
   lua_setglobal(l, "sol");
@@ -186,6 +341,9 @@ void LuaContext::exit() {
     destroy_drawables();
     userdata_close_lua();
 
+    // Scripts will be compiled again after a reset in case they changed.
+    compiled_chunks.clear();
+
     // Finalize Lua.
     lua_close(l);
     lua_contexts.erase(l);
@@ -201,6 +359,8 @@ void LuaContext::exit() {
  */
 void LuaContext::update() {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::LUA_UPDATE);
+
   // Make sure the stack does not leak.
   Debug::check_assertion(lua_gettop(l) == 0,
       "Non-empty stack before LuaContext::update()"
@@ -318,7 +478,7 @@ void LuaContext::run_item(EquipmentItem& item) {
   std::string file_name = std::string("items/") + item.get_name();
 
   // Load the item's code.
-  if (load_file(l, file_name)) {
+  if (load_compiled_file(l, file_name)) {
 
     // Run it with the item userdata as parameter.
     push_item(l, item);
@@ -342,14 +502,13 @@ void LuaContext::run_enemy(Enemy& enemy) {
   std::string file_name = std::string("enemies/") + enemy.get_breed();
 
   // Load the enemy's code.
-  if (load_file(l, file_name)) {
+  // It is compiled only once for each breed.
+  if (load_compiled_file(l, file_name)) {
 
     // Run it with the enemy userdata as parameter.
     push_enemy(l, enemy);
     call_function(1, 0, file_name.c_str());
   }
-
-  // TODO parse Lua only once for each breed.
 }
 
 /**
@@ -373,14 +532,13 @@ void LuaContext::run_custom_entity(CustomEntity& custom_entity) {
   std::string file_name = std::string("entities/") + model;
 
   // Load the entity's code.
-  if (load_file(l, file_name)) {
+  // It is compiled only once for each model.
+  if (load_compiled_file(l, file_name)) {
 
     // Run it with the entity userdata as parameter.
     push_custom_entity(l, custom_entity);
     call_function(1, 0, file_name.c_str());
   }
-
-  // TODO parse Lua only once for each model.
 }
 
 /**
@@ -567,6 +725,41 @@ bool LuaContext::userdata_has_field(
   return it->second.find(key) != it->second.end();
 }
 
+/**
+ * \brief Returns whether a userdata has the specified engine event.
+ *
+ * Version with a tracked event, better for performance: in the common
+ * case where the event is not defined, this costs no Lua lookup.
+ *
+ * \param userdata A userdata.
+ * \param event The event to test.
+ * \return \c true if this event exists on the userdata or on its metatable.
+ */
+bool LuaContext::userdata_has_field(
+    const ExportableToLua& userdata, TrackedEvent event) const {
+
+  const uint32_t event_bit = get_tracked_event_bit(event);
+
+  // The mask of the userdata itself is always exact.
+  if ((userdata.get_event_mask() & event_bit) != 0) {
+    return true;
+  }
+
+  // The masks of metatables only tell if the event may exist.
+  if ((metatable_event_mask & event_bit) == 0) {
+    return false;
+  }
+
+  const auto& it = metatable_event_masks.find(userdata.get_lua_type_name());
+  if (it == metatable_event_masks.end() ||
+      (it->second & event_bit) == 0) {
+    return false;
+  }
+
+  return userdata_has_metafield(
+      userdata, tracked_event_names[static_cast<int>(event)]);
+}
+
 /**
  * \brief Returns whether the metatable of a userdata has the specified field.
  * \param userdata A userdata.
@@ -665,6 +858,7 @@ bool LuaContext::call_function(
     int nb_results,
     const char* function_name
 ) {
+  SOLARUS_PROFILE_ZONE(function_name);
   return LuaTools::call_function(l, nb_arguments, nb_results, function_name);
 }
 
@@ -696,10 +890,9 @@ bool LuaContext::load_file(lua_State* l, const std::string& script_name) {
     return false;
   }
 
-  // Load the file.
+  // Load the file, or its precompiled version if any.
   // "@" tells Lua that the name is a file name, which is useful for better error messages.
-  const std::string& buffer = QuestFiles::data_file_read(file_name);
-  int result = luaL_loadbuffer(l, buffer.data(), buffer.size(), ("@" + file_name).c_str());
+  int result = LuaTools::load_quest_file(l, file_name, "@" + file_name);
 
   if (result != 0) {
     Debug::error(std::string("Failed to load script '")
@@ -710,6 +903,82 @@ bool LuaContext::load_file(lua_State* l, const std::string& script_name) {
   return true;
 }
 
+/**
+ * \brief Like load_file(), but compiles each script only once.
+ *
+ * The bytecode of scripts is kept in a cache of the LuaContext, so that
+ * the next loads of the same script neither read the file nor parse it
+ * again.
+ * A new function is still created at each call, so the environment
+ * of previously loaded functions is not shared.
+ *
+ * \param l A Lua state.
+ * \param script_name File name of the script with or without extension,
+ * relative to the data directory.
+ * \return true if the file exists and was loaded.
+ */
+bool LuaContext::load_compiled_file(lua_State* l, const std::string& script_name) {
+
+  const auto& context_it = lua_contexts.find(l);
+  if (context_it == lua_contexts.end()) {
+    // Not the main state, probably a coroutine.
+    return load_file(l, script_name);
+  }
+  LuaContext& lua_context = *context_it->second;
+
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point start_time = Clock::now();
+
+  bool success = false;
+  const auto& it = lua_context.compiled_chunks.find(script_name);
+  if (it != lua_context.compiled_chunks.end()) {
+    // Already compiled.
+    const std::string& bytecode = it->second;
+    success = luaL_loadbuffer(l, bytecode.data(), bytecode.size(), script_name.c_str()) == 0;
+    if (!success) {
+      Debug::error(std::string("Failed to load compiled script '")
+          + script_name + "': " + lua_tostring(l, -1));
+      lua_pop(l, 1);
+    }
+    ++lua_context.compiled_chunk_hits;
+  }
+  else {
+    success = load_file(l, script_name);
+    if (success && is_script_cacheable(script_name)) {
+      std::string bytecode;
+      if (lua_dump(l, bytecode_writer, &bytecode) == 0) {
+        lua_context.compiled_chunks.emplace(script_name, std::move(bytecode));
+      }
+    }
+    ++lua_context.compiled_chunk_misses;
+  }
+
+  lua_context.compiled_chunk_load_time += std::chrono::duration_cast<std::chrono::microseconds>(
+      Clock::now() - start_time
+  ).count();
+  return success;
+}
+
+/**
+ * \brief Removes a script from the cache of load_compiled_file().
+ *
+ * This function should be called when the script has changed on disk.
+ *
+ * \param script_name File name of the script with or without extension,
+ * relative to the data directory.
+ */
+void LuaContext::invalidate_compiled_file(const std::string& script_name) {
+
+  compiled_chunks.erase(script_name);
+  compiled_chunks.erase(script_name + ".lua");
+
+  const std::string extension = ".lua";
+  if (script_name.size() > extension.size() &&
+      script_name.compare(script_name.size() - extension.size(), extension.size(), extension) == 0) {
+    compiled_chunks.erase(script_name.substr(0, script_name.size() - extension.size()));
+  }
+}
+
 /**
  * \brief Opens a Lua file and executes it.
  *
@@ -932,6 +1201,22 @@ void LuaContext::register_type(
   }
   lua_settop(l, 0);
                                   // --
+
+  // Keep track of the engine events that scripts define in the metatable.
+  luaL_getmetatable(l, module_name.c_str());
+                                  // meta
+  lua_newtable(l);
+                                  // meta meta_meta
+  lua_pushlightuserdata(l, this);
+                                  // meta meta_meta lua_context
+  lua_pushcclosure(l, metatable_meta_newindex, 1);
+                                  // meta meta_meta newindex
+  lua_setfield(l, -2, "__newindex");
+                                  // meta meta_meta
+  lua_setmetatable(l, -2);
+                                  // meta
+  lua_settop(l, 0);
+                                  // --
 }
 
 /**
@@ -1247,10 +1532,13 @@ void LuaContext::userdata_close_lua() {
     ExportableToLua* userdata = static_cast<ExportableToLua*>(
         lua_touserdata(l, -2));
     userdata->set_lua_context(nullptr);
+    userdata->set_event_mask(0);
     lua_pop(l, 1);
   }
   lua_pop(l, 1);
   userdata_fields.clear();
+  metatable_event_masks.clear();
+  metatable_event_mask = 0;
 
   // Clear userdata tables.
   lua_pushnil(l);
@@ -1315,19 +1603,137 @@ int LuaContext::userdata_meta_newindex_as_table(lua_State* l) {
                                   // ... udata_tables udata_table
 
   if (lua_isstring(l, 2)) {
+    const char* key = lua_tostring(l, 2);
+    const uint32_t event_bit = get_tracked_event_bit(key);
     if (!lua_isnil(l, 3)) {
       // Add the key to the list of existing strings keys on this userdata.
-      get_lua_context(l).userdata_fields[userdata.get()].insert(lua_tostring(l, 2));
+      get_lua_context(l).userdata_fields[userdata.get()].insert(key);
+      userdata->set_event_mask(userdata->get_event_mask() | event_bit);
     }
     else {
       // Assigning nil: remove the key from the list.
-      get_lua_context(l).userdata_fields[userdata.get()].erase(lua_tostring(l, 2));
+      get_lua_context(l).userdata_fields[userdata.get()].erase(key);
+      userdata->set_event_mask(userdata->get_event_mask() & ~event_bit);
     }
   }
 
   return 0;
 }
 
+/**
+ * \brief Implementation of __newindex for the metatable of type metatables.
+ *
+ * Lua code can make "metatable[key] = value" as usual: the field is stored
+ * in the metatable, and if it is a tracked engine event, it is recorded
+ * in the event mask of the type.
+ *
+ * Fields set with rawset() are not recorded.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::metatable_meta_newindex(lua_State* l) {
+
+  LuaTools::check_type(l, 1, LUA_TTABLE);
+  LuaTools::check_any(l, 2);
+  LuaTools::check_any(l, 3);
+  lua_settop(l, 3);
+                                  // meta key value
+
+  get_lua_context_upvalue(l, 1).notify_metatable_field_set(l);
+
+  lua_rawset(l, 1);
+                                  // meta
+  return 0;
+}
+
+/**
+ * \brief Makes the event masks of type metatables follow all changes
+ * made by scripts.
+ *
+ * Fields set normally go through the __newindex of type metatables.
+ * The functions rawset(), setmetatable() and debug.setmetatable() are
+ * replaced by versions that also update the event masks.
+ */
+void LuaContext::track_metatable_changes() {
+
+                                  // --
+  lua_getglobal(l, "rawset");
+                                  // rawset
+  lua_pushlightuserdata(l, this);
+                                  // rawset lua_context
+  lua_pushcclosure(l, l_rawset, 2);
+                                  // l_rawset
+  lua_setglobal(l, "rawset");
+                                  // --
+  lua_getglobal(l, "setmetatable");
+                                  // setmetatable
+  lua_pushlightuserdata(l, this);
+                                  // setmetatable lua_context
+  lua_pushcclosure(l, l_setmetatable, 2);
+                                  // l_setmetatable
+  lua_setglobal(l, "setmetatable");
+                                  // --
+  lua_getglobal(l, "debug");
+                                  // debug
+  lua_getfield(l, -1, "setmetatable");
+                                  // debug setmetatable
+  lua_pushlightuserdata(l, this);
+                                  // debug setmetatable lua_context
+  lua_pushcclosure(l, l_setmetatable, 2);
+                                  // debug l_setmetatable
+  lua_setfield(l, -2, "setmetatable");
+                                  // debug
+  lua_pop(l, 1);
+                                  // --
+}
+
+/**
+ * \brief Records a field about to be set in a table, if this table is a
+ * type metatable and the field is a tracked event.
+ * \param l The Lua state. The table, the key and the value must be at
+ * indexes 1, 2 and 3.
+ */
+void LuaContext::notify_metatable_field_set(lua_State* l) {
+
+  if (lua_type(l, 2) != LUA_TSTRING || lua_isnoneornil(l, 3)) {
+    return;
+  }
+
+  const uint32_t event_bit = get_tracked_event_bit(lua_tostring(l, 2));
+  if (event_bit == 0) {
+    return;
+  }
+
+  const std::string& type_name = get_metatable_type_name(l, 1);
+  if (type_name.empty()) {
+    return;
+  }
+
+  metatable_event_masks[type_name] |= event_bit;
+  metatable_event_mask |= event_bit;
+}
+
+/**
+ * \brief Stops relying on __newindex for a type metatable whose own
+ * metatable is about to be replaced.
+ *
+ * All tracked events of this type are then considered as possibly defined,
+ * so that they are always looked up in the metatable.
+ *
+ * \param l The Lua state. The table must be at index 1.
+ */
+void LuaContext::notify_metatable_replaced(lua_State* l) {
+
+  const std::string& type_name = get_metatable_type_name(l, 1);
+  if (type_name.empty()) {
+    return;
+  }
+
+  metatable_event_masks[type_name] = ~0u;
+  metatable_event_mask = ~0u;
+}
+
 /**
  * \brief Implementation of __index that allows userdata to be like tables.
  *
@@ -2976,6 +3382,36 @@ int LuaContext::l_loader(lua_State* l) {
   });
 }
 
+/**
+ * \brief Replacement of rawset() that keeps event masks of type metatables
+ * up to date.
+ *
+ * Upvalues are the original rawset() and the LuaContext.
+ *
+ * \param l The Lua context.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_rawset(lua_State* l) {
+
+  get_lua_context_upvalue(l, 2).notify_metatable_field_set(l);
+  return call_wrapped_function(l);
+}
+
+/**
+ * \brief Replacement of setmetatable() and debug.setmetatable() that keeps
+ * event masks of type metatables correct.
+ *
+ * Upvalues are the original function and the LuaContext.
+ *
+ * \param l The Lua context.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_setmetatable(lua_State* l) {
+
+  get_lua_context_upvalue(l, 2).notify_metatable_replaced(l);
+  return call_wrapped_function(l);
+}
+
 /**
  * \brief A function that prints the stack trace of an error raised in lua
  * \param l The lua context
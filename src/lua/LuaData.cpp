@@ -17,6 +17,7 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/lua/LuaData.h"
+#include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
 #include <cstdio>
 #include <fstream>
@@ -81,6 +82,10 @@ bool LuaData::import_from_file(const std::string& file_name) {
  * in the quest write directory or in the quest data archive (see QuestFiles).
  * This function does the search for you.
  *
+ * If a binary version of the file exists (see get_binary_file_name()),
+ * it is loaded instead, unless it is invalid or it comes from another
+ * directory or archive than the text version.
+ *
  * \param[in] quest_file_name Path of the file to load, relative to the quest
  * data path.
  * \param[in] language_specific \c true to search in the language-specific
@@ -92,15 +97,36 @@ bool LuaData::import_from_quest_file(
     const std::string& quest_file_name,
     bool language_specific
 ) {
+  // Prefer the binary version of the file if any.
+  const std::string& binary_file_name = get_binary_file_name(quest_file_name);
+  if (QuestFiles::data_file_exists(binary_file_name, language_specific) &&
+      (!QuestFiles::data_file_exists(quest_file_name, language_specific) ||
+       QuestFiles::data_files_have_same_location(quest_file_name, binary_file_name, language_specific))) {
+    const std::string& buffer = QuestFiles::data_file_read(binary_file_name, language_specific);
+    if (import_from_binary(buffer)) {
+      return true;
+    }
+    Debug::warning(std::string("Invalid binary data file '") + binary_file_name +
+        "', loading '" + quest_file_name + "' instead");
+  }
+
   if (!QuestFiles::data_file_exists(quest_file_name, language_specific)) {
     Debug::error(std::string("Cannot find quest file '") + quest_file_name + "'");
     return false;
   }
 
-  const std::string& buffer = QuestFiles::data_file_read(
-      quest_file_name, language_specific
-  );
-  return import_from_buffer(buffer, quest_file_name);
+  // Use the precompiled version of the file if any.
+  lua_State* l = luaL_newstate();
+  if (LuaTools::load_quest_file(l, quest_file_name, quest_file_name, language_specific) != 0) {
+    Debug::error(std::string("Failed to load data file: ") + lua_tostring(l, -1));
+    lua_pop(l, 1);
+    lua_close(l);
+    return false;
+  }
+
+  bool success = import_from_lua(l);
+  lua_close(l);
+  return success;
 }
 
 /**
@@ -160,6 +186,47 @@ bool LuaData::export_to_file(const std::string& file_name) const {
   return true;
 }
 
+/**
+ * \brief Saves the data into a binary file.
+ * \param[in] file_name Path of the file to save.
+ * \return \c true in case of success, \c false if the data
+ * could not be exported.
+ */
+bool LuaData::export_to_binary_file(const std::string& file_name) const {
+
+  std::string buffer;
+  if (!export_to_binary(buffer)) {
+    return false;
+  }
+
+  std::ofstream out(file_name, std::ios::binary);
+  if (!out) {
+    return false;
+  }
+  out.write(buffer.data(), buffer.size());
+  out.flush();
+  return static_cast<bool>(out);
+}
+
+/**
+ * \brief Returns the name of the binary version of a data file.
+ *
+ * The binary file is in the same directory, with the extension ".bin"
+ * instead of ".dat".
+ *
+ * \param file_name Name of a data file.
+ * \return Name of the corresponding binary file.
+ */
+std::string LuaData::get_binary_file_name(const std::string& file_name) {
+
+  const std::string dat_extension = ".dat";
+  if (file_name.size() >= dat_extension.size() &&
+      file_name.compare(file_name.size() - dat_extension.size(), dat_extension.size(), dat_extension) == 0) {
+    return file_name.substr(0, file_name.size() - dat_extension.size()) + ".bin";
+  }
+  return file_name + ".bin";
+}
+
 /**
  * \fn LuaData::import_from_lua
  * \brief Loads data from a Lua chunk.
@@ -180,6 +247,33 @@ bool LuaData::export_to_lua(std::ostream& /* out */) const {
   return false;
 }
 
+/**
+ * \brief Loads this data from a buffer in binary format.
+ *
+ * In case of failure, the data is left unchanged.
+ *
+ * \param buffer The binary data, as saved by export_to_binary().
+ * \return \c true in case of success, \c false if the data is invalid
+ * or if the binary format is not supported.
+ */
+bool LuaData::import_from_binary(const std::string& /* buffer */) {
+
+  // The binary format is optional. Not implemented by default.
+  return false;
+}
+
+/**
+ * \brief Saves this data into a buffer in binary format.
+ * \param buffer The buffer to write.
+ * \return \c true in case of success, \c false if the data
+ * could not be exported.
+ */
+bool LuaData::export_to_binary(std::string& /* buffer */) const {
+
+  // The binary format is optional. Not implemented by default.
+  return false;
+}
+
 /**
  * \brief Protects a string so that it can safely be enclosed in double quotes.
  *
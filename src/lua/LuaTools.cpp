@@ -15,11 +15,13 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Map.h"
+#include "solarus/core/QuestFiles.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/lua/LuaException.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/ScopedLuaRef.h"
+#include <atomic>
 #include <cctype>
 #include <sstream>
 
@@ -155,6 +157,70 @@ bool do_string(
   return call_function(l, 0, 0, chunk_name.c_str());
 }
 
+/**
+ * \brief Returns the name of the precompiled version of a quest file.
+ *
+ * Quest packages may contain, next to each Lua script or data file,
+ * the same chunk precompiled to bytecode to avoid parsing it at runtime.
+ *
+ * \param file_name Name of a Lua script or data file, relative to the
+ * data directory.
+ * \return Name of the corresponding bytecode file.
+ */
+std::string get_compiled_file_name(const std::string& file_name) {
+  return file_name + ".luac";
+}
+
+/**
+ * \brief Loads a Lua script or data file of the quest as a function.
+ *
+ * If a precompiled version of the file exists (see get_compiled_file_name())
+ * in the same directory or archive as the source, it is loaded instead of
+ * the source. Bytecode from another place of the search path is ignored
+ * because it may be older than the source.
+ * The source is used as a fallback if the bytecode cannot be loaded,
+ * for example because it was compiled for another Lua implementation.
+ *
+ * \param l A Lua state.
+ * \param file_name Name of the source file, relative to the data directory.
+ * It must exist.
+ * \param chunk_name Name of the chunk to use in error messages.
+ * \param language_specific \c true to search in the language-specific
+ * directory of the current language.
+ * \return The result of luaL_loadbuffer(): 0 in case of success.
+ * In case of error, the error message is on top of the stack.
+ */
+int load_quest_file(
+    lua_State* l,
+    const std::string& file_name,
+    const std::string& chunk_name,
+    bool language_specific
+) {
+  const std::string& compiled_file_name = get_compiled_file_name(file_name);
+  if (QuestFiles::data_file_exists(compiled_file_name, language_specific) &&
+      QuestFiles::data_files_have_same_location(file_name, compiled_file_name, language_specific)) {
+    const std::string& bytecode = QuestFiles::data_file_read(
+        compiled_file_name, language_specific
+    );
+    if (luaL_loadbuffer(l, bytecode.data(), bytecode.size(), chunk_name.c_str()) == 0) {
+      return 0;
+    }
+
+    // Only warn once: all files of the package probably have the same problem.
+    // Data files may also be loaded from a background thread.
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true)) {
+      Debug::warning(std::string("Cannot load precompiled file '")
+          + compiled_file_name + "', using the source file instead: "
+          + lua_tostring(l, -1));
+    }
+    lua_pop(l, 1);
+  }
+
+  const std::string& buffer = QuestFiles::data_file_read(file_name, language_specific);
+  return luaL_loadbuffer(l, buffer.data(), buffer.size(), chunk_name.c_str());
+}
+
 /**
  * \brief Similar to luaL_error() but throws a LuaException.
  *
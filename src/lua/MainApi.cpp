@@ -17,6 +17,7 @@
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/MainLoop.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestDatabase.h"
 #include "solarus/core/QuestProperties.h"
@@ -25,6 +26,7 @@
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
+#include <sstream>
 
 namespace Solarus {
 
@@ -54,7 +56,12 @@ void LuaContext::register_main_module() {
       { "get_angle", main_api_get_angle },
       { "get_type", main_api_get_type },
       { "get_metatable", main_api_get_metatable },
-      { "get_os", main_api_get_os }
+      { "get_os", main_api_get_os },
+      { "is_profiler_enabled", main_api_is_profiler_enabled },
+      { "set_profiler_enabled", main_api_set_profiler_enabled },
+      { "get_profile", main_api_get_profile },
+      { "save_profile", main_api_save_profile },
+      { "get_script_cache_stats", main_api_get_script_cache_stats }
   };
 
   if (CurrentQuest::is_format_at_least({ 1, 6 })) {
@@ -153,7 +160,7 @@ int LuaContext::main_api_load_file(lua_State *l) {
   return LuaTools::exception_boundary_handle(l, [&] {
     const std::string& file_name = LuaTools::check_string(l, 1);
 
-    if (!load_file(l, file_name)) {
+    if (!load_compiled_file(l, file_name)) {
       lua_pushnil(l);
     }
 
@@ -427,6 +434,105 @@ int LuaContext::main_api_get_os(lua_State* l) {
   return 1;
 }
 
+/**
+ * \brief Implementation of sol.main.is_profiler_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_is_profiler_enabled(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    lua_pushboolean(l, Profiler::is_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.set_profiler_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_set_profiler_enabled(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    bool enabled = LuaTools::opt_boolean(l, 1, true);
+
+    Profiler::set_enabled(enabled);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_profile().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_profile(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const std::vector<Profiler::ZoneStatistics>& statistics = Profiler::get_statistics();
+
+    lua_createtable(l, 0, 2);
+    lua_pushinteger(l, Profiler::get_num_frames());
+    lua_setfield(l, -2, "num_frames");
+    lua_createtable(l, 0, statistics.size());
+    for (const Profiler::ZoneStatistics& zone_statistics : statistics) {
+      // Times are in milliseconds.
+      lua_createtable(l, 0, 3);
+      lua_pushnumber(l, zone_statistics.total_time / 1000000.0);
+      lua_setfield(l, -2, "total");
+      lua_pushnumber(l, zone_statistics.max_time / 1000000.0);
+      lua_setfield(l, -2, "max");
+      lua_pushinteger(l, zone_statistics.count);
+      lua_setfield(l, -2, "count");
+      lua_setfield(l, -2, zone_statistics.name.c_str());
+    }
+    lua_setfield(l, -2, "zones");
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.save_profile().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_save_profile(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const std::string& file_name = LuaTools::check_string(l, 1);
+
+    if (QuestFiles::get_quest_write_dir().empty()) {
+      LuaTools::error(l, "Cannot save profile: no write directory was specified in quest.dat");
+    }
+
+    std::ostringstream oss;
+    Profiler::write_chrome_trace(oss);
+    QuestFiles::data_file_save(file_name, oss.str());
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_script_cache_stats().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_script_cache_stats(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const LuaContext& lua_context = get_lua_context(l);
+
+    lua_pushinteger(l, lua_context.compiled_chunk_hits);
+    lua_pushinteger(l, lua_context.compiled_chunk_misses);
+    // The load time is in milliseconds.
+    lua_pushnumber(l, lua_context.compiled_chunk_load_time / 1000.0);
+    return 3;
+  });
+}
+
 /**
  * \brief Calls sol.main.on_started() if it exists.
  *
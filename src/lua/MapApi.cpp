@@ -152,7 +152,10 @@ void LuaContext::register_map_module() {
       { "get_entities_in_region", map_api_get_entities_in_region },
       { "get_hero", map_api_get_hero },
       { "set_entities_enabled", map_api_set_entities_enabled },
-      { "remove_entities", map_api_remove_entities }
+      { "remove_entities", map_api_remove_entities },
+      { "is_collision_broad_phase_enabled", map_api_is_collision_broad_phase_enabled },
+      { "set_collision_broad_phase_enabled", map_api_set_collision_broad_phase_enabled },
+      { "get_tile_cache_stats", map_api_get_tile_cache_stats }
   };
 
   const std::vector<luaL_Reg> metamethods = {
@@ -2210,6 +2213,53 @@ int LuaContext::map_api_remove_entities(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of map:is_collision_broad_phase_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_is_collision_broad_phase_enabled(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    lua_pushboolean(l, map.get_entities().is_collision_broad_phase_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_collision_broad_phase_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_collision_broad_phase_enabled(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    bool enabled = LuaTools::opt_boolean(l, 2, true);
+
+    map.get_entities().set_collision_broad_phase_enabled(enabled);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_tile_cache_stats().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_tile_cache_stats(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    lua_pushinteger(l, map.get_entities().get_num_resident_tile_cells());
+    lua_pushinteger(l, map.get_entities().get_num_tile_cells_built_last_draw());
+    return 2;
+  });
+}
+
 /**
  * \brief Implementation of all entity creation functions: map_api_create_*.
  * \param l The Lua context that is calling this function.
@@ -2278,10 +2328,7 @@ void LuaContext::map_on_finished(Map& map) {
 void LuaContext::map_on_update(Map& map) {
 
   push_map(l, map);
-  // This particular method is tried so often that we want to save optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (userdata_has_field(map, method_name)) {
+  if (userdata_has_field(map, TrackedEvent::ON_UPDATE)) {
     on_update();
   }
   menus_on_update(-1);
@@ -2386,7 +2433,7 @@ bool LuaContext::map_on_command_released(Map& map, GameCommand command) {
  */
 void LuaContext::map_on_suspended(Map& map, bool suspended) {
 
-  if (!userdata_has_field(map, "on_suspended")) {
+  if (!userdata_has_field(map, TrackedEvent::ON_SUSPENDED)) {
     return;
   }
 
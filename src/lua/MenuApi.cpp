@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/Profiler.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/LuaContext.h"
@@ -156,6 +157,8 @@ void LuaContext::destroy_menus() {
  */
 void LuaContext::update_menus() {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::LUA_MENUS);
+
   // Destroy the ones that should be removed.
   for (auto it = menus.begin();
       it != menus.end();
@@ -18,6 +18,7 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/Hero.h"
 #include "solarus/graphics/Drawable.h"
@@ -234,7 +235,9 @@ void LuaContext::register_movement_module() {
       { "set_target", path_finding_movement_api_set_target },
       { "get_speed", path_finding_movement_api_get_speed },
       { "set_speed", path_finding_movement_api_set_speed },
-      { "get_angle", path_finding_movement_api_get_angle}
+      { "get_angle", path_finding_movement_api_get_angle},
+      { "get_max_expanded_nodes", path_finding_movement_api_get_max_expanded_nodes },
+      { "set_max_expanded_nodes", path_finding_movement_api_set_max_expanded_nodes }
   };
   path_finding_movement_methods.insert(
         path_finding_movement_methods.end(),
@@ -479,6 +482,8 @@ void LuaContext::stop_movement_on_point(const std::shared_ptr<Movement>& movemen
  */
 void LuaContext::update_movements() {
 
+  SOLARUS_PROFILE_ZONE(ProfilerZone::LUA_MOVEMENTS);
+
   lua_getfield(l, LUA_REGISTRYINDEX, "sol.movements_on_points");
   std::vector<std::shared_ptr<Movement>> movements;
   lua_pushnil(l);  // First key.
@@ -1447,6 +1452,41 @@ int LuaContext::path_finding_movement_api_set_speed(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of path_finding_movement:get_max_expanded_nodes().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::path_finding_movement_api_get_max_expanded_nodes(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const PathFindingMovement& movement = *check_path_finding_movement(l, 1);
+
+    lua_pushinteger(l, movement.get_max_expanded_nodes());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of path_finding_movement:set_max_expanded_nodes().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::path_finding_movement_api_set_max_expanded_nodes(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    PathFindingMovement& movement = *check_path_finding_movement(l, 1);
+    int max_expanded_nodes = LuaTools::check_int(l, 2);
+
+    if (max_expanded_nodes <= 0) {
+      LuaTools::arg_error(l, 2, "The maximum number of expanded nodes must be positive");
+    }
+
+    movement.set_max_expanded_nodes(max_expanded_nodes);
+    return 0;
+  });
+}
+
 /**
  * \brief Returns whether a value is a userdata of type circle movement.
  * \param l A Lua context.
@@ -2016,7 +2056,7 @@ void LuaContext::movement_on_position_changed(
   }
   lua_pop(l, 2);
                                   // ... movement
-  if (userdata_has_field(movement, "on_position_changed")) {
+  if (userdata_has_field(movement, TrackedEvent::ON_POSITION_CHANGED)) {
     on_position_changed(xy);
   }
   lua_pop(l, 1);
@@ -2031,7 +2071,7 @@ void LuaContext::movement_on_position_changed(
  */
 void LuaContext::movement_on_obstacle_reached(Movement& movement) {
 
-  if (!userdata_has_field(movement, "on_obstacle_reached")) {
+  if (!userdata_has_field(movement, TrackedEvent::ON_OBSTACLE_REACHED)) {
     return;
   }
 
@@ -50,6 +50,7 @@ void LuaContext::register_shader_module() {
       { "get_id", shader_api_get_id },
       { "get_vertex_file", shader_api_get_vertex_file },
       { "get_fragment_file", shader_api_get_fragment_file },
+      { "get_uniform_handle", shader_api_get_uniform_handle },
       { "set_uniform", shader_api_set_uniform },
   };
 
@@ -103,6 +104,10 @@ int LuaContext::shader_api_create(lua_State* l) {
 
     const std::string& shader_id = LuaTools::check_string(l, 1);
 
+    if (!ShaderContext::is_shader_supported()) {
+      LuaTools::error(l, "Failed to create shader '" + shader_id + "': shaders are not supported");
+    }
+
     ShaderPtr shader = ShaderContext::create_shader(shader_id);
 
     if (!shader->is_valid()) {
@@ -194,6 +199,29 @@ int LuaContext::shader_api_get_fragment_file(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of shader:get_uniform_handle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::shader_api_get_uniform_handle(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    Shader& shader = *check_shader(l, 1);
+    const std::string& uniform_name = LuaTools::check_string(l, 2);
+
+    const int uniform_handle = shader.get_uniform_handle(uniform_name);
+    if (uniform_handle == -1) {
+      lua_pushnil(l);
+    }
+    else {
+      lua_pushinteger(l, uniform_handle);
+    }
+    return 1;
+  });
+}
+
 /**
  * \brief Implementation of shader:set_uniform().
  * \param l The Lua context that is calling this function.
@@ -204,17 +232,26 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
   return LuaTools::exception_boundary_handle(l, [&] {
 
     Shader& shader = *check_shader(l, 1);
-    const std::string& uniform_name = LuaTools::check_string(l, 2);
+    int uniform_handle = -1;
+    if (lua_type(l, 2) == LUA_TNUMBER) {
+      uniform_handle = LuaTools::check_int(l, 2);
+    }
+    else if (lua_type(l, 2) == LUA_TSTRING) {
+      uniform_handle = shader.get_uniform_handle(LuaTools::check_string(l, 2));
+    }
+    else {
+      LuaTools::type_error(l, 2, "string or number");
+    }
 
     if (lua_isboolean(l, 3)) {
       // Boolean.
       const bool value = lua_toboolean(l, 3);
-      shader.set_uniform_1b(uniform_name, value);
+      shader.set_uniform_1b(uniform_handle, value);
     }
     else if (lua_isnumber(l, 3)) {
       // Number.
       const float value = static_cast<float>(lua_tonumber(l, 3));
-      shader.set_uniform_1f(uniform_name, value);
+      shader.set_uniform_1f(uniform_handle, value);
     }
     else if (lua_istable(l, 3)) {
       // Table of 2, 3 or 4 numbers.
@@ -235,7 +272,7 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
       lua_rawgeti(l, 3, 3);
       if (lua_isnil(l, -1)) {
         // 2 numbers.
-        shader.set_uniform_2f(uniform_name, value_1, value_2);
+        shader.set_uniform_2f(uniform_handle, value_1, value_2);
         return 0;
       }
 
@@ -247,7 +284,7 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
       lua_rawgeti(l, 3, 4);
       if (lua_isnil(l, -1)) {
         // 3 numbers.
-        shader.set_uniform_3f(uniform_name, value_1, value_2, value_3);
+        shader.set_uniform_3f(uniform_handle, value_1, value_2, value_3);
         return 0;
       }
 
@@ -256,12 +293,12 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
         LuaTools::arg_error(l, 3, table_error_message);
       }
       const float value_4 = static_cast<float>(LuaTools::check_number(l, -1));
-      shader.set_uniform_4f(uniform_name, value_1, value_2, value_3, value_4);
+      shader.set_uniform_4f(uniform_handle, value_1, value_2, value_3, value_4);
     }
     else if (is_surface(l, 3)) {
       // Surface.
       const SurfacePtr& value = check_surface(l, 3);
-      bool success = shader.set_uniform_texture(uniform_name, value);
+      bool success = shader.set_uniform_texture(uniform_handle, value);
       if (!success) {
         LuaTools::arg_error(l, 3, "Cannot use this surface in a shader");
       }
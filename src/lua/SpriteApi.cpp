@@ -692,7 +692,7 @@ void LuaContext::sprite_on_direction_changed(Sprite& sprite,
 void LuaContext::sprite_on_frame_changed(Sprite& sprite,
     const std::string& animation, int frame) {
 
-  if (!userdata_has_field(sprite, "on_frame_changed")) {
+  if (!userdata_has_field(sprite, TrackedEvent::ON_FRAME_CHANGED)) {
     return;
   }
 
@@ -211,8 +211,9 @@ int LuaContext::surface_api_get_pixels(lua_State* l) {
   return LuaTools::exception_boundary_handle(l, [&] {
     Surface& surface = *check_surface(l, 1);
     // TODO optional parameters x, y, width, height
+    bool previous_frame = LuaTools::opt_boolean(l, 2, false);
 
-    push_string(l, surface.get_pixels());
+    push_string(l, surface.get_pixels(previous_frame));
     return 1;
   });
 }
@@ -18,12 +18,14 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/System.h"
 #include "solarus/core/Timer.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
+#include <algorithm>
 #include <list>
 #include <sstream>
 
@@ -97,6 +99,22 @@ void LuaContext::push_timer(lua_State* l, const TimerPtr& timer) {
   push_userdata(l, *timer);
 }
 
+/**
+ * \brief Returns the context of timers at the given index of the stack.
+ * \param context_index Index of a table or userdata in the stack.
+ * \return The object that identifies the context.
+ */
+const void* LuaContext::get_timer_context(int context_index) const {
+
+  if (lua_type(l, context_index) == LUA_TUSERDATA) {
+    ExportableToLuaPtr* userdata = static_cast<ExportableToLuaPtr*>(
+        lua_touserdata(l, context_index)
+    );
+    return userdata->get();
+  }
+  return lua_topointer(l, context_index);
+}
+
 /**
  * \brief Registers a timer into a context (table or a userdata).
  * \param timer A timer.
@@ -108,16 +126,7 @@ void LuaContext::add_timer(
     int context_index,
     const ScopedLuaRef& callback_ref
 ) {
-  const void* context;
-  if (lua_type(l, context_index) == LUA_TUSERDATA) {
-    ExportableToLuaPtr* userdata = static_cast<ExportableToLuaPtr*>(
-        lua_touserdata(l, context_index)
-    );
-    context = userdata->get();
-  }
-  else {
-    context = lua_topointer(l, context_index);
-  }
+  const void* context = get_timer_context(context_index);
 
   Debug::execute_if_debug([&] {
     // Sanity check: check the uniqueness of the ref.
@@ -134,8 +143,13 @@ void LuaContext::add_timer(
   Debug::check_assertion(timers.find(timer) == timers.end(),
       "Duplicate timer in the system");
 
-  timers[timer].callback_ref = callback_ref;
-  timers[timer].context = context;
+  LuaTimerData& timer_data = timers[timer];
+  timer_data.callback_ref = callback_ref;
+  timer_data.context = context;
+  timer_data.scheduled = false;
+  timer_data.scheduled_date = 0;
+  timer_data.scheduled_order = 0;
+  timers_by_context[context].push_back(timer);
 
   Game* game = main_loop.get_game();
   if (game != nullptr) {
@@ -171,6 +185,8 @@ void LuaContext::add_timer(
       timer->set_suspended(initially_suspended);
     }
   }
+
+  schedule_timer(timer);
 }
 
 /**
@@ -181,8 +197,11 @@ void LuaContext::add_timer(
  * \param timer A timer.
  */
 void LuaContext::remove_timer(const TimerPtr& timer) {
-  if (timers.find(timer) != timers.end()) {
-    timers[timer].callback_ref.clear();
+
+  const auto& it = timers.find(timer);
+  if (it != timers.end() &&
+      !it->second.callback_ref.is_empty()) {
+    it->second.callback_ref.clear();
     timers_to_remove.push_back(timer);
   }
 }
@@ -196,22 +215,14 @@ void LuaContext::remove_timer(const TimerPtr& timer) {
  */
 void LuaContext::remove_timers(int context_index) {
 
-  const void* context;
-  if (lua_type(l, context_index) == LUA_TUSERDATA) {
-    ExportableToLuaPtr* userdata = static_cast<ExportableToLuaPtr*>(
-        lua_touserdata(l, context_index));
-    context = userdata->get();
-  }
-  else {
-    context = lua_topointer(l, context_index);
+  const auto& it = timers_by_context.find(get_timer_context(context_index));
+  if (it == timers_by_context.end()) {
+    // No timers in this context.
+    return;
   }
 
-  for (auto& kvp: timers) {
-    const TimerPtr& timer = kvp.first;
-    if (kvp.second.context == context) {
-      kvp.second.callback_ref.clear();
-      timers_to_remove.push_back(timer);
-    }
+  for (const TimerPtr& timer: it->second) {
+    remove_timer(timer);
   }
 }
 
@@ -219,33 +230,128 @@ void LuaContext::remove_timers(int context_index) {
  * \brief Destroys immediately all existing timers.
  */
 void LuaContext::destroy_timers() {
+
   timers.clear();
+  timers_to_remove.clear();
+  timers_by_context.clear();
+  timer_schedule = decltype(timer_schedule)();
 }
 
 /**
- * \brief Updates all timers currently running for this script.
+ * \brief Adds or updates the entry of a timer in the timer schedule.
+ *
+ * This function should be called whenever the timer is resumed or its
+ * expiration date changes.
+ * Suspended timers are not scheduled: they need to be scheduled again
+ * when they get resumed.
+ *
+ * \param timer A timer.
  */
-void LuaContext::update_timers() {
+void LuaContext::schedule_timer(const TimerPtr& timer) {
+
+  const auto& it = timers.find(timer);
+  if (it == timers.end() ||
+      it->second.callback_ref.is_empty()) {
+    // Not running.
+    return;
+  }
+
+  LuaTimerData& timer_data = it->second;
+  if (timer->is_suspended()) {
+    // Any existing entry becomes obsolete.
+    timer_data.scheduled = false;
+    return;
+  }
+
+  const uint32_t date = timer->get_next_update_date();
+  if (timer_data.scheduled && timer_data.scheduled_date == date) {
+    // Already up-to-date.
+    return;
+  }
+
+  timer_data.scheduled = true;
+  timer_data.scheduled_date = date;
+  timer_data.scheduled_order = timer_schedule_order++;
+  timer_schedule.push({ date, timer_data.scheduled_order, timer });
 
-  // Update all timers.
+  if (timer_schedule.size() > 2 * timers.size() + 64) {
+    // Too many obsolete entries.
+    rebuild_timer_schedule();
+  }
+}
+
+/**
+ * \brief Recreates the timer schedule with only up-to-date entries.
+ */
+void LuaContext::rebuild_timer_schedule() {
+
+  std::vector<ScheduledTimer> entries;
+  entries.reserve(timers.size());
   for (const auto& kvp: timers) {
+    const LuaTimerData& timer_data = kvp.second;
+    if (timer_data.scheduled && !timer_data.callback_ref.is_empty()) {
+      entries.push_back({ timer_data.scheduled_date, timer_data.scheduled_order, kvp.first });
+    }
+  }
+  timer_schedule = decltype(timer_schedule)(std::greater<ScheduledTimer>(), std::move(entries));
+}
 
-    const TimerPtr& timer = kvp.first;
-    const ScopedLuaRef& callback_ref = kvp.second.callback_ref;
-    if (!callback_ref.is_empty()) {
-      // The timer is not being removed: update it.
-      timer->update();
-      if (timer->is_finished()) {
-        do_timer_callback(timer);
-      }
+/**
+ * \brief Updates the timers currently running for this script.
+ *
+ * Only timers that need to be updated at this date are considered.
+ */
+void LuaContext::update_timers() {
+
+  SOLARUS_PROFILE_ZONE(ProfilerZone::LUA_TIMERS);
+
+  // Update the timers whose date has come.
+  const uint32_t now = System::now();
+  std::vector<TimerPtr> timers_to_schedule;
+  while (!timer_schedule.empty() &&
+      timer_schedule.top().date <= now) {
+
+    const ScheduledTimer scheduled_timer = timer_schedule.top();
+    timer_schedule.pop();
+
+    const TimerPtr& timer = scheduled_timer.timer;
+    const auto& it = timers.find(timer);
+    if (it == timers.end()) {
+      // Already removed.
+      continue;
     }
+
+    LuaTimerData& timer_data = it->second;
+    if (timer_data.callback_ref.is_empty() ||
+        !timer_data.scheduled ||
+        timer_data.scheduled_date != scheduled_timer.date) {
+      // Obsolete entry.
+      continue;
+    }
+
+    // The timer is not being removed: update it.
+    timer_data.scheduled = false;
+    timer->update();
+    if (timer->is_finished()) {
+      do_timer_callback(timer);
+    }
+    else {
+      // Schedule it again after this loop to update it at most once per cycle.
+      timers_to_schedule.push_back(timer);
+    }
+  }
+
+  for (const TimerPtr& timer: timers_to_schedule) {
+    schedule_timer(timer);
   }
 
   // Destroy the ones that should be removed.
+  std::vector<const void*> contexts;
   for (const TimerPtr& timer: timers_to_remove) {
 
     const auto& it = timers.find(timer);
     if (it != timers.end()) {
+      contexts.push_back(it->second.context);
       timers.erase(it);
 
       Debug::check_assertion(timers.find(timer) == timers.end(),
@@ -253,6 +359,31 @@ void LuaContext::update_timers() {
     }
   }
   timers_to_remove.clear();
+
+  // Update the index of contexts that lost timers.
+  for (const void* context: contexts) {
+    const auto& it = timers_by_context.find(context);
+    if (it == timers_by_context.end()) {
+      continue;
+    }
+    std::vector<TimerPtr>& context_timers = it->second;
+    context_timers.erase(std::remove_if(
+        context_timers.begin(),
+        context_timers.end(),
+        [&](const TimerPtr& timer) {
+          return timers.find(timer) == timers.end();
+        }
+    ), context_timers.end());
+    if (context_timers.empty()) {
+      timers_by_context.erase(it);
+    }
+  }
+
+  if (!contexts.empty() &&
+      timer_schedule.size() > 2 * timers.size() + 64) {
+    // Release removed timers still in the schedule.
+    rebuild_timer_schedule();
+  }
 }
 
 /**
@@ -266,6 +397,7 @@ void LuaContext::notify_timers_map_suspended(bool suspended) {
     const TimerPtr& timer = kvp.first;
     if (timer->is_suspended_with_map()) {
       timer->notify_map_suspended(suspended);
+      schedule_timer(timer);
     }
   }
 }
@@ -282,11 +414,15 @@ void LuaContext::set_entity_timers_suspended(
     Entity& entity, bool suspended
 ) {
 
-  for (const auto& kvp: timers) {
-    const TimerPtr& timer = kvp.first;
-    if (kvp.second.context == &entity) {
-      timer->set_suspended(suspended);
-    }
+  const auto& it = timers_by_context.find(&entity);
+  if (it == timers_by_context.end()) {
+    // No timers on this entity.
+    return;
+  }
+
+  for (const TimerPtr& timer: it->second) {
+    timer->set_suspended(suspended);
+    schedule_timer(timer);
   }
 }
 
@@ -325,6 +461,9 @@ void LuaContext::do_timer_callback(const TimerPtr& timer) {
         // the main loop stepsize.
         do_timer_callback(timer);
       }
+      else {
+        schedule_timer(timer);
+      }
     }
     else {
       callback_ref.clear();
@@ -444,10 +583,12 @@ int LuaContext::timer_api_is_with_sound(lua_State* l) {
 int LuaContext::timer_api_set_with_sound(lua_State* l) {
 
   return LuaTools::exception_boundary_handle(l, [&] {
+    LuaContext& lua_context = get_lua_context(l);
     const TimerPtr& timer = check_timer(l, 1);
     bool with_sound = LuaTools::opt_boolean(l, 2, true);
 
     timer->set_with_sound(with_sound);
+    lua_context.schedule_timer(timer);
 
     return 0;
   });
@@ -476,10 +617,12 @@ int LuaContext::timer_api_is_suspended(lua_State* l) {
 int LuaContext::timer_api_set_suspended(lua_State* l) {
 
   return LuaTools::exception_boundary_handle(l, [&] {
+    LuaContext& lua_context = get_lua_context(l);
     const TimerPtr& timer = check_timer(l, 1);
     bool suspended = LuaTools::opt_boolean(l, 2, true);
 
     timer->set_suspended(suspended);
+    lua_context.schedule_timer(timer);
 
     return 0;
   });
@@ -520,6 +663,7 @@ int LuaContext::timer_api_set_suspended_with_map(lua_State* l) {
       // If the game is running, suspend/resume the timer like the map.
       timer->notify_map_suspended(game->get_current_map().is_suspended());
     }
+    lua_context.schedule_timer(timer);
 
     return 0;
   });
@@ -576,6 +720,9 @@ int LuaContext::timer_api_set_remaining_time(lua_State* l) {
         // Execute the callback now.
         lua_context.do_timer_callback(timer);
       }
+      else {
+        lua_context.schedule_timer(timer);
+      }
     }
 
     return 0;
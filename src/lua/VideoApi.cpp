@@ -16,6 +16,7 @@
  */
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Size.h"
+#include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/graphics/SoftwareVideoMode.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaContext.h"
@@ -49,7 +50,9 @@ void LuaContext::register_video_module() {
       { "get_quest_size", video_api_get_quest_size },
       { "get_window_size", video_api_get_window_size },
       { "set_window_size", video_api_set_window_size },
-      { "reset_window_size", video_api_reset_window_size }
+      { "reset_window_size", video_api_reset_window_size },
+      { "get_tile_cache_size", video_api_get_tile_cache_size },
+      { "set_tile_cache_size", video_api_set_tile_cache_size }
   };
   if (CurrentQuest::is_format_at_least({ 1, 6 })) {
     functions.insert(functions.end(), {
@@ -401,5 +404,35 @@ int LuaContext::video_api_set_shader(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.video.get_tile_cache_size().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::video_api_get_tile_cache_size(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    lua_pushinteger(l, NonAnimatedRegions::get_cache_size());
+    return 1;
+  });
 }
 
+/**
+ * \brief Implementation of sol.video.set_tile_cache_size().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::video_api_set_tile_cache_size(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    int cache_size = LuaTools::check_int(l, 1);
+    if (cache_size < 0) {
+      LuaTools::arg_error(l, 1, "Tile cache size cannot be negative");
+    }
+    NonAnimatedRegions::set_cache_size(cache_size);
+
+    return 0;
+  });
+}
+
+}
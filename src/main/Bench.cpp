@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Arguments.h"
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/Game.h"
+#include "solarus/core/GameCommands.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/MainLoop.h"
+#include "solarus/core/Profiler.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/core/Savegame.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/graphics/Video.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * \brief A game command to simulate at a given tick.
+ */
+struct InputAction {
+  int tick;                 /**< Tick when to simulate the command,
+                             * counted from the start of the map. */
+  bool pressed;             /**< \c true for a press, \c false for a release. */
+  GameCommand command;      /**< The game command. */
+};
+
+/**
+ * \brief Measured phase of a tick and its durations.
+ */
+struct Phase {
+  std::string name;         /**< Name in the report. */
+  std::vector<uint64_t> durations;  /**< Duration of each measured tick in nanoseconds. */
+};
+
+/**
+ * \brief Prints the usage of the program.
+ * \param args Command-line arguments.
+ */
+void print_help(const Arguments& args) {
+
+  std::string binary_name = args.get_program_name();
+  if (binary_name.empty()) {
+    binary_name = "solarus-bench";
+  }
+  std::cout << "Usage: " << binary_name << " -map=<map_id> [options] [quest_path]"
+    << std::endl << std::endl
+    << "Runs a map of a quest for a fixed number of ticks as fast as possible"
+    << std::endl
+    << "and reports statistics about the time taken by each phase in JSON."
+    << std::endl
+    << "Durations are in microseconds."
+    << std::endl
+    << std::endl
+    << "Options:"
+    << std::endl
+    << "  -help                         shows this help message and exits"
+    << std::endl
+    << "  -map=<map_id>                 map to run (required)"
+    << std::endl
+    << "  -ticks=N                      number of ticks to measure (default 1000)"
+    << std::endl
+    << "  -warmup=N                     number of ticks to run before measuring (default 60)"
+    << std::endl
+    << "  -input=<file>                 replays game commands from a file"
+    << std::endl
+    << "  -output=<file>                writes the report to a file instead of the standard output"
+    << std::endl
+    << "  -trace=<file>                 writes the measured ticks in the Chrome trace event format"
+    << std::endl
+    << std::endl
+    << "Each line of the input file has the form '<tick> press|release <command>',"
+    << std::endl
+    << "where the tick is counted from the start of the map, including warmup ticks,"
+    << std::endl
+    << "and the command is a game command like 'right' or 'action'."
+    << std::endl
+    << "Lines starting with '#' are ignored."
+    << std::endl
+    << std::endl
+    << "Engine options like -no-audio, -no-video and -quest-size are also supported."
+    << std::endl;
+}
+
+/**
+ * \brief Returns the integer value of an option.
+ * \param args Command-line arguments.
+ * \param key Name of the option.
+ * \param default_value Value to return if the option is not set.
+ * \return The value of the option.
+ */
+int get_int_argument(const Arguments& args, const std::string& key, int default_value) {
+
+  const std::string& value_string = args.get_argument_value(key);
+  if (value_string.empty()) {
+    return default_value;
+  }
+
+  std::istringstream iss(value_string);
+  int value = 0;
+  if (!(iss >> value) || value < 0) {
+    Debug::die("Invalid value for option " + key + ": '" + value_string + "'");
+  }
+  return value;
+}
+
+/**
+ * \brief Reads game commands to replay from a file.
+ * \param file_name Name of the input file.
+ * \return The commands sorted by tick.
+ */
+std::vector<InputAction> load_input_actions(const std::string& file_name) {
+
+  std::ifstream file(file_name);
+  if (!file) {
+    Debug::die("Cannot open input file '" + file_name + "'");
+  }
+
+  std::vector<InputAction> actions;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+    ++line_number;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream iss(line);
+    InputAction action;
+    std::string state;
+    std::string command_name;
+    if (!(iss >> action.tick >> state >> command_name) ||
+        (state != "press" && state != "release")) {
+      std::ostringstream oss;
+      oss << "Invalid line " << line_number << " in input file '" << file_name << "'";
+      Debug::die(oss.str());
+    }
+    action.pressed = (state == "press");
+    action.command = GameCommands::get_command_by_name(command_name);
+    if (action.command == GameCommand::NONE) {
+      Debug::die("Unknown game command '" + command_name + "' in input file '" + file_name + "'");
+    }
+    actions.push_back(action);
+  }
+
+  std::stable_sort(actions.begin(), actions.end(),
+      [](const InputAction& action_1, const InputAction& action_2) {
+    return action_1.tick < action_2.tick;
+  });
+  return actions;
+}
+
+/**
+ * \brief Writes the statistics of a phase as a JSON object.
+ * \param out The stream to write.
+ * \param phase The phase to report. Its durations are sorted.
+ */
+void print_phase_statistics(std::ostream& out, Phase& phase) {
+
+  std::vector<uint64_t>& durations = phase.durations;
+  std::sort(durations.begin(), durations.end());
+
+  out << "    \"" << phase.name << "\": { ";
+  if (durations.empty()) {
+    out << "\"min\": 0, \"median\": 0, \"p99\": 0, \"max\": 0 }";
+    return;
+  }
+
+  const size_t p99_index = std::min(durations.size() - 1, (durations.size() * 99 + 99) / 100 - 1);
+  const auto to_us = [](uint64_t duration) {
+    return duration / 1000.0;
+  };
+  out << "\"min\": " << to_us(durations.front())
+      << ", \"median\": " << to_us(durations[durations.size() / 2])
+      << ", \"p99\": " << to_us(durations[p99_index])
+      << ", \"max\": " << to_us(durations.back())
+      << " }";
+}
+
+}  // Anonymous namespace.
+
+}  // namespace Solarus.
+
+/**
+ * \brief Entry point of the benchmark runner.
+ *
+ * Usage: solarus-bench -map=<map_id> [options] [quest_path]
+ *
+ * Starts a game on the given map and runs a fixed number of ticks, each one
+ * made of MainLoop::step() and MainLoop::draw(), without waiting between
+ * them. The time spent in each phase is measured with the profiler and
+ * reported as min, median, 99th percentile and max in JSON.
+ *
+ * \param argc Number of command-line arguments.
+ * \param argv Command-line arguments.
+ * \return 0 in case of success.
+ */
+int main(int argc, char** argv) {
+
+  using namespace Solarus;
+
+  Debug::set_show_popup_on_die(false);
+  Debug::set_abort_on_die(true);
+
+  Arguments args(argc, argv);
+  if (args.has_argument("-help")) {
+    print_help(args);
+    return 0;
+  }
+
+  const std::string& map_id = args.get_argument_value("-map");
+  if (map_id.empty()) {
+    print_help(args);
+    return 1;
+  }
+  const int num_ticks = get_int_argument(args, "-ticks", 1000);
+  const int num_warmup_ticks = get_int_argument(args, "-warmup", 60);
+  const std::string& input_file_name = args.get_argument_value("-input");
+  const std::string& output_file_name = args.get_argument_value("-output");
+  const std::string& trace_file_name = args.get_argument_value("-trace");
+
+  std::vector<InputAction> input_actions;
+  if (!input_file_name.empty()) {
+    input_actions = load_input_actions(input_file_name);
+  }
+
+  // Standard input must not interfere with the measures.
+  if (args.get_argument_value("-lua-console").empty()) {
+    args.add_argument("-lua-console", "no");
+  }
+
+  MainLoop main_loop(args);
+  if (!QuestFiles::quest_exists()) {
+    return 1;
+  }
+
+  if (!CurrentQuest::resource_exists(ResourceType::MAP, map_id)) {
+    Debug::error("No such map: '" + map_id + "'");
+    return 1;
+  }
+
+  // Start a game on the map, without any savegame file.
+  std::shared_ptr<Savegame> savegame = std::make_shared<Savegame>(
+      main_loop, "solarus_bench.dat"
+  );
+  savegame->initialize();
+  savegame->set_string(Savegame::KEY_STARTING_MAP, map_id);
+  main_loop.set_game(new Game(main_loop, savegame));
+
+  while (!main_loop.is_exiting() &&
+         (main_loop.get_game() == nullptr || !main_loop.get_game()->has_current_map())) {
+    main_loop.step();
+  }
+
+  std::vector<Phase> phases;
+  for (ProfilerZone zone : EnumInfo<ProfilerZone>::enums()) {
+    phases.push_back({ enum_to_name(zone), {} });
+    phases.back().durations.reserve(num_ticks);
+  }
+  phases.push_back({ "total", {} });
+  phases.back().durations.reserve(num_ticks);
+
+#ifndef SOLARUS_PROFILING
+  Debug::warning("The engine was compiled without SOLARUS_PROFILING: only total times are measured");
+#endif
+  // Keep all measured ticks for the trace, plus the one being recorded.
+  Profiler::set_max_frames(num_ticks + 1);
+  Profiler::set_enabled(true);
+  auto next_action = input_actions.cbegin();
+  int num_ticks_done = 0;
+  int num_resident_tile_cells = 0;
+  int max_tile_cells_built = 0;
+  uint64_t num_draw_list_changes = 0;
+  int max_draw_list_changes = 0;
+  uint64_t num_target_switches = 0;
+  uint64_t num_copies = 0;
+  int max_target_switches = 0;
+  int max_copies = 0;
+  for (int tick = 0; tick < num_warmup_ticks + num_ticks && !main_loop.is_exiting(); ++tick) {
+
+    // Replay input.
+    Game* game = main_loop.get_game();
+    while (next_action != input_actions.cend() && next_action->tick <= tick) {
+      if (game != nullptr) {
+        if (next_action->pressed) {
+          game->simulate_command_pressed(next_action->command);
+        }
+        else {
+          game->simulate_command_released(next_action->command);
+        }
+      }
+      ++next_action;
+    }
+
+    // step() starts a new profiler frame, draw() is part of it.
+    const Clock::time_point start = Clock::now();
+    main_loop.step();
+    main_loop.draw();
+    const uint64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start
+    ).count();
+
+    if (tick < num_warmup_ticks) {
+      continue;
+    }
+
+    size_t i = 0;
+    for (ProfilerZone zone : EnumInfo<ProfilerZone>::enums()) {
+      phases[i].durations.push_back(Profiler::get_zone_time(zone));
+      ++i;
+    }
+    phases[i].durations.push_back(total);
+    ++num_ticks_done;
+
+    // Count the renderer calls of this tick.
+    num_target_switches += Video::get_num_render_target_switches();
+    num_copies += Video::get_num_render_copies();
+    max_target_switches = std::max(max_target_switches, Video::get_num_render_target_switches());
+    max_copies = std::max(max_copies, Video::get_num_render_copies());
+
+    // Watch the optimized tiles built on the fly.
+    game = main_loop.get_game();
+    if (game != nullptr && game->has_current_map()) {
+      const Entities& entities = game->get_current_map().get_entities();
+      num_resident_tile_cells = entities.get_num_resident_tile_cells();
+      max_tile_cells_built = std::max(max_tile_cells_built, entities.get_num_tile_cells_built_last_draw());
+      num_draw_list_changes += entities.get_num_draw_list_changes_last_draw();
+      max_draw_list_changes = std::max(max_draw_list_changes, entities.get_num_draw_list_changes_last_draw());
+    }
+  }
+  Profiler::begin_frame();  // End the last tick.
+
+  if (!trace_file_name.empty()) {
+    std::ofstream trace_file(trace_file_name);
+    if (!trace_file) {
+      Debug::error("Cannot write trace file '" + trace_file_name + "'");
+      return 1;
+    }
+    Profiler::write_chrome_trace(trace_file);
+  }
+  Profiler::set_enabled(false);
+
+  // Report the results.
+  std::ofstream output_file;
+  if (!output_file_name.empty()) {
+    output_file.open(output_file_name);
+    if (!output_file) {
+      Debug::error("Cannot write output file '" + output_file_name + "'");
+      return 1;
+    }
+  }
+  std::ostream& out = output_file_name.empty() ? std::cout : output_file;
+
+  out << std::fixed << std::setprecision(1)
+      << "{" << std::endl
+      << "  \"map\": \"" << map_id << "\"," << std::endl
+      << "  \"ticks\": " << num_ticks_done << "," << std::endl
+      << "  \"warmup_ticks\": " << num_warmup_ticks << "," << std::endl
+      << "  \"unit\": \"us\"," << std::endl
+#ifdef SOLARUS_PROFILING
+      << "  \"profiling\": true," << std::endl
+#else
+      << "  \"profiling\": false," << std::endl
+#endif
+      << "  \"render_calls\": {" << std::endl
+      << "    \"target_switches\": { \"mean\": "
+      << (num_ticks_done > 0 ? num_target_switches / static_cast<double>(num_ticks_done) : 0.0)
+      << ", \"max\": " << max_target_switches << " }," << std::endl
+      << "    \"copies\": { \"mean\": "
+      << (num_ticks_done > 0 ? num_copies / static_cast<double>(num_ticks_done) : 0.0)
+      << ", \"max\": " << max_copies << " }" << std::endl
+      << "  }," << std::endl
+      << "  \"tile_cells\": {" << std::endl
+      << "    \"resident\": " << num_resident_tile_cells << "," << std::endl
+      << "    \"max_built_per_tick\": " << max_tile_cells_built << std::endl
+      << "  }," << std::endl
+      << "  \"draw_list_changes\": { \"mean\": "
+      << (num_ticks_done > 0 ? num_draw_list_changes / static_cast<double>(num_ticks_done) : 0.0)
+      << ", \"max\": " << max_draw_list_changes << " }," << std::endl
+      << "  \"phases\": {" << std::endl;
+  for (size_t i = 0; i < phases.size(); ++i) {
+    print_phase_statistics(out, phases[i]);
+    out << (i + 1 < phases.size() ? "," : "") << std::endl;
+  }
+  out << "  }" << std::endl
+      << "}" << std::endl;
+
+  return 0;
+}
+
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/MapData.h"
+#include "solarus/entities/TilesetData.h"
+#include "solarus/graphics/SpriteData.h"
+#include "solarus/lua/LuaData.h"
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Prints the usage of the program.
+ * \param program_name Name of the executable.
+ */
+void print_help(const std::string& program_name) {
+
+  std::cout << "Usage: " << program_name << " data_file..."
+    << std::endl << std::endl
+    << "Writes the binary version (.bin) of map, tileset and sprite data files."
+    << std::endl
+    << "File names are relative to the data directory of the quest,"
+    << std::endl
+    << "which must be the current directory."
+    << std::endl
+    << "Other data files are ignored."
+    << std::endl;
+}
+
+/**
+ * \brief Returns whether a string starts with the given prefix.
+ * \param value The string to test.
+ * \param prefix The prefix.
+ * \return \c true if the string starts with this prefix.
+ */
+bool starts_with(const std::string& value, const std::string& prefix) {
+  return value.compare(0, prefix.size(), prefix) == 0;
+}
+
+/**
+ * \brief Creates the data object corresponding to a data file.
+ * \param file_name Name of a data file relative to the data directory.
+ * \return The data object, or nullptr if this file has no binary format.
+ */
+std::unique_ptr<LuaData> create_data(const std::string& file_name) {
+
+  if (starts_with(file_name, "maps/")) {
+    return std::unique_ptr<LuaData>(new MapData());
+  }
+  if (starts_with(file_name, "tilesets/")) {
+    return std::unique_ptr<LuaData>(new TilesetData());
+  }
+  if (starts_with(file_name, "sprites/")) {
+    return std::unique_ptr<LuaData>(new SpriteData());
+  }
+  return nullptr;
+}
+
+}  // Anonymous namespace.
+
+}  // namespace Solarus.
+
+/**
+ * \brief Usage: solarus-export-binary data_file...
+ *
+ * Converts map, tileset and sprite data files to their binary format.
+ * This is used when packaging a quest.
+ */
+int main(int argc, char** argv) {
+
+  using namespace Solarus;
+
+  Debug::set_show_popup_on_die(false);
+
+  if (argc < 2 || std::string(argv[1]) == "-help") {
+    print_help(argv[0]);
+    return argc < 2 ? 1 : 0;
+  }
+
+  int num_errors = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string file_name = argv[i];
+    std::unique_ptr<LuaData> data = create_data(file_name);
+    if (data == nullptr) {
+      continue;
+    }
+
+    if (!data->import_from_file(file_name) ||
+        !data->export_to_binary_file(LuaData::get_binary_file_name(file_name))) {
+      std::cerr << "Failed to export '" << file_name << "' to binary" << std::endl;
+      ++num_errors;
+    }
+  }
+
+  return num_errors == 0 ? 0 : 1;
+}
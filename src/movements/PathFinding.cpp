@@ -17,12 +17,36 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/Map.h"
+#include "solarus/entities/Entities.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/movements/PathFinding.h"
+#include <algorithm>
 #include <limits>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Maximum Manhattan distance between nodes and the target.
+ */
+constexpr int max_distance = 200;
+
+/**
+ * \brief Margin of the search area around the farthest nodes,
+ * to also contain the transition boxes.
+ */
+constexpr int search_area_margin = 8;
+
+/**
+ * \brief Size of the search area in 8*8 squares.
+ *
+ * Nodes are 16*16 and transitions overlap 8 more pixels on each side.
+ */
+constexpr int search_area_size8 = (2 * (max_distance + search_area_margin) + 16) / 8;
+
+}
+
 const Point PathFinding::neighbours_locations[] = {
   {  8,  0 },
   {  8, -8 },
@@ -58,12 +82,44 @@ PathFinding::PathFinding(
     Entity& target_entity):
   map(map),
   source_entity(source_entity),
-  target_entity(target_entity) {
+  target_entity(target_entity),
+  max_expanded_nodes(default_max_expanded_nodes),
+  search_area_origin(),
+  costs(),
+  directions(),
+  closed(),
+  terrain(),
+  entities_squares(),
+  obstacle_candidates(),
+  open_list() {
 
   Debug::check_assertion(source_entity.is_aligned_to_grid(),
       "The source must be aligned on the map grid");
 }
 
+/**
+ * \brief Returns the maximum number of nodes to expand when searching a path.
+ * \return The search budget.
+ */
+int PathFinding::get_max_expanded_nodes() const {
+  return max_expanded_nodes;
+}
+
+/**
+ * \brief Sets the maximum number of nodes to expand when searching a path.
+ *
+ * When this number is reached, the search stops and no path is returned.
+ * This bounds the time taken by compute_path().
+ *
+ * \param max_expanded_nodes The search budget.
+ */
+void PathFinding::set_max_expanded_nodes(int max_expanded_nodes) {
+
+  Debug::check_assertion(max_expanded_nodes > 0,
+      "The maximum number of expanded nodes must be positive");
+  this->max_expanded_nodes = max_expanded_nodes;
+}
+
 /**
  * \brief Tries to find a path between the source point and the target point.
  * \return the path found, or an empty string if no path was found
@@ -102,210 +158,314 @@ std::string PathFinding::compute_path() {
  * plus an offset.
  * \param offset Translation to add to the target.
  * \return the path found, or an empty string if no path was found
- * (because there is no path or the target is too far)
+ * (because there is no path, the target is too far or the search budget
+ * is exceeded)
  */
 std::string PathFinding::compute_path(const Point& offset) {
 
   Point source = source_entity.get_bounding_box().get_xy();
   Point target = target_entity.get_bounding_box().get_xy() + offset;
 
-  // std::cout << "will compute a path from " << source << " to " << target << std::endl;
-
   target.x += 4;
   target.x += -target.x % 8;
   target.y += 4;
   target.y += -target.y % 8;
-  const int target_index = get_square_index(target);
 
   Debug::check_assertion(target.x % 8 == 0 && target.y % 8 == 0,
       "Could not snap the target to the map grid");
 
   const int total_mdistance = Geometry::get_manhattan_distance(source, target);
-  if (total_mdistance > 200 || target_entity.get_layer() != source_entity.get_layer()) {
-    //std::cout << "too far, not computing a path\n";
+  if (total_mdistance > max_distance || target_entity.get_layer() != source_entity.get_layer()) {
     return ""; // too far to compute a path
   }
 
-  std::string path = "";
-
-  Node starting_node;
-  const int index = get_square_index(source);
-  starting_node.location = source;
-  starting_node.index = index;
-  starting_node.previous_cost = 0;
-  starting_node.heuristic = total_mdistance;
-  starting_node.total_cost = total_mdistance;
-  starting_node.direction = ' ';
-  starting_node.parent_index = -1;
-
-  open_list.clear();
-  closed_list.clear();
-  open_list_indices.clear();
+  initialize_search_area(target);
+  const int source_index = get_square_index(source);
+  const int target_index = get_square_index(target);
 
-  open_list[index] = starting_node;
-  open_list_indices.push_front(index);
+  costs[source_index] = 0;
+  directions[source_index] = ' ';
+  int order = 0;
+  open_list.push({ total_mdistance, order++, source_index });
 
-  bool finished = false;
-  while (!finished) {
+  int num_expanded_nodes = 0;
+  while (!open_list.empty()) {
 
     // pick the node with the lowest total cost in the open list
-    const int index = open_list_indices.front();
-    Node* current_node = &open_list[index];
-    open_list_indices.pop_front();
-    closed_list[index] = *current_node;
-    open_list.erase(index);
-    current_node = &closed_list[index];
-
-    //std::cout << System::now() << " picking the lowest cost node in the open list ("
-    //  << (open_list_indices.size() + 1) << " elements): "
-    //  << current_node->location << ", index = " << current_node->index
-    //  << ", cost = " << current_node->previous_cost << " + " << current_node->heuristic << "\n";
+    const OpenNode current_node = open_list.top();
+    open_list.pop();
+    const int index = current_node.index;
+    if (closed[index]) {
+      // Obsolete entry: a better path to this node was already expanded.
+      continue;
+    }
+    closed[index] = true;
 
     if (index == target_index) {
-      //std::cout << "target node was added to the closed list\n";
-      finished = true;
-      path = rebuild_path(current_node);
-      //std::cout << "rebuild done\n";
+      return rebuild_path(index);
     }
-    else {
-      // look at the accessible nodes from it
-      //std::cout << System::now() << " looking for accessible states\n";
-      for (int i = 0; i < 8; i++) {
-
-        Node new_node;
-        const int immediate_cost = (i & 1) ? 11 : 8;
-        new_node.previous_cost = current_node->previous_cost + immediate_cost;
-        new_node.location = current_node->location;
-        new_node.location += neighbours_locations[i];
-        new_node.index = get_square_index(new_node.location);
-        //std::cout << "  node in direction " << i << ": index = " << new_node.index << std::endl;
-
-        const bool in_closed_list = (closed_list.find(new_node.index) != closed_list.end());
-        if (!in_closed_list && Geometry::get_manhattan_distance(new_node.location, target) < 200
-            && is_node_transition_valid(*current_node, i)) {
-          //std::cout << "  node in direction " << i << " is not in the closed list\n";
-          // not in the closed list: look in the open list
-
-          const bool in_open_list = open_list.find(new_node.index) != open_list.end();
-
-          if (!in_open_list) {
-            // not in the open list: add it
-            new_node.heuristic = Geometry::get_manhattan_distance(new_node.location, target);
-            new_node.total_cost = new_node.previous_cost + new_node.heuristic;
-            new_node.parent_index = index;
-            new_node.direction = '0' + i;
-            open_list[new_node.index] = new_node;
-            add_index_sorted(&open_list[new_node.index]);
-            //std::cout << "  node in direction " << i << " is not in the open list, adding it with cost "
-            //  << new_node.previous_cost << " (" << current_node->previous_cost << " + "
-            //  << immediate_cost << ") + " << new_node.heuristic << " and parent " << new_node.parent_index << "\n";
-          }
-          else {
-            //std::cout << "  node in direction " << i << " is already in the open list\n";
-            Node* existing_node = &open_list[new_node.index];
-            // already in the open list: see if the current path is better
-            if (new_node.previous_cost < existing_node->previous_cost) {
-              existing_node->previous_cost = new_node.previous_cost;
-              existing_node->total_cost = existing_node->previous_cost + existing_node->heuristic;
-              existing_node->parent_index = index;
-              open_list_indices.sort();
-            }
-          }
-        }
-        else {
-          //std::cout << "skipping node in direction " << i << ": already in closed list = "
-          //  << in_closed_list << ", too far from target = "
-          //  << (get_manhattan_distance(new_node.location, target) >= 200) << ", invalid transition = "
-          //  << (!is_node_transition_valid(*current_node, i)) << std::endl;
-        }
+
+    ++num_expanded_nodes;
+    if (num_expanded_nodes > max_expanded_nodes) {
+      // Too costly: give up.
+      break;
+    }
+
+    // look at the accessible nodes from it
+    const Point& location = get_square_location(index);
+    const int previous_cost = costs[index];
+    for (int i = 0; i < 8; i++) {
+
+      const Point& new_location = location + neighbours_locations[i];
+      const int new_index = get_square_index(new_location);
+      if (closed[new_index]) {
+        continue;
       }
-      if (open_list_indices.empty()) {
-        finished = true;
+
+      const int heuristic = Geometry::get_manhattan_distance(new_location, target);
+      if (heuristic >= max_distance) {
+        continue;
+      }
+
+      const int immediate_cost = (i & 1) ? 11 : 8;
+      const int new_cost = previous_cost + immediate_cost;
+      if (costs[new_index] != -1 && new_cost >= costs[new_index]) {
+        // Already in the open list with a better path.
+        continue;
       }
+
+      if (!is_node_transition_valid(location, i)) {
+        continue;
+      }
+
+      // Add it to the open list or update it.
+      costs[new_index] = new_cost;
+      directions[new_index] = '0' + i;
+      open_list.push({ new_cost + heuristic, order++, new_index });
     }
   }
 
-  //std::cout << "path found: " << path << ", open nodes: " << open_list.size() << ", closed nodes: " << closed_list.size() << std::endl;
-  return path;
+  return "";
 }
 
 /**
- * \brief Returns the index of the 8*8 square in the map
+ * \brief Prepares the data of a new search around a target.
+ *
+ * The search area is a square that contains all nodes closer than the
+ * maximum distance from the target, and their transitions.
+ * Obstacle entities of this area are found here once for all transitions.
+ *
+ * \param target Location of the target node.
+ */
+void PathFinding::initialize_search_area(const Point& target) {
+
+  search_area_origin = target - Point(max_distance + search_area_margin, max_distance + search_area_margin);
+
+  const int num_squares = search_area_size8 * search_area_size8;
+  costs.assign(num_squares, -1);
+  directions.assign(num_squares, ' ');
+  closed.assign(num_squares, false);
+  terrain.assign(num_squares, Terrain::UNKNOWN);
+  entities_squares.assign(num_squares, false);
+  open_list = std::priority_queue<OpenNode>();
+
+  // Get the entities that may be obstacles.
+  const Rectangle search_area(search_area_origin, Size(search_area_size8 * 8, search_area_size8 * 8));
+  const int layer = source_entity.get_layer();
+  obstacle_candidates.clear();
+  map.get_entities().get_entities_in_rectangle(search_area, obstacle_candidates);
+  obstacle_candidates.erase(std::remove_if(
+      obstacle_candidates.begin(),
+      obstacle_candidates.end(),
+      [&](const EntityPtr& entity) {
+        return (entity->get_layer() != layer && !entity->has_layer_independent_collisions()) ||
+            !entity->is_enabled() ||
+            entity->is_being_removed() ||
+            entity.get() == &source_entity;
+      }
+  ), obstacle_candidates.end());
+
+  // Mark their squares.
+  for (const EntityPtr& entity : obstacle_candidates) {
+    const Rectangle& box = entity->get_bounding_box() & search_area;
+    if (box.is_flat()) {
+      continue;
+    }
+    const int x8_min = (box.get_x() - search_area_origin.x) / 8;
+    const int x8_max = (box.get_x() + box.get_width() - 1 - search_area_origin.x) / 8;
+    const int y8_min = (box.get_y() - search_area_origin.y) / 8;
+    const int y8_max = (box.get_y() + box.get_height() - 1 - search_area_origin.y) / 8;
+    for (int y8 = y8_min; y8 <= y8_max; ++y8) {
+      for (int x8 = x8_min; x8 <= x8_max; ++x8) {
+        entities_squares[y8 * search_area_size8 + x8] = true;
+      }
+    }
+  }
+}
+
+/**
+ * \brief Returns the index of the 8*8 square in the search area
  * corresponding to the specified location.
  * \param location location of a node on the map
  * \return index of the square corresponding to the top-left part of the location
  */
 int PathFinding::get_square_index(const Point& location) const {
 
-  const int x8 = location.x / 8;
-  const int y8 = location.y / 8;
-  return y8 * map.get_width8() + x8;
+  const int x8 = (location.x - search_area_origin.x) / 8;
+  const int y8 = (location.y - search_area_origin.y) / 8;
+  return y8 * search_area_size8 + x8;
 }
 
 /**
- * \brief Compares two nodes according to their total estimated cost.
- * \param other the other node
+ * \brief Returns the location on the map of a square of the search area.
+ * \param index index of a square in the search area
+ * \return location of this square on the map
  */
-bool PathFinding::Node::operator<(const Node& other) const {
-  return total_cost < other.total_cost;
+Point PathFinding::get_square_location(int index) const {
+
+  return search_area_origin + Point(
+      (index % search_area_size8) * 8,
+      (index / search_area_size8) * 8
+  );
 }
 
 /**
- * \brief Adds the index of a node to the sorted list of indices of the open
- * list, making sure that the list remains sorted.
- * \param node The node.
+ * \brief Compares two entries of the open list.
+ *
+ * Nodes with the lowest total cost have the highest priority.
+ * For equal costs, the node added the most recently is preferred.
+ *
+ * \param other the other node
+ * \return \c true if this node has a lower priority than the other one
  */
-void PathFinding::add_index_sorted(Node* node) {
-
-  bool inserted = false;
-  for (auto it = open_list_indices.begin();
-      it != open_list_indices.end() && !inserted;
-      ++it) {
-    const int index = *it;
-    const Node* current_node = &open_list[index];
-    if (current_node->total_cost >= node->total_cost) {
-      open_list_indices.insert(it, node->index);
-      inserted = true;
-    }
+bool PathFinding::OpenNode::operator<(const OpenNode& other) const {
+
+  if (total_cost != other.total_cost) {
+    return total_cost > other.total_cost;
   }
+  return order < other.order;
+}
 
-  if (!inserted) {
-    open_list_indices.push_back(node->index);
+/**
+ * \brief Returns whether the terrain of a square of the search area is an
+ * obstacle for the source entity.
+ *
+ * This is computed the first time and then cached for the current search.
+ *
+ * \param index index of a square in the search area
+ * \return the terrain state of this square
+ */
+PathFinding::Terrain PathFinding::get_terrain(int index) {
+
+  Terrain& square_terrain = terrain[index];
+  if (square_terrain == Terrain::UNKNOWN) {
+    const Point& location = get_square_location(index);
+    const int layer = source_entity.get_layer();
+    bool found_diagonal_wall = false;
+    bool obstacle =
+        map.test_collision_with_ground(layer, location.x, location.y, source_entity, found_diagonal_wall) ||
+        map.test_collision_with_ground(layer, location.x + 7, location.y, source_entity, found_diagonal_wall) ||
+        map.test_collision_with_ground(layer, location.x, location.y + 7, source_entity, found_diagonal_wall) ||
+        map.test_collision_with_ground(layer, location.x + 7, location.y + 7, source_entity, found_diagonal_wall);
+
+    if (found_diagonal_wall) {
+      square_terrain = Terrain::DIAGONAL_WALL;
+    }
+    else if (obstacle) {
+      square_terrain = Terrain::OBSTACLE;
+    }
+    else {
+      square_terrain = Terrain::TRAVERSABLE;
+    }
   }
+  return square_terrain;
 }
 
 /**
  * \brief Builds the string representation of the path found by the algorithm.
- * \param closed_list The closed list of A*.
- * \return final_node The final node of the path.
+ * \param final_index Index of the final node of the path.
+ * \return The path.
  */
-std::string PathFinding::rebuild_path(const Node* final_node) {
+std::string PathFinding::rebuild_path(int final_index) const {
 
-  const Node* current_node = final_node;
   std::string path = "";
-  while (current_node->direction != ' ') {
-    path = current_node->direction + path;
-    current_node = &closed_list[current_node->parent_index];
-    //std::cout << "current_node: " << current_node->index << ", path = " << path << std::endl;
+  int index = final_index;
+  while (directions[index] != ' ') {
+    const char direction = directions[index];
+    path += direction;
+    index = get_square_index(get_square_location(index) - neighbours_locations[direction - '0']);
   }
+  std::reverse(path.begin(), path.end());
   return path;
 }
 
 /**
  * \brief Returns whether a transition between two nodes is valid, i.e.
  * whether there is no collision with the map.
- * \param initial_node the first node
+ *
+ * This gives the same result as Map::test_collision_with_obstacles()
+ * on the transition box, except that squares of the terrain are
+ * entirely tested, which makes ground modifier entities not aligned on the
+ * grid a bit more blocking.
+ *
+ * \param location location of the first node
  * \param direction the direction to take (0 to 7)
  * \return true if there is no collision for this transition
  */
-bool PathFinding::is_node_transition_valid(
-    const Node& initial_node, int direction) const {
+bool PathFinding::is_node_transition_valid(const Point& location, int direction) {
 
   Rectangle collision_box = transition_collision_boxes[direction];
-  collision_box.add_xy(initial_node.location);
+  collision_box.add_xy(location);
+
+  const int first_index = get_square_index(collision_box.get_xy());
+  const int width8 = collision_box.get_width() / 8;
+  const int height8 = collision_box.get_height() / 8;
+
+  // Check the terrain of the border of the box.
+  bool found_diagonal_wall = false;
+  bool found_entity = false;
+  for (int j = 0; j < height8; ++j) {
+    for (int i = 0; i < width8; ++i) {
+      const int index = first_index + j * search_area_size8 + i;
+      found_entity |= entities_squares[index];
+      if (i != 0 && i != width8 - 1 && j != 0 && j != height8 - 1) {
+        // Not on the border.
+        continue;
+      }
 
-  return !map.test_collision_with_obstacles(source_entity.get_layer(), collision_box, source_entity);
-}
+      switch (get_terrain(index)) {
+
+      case Terrain::OBSTACLE:
+        return false;
+
+      case Terrain::DIAGONAL_WALL:
+        found_diagonal_wall = true;
+        break;
 
+      default:
+        break;
+      }
+    }
+  }
+
+  if (found_diagonal_wall) {
+    // Diagonal walls need pixel-precise checks: use the full test.
+    return !map.test_collision_with_obstacles(source_entity.get_layer(), collision_box, source_entity);
+  }
+
+  if (!found_entity) {
+    // No entity here.
+    return true;
+  }
+
+  // Check obstacle entities.
+  for (const EntityPtr& entity : obstacle_candidates) {
+    if (entity->overlaps(collision_box) &&
+        entity->is_obstacle_for(source_entity, collision_box)) {
+      return false;
+    }
+  }
+  return true;
 }
 
+}
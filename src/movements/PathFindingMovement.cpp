@@ -31,7 +31,8 @@ namespace Solarus {
 PathFindingMovement::PathFindingMovement(int speed):
   PathMovement("", speed, false, false, true),
   target(),
-  next_recomputation_date(0) {
+  next_recomputation_date(0),
+  max_expanded_nodes(PathFinding::default_max_expanded_nodes) {
 
 }
 
@@ -44,6 +45,28 @@ void PathFindingMovement::set_target(const EntityPtr& target) {
   next_recomputation_date = System::now() + 100;
 }
 
+/**
+ * \brief Returns the maximum number of nodes the path finding algorithm
+ * can explore each time a path is computed.
+ * \return The search budget.
+ */
+int PathFindingMovement::get_max_expanded_nodes() const {
+  return max_expanded_nodes;
+}
+
+/**
+ * \brief Sets the maximum number of nodes the path finding algorithm
+ * can explore each time a path is computed.
+ *
+ * A lower value bounds the time of each computation,
+ * but distant targets might not be found.
+ *
+ * \param max_expanded_nodes The search budget.
+ */
+void PathFindingMovement::set_max_expanded_nodes(int max_expanded_nodes) {
+  this->max_expanded_nodes = max_expanded_nodes;
+}
+
 /**
  * \brief Updates the position.
  */
@@ -81,11 +104,12 @@ void PathFindingMovement::recompute_movement() {
 
   if (target != nullptr) {
     PathFinding path_finding(get_entity()->get_map(), *get_entity(), *target);
+    path_finding.set_max_expanded_nodes(max_expanded_nodes);
     std::string path = path_finding.compute_path();
 
     uint32_t min_delay;
     if (path.size() == 0) {
-      // the target is too far or there is no path
+      // the target is too far, there is no path or it is too costly to find
       path = create_random_path();
 
       // no path was found: no need to try again very soon
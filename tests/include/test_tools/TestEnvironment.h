@@ -58,6 +58,7 @@ class TestEnvironment {
     Entities& get_entities();
     Hero& get_hero();
 
+    void set_starting_map(const std::string& map_id);
     void run_map(const std::string& map_id);
 
     // Creating entities.
@@ -104,6 +104,20 @@ Hero& TestEnvironment::get_hero() {
   return *get_game().get_hero();
 }
 
+/**
+ * \brief Sets the map where the game starts.
+ *
+ * This must be called before the game is created.
+ *
+ * \param map_id Id of the map to open.
+ */
+void TestEnvironment::set_starting_map(const std::string& map_id) {
+
+  Debug::check_assertion(main_loop.get_game() == nullptr, "Game already started");
+
+  this->map_id = map_id;
+}
+
 /**
  * \brief Runs the main loop on the specified map.
  * \param map_id Id of the map to open.
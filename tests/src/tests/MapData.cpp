@@ -75,6 +75,24 @@ void check_map(TestEnvironment& /* env */, const std::string& map_id) {
     Debug::die("Map '" + map_id + "': exported file differs from the original one");
   }
 
+  // Check that the binary format gives the same data.
+  std::string binary_buffer;
+  success = map_data.export_to_binary(binary_buffer);
+  Debug::check_assertion(success, "Map binary export failed");
+  MapData binary_map_data;
+  success = binary_map_data.import_from_binary(binary_buffer);
+  Debug::check_assertion(success, "Map binary import failed");
+  std::string exported_binary_map_buffer;
+  success = binary_map_data.export_to_buffer(exported_binary_map_buffer);
+  Debug::check_assertion(success, "Map export failed");
+  Debug::check_assertion(exported_binary_map_buffer == exported_map_buffer,
+      "Map '" + map_id + "': data differs after binary export/import");
+
+  // Truncated binary data should be rejected.
+  binary_buffer.pop_back();
+  success = binary_map_data.import_from_binary(binary_buffer);
+  Debug::check_assertion(!success, "Map truncated binary import should fail");
+
   // Then export and import every entity of the map.
   for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
     for (int j = 0; j < map_data.get_num_entities(layer); ++j) {
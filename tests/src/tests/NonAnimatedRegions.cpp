@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/Point.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/NonAnimatedRegions.h"
+#include "solarus/graphics/Surface.h"
+#include "test_tools/TestEnvironment.h"
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * Maximum difference allowed on each channel. Renderers may round blended
+ * channels differently from the CPU composition.
+ */
+constexpr int channel_tolerance = 1;
+
+/**
+ * \brief Returns the alpha value of a pixel of a surface.
+ * \param surface A surface.
+ * \param xy Coordinates of a pixel in this surface.
+ * \return The alpha value of this pixel.
+ */
+int get_alpha(const Surface& surface, const Point& xy) {
+
+  const std::string& pixels = surface.get_pixels();
+  const size_t index = (xy.y * surface.get_width() + xy.x) * 4 + 3;
+  return static_cast<uint8_t>(pixels[index]);
+}
+
+/**
+ * \brief Checks that the CPU composition of a cell gives the same pixels as
+ * the renderer.
+ * \param regions The non-animated regions of a layer.
+ * \param layer The layer.
+ * \param cell_index Index of a cell of this layer.
+ */
+void check_cell(const NonAnimatedRegions& regions, int layer, int cell_index) {
+
+  const std::string& cell_name = "cell " + std::to_string(cell_index) +
+      " of layer " + std::to_string(layer);
+
+  const SurfacePtr& composed_surface = regions.compose_cell(cell_index);
+  Debug::check_assertion(composed_surface != nullptr,
+      "Cannot compose " + cell_name + " on the CPU");
+  const SurfacePtr& rendered_surface = regions.render_cell(cell_index);
+
+  const std::string& composed_pixels = composed_surface->get_pixels();
+  const std::string& rendered_pixels = rendered_surface->get_pixels();
+  Debug::check_assertion(composed_pixels.size() == rendered_pixels.size(),
+      "Wrong size of " + cell_name);
+
+  for (size_t i = 0; i < composed_pixels.size(); ++i) {
+    const int composed_channel = static_cast<uint8_t>(composed_pixels[i]);
+    const int rendered_channel = static_cast<uint8_t>(rendered_pixels[i]);
+    if (std::abs(composed_channel - rendered_channel) > channel_tolerance) {
+      const int pixel_index = i / 4;
+      Debug::die("Wrong pixel (" +
+          std::to_string(pixel_index % composed_surface->get_width()) + "," +
+          std::to_string(pixel_index / composed_surface->get_width()) +
+          ") channel " + std::to_string(i % 4) + " in " + cell_name +
+          ": composed " + std::to_string(composed_channel) +
+          ", rendered " + std::to_string(rendered_channel));
+    }
+  }
+}
+
+/**
+ * \brief Composes all cells of a map on the CPU and compares them with the
+ * renderer.
+ *
+ * The map has translucent patterns drawn on opaque and translucent ones,
+ * repeated patterns, animated tiles whose squares are erased from cells and
+ * tiles crossing cell borders.
+ */
+void test_compose_cells(TestEnvironment& env) {
+
+  const Map& map = env.get_map();
+  const Entities& entities = env.get_entities();
+
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    const NonAnimatedRegions* regions = entities.get_non_animated_regions(layer);
+    Debug::check_assertion(regions != nullptr, "Missing non-animated regions");
+    Debug::check_assertion(regions->get_num_cells() == 4, "Wrong number of cells");
+
+    for (int cell_index = 0; cell_index < regions->get_num_cells(); ++cell_index) {
+      check_cell(*regions, layer, cell_index);
+    }
+  }
+
+  // Make sure that the map has what we want to compare.
+  const NonAnimatedRegions& regions = *entities.get_non_animated_regions(0);
+  const SurfacePtr& top_left_cell = regions.compose_cell(0);
+  const SurfacePtr& top_right_cell = regions.compose_cell(1);
+  const SurfacePtr& bottom_left_cell = regions.compose_cell(2);
+  const SurfacePtr& bottom_right_cell = regions.compose_cell(3);
+
+  // Translucent pattern on an opaque one.
+  Debug::check_assertion(get_alpha(*top_left_cell, Point(8, 8)) == 255,
+      "Expected an opaque pixel");
+  // Repeated translucent pattern.
+  const int repeated_alpha = get_alpha(*top_left_cell, Point(13, 69));
+  Debug::check_assertion(repeated_alpha > 0 && repeated_alpha < 255,
+      "Expected a translucent pixel");
+  // Animated square erased.
+  Debug::check_assertion(get_alpha(*top_right_cell, Point(106, 114)) == 0,
+      "Expected an erased pixel");
+  Debug::check_assertion(get_alpha(*top_right_cell, Point(98, 106)) == 255,
+      "Expected an opaque pixel");
+  // Tiles crossing cell borders.
+  Debug::check_assertion(get_alpha(*bottom_right_cell, Point(0, 0)) == 255,
+      "Expected an opaque pixel");
+  Debug::check_assertion(get_alpha(*bottom_left_cell, Point(511, 0)) == 255,
+      "Expected an opaque pixel");
+  Debug::check_assertion(get_alpha(*bottom_left_cell, Point(505, 145)) == 0,
+      "Expected an erased pixel");
+  Debug::check_assertion(get_alpha(*bottom_right_cell, Point(4, 145)) == 0,
+      "Expected an erased pixel");
+}
+
+}
+
+/**
+ * \brief Tests the composition of non-animated tiles on the CPU.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  env.set_starting_map("non_animated_regions_tests");
+
+  test_compose_cells(env);
+
+  return 0;
+}
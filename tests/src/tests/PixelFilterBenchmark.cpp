@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/Hq2xFilter.h"
+#include "solarus/graphics/Hq3xFilter.h"
+#include "solarus/graphics/Hq4xFilter.h"
+#include "solarus/graphics/Scale2xFilter.h"
+#include "solarus/third_party/hqx/common.h"
+#include <SDL_cpuinfo.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int width = 320;
+constexpr int height = 240;
+constexpr int num_frames = 20;
+
+/**
+ * \brief Returns the number of microseconds elapsed since a date.
+ */
+long long get_elapsed_us(const Clock::time_point& start) {
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+/**
+ * \brief Creates an image that looks like pixel art: blocks of a few colors
+ * with some noise, so that all kinds of patterns occur.
+ */
+std::vector<uint32_t> create_image() {
+
+  std::mt19937 random_engine(42);
+  const uint32_t palette[] = {
+      0xFF000000, 0xFFFFFFFF, 0xFF3050A0, 0xFF40A040,
+      0xFFA03030, 0xFFE0C060, 0xFF808080, 0x80FFFFFF
+  };
+  std::uniform_int_distribution<int> color_distribution(0, 7);
+  std::uniform_int_distribution<int> noise_distribution(0, 9);
+
+  std::vector<uint32_t> image(width * height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint32_t color = palette[((x / 8) * 7 + (y / 8) * 3 + (x * y / 64)) % 8];
+      if (noise_distribution(random_engine) == 0) {
+        color = palette[color_distribution(random_engine)];
+      }
+      image[y * width + x] = color;
+    }
+  }
+  return image;
+}
+
+/**
+ * \brief Scale2x as it was implemented before it was vectorized.
+ */
+void scale2x_reference(const uint32_t* src, int src_width, int src_height, uint32_t* dst) {
+
+  const int dst_width = src_width * 2;
+  for (int row = 0; row < src_height; ++row) {
+    for (int col = 0; col < src_width; ++col) {
+      const int e = row * src_width + col;
+      const int b = (row == 0) ? e : e - src_width;
+      const int h = (row == src_height - 1) ? e : e + src_width;
+      const int d = (col == 0) ? e : e - 1;
+      const int f = (col == src_width - 1) ? e : e + 1;
+      const int e1 = row * 2 * dst_width + col * 2;
+      const int e3 = e1 + dst_width;
+
+      if (src[b] != src[h] && src[d] != src[f]) {
+        dst[e1] = src[(src[d] == src[b]) ? d : e];
+        dst[e1 + 1] = src[(src[b] == src[f]) ? f : e];
+        dst[e3] = src[(src[d] == src[h]) ? d : e];
+        dst[e3 + 1] = src[(src[h] == src[f]) ? f : e];
+      }
+      else {
+        dst[e1] = dst[e1 + 1] = dst[e3] = dst[e3 + 1] = src[e];
+      }
+    }
+  }
+}
+
+/**
+ * \brief Creates an RGB to YUV table like hqxInit() does.
+ */
+std::vector<uint32_t> create_yuv_table() {
+
+  std::vector<uint32_t> yuv_table(1 << 24);
+  for (uint32_t c = 0; c < yuv_table.size(); ++c) {
+    const double r = (c >> 16) & 0xFF;
+    const double g = (c >> 8) & 0xFF;
+    const double b = c & 0xFF;
+    const uint32_t y = static_cast<uint32_t>(0.299 * r + 0.587 * g + 0.114 * b);
+    const uint32_t u = static_cast<uint32_t>(static_cast<int>(-0.169 * r - 0.331 * g + 0.5 * b) + 128);
+    const uint32_t v = static_cast<uint32_t>(static_cast<int>(0.5 * r - 0.419 * g - 0.081 * b) + 128);
+    yuv_table[c] = (y << 16) + (u << 8) + v;
+  }
+  return yuv_table;
+}
+
+/**
+ * \brief Checks that the SIMD versions of hqx_pattern() give the same
+ * pattern as the scalar one on a 3x3 block.
+ * \param yuv_table The RGB to YUV table.
+ * \param w The block in w[1..9].
+ * \param avx2 Whether the AVX2 version can run on this CPU.
+ */
+void check_hqx_pattern(const std::vector<uint32_t>& yuv_table, const uint32_t* w, bool avx2) {
+
+  const int expected = hqx_pattern_scalar(yuv_table.data(), w);
+#ifdef HQX_HAVE_SSE2
+  Debug::check_assertion(hqx_pattern_sse2(yuv_table.data(), w) == expected,
+      "hqx: the SSE2 pattern is different from the scalar one");
+#endif
+#ifdef HQX_HAVE_AVX2
+  if (avx2) {
+    Debug::check_assertion(hqx_pattern_avx2(yuv_table.data(), w) == expected,
+        "hqx: the AVX2 pattern is different from the scalar one");
+  }
+#else
+  (void) avx2;
+#endif
+}
+
+/**
+ * \brief Checks hqx_pattern() on all 3x3 blocks of an image, borders
+ * included, and on blocks made to be close to the color thresholds.
+ * \return The number of blocks checked.
+ */
+int check_hqx_patterns(const std::vector<uint32_t>& src, bool avx2) {
+
+  const std::vector<uint32_t> yuv_table = create_yuv_table();
+  uint32_t w[10];
+  int num_blocks = 0;
+
+  // Blocks of the image, with the borders repeated like the filters do.
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      int k = 1;
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          const int sx = std::min(std::max(x + dx, 0), width - 1);
+          const int sy = std::min(std::max(y + dy, 0), height - 1);
+          w[k++] = src[sy * width + sx];
+        }
+      }
+      check_hqx_pattern(yuv_table, w, avx2);
+      ++num_blocks;
+    }
+  }
+
+  // Every pattern with edge colors: extreme values, sign bits, and neighbors
+  // that only differ from the center by their alpha.
+  const uint32_t edge_colors[] = {
+      0x00000000, 0xFFFFFFFF, 0x00FFFFFF, 0xFF000000, 0x80000000, 0x7FFFFFFF,
+      0x00FF0000, 0x0000FF00, 0x000000FF, 0x80808080, 0x7F7F7F7F, 0x01010101
+  };
+  for (uint32_t center : edge_colors) {
+    for (uint32_t other : edge_colors) {
+      for (int pattern = 0; pattern < 256; ++pattern) {
+        w[5] = center;
+        for (int i = 0; i < 8; ++i) {
+          const int k = (i < 4) ? i + 1 : i + 2;
+          w[k] = (pattern & (1 << i)) ? other : (center ^ 0xFF000000);
+        }
+        check_hqx_pattern(yuv_table, w, avx2);
+        ++num_blocks;
+      }
+    }
+  }
+
+  // Neighbors a few levels away from the center on each channel, around the
+  // Y, U and V thresholds.
+  std::mt19937 random_engine(7);
+  std::uniform_int_distribution<uint32_t> color_distribution;
+  std::uniform_int_distribution<int> delta_distribution(-12, 12);
+  for (int i = 0; i < 100000; ++i) {
+    w[5] = color_distribution(random_engine);
+    for (int k = 1; k <= 9; ++k) {
+      if (k == 5) {
+        continue;
+      }
+      uint32_t color = w[5];
+      for (int shift = 0; shift < 32; shift += 8) {
+        const int channel = static_cast<int>((w[5] >> shift) & 0xFF);
+        const int level = std::min(std::max(channel + delta_distribution(random_engine), 0), 255);
+        color = (color & ~(0xFFu << shift)) | (static_cast<uint32_t>(level) << shift);
+      }
+      w[k] = color;
+    }
+    check_hqx_pattern(yuv_table, w, avx2);
+    ++num_blocks;
+  }
+
+  return num_blocks;
+}
+
+/**
+ * \brief Checks Scale2xFilter against the scalar implementation on an image.
+ */
+void check_scale2x(
+    const Scale2xFilter& filter,
+    const std::vector<uint32_t>& src,
+    int src_width,
+    int src_height,
+    const std::string& image_name
+) {
+  std::vector<uint32_t> reference_dst(src.size() * 4);
+  std::vector<uint32_t> dst(reference_dst.size());
+  scale2x_reference(src.data(), src_width, src_height, reference_dst.data());
+  filter.filter(src.data(), src_width, src_height, dst.data());
+  Debug::check_assertion(dst == reference_dst,
+      "Scale2x: different results than the scalar implementation on " + image_name +
+      " " + std::to_string(src_width) + "x" + std::to_string(src_height));
+}
+
+/**
+ * \brief Checks Scale2xFilter on random and edge pattern images of all
+ * small widths, so that the vectorized loop runs with every possible
+ * number of scalar columns after it.
+ */
+void check_scale2x_sizes(const Scale2xFilter& filter) {
+
+  std::mt19937 random_engine(13);
+  std::uniform_int_distribution<uint32_t> color_distribution;
+  std::uniform_int_distribution<int> palette_distribution(0, 2);
+  // Colors that differ in their sign bit only or in their alpha only.
+  const uint32_t palette[] = { 0x80000000, 0x00000000, 0x7FFFFFFF };
+
+  for (int w = 1; w <= 19; ++w) {
+    for (int h : { 1, 2, 3, 8 }) {
+      const int size = w * h;
+      std::vector<uint32_t> random(size);
+      std::vector<uint32_t> few_colors(size);
+      std::vector<uint32_t> uniform(size, 0xFF3050A0);
+      std::vector<uint32_t> checkerboard(size);
+      std::vector<uint32_t> columns(size);
+      std::vector<uint32_t> rows(size);
+      std::vector<uint32_t> diagonals(size);
+      for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+          const int i = y * w + x;
+          random[i] = color_distribution(random_engine);
+          few_colors[i] = palette[palette_distribution(random_engine)];
+          checkerboard[i] = palette[(x + y) % 2];
+          columns[i] = palette[x % 3];
+          rows[i] = palette[y % 2];
+          diagonals[i] = (x == y || x + y == w - 1) ? 0xFFFFFFFF : 0x00FFFFFF;
+        }
+      }
+      check_scale2x(filter, random, w, h, "a random image");
+      check_scale2x(filter, few_colors, w, h, "a random image of 3 colors");
+      check_scale2x(filter, uniform, w, h, "a uniform image");
+      check_scale2x(filter, checkerboard, w, h, "a checkerboard");
+      check_scale2x(filter, columns, w, h, "columns");
+      check_scale2x(filter, rows, w, h, "rows");
+      check_scale2x(filter, diagonals, w, h, "diagonals");
+    }
+  }
+}
+
+/**
+ * \brief Applies a filter several times and returns the time taken.
+ */
+long long run_filter(
+    const SoftwarePixelFilter& filter,
+    const std::vector<uint32_t>& src,
+    std::vector<uint32_t>& dst
+) {
+  const Clock::time_point start = Clock::now();
+  for (int i = 0; i < num_frames; ++i) {
+    filter.filter(src.data(), width, height, dst.data());
+  }
+  return get_elapsed_us(start);
+}
+
+/**
+ * \brief Compares the time taken by a filter with one thread and with
+ * several threads, and checks that the results are the same.
+ */
+void benchmark(
+    const std::string& name,
+    const SoftwarePixelFilter& filter,
+    const std::vector<uint32_t>& src,
+    int num_threads
+) {
+  const int factor = filter.get_scaling_factor();
+  std::vector<uint32_t> single_dst(width * height * factor * factor);
+  std::vector<uint32_t> multi_dst(single_dst.size());
+
+  // Once first to exclude initializations from the measures.
+  filter.filter(src.data(), width, height, single_dst.data());
+
+  SoftwarePixelFilter::set_num_threads(1);
+  const long long single_time = run_filter(filter, src, single_dst);
+  SoftwarePixelFilter::set_num_threads(num_threads);
+  const long long multi_time = run_filter(filter, src, multi_dst);
+
+  Debug::check_assertion(multi_dst == single_dst,
+      name + ": different results with several threads");
+
+  std::cout << std::setw(7) << name << ", "
+            << num_frames << " frames of " << width << "x" << height << ": "
+            << "1 thread " << single_time << " us, "
+            << num_threads << " threads " << multi_time << " us"
+            << std::endl;
+}
+
+}
+
+/**
+ * Compares the performance of software pixel filters with one and several
+ * threads, and checks the vectorized Scale2x and hqx code bit for bit
+ * against the scalar one.
+ */
+int main(int /* argc */, char** /* argv */) {
+
+  const std::vector<uint32_t> src = create_image();
+  const int num_threads = std::max(2, SoftwarePixelFilter::get_num_threads());
+
+  // Vectorized Scale2x.
+  Scale2xFilter scale2x;
+  std::vector<uint32_t> reference_dst(width * height * 4);
+  std::vector<uint32_t> dst(reference_dst.size());
+  SoftwarePixelFilter::set_num_threads(1);
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < num_frames; ++i) {
+    scale2x_reference(src.data(), width, height, reference_dst.data());
+  }
+  const long long reference_time = get_elapsed_us(start);
+  const long long scale2x_time = run_filter(scale2x, src, dst);
+  Debug::check_assertion(dst == reference_dst,
+      "Scale2x: different results than the scalar implementation");
+  std::cout << "Scale2x, " << num_frames << " frames: scalar "
+            << reference_time << " us, Scale2xFilter " << scale2x_time << " us"
+            << std::endl;
+
+  // Random and edge pattern images whose widths are not all multiples of
+  // the vector width.
+  check_scale2x_sizes(scale2x);
+
+  // hqx color difference patterns: each SIMD version against the scalar one.
+  const bool avx2 = SDL_HasAVX2() == SDL_TRUE;
+  const int num_blocks = check_hqx_patterns(src, avx2);
+  std::cout << "hqx patterns: " << num_blocks << " blocks checked against the scalar version"
+#ifdef HQX_HAVE_SSE2
+            << ", SSE2"
+#endif
+#ifdef HQX_HAVE_AVX2
+            << (avx2 ? ", AVX2" : "")
+#endif
+            << std::endl;
+
+  benchmark("Scale2x", scale2x, src, num_threads);
+  benchmark("hq2x", Hq2xFilter(), src, num_threads);
+  benchmark("hq3x", Hq3xFilter(), src, num_threads);
+  benchmark("hq4x", Hq4xFilter(), src, num_threads);
+
+  return 0;
+}
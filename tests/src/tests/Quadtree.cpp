@@ -18,6 +18,7 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Rectangle.h"
 #include "test_tools/TestEnvironment.h"
+#include <algorithm>
 #include <memory>
 #include <sstream>
 
@@ -154,6 +155,43 @@ void test_add(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree) {
   check_found(found_elements, added_elements[4]);
 }
 
+/**
+ * \brief Tests getting elements into a vector provided by the caller.
+ */
+void test_get_elements_vector(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree) {
+
+  // Elements overlapping several cells must be found only once.
+  ElementPtr big_element = add(quadtree, Box(0, 0, 1280, 16));
+
+  std::vector<ElementPtr> found_elements = { big_element };
+  quadtree.get_elements(Box(0, 0, 1280, 960), found_elements);
+  Debug::check_assertion(std::count(found_elements.begin(), found_elements.end(), big_element) == 1,
+      "Expected the element once");
+  Debug::check_assertion(static_cast<int>(found_elements.size()) == quadtree.get_num_elements(),
+      "Expected all elements");
+
+  // The same vector can be used again.
+  quadtree.get_elements(Box(220, 10, 100, 100), found_elements);
+  Debug::check_assertion(found_elements.size() == 4, "Expected 4 elements found");
+  check_found(found_elements, big_element);
+
+  remove(quadtree, big_element);
+}
+
+/**
+ * \brief Tests visiting elements.
+ */
+void test_visit_elements(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree) {
+
+  Box region(220, 10, 100, 100);
+  std::vector<ElementPtr> expected_elements = quadtree.get_elements(region);
+  std::vector<ElementPtr> visited_elements;
+  quadtree.visit_elements(region, [&visited_elements](const ElementPtr& element) {
+    visited_elements.push_back(element);
+  });
+  Debug::check_assertion(visited_elements == expected_elements, "Wrong visited elements");
+}
+
 /**
  * \brief Tests removing elements from a quadtree.
  */
@@ -249,6 +287,8 @@ int main(int argc, char** argv) {
 
   test_empty(env, quadtree);
   test_add(env, quadtree);
+  test_get_elements_vector(env, quadtree);
+  test_visit_elements(env, quadtree);
   test_add_big_size(env, quadtree);
   test_add_limit(env, quadtree);
   test_add_center_outside(env, quadtree);
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/Quadtree.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/Rectangle.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace Solarus;
+
+using Box = Solarus::Rectangle;
+
+namespace {
+
+using ElementPtr = std::shared_ptr<int>;
+using Clock = std::chrono::steady_clock;
+
+constexpr int map_width = 2560;
+constexpr int map_height = 2560;
+constexpr int num_queries = 20000;
+
+/**
+ * \brief Gets elements like Quadtree::get_elements() did before it
+ * supported caller-provided vectors: duplicates are removed with a set
+ * and the set is then copied into a new vector.
+ */
+std::vector<ElementPtr> get_elements_with_set(
+    const Quadtree<ElementPtr>& quadtree,
+    const Box& region
+) {
+  std::set<ElementPtr> element_set;
+  quadtree.visit_elements(region, [&element_set](const ElementPtr& element) {
+    element_set.insert(element);
+  });
+  return std::vector<ElementPtr>(element_set.begin(), element_set.end());
+}
+
+/**
+ * \brief Returns the number of microseconds elapsed since a date.
+ */
+long long get_elapsed_us(const Clock::time_point& start) {
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+/**
+ * \brief Runs the same queries with the three ways of querying the quadtree
+ * and prints the time taken by each one, as well as the time taken to move
+ * all elements.
+ */
+void benchmark(int num_elements) {
+
+  std::mt19937 random_engine(42);
+  std::uniform_int_distribution<int> x_distribution(0, map_width - 32);
+  std::uniform_int_distribution<int> y_distribution(0, map_height - 32);
+  std::uniform_int_distribution<int> size_distribution(8, 32);
+
+  const int margin = 64;
+  Quadtree<ElementPtr> quadtree(Box(-margin, -margin, map_width + 2 * margin, map_height + 2 * margin));
+  std::vector<ElementPtr> elements;
+  std::vector<Box> boxes;
+  for (int i = 0; i < num_elements; ++i) {
+    ElementPtr element = std::make_shared<int>(i);
+    Box box(x_distribution(random_engine), y_distribution(random_engine),
+            size_distribution(random_engine), size_distribution(random_engine));
+    quadtree.add(element, box);
+    elements.push_back(element);
+    boxes.push_back(box);
+  }
+
+  // Boxes similar to the ones of collision checks (entity box extended by 8 pixels).
+  std::vector<Box> regions;
+  for (int i = 0; i < num_queries; ++i) {
+    regions.emplace_back(x_distribution(random_engine), y_distribution(random_engine), 32, 32);
+  }
+
+  // Previous implementation.
+  size_t num_found_with_set = 0;
+  Clock::time_point start = Clock::now();
+  for (const Box& region : regions) {
+    num_found_with_set += get_elements_with_set(quadtree, region).size();
+  }
+  const long long set_time = get_elapsed_us(start);
+
+  // Caller-provided vector.
+  size_t num_found_with_vector = 0;
+  std::vector<ElementPtr> result;
+  start = Clock::now();
+  for (const Box& region : regions) {
+    quadtree.get_elements(region, result);
+    num_found_with_vector += result.size();
+  }
+  const long long vector_time = get_elapsed_us(start);
+
+  // Visitor.
+  size_t num_found_with_visitor = 0;
+  start = Clock::now();
+  for (const Box& region : regions) {
+    quadtree.visit_elements(region, [&num_found_with_visitor](const ElementPtr&) {
+      ++num_found_with_visitor;
+    });
+  }
+  const long long visitor_time = get_elapsed_us(start);
+
+  // Moves, like entities walking one pixel per tick.
+  const int num_moves = 20;
+  start = Clock::now();
+  for (int i = 0; i < num_moves; ++i) {
+    const Point offset = (i % 2 == 0) ? Point(1, 1) : Point(-1, -1);
+    for (int j = 0; j < num_elements; ++j) {
+      boxes[j].add_xy(offset);
+      quadtree.move(elements[j], boxes[j]);
+    }
+  }
+  const long long move_time = get_elapsed_us(start);
+
+  Debug::check_assertion(quadtree.get_num_elements() == num_elements,
+      "Wrong number of elements after moves");
+  Debug::check_assertion(num_found_with_vector == num_found_with_set,
+      "Different results with a set and with a vector");
+  Debug::check_assertion(num_found_with_visitor == num_found_with_set,
+      "Different results with a set and with a visitor");
+
+  std::cout << std::setw(6) << num_elements << " elements, "
+            << num_queries << " queries: "
+            << "set " << set_time << " us, "
+            << "vector " << vector_time << " us, "
+            << "visitor " << visitor_time << " us ("
+            << num_found_with_set << " elements found), "
+            << num_moves << " moves of each element: "
+            << move_time << " us"
+            << std::endl;
+}
+
+}
+
+/**
+ * Compares the performance of quadtree queries and moves.
+ */
+int main(int /* argc */, char** /* argv */) {
+
+  benchmark(100);
+  benchmark(1000);
+  benchmark(10000);
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Point.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include "test_tools/TestEnvironment.h"
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Ends the current frame and checks the renderer calls counted.
+ * \param frame_surface A surface to render as the quest screen.
+ * \param expected_copies Expected number of texture copies in the frame.
+ * \param expected_switches Expected number of render target switches.
+ */
+void check_frame(
+    const SurfacePtr& frame_surface,
+    int expected_copies,
+    int expected_switches) {
+
+  Video::render(frame_surface);
+  Debug::check_assertion(Video::get_num_render_copies() == expected_copies,
+      "Expected " + std::to_string(expected_copies) + " copies, got " +
+      std::to_string(Video::get_num_render_copies()));
+  Debug::check_assertion(Video::get_num_render_target_switches() == expected_switches,
+      "Expected " + std::to_string(expected_switches) + " target switches, got " +
+      std::to_string(Video::get_num_render_target_switches()));
+}
+
+/**
+ * \brief Checks that several draws to the same surface only set the
+ * render target once.
+ */
+void test_same_target(const SurfacePtr& frame_surface) {
+
+  // The render target is left on the source surface.
+  SurfacePtr dst_surface = Surface::create(64, 64);
+  SurfacePtr src_surface = Surface::create(16, 16);
+  src_surface->fill_with_color(Color::red);
+  Video::render(frame_surface);  // Start a new frame.
+
+  for (int i = 0; i < 4; ++i) {
+    src_surface->draw(dst_surface, Point(i * 16, 0));
+  }
+  dst_surface->get_internal_surface().get_texture();  // Flush the draws.
+  check_frame(frame_surface, 4, 1);
+
+  // Nothing drawn: nothing counted.
+  check_frame(frame_surface, 0, 0);
+}
+
+/**
+ * \brief Checks that alternating destination surfaces switches the
+ * render target each time.
+ */
+void test_alternate_targets(const SurfacePtr& frame_surface) {
+
+  SurfacePtr src_surface = Surface::create(16, 16);
+  SurfacePtr dst_surface_1 = Surface::create(32, 32);
+  SurfacePtr dst_surface_2 = Surface::create(32, 32);
+  src_surface->fill_with_color(Color::blue);
+  Video::render(frame_surface);  // Start a new frame.
+
+  src_surface->draw(dst_surface_1, Point(0, 0));
+  src_surface->draw(dst_surface_2, Point(0, 0));
+  src_surface->draw(dst_surface_1, Point(16, 16));
+  dst_surface_1->get_internal_surface().get_texture();  // Flush the draws.
+  check_frame(frame_surface, 3, 3);
+}
+
+}
+
+/**
+ * \brief Tests the renderer calls counted by Video in each frame.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  SurfacePtr frame_surface = Surface::create(Video::get_quest_size());
+  test_same_target(frame_surface);
+  test_alternate_targets(frame_surface);
+
+  return 0;
+}
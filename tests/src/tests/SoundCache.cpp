@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/SoundCache.h"
+#include "solarus/core/Debug.h"
+#include "test_tools/TestEnvironment.h"
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks the total size and the number of sounds of a cache.
+ */
+void check_size(const SoundCache& cache, size_t expected_size, size_t expected_num_sounds) {
+
+  if (cache.get_size() != expected_size ||
+      cache.get_num_sounds() != expected_num_sounds) {
+    std::ostringstream oss;
+    oss << "Wrong cache content: expected " << expected_num_sounds << " sounds of "
+        << expected_size << " bytes, got " << cache.get_num_sounds() << " sounds of "
+        << cache.get_size() << " bytes";
+    Debug::die(oss.str());
+  }
+}
+
+/**
+ * \brief Checks the sounds evicted by a call to shrink().
+ */
+void check_evicted(
+    const std::vector<std::string>& evicted_sounds,
+    const std::vector<std::string>& expected) {
+
+  Debug::check_assertion(evicted_sounds == expected, "Unexpected sounds evicted");
+}
+
+/**
+ * \brief Returns a function that allows to evict any sound.
+ */
+std::function<bool (const std::string&)> any_sound() {
+  return [](const std::string&) { return true; };
+}
+
+/**
+ * \brief Tests adding and removing sounds.
+ */
+void test_add_remove(TestEnvironment& /* env */) {
+
+  SoundCache cache(1000);
+  check_size(cache, 0, 0);
+
+  cache.add("a", 100);
+  cache.add("b", 250);
+  check_size(cache, 350, 2);
+  Debug::check_assertion(cache.contains("a"), "Sound 'a' not in the cache");
+  Debug::check_assertion(!cache.contains("c"), "Sound 'c' in the cache");
+
+  cache.remove("a");
+  check_size(cache, 250, 1);
+  cache.remove("a");  // Not in the cache: nothing happens.
+  check_size(cache, 250, 1);
+
+  // Nothing to evict while the cache fits.
+  check_evicted(cache.shrink(any_sound()), {});
+  check_size(cache, 250, 1);
+}
+
+/**
+ * \brief Tests that the least recently used sounds are evicted until the
+ * total size in bytes fits.
+ */
+void test_evict_by_size(TestEnvironment& /* env */) {
+
+  SoundCache cache(1000);
+  cache.add("a", 400);
+  cache.add("b", 300);
+  cache.add("c", 200);
+  cache.add("d", 300);
+  check_size(cache, 1200, 4);
+
+  // 200 bytes too many: evicting 'a' is enough.
+  check_evicted(cache.shrink(any_sound()), { "a" });
+  check_size(cache, 800, 3);
+
+  // A smaller budget evicts several sounds, the oldest first.
+  cache.set_max_size(300);
+  check_evicted(cache.shrink(any_sound()), { "b", "c" });
+  check_size(cache, 300, 1);
+  Debug::check_assertion(cache.contains("d"), "Sound 'd' evicted");
+
+  // A sound bigger than the whole budget does not stay.
+  cache.add("e", 500);
+  check_evicted(cache.shrink(any_sound()), { "d", "e" });
+  check_size(cache, 0, 0);
+
+  // A budget of zero empties the cache.
+  cache.set_max_size(0);
+  cache.add("f", 1);
+  check_evicted(cache.shrink(any_sound()), { "f" });
+  check_size(cache, 0, 0);
+}
+
+/**
+ * \brief Tests that recently used sounds are evicted last.
+ */
+void test_touch(TestEnvironment& /* env */) {
+
+  SoundCache cache(1000);
+  cache.add("a", 300);
+  cache.add("b", 300);
+  cache.add("c", 300);
+
+  cache.touch("a");
+  cache.touch("no_such_sound");  // Not in the cache: nothing happens.
+  check_size(cache, 900, 3);
+
+  cache.set_max_size(600);
+  check_evicted(cache.shrink(any_sound()), { "b" });
+
+  cache.touch("c");
+  cache.set_max_size(300);
+  check_evicted(cache.shrink(any_sound()), { "a" });
+  Debug::check_assertion(cache.contains("c"), "Sound 'c' evicted");
+}
+
+/**
+ * \brief Tests that sounds that cannot be evicted are kept, even if the
+ * cache is still too big.
+ */
+void test_keep_playing_sounds(TestEnvironment& /* env */) {
+
+  SoundCache cache(1000);
+  cache.add("a", 400);
+  cache.add("b", 400);
+  cache.add("c", 400);
+
+  std::set<std::string> playing_sounds = { "a" };
+  const auto not_playing = [&playing_sounds](const std::string& sound_id) {
+    return playing_sounds.find(sound_id) == playing_sounds.end();
+  };
+
+  // 'a' is the oldest one but is playing.
+  check_evicted(cache.shrink(not_playing), { "b" });
+  check_size(cache, 800, 2);
+
+  // Everything is playing: the cache stays too big.
+  playing_sounds = { "a", "c" };
+  cache.set_max_size(100);
+  check_evicted(cache.shrink(not_playing), {});
+  check_size(cache, 800, 2);
+
+  // Once finished, they are evicted.
+  playing_sounds.clear();
+  check_evicted(cache.shrink(not_playing), { "a", "c" });
+  check_size(cache, 0, 0);
+}
+
+}
+
+/**
+ * \brief Tests the cache of decoded sounds.
+ *
+ * It does not need an audio device.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_add_remove(env);
+  test_evict_by_size(env);
+  test_touch(env);
+  test_keep_playing_sounds(env);
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/SoundDecoder.h"
+#include "solarus/core/Debug.h"
+#include "test_tools/TestEnvironment.h"
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+using DecodedSound = SoundDecoder::DecodedSound;
+
+/**
+ * \brief Waits until a decoder has produced a number of sounds.
+ * \return The decoded sounds by id.
+ */
+std::map<std::string, DecodedSound> wait_decoded_sounds(
+    SoundDecoder& decoder,
+    size_t num_sounds) {
+
+  std::map<std::string, DecodedSound> sounds;
+  const auto start = std::chrono::steady_clock::now();
+  while (sounds.size() < num_sounds) {
+    for (DecodedSound& sound: decoder.take_decoded_sounds()) {
+      Debug::check_assertion(sounds.find(sound.id) == sounds.end(),
+          "Sound '" + sound.id + "' decoded twice");
+      sounds[sound.id] = std::move(sound);
+    }
+    Debug::check_assertion(std::chrono::steady_clock::now() - start < std::chrono::seconds(30),
+        "Timeout while decoding sounds");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return sounds;
+}
+
+/**
+ * \brief Checks that a sound was decoded into stereo 16-bit samples.
+ */
+void check_decoded(const DecodedSound& sound) {
+
+  Debug::check_assertion(sound.error.empty(),
+      "Failed to decode sound '" + sound.id + "': " + sound.error);
+  Debug::check_assertion(!sound.samples.empty(), "No samples in sound '" + sound.id + "'");
+  Debug::check_assertion(sound.samples.size() % 4 == 0,
+      "Samples of sound '" + sound.id + "' are not stereo 16-bit");
+  Debug::check_assertion(sound.sample_rate > 0, "No sample rate in sound '" + sound.id + "'");
+}
+
+/**
+ * \brief Tests decoding a file on the calling thread.
+ */
+void test_decode_file(TestEnvironment& /* env */) {
+
+  DecodedSound sound;
+  sound.id = "bomb";
+  SoundDecoder::decode_file("sounds/bomb.ogg", sound);
+  check_decoded(sound);
+
+  DecodedSound missing_sound;
+  missing_sound.id = "no_such_sound";
+  SoundDecoder::decode_file("sounds/no_such_sound.ogg", missing_sound);
+  Debug::check_assertion(!missing_sound.error.empty(), "Missing sound decoded");
+  Debug::check_assertion(missing_sound.samples.empty(), "Samples in a missing sound");
+}
+
+/**
+ * \brief Tests decoding sounds with a pool of threads.
+ */
+void test_threads(TestEnvironment& /* env */) {
+
+  const std::vector<std::string> sound_ids = {
+      "bomb", "boomerang", "bounce", "bow", "bush", "cane", "chest_open", "cursor"
+  };
+
+  SoundDecoder decoder;
+  Debug::check_assertion(!decoder.is_started(), "Decoder started too early");
+  decoder.start(2);
+  Debug::check_assertion(decoder.is_started(), "Decoder not started");
+
+  for (const std::string& sound_id: sound_ids) {
+    decoder.request(sound_id, false);
+  }
+  decoder.request("no_such_sound", true);
+  decoder.make_urgent("cursor");
+
+  std::map<std::string, DecodedSound> sounds =
+      wait_decoded_sounds(decoder, sound_ids.size() + 1);
+  Debug::check_assertion(sounds.size() == sound_ids.size() + 1, "Wrong number of decoded sounds");
+
+  // Each sound gives the same samples as when decoded on the calling thread.
+  for (const std::string& sound_id: sound_ids) {
+    Debug::check_assertion(sounds.find(sound_id) != sounds.end(),
+        "Sound '" + sound_id + "' not decoded");
+    const DecodedSound& sound = sounds[sound_id];
+    check_decoded(sound);
+
+    DecodedSound expected;
+    SoundDecoder::decode_file("sounds/" + sound_id + ".ogg", expected);
+    Debug::check_assertion(sound.samples == expected.samples,
+        "Different samples for sound '" + sound_id + "' decoded in a thread");
+    Debug::check_assertion(sound.sample_rate == expected.sample_rate,
+        "Different sample rate for sound '" + sound_id + "' decoded in a thread");
+  }
+
+  // Errors are reported through the results.
+  Debug::check_assertion(!sounds["no_such_sound"].error.empty(), "Missing sound decoded");
+
+  // Nothing more.
+  Debug::check_assertion(decoder.take_decoded_sounds().empty(), "Sounds decoded twice");
+
+  decoder.stop();
+  Debug::check_assertion(!decoder.is_started(), "Decoder not stopped");
+
+  // The decoder can be started again.
+  decoder.start(1);
+  decoder.request("bomb", false);
+  sounds = wait_decoded_sounds(decoder, 1);
+  check_decoded(sounds["bomb"]);
+}
+
+}
+
+/**
+ * \brief Tests the threads that decode sounds.
+ *
+ * It does not need an audio device.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_decode_file(env);
+  test_threads(env);
+
+  return 0;
+}
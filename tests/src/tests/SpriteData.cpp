@@ -53,6 +53,24 @@ void check_sprite(TestEnvironment& /* env */, const std::string& sprite_id) {
         << "*** Exported sprite file:" << std::endl << exported_sprite_buffer << std::endl;
     Debug::die("Sprite '" + sprite_id + "': exported file differs from the original one");
   }
+
+  // Check that the binary format gives the same data.
+  std::string binary_buffer;
+  success = sprite_data.export_to_binary(binary_buffer);
+  Debug::check_assertion(success, "Sprite binary export failed");
+  SpriteData binary_sprite_data;
+  success = binary_sprite_data.import_from_binary(binary_buffer);
+  Debug::check_assertion(success, "Sprite binary import failed");
+  std::string exported_binary_sprite_buffer;
+  success = binary_sprite_data.export_to_buffer(exported_binary_sprite_buffer);
+  Debug::check_assertion(success, "Sprite export failed");
+  Debug::check_assertion(exported_binary_sprite_buffer == exported_sprite_buffer,
+      "Sprite '" + sprite_id + "': data differs after binary export/import");
+
+  // Truncated binary data should be rejected.
+  binary_buffer.pop_back();
+  success = binary_sprite_data.import_from_binary(binary_buffer);
+  Debug::check_assertion(!success, "Sprite truncated binary import should fail");
 }
 
 }
@@ -52,6 +52,24 @@ void check_tileset(TestEnvironment& /* env */, const std::string& tileset_id) {
         << "*** Exported tileset file:" << std::endl << exported_tileset_buffer << std::endl;
     Debug::die("Tileset '" + tileset_id + "': exported file differs from the original one");
   }
+
+  // Check that the binary format gives the same data.
+  std::string binary_buffer;
+  success = tileset_data.export_to_binary(binary_buffer);
+  Debug::check_assertion(success, "Tileset binary export failed");
+  TilesetData binary_tileset_data;
+  success = binary_tileset_data.import_from_binary(binary_buffer);
+  Debug::check_assertion(success, "Tileset binary import failed");
+  std::string exported_binary_tileset_buffer;
+  success = binary_tileset_data.export_to_buffer(exported_binary_tileset_buffer);
+  Debug::check_assertion(success, "Tileset export failed");
+  Debug::check_assertion(exported_binary_tileset_buffer == exported_tileset_buffer,
+      "Tileset '" + tileset_id + "': data differs after binary export/import");
+
+  // Truncated binary data should be rejected.
+  binary_buffer.pop_back();
+  success = binary_tileset_data.import_from_binary(binary_buffer);
+  Debug::check_assertion(!success, "Tileset truncated binary import should fail");
 }
 
 }
@@ -0,0 +1,29 @@
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  -- Sound cache size.
+  assert(sol.audio.get_sound_cache_size() == 64 * 1024 * 1024)
+  sol.audio.set_sound_cache_size(1024 * 1024)
+  assert(sol.audio.get_sound_cache_size() == 1024 * 1024)
+  sol.audio.set_sound_cache_size(0)
+  assert(sol.audio.get_sound_cache_size() == 0)
+  assert(not pcall(sol.audio.set_sound_cache_size, -1))
+  assert(sol.audio.get_sound_cache_size() == 0)
+  sol.audio.set_sound_cache_size(64 * 1024 * 1024)
+
+  -- Preloading some sounds only.
+  sol.audio.preload_sounds({ "bomb", "boomerang" })
+  sol.audio.preload_sounds({})
+  assert(not pcall(sol.audio.preload_sounds, { "bomb", "no_such_sound" }))
+  assert(not pcall(sol.audio.preload_sounds, "bomb"))
+  sol.audio.play_sound("bomb")
+
+  -- Preloading all sounds.
+  sol.audio.preload_sounds()
+  sol.audio.play_sound("boomerang")
+
+  sol.timer.start(map, 100, function()
+    sol.main.exit()
+  end)
+end
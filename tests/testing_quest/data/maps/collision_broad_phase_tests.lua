@@ -0,0 +1,63 @@
+local map = ...
+
+local num_bullets = 8
+local bullets_detected = {}
+local num_bullets_detected = 0
+local target_detected = false
+
+function map:on_started()
+
+  assert(not map:is_collision_broad_phase_enabled())
+  map:set_collision_broad_phase_enabled()
+  assert(map:is_collision_broad_phase_enabled())
+  map:set_collision_broad_phase_enabled(false)
+  assert(not map:is_collision_broad_phase_enabled())
+  map:set_collision_broad_phase_enabled(true)
+  assert(map:is_collision_broad_phase_enabled())
+
+  -- Static detector hit by moving entities.
+  target:add_collision_test("overlapping", function(_, other)
+    if other:get_type() == "custom_entity" and other ~= moving_detector then
+      if not bullets_detected[other] then
+        bullets_detected[other] = true
+        num_bullets_detected = num_bullets_detected + 1
+      end
+    end
+  end)
+
+  for i = 1, num_bullets do
+    local angle = i * 2 * math.pi / num_bullets
+    local bullet = map:create_custom_entity({
+      layer = 0,
+      x = 160 + math.floor(64 * math.cos(angle)),
+      y = 125 - math.floor(64 * math.sin(angle)),
+      width = 8,
+      height = 8,
+      direction = 0,
+    })
+    local movement = sol.movement.create("target")
+    movement:set_target(target)
+    movement:set_speed(64)
+    movement:set_ignore_obstacles(true)
+    movement:start(bullet)
+  end
+
+  -- Moving detector hitting a static entity.
+  moving_detector:add_collision_test("overlapping", function(_, other)
+    if other == target then
+      target_detected = true
+    end
+  end)
+  local movement = sol.movement.create("straight")
+  movement:set_angle(math.pi / 2)
+  movement:set_speed(64)
+  movement:set_max_distance(96)
+  movement:set_ignore_obstacles(true)
+  movement:start(moving_detector)
+
+  sol.timer.start(map, 2000, function()
+    assert(num_bullets_detected == num_bullets)
+    assert(target_detected)
+    sol.main.exit()
+  end)
+end
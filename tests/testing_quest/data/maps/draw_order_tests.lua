@@ -0,0 +1,201 @@
+local map = ...
+
+-- Squares that record the order in which they are drawn.
+local squares = {}
+local drawn_names = {}
+
+local function create_square(name, x, y, color)
+
+  local square = map:create_custom_entity({
+    name = name,
+    x = x,
+    y = y,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  square:set_drawn_in_y_order(true)
+  square.color = color
+
+  local surface = sol.surface.create(16, 16)
+  surface:fill_color(color)
+
+  function square:on_pre_draw()
+    if square.next_y ~= nil then
+      -- Move during drawing.
+      local square_x = square:get_position()
+      square:set_position(square_x, square.next_y)
+      square.next_y = nil
+    end
+    drawn_names[#drawn_names + 1] = name
+    local box_x, box_y = square:get_bounding_box()
+    map:draw_visual(surface, box_x, box_y)
+  end
+
+  squares[name] = square
+end
+
+-- Checks that squares were drawn in the expected order.
+local function check_draw_order(expected)
+  assert_equal(table.concat(drawn_names, " "), table.concat(expected, " "))
+end
+
+-- Checks that the bottom-right pixel of each square drawn shows the last
+-- square drawn there.
+local function check_pixels(dst_surface, expected)
+
+  local camera_x, camera_y = map:get_camera():get_position()
+  local width = dst_surface:get_size()
+  local pixels = dst_surface:get_pixels()
+  for _, name in ipairs(expected) do
+    local x, y, square_width, square_height = squares[name]:get_bounding_box()
+    x, y = x + square_width - 1, y + square_height - 1
+
+    local front_name
+    for _, other_name in ipairs(expected) do
+      local other_x, other_y, other_width, other_height = squares[other_name]:get_bounding_box()
+      if x >= other_x and x < other_x + other_width and
+          y >= other_y and y < other_y + other_height then
+        front_name = other_name
+      end
+    end
+
+    local index = ((y - camera_y) * width + x - camera_x) * 4
+    local r, g, b = pixels:byte(index + 1, index + 3)
+    local color = squares[front_name].color
+    assert_equal(r, color[1])
+    assert_equal(g, color[2])
+    assert_equal(b, color[3])
+  end
+end
+
+-- Each step changes the map and gives the order of the next frame.
+local steps = {
+  {
+    apply = function() end,
+    expected = { "a", "b", "c" },
+  },
+  {
+    -- Moving in Y.
+    apply = function()
+      squares.a:set_position(40, 52)
+    end,
+    expected = { "b", "c", "a" },
+  },
+  {
+    -- Changing the layer.
+    apply = function()
+      squares.b:set_layer(1)
+    end,
+    expected = { "c", "a", "b" },
+  },
+  {
+    apply = function()
+      squares.b:set_layer(0)
+    end,
+    expected = { "b", "c", "a" },
+  },
+  {
+    -- Entities not drawn in Y order are drawn first.
+    apply = function()
+      squares.c:set_drawn_in_y_order(false)
+    end,
+    expected = { "c", "b", "a" },
+  },
+  {
+    -- Bringing to front.
+    apply = function()
+      squares.a:set_drawn_in_y_order(false)
+      squares.b:set_drawn_in_y_order(false)
+      squares.a:bring_to_front()
+      squares.b:bring_to_front()
+      squares.c:bring_to_front()
+    end,
+    expected = { "a", "b", "c" },
+  },
+  {
+    apply = function()
+      squares.a:bring_to_front()
+    end,
+    expected = { "b", "c", "a" },
+  },
+  {
+    -- Bringing to back.
+    apply = function()
+      squares.a:bring_to_back()
+      squares.c:bring_to_back()
+    end,
+    expected = { "c", "a", "b" },
+  },
+  {
+    apply = function()
+      squares.a:set_drawn_in_y_order(true)
+      squares.b:set_drawn_in_y_order(true)
+      squares.c:set_drawn_in_y_order(true)
+    end,
+    expected = { "b", "c", "a" },
+  },
+  {
+    -- Jumping beyond the draw region.
+    apply = function()
+      local camera = map:get_camera()
+      camera:start_manual()
+      camera:set_position(2000, 0)
+    end,
+    expected = { "d" },
+  },
+  {
+    apply = function()
+      map:get_camera():set_position(0, 0)
+    end,
+    expected = { "b", "c", "a" },
+  },
+  {
+    -- Moving during drawing: the order changes at the next frame.
+    apply = function()
+      squares.a.next_y = 36
+    end,
+    expected = { "b", "c", "a" },
+  },
+  {
+    apply = function() end,
+    expected = { "a", "b", "c" },
+  },
+}
+
+local started = false
+local step_index = 0
+
+function map:on_started()
+
+  create_square("a", 40, 40, { 255, 0, 0 })
+  create_square("b", 40, 44, { 0, 255, 0 })
+  create_square("c", 40, 48, { 0, 0, 255 })
+  create_square("d", 2100, 60, { 255, 255, 0 })
+end
+
+function map:on_opening_transition_finished()
+  started = true
+end
+
+function map:on_draw(dst_surface)
+
+  if not started then
+    return
+  end
+
+  if step_index > 0 then
+    local expected = steps[step_index].expected
+    check_draw_order(expected)
+    check_pixels(dst_surface, expected)
+  end
+
+  drawn_names = {}
+  step_index = step_index + 1
+  if steps[step_index] == nil then
+    sol.main.exit()
+    return
+  end
+  steps[step_index].apply()
+end
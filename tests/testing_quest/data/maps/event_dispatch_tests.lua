@@ -0,0 +1,127 @@
+local map = ...
+
+local entity = map:create_custom_entity({
+  x = 160,
+  y = 80,
+  layer = 0,
+  direction = 0,
+  width = 16,
+  height = 16,
+})
+local custom_entity_meta = sol.main.get_metatable("custom_entity")
+local num_calls = 0
+
+-- Waits a bit and checks whether on_update() was called in the meantime.
+local function check_called(expected_called, next_test)
+
+  num_calls = 0
+  sol.timer.start(map, 100, function()
+    assert((num_calls > 0) == expected_called)
+    next_test()
+  end)
+end
+
+-- Events defined on the entity itself are called until they are removed.
+local function test_entity_event(next_test)
+
+  function entity:on_update()
+    num_calls = num_calls + 1
+  end
+  check_called(true, function()
+    entity.on_update = nil
+    check_called(false, next_test)
+  end)
+end
+
+-- Events set with rawset() in the metatable of the type are called too.
+local function test_rawset_metatable_event(next_test)
+
+  rawset(custom_entity_meta, "on_update", function(self)
+    if self == entity then
+      num_calls = num_calls + 1
+    end
+  end)
+  check_called(true, function()
+    rawset(custom_entity_meta, "on_update", nil)
+    check_called(false, next_test)
+  end)
+end
+
+-- Events are still called after scripts replace the metatable of the
+-- metatable of a type.
+local function test_replaced_metatable_event(next_test)
+
+  local enemy = map:create_enemy({
+    breed = "test_enemy",
+    x = 40,
+    y = 40,
+    layer = 0,
+    direction = 0,
+  })
+  local enemy_meta = sol.main.get_metatable("enemy")
+  setmetatable(enemy_meta, {})
+  function enemy_meta:on_update()
+    if self == enemy then
+      num_calls = num_calls + 1
+    end
+  end
+  check_called(true, function()
+    enemy_meta.on_update = nil
+    enemy:remove()
+    check_called(false, next_test)
+  end)
+end
+
+-- Events defined later in the metatable of the type are called too.
+local function test_metatable_event(next_test)
+
+  function custom_entity_meta:on_update()
+    if self == entity then
+      num_calls = num_calls + 1
+    end
+  end
+  check_called(true, function()
+    custom_entity_meta.on_update = nil
+    check_called(false, function()
+      -- Defining it again in the metatable works as well.
+      custom_entity_meta.on_update = function()
+        num_calls = num_calls + 1
+      end
+      check_called(true, function()
+        custom_entity_meta.on_update = nil
+        next_test()
+      end)
+    end)
+  end)
+end
+
+-- Events defined in the metatable of another type are not called.
+local function test_other_metatable_event(next_test)
+
+  local npc_meta = sol.main.get_metatable("npc")
+  function npc_meta:on_update()
+    if self == entity then
+      num_calls = num_calls + 1
+    end
+  end
+  assert(npc_meta.on_update ~= nil)
+  check_called(false, function()
+    npc_meta.on_update = nil
+    next_test()
+  end)
+end
+
+function map:on_opening_transition_finished()
+
+  test_entity_event(function()
+    test_rawset_metatable_event(function()
+      test_replaced_metatable_event(function()
+        test_metatable_event(function()
+          test_other_metatable_event(function()
+            sol.main.exit()
+          end)
+        end)
+      end)
+    end)
+  end)
+end
@@ -0,0 +1,32 @@
+local map = ...
+local game = map:get_game()
+local hero = map:get_hero()
+
+function game:on_map_changed(new_map)
+
+  if new_map:get_id() ~= "all_entities" then
+    return
+  end
+
+  -- The preloaded map is complete.
+  local num_entities = 0
+  for entity in new_map:get_entities() do
+    num_entities = num_entities + 1
+  end
+  assert(num_entities > 1)
+  assert(new_map:get_tileset() == "castle")
+
+  sol.main.exit()
+end
+
+function map:on_started()
+
+  assert(not pcall(game.preload_map, game, "no_such_map"))
+
+  -- Preloading several times or another map is allowed.
+  game:preload_map("traversable")
+  game:preload_map("all_entities")
+  game:preload_map("all_entities")
+
+  hero:teleport("all_entities")
+end
@@ -0,0 +1,21 @@
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  local hero = map:get_hero()
+  local movement = sol.movement.create("path_finding")
+  assert(movement:get_max_expanded_nodes() > 0)
+  movement:set_max_expanded_nodes(500)
+  assert(movement:get_max_expanded_nodes() == 500)
+  assert(not pcall(movement.set_max_expanded_nodes, movement, 0))
+
+  movement:set_target(hero)
+  movement:set_speed(96)
+  movement:start(chaser)
+
+  -- The chaser has to go around the wall to reach the hero.
+  sol.timer.start(map, 6000, function()
+    assert(chaser:get_distance(hero) <= 32)
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,31 @@
+local map = ...
+
+function map:on_started()
+
+  sol.file.mkdir("scripts")
+
+  -- A valid precompiled file next to its source is loaded instead of it.
+  local file = sol.file.open("scripts/valid_bytecode.lua", "w")
+  file:write("return \"source\"\n")
+  file:close()
+  file = sol.file.open("scripts/valid_bytecode.lua.luac", "wb")
+  file:write(string.dump(function() return "bytecode" end))
+  file:close()
+  assert(sol.main.load_file("scripts/valid_bytecode")() == "bytecode")
+  sol.file.remove("scripts/valid_bytecode.lua.luac")
+  sol.file.remove("scripts/valid_bytecode.lua")
+
+  -- An invalid precompiled file is ignored in favor of the source.
+  assert(sol.main.load_file("scripts/corrupt_bytecode")() == "source")
+
+  -- A precompiled file from another place of the search path than the
+  -- source is ignored, since it may be older.
+  file = sol.file.open("scripts/stale_bytecode.lua.luac", "wb")
+  file:write(string.dump(function() return "stale" end))
+  file:close()
+  assert(sol.file.exists("scripts/stale_bytecode.lua.luac"))
+  assert(sol.main.load_file("scripts/stale_bytecode")() == "source")
+  sol.file.remove("scripts/stale_bytecode.lua.luac")
+
+  sol.main.exit()
+end
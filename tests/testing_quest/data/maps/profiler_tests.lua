@@ -0,0 +1,42 @@
+local map = ...
+
+local num_updates = 0
+
+function map:on_update()
+  num_updates = num_updates + 1
+end
+
+function map:on_opening_transition_finished()
+
+  assert(not sol.main.is_profiler_enabled())
+  sol.main.set_profiler_enabled()
+  assert(sol.main.is_profiler_enabled())
+
+  sol.timer.start(map, 200, function()
+    local profile = sol.main.get_profile()
+    assert(type(profile) == "table")
+    assert(profile.num_frames > 1)
+    assert(type(profile.zones) == "table")
+
+    -- Zones are only recorded if the engine was compiled with the profiler.
+    local game_update = profile.zones.game_update
+    if game_update ~= nil then
+      assert(game_update.count >= profile.num_frames - 1)
+      assert(game_update.total >= game_update.max)
+      assert(game_update.max >= 0)
+      local on_update = profile.zones.on_update
+      assert(on_update ~= nil)
+      assert(on_update.count > 0)
+    end
+    assert(num_updates > 0)
+
+    sol.main.save_profile("profiler_tests_trace.json")
+    assert(sol.file.exists("profiler_tests_trace.json"))
+    sol.file.remove("profiler_tests_trace.json")
+
+    sol.main.set_profiler_enabled(false)
+    assert(not sol.main.is_profiler_enabled())
+    assert(sol.main.get_profile().num_frames == 0)
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,51 @@
+local map = ...
+
+function map:on_started()
+
+  local hits, misses, load_time = sol.main.get_script_cache_stats()
+  assert(type(hits) == "number")
+  assert(type(misses) == "number")
+  assert(type(load_time) == "number")
+  assert(load_time >= 0)
+
+  -- The first enemy of a breed compiles the script, the next ones reuse it.
+  for i = 1, 3 do
+    local enemy = map:create_enemy({
+      breed = "test_enemy",
+      layer = 0,
+      x = 40 * i,
+      y = 64,
+      direction = 0,
+    })
+    assert(enemy ~= nil)
+  end
+  local new_hits, new_misses = sol.main.get_script_cache_stats()
+  assert(new_hits - hits >= 2)
+  assert(new_misses - misses <= 1)
+
+  -- Each load returns a new function.
+  local first = sol.main.load_file("enemies/test_enemy")
+  local second = sol.main.load_file("enemies/test_enemy")
+  assert(type(first) == "function")
+  assert(type(second) == "function")
+  assert(first ~= second)
+
+  -- Missing files are not an error.
+  assert(sol.main.load_file("enemies/no_such_breed") == nil)
+
+  -- Scripts written by the quest are not cached.
+  local function write_script(value)
+    local file = sol.file.open("script_cache_test_file.lua", "w")
+    file:write("return " .. value)
+    file:close()
+  end
+  write_script(1)
+  assert(sol.main.load_file("script_cache_test_file")() == 1)
+  write_script(2)
+  assert(sol.main.load_file("script_cache_test_file")() == 2)
+  assert(sol.main.load_file("script_cache_test_file.lua")() == 2)
+  sol.file.remove("script_cache_test_file.lua")
+  assert(sol.main.load_file("script_cache_test_file") == nil)
+
+  sol.main.exit()
+end
@@ -0,0 +1,103 @@
+local map = ...
+
+local function get_first_pixel(surface)
+  return surface:get_pixels():byte(1, 4)
+end
+
+-- Test for shader:get_uniform_handle().
+local function test_get_uniform_handle(shader)
+
+  local brightness_handle = shader:get_uniform_handle("brightness")
+  assert_equal(type(brightness_handle), "number")
+  assert_equal(shader:get_uniform_handle("brightness"), brightness_handle)
+  assert(shader:get_uniform_handle("fade_color") ~= brightness_handle)
+  assert_equal(shader:get_uniform_handle("no_such_uniform"), nil)
+end
+
+-- Test for shader:set_uniform() with handles and names.
+local function test_set_uniform_by_handle(shader)
+
+  local brightness_handle = shader:get_uniform_handle("brightness")
+  local offset_handle = shader:get_uniform_handle("offset")
+  local tint_handle = shader:get_uniform_handle("tint")
+  local fade_color_handle = shader:get_uniform_handle("fade_color")
+  local inverted_handle = shader:get_uniform_handle("inverted")
+
+  shader:set_uniform(brightness_handle, 1.0)
+  shader:set_uniform(offset_handle, { 0.0, 0.0 })
+  shader:set_uniform(tint_handle, { 1.0, 1.0, 1.0 })
+  shader:set_uniform(fade_color_handle, { 0.0, 0.0, 0.0, 0.0 })
+  shader:set_uniform(inverted_handle, false)
+
+  local source = sol.surface.create(8, 8)
+  source:fill_color({255, 0, 0, 255})
+  source:set_shader(shader)
+  local destination = sol.surface.create(8, 8)
+
+  -- Neutral uniform values keep the source color.
+  source:draw(destination)
+  local r, g, b, a = get_first_pixel(destination)
+  assert_equal(r, 255)
+  assert_equal(g, 0)
+  assert_equal(b, 0)
+  assert_equal(a, 255)
+
+  -- A new value set by handle is used by the next draw.
+  shader:set_uniform(fade_color_handle, { 0.0, 1.0, 0.0, 1.0 })
+  destination:clear()
+  source:draw(destination)
+  r, g, b, a = get_first_pixel(destination)
+  assert_equal(r, 0)
+  assert_equal(g, 255)
+  assert_equal(b, 0)
+  assert_equal(a, 255)
+
+  -- Setting by name and by handle changes the same uniform.
+  shader:set_uniform("fade_color", { 0.0, 0.0, 1.0, 1.0 })
+  destination:clear()
+  source:draw(destination)
+  r, g, b = get_first_pixel(destination)
+  assert_equal(r, 0)
+  assert_equal(g, 0)
+  assert_equal(b, 255)
+
+  shader:set_uniform(fade_color_handle, { 0.0, 0.0, 0.0, 0.0 })
+  shader:set_uniform(inverted_handle, true)
+  destination:clear()
+  source:draw(destination)
+  r, g, b = get_first_pixel(destination)
+  assert_equal(r, 0)
+  assert_equal(g, 255)
+  assert_equal(b, 255)
+end
+
+-- Test for the shader API without OpenGL, as with -no-video.
+local function test_without_opengl()
+
+  -- Creating a shader fails with an error instead of using a missing context.
+  local success, error_message = pcall(sol.shader.create, "uniform_test")
+  assert(not success)
+  assert(error_message:find("shaders are not supported", 1, true) ~= nil)
+
+  -- The uniform handle methods exist and check their shader argument.
+  local shader_meta = sol.main.get_metatable("sol.shader")
+  assert_equal(type(shader_meta.get_uniform_handle), "function")
+  assert_equal(type(shader_meta.set_uniform), "function")
+  assert(not pcall(shader_meta.get_uniform_handle, {}, "brightness"))
+  assert(not pcall(shader_meta.set_uniform, {}, "brightness", 1.0))
+
+  print("shader_tests: no OpenGL renderer, uniform values are not checked")
+end
+
+function map:on_started()
+
+  if sol.shader.get_opengl_version() ~= "" then
+    local shader = sol.shader.create("uniform_test")
+    test_get_uniform_handle(shader)
+    test_set_uniform_by_handle(shader)
+  else
+    test_without_opengl()
+  end
+
+  sol.main.exit()
+end
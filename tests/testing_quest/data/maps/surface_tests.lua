@@ -31,7 +31,89 @@ local function test_set_pixels()
   assert_equal(a, 255)
 end
 
+-- Test that draws keep their order when surfaces change in the meantime.
+local function test_draw_order()
+
+  local source = sol.surface.create(8, 8)
+  source:fill_color({0, 0, 255, 255})
+  local destination = sol.surface.create(16, 8)
+  source:draw(destination, 0, 0)
+  source:fill_color({255, 0, 0, 255})
+  source:draw(destination, 8, 0)
+
+  local pixels = destination:get_pixels()
+  local r, g, b, a = pixels:byte(1, 4)
+  assert_equal(r, 0)
+  assert_equal(g, 0)
+  assert_equal(b, 255)
+  assert_equal(a, 255)
+  r, g, b, a = pixels:byte(8 * 4 + 1, 8 * 4 + 4)
+  assert_equal(r, 255)
+  assert_equal(g, 0)
+  assert_equal(b, 0)
+  assert_equal(a, 255)
+
+  -- Drawing the destination somewhere else uses all previous draws.
+  local copy = sol.surface.create(16, 8)
+  destination:draw(copy)
+  pixels = copy:get_pixels()
+  r, g, b, a = pixels:byte(8 * 4 + 1, 8 * 4 + 4)
+  assert_equal(r, 255)
+  assert_equal(b, 0)
+end
+
+-- Test that pixels modified after a read are read again.
+local function test_get_pixels_after_change()
+
+  local surface = sol.surface.create(16, 16)
+  surface:fill_color({255, 0, 0, 255})
+  local pixels = surface:get_pixels()
+  surface:fill_color({0, 255, 0, 255}, 8, 8, 8, 8)
+  pixels = surface:get_pixels()
+
+  local r, g, b, a = pixels:byte(1, 4)
+  assert_equal(r, 255)
+  assert_equal(g, 0)
+  local index = (15 * 16 + 15) * 4
+  r, g, b, a = pixels:byte(index + 1, index + 4)
+  assert_equal(r, 0)
+  assert_equal(g, 255)
+end
+
+-- Test for surface:get_pixels(true).
+local function test_get_previous_pixels(callback)
+
+  local surface = sol.surface.create(16, 16)
+  surface:fill_color({255, 0, 0, 255})
+
+  -- The first call gets the current pixels.
+  local pixels = surface:get_pixels(true)
+  assert_equal(pixels:byte(1), 255)
+
+  -- Changes are only seen at the next frame.
+  surface:fill_color({0, 0, 255, 255})
+  pixels = surface:get_pixels(true)
+  assert_equal(pixels:byte(1), 255)
+  assert_equal(pixels:byte(3), 0)
+  pixels = surface:get_pixels()
+  assert_equal(pixels:byte(1), 0)
+  assert_equal(pixels:byte(3), 255)
+
+  sol.timer.start(map, 10, function()
+    pixels = surface:get_pixels(true)
+    assert_equal(pixels:byte(1), 0)
+    assert_equal(pixels:byte(3), 255)
+    callback()
+  end)
+end
+
 test_get_pixels()
 test_set_pixels()
+test_draw_order()
+test_get_pixels_after_change()
 
-sol.main.exit()
+function map:on_started()
+  test_get_previous_pixels(function()
+    sol.main.exit()
+  end)
+end
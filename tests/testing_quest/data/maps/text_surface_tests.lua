@@ -0,0 +1,162 @@
+local map = ...
+
+-- Returns whether a surface has at least one non-transparent pixel.
+local function has_visible_pixels(surface)
+
+  local pixels = surface:get_pixels()
+  for i = 4, #pixels, 4 do
+    if pixels:byte(i) ~= 0 then
+      return true
+    end
+  end
+  return false
+end
+
+-- Test the size of texts with a bitmap font.
+local function test_bitmap_font_size()
+
+  -- The 8_bit font has 9x12 characters that overlap by one pixel.
+  local text_surface = sol.text_surface.create({
+    font = "8_bit",
+    text = "99",
+  })
+  local width, height = text_surface:get_size()
+  assert_equal(width, 17)
+  assert_equal(height, 12)
+
+  text_surface:set_text("100")
+  width, height = text_surface:get_size()
+  assert_equal(width, 25)
+  assert_equal(height, 12)
+
+  text_surface:set_text("  ")
+  width, height = text_surface:get_size()
+  assert_equal(width, 0)
+  assert_equal(height, 0)
+end
+
+-- Test the size of texts with an outline font.
+local function test_outline_font_size()
+
+  local text_surface = sol.text_surface.create({
+    font = "minecraftia",
+    text = "Rupees: 99",
+  })
+  local width_99, height = text_surface:get_size()
+  assert(width_99 > 0)
+  assert(height > 0)
+
+  text_surface:set_text("Rupees: 100")
+  local width_100 = text_surface:get_size()
+  assert(width_100 > width_99)
+
+  text_surface:set_text("Rupees: 99")
+  assert_equal(text_surface:get_size(), width_99)
+
+  text_surface:set_font_size(22)
+  assert(text_surface:get_size() > width_99)
+end
+
+-- Test that moving or aligning a text does not change it.
+local function test_alignment()
+
+  local text_surface = sol.text_surface.create({
+    font = "minecraftia",
+    text = "Hello",
+    vertical_alignment = "top",
+  })
+  local width, height = text_surface:get_size()
+  text_surface:set_horizontal_alignment("right")
+  text_surface:set_vertical_alignment("bottom")
+  local new_width, new_height = text_surface:get_size()
+  assert_equal(new_width, width)
+  assert_equal(new_height, height)
+end
+
+-- Test that texts are drawn and that drawing a region gives the same pixels.
+local function test_draw(font, rendering_mode)
+
+  local text_surface = sol.text_surface.create({
+    font = font,
+    text = "Ab1",
+    vertical_alignment = "top",
+    rendering_mode = rendering_mode,
+  })
+  local width, height = text_surface:get_size()
+
+  local full = sol.surface.create(width, height)
+  text_surface:draw(full)
+  assert(has_visible_pixels(full))
+
+  local halves = sol.surface.create(width, height)
+  local half_width = math.floor(width / 2)
+  text_surface:draw_region(0, 0, half_width, height, halves, 0, 0)
+  text_surface:draw_region(half_width, 0, width - half_width, height, halves, half_width, 0)
+  assert(full:get_pixels() == halves:get_pixels())
+end
+
+-- Test that a text with an opacity looks like the text drawn at once
+-- with this opacity, even where characters overlap.
+local function test_draw_with_opacity(font)
+
+  local text_surface = sol.text_surface.create({
+    font = font,
+    text = "99 Ab1",
+    vertical_alignment = "top",
+    rendering_mode = "solid",
+  })
+  local width, height = text_surface:get_size()
+
+  local translucent = sol.surface.create(width, height)
+  text_surface:set_opacity(128)
+  text_surface:draw(translucent)
+  assert(has_visible_pixels(translucent))
+
+  -- Blending premultiplied surfaces needs an OpenGL renderer.
+  if sol.shader.get_opengl_version() == "" then
+    return
+  end
+
+  local opaque = sol.surface.create(width, height)
+  text_surface:set_opacity(255)
+  text_surface:draw(opaque)
+  local expected = sol.surface.create(width, height)
+  opaque:set_opacity(128)
+  opaque:draw(expected)
+  assert(translucent:get_pixels() == expected:get_pixels())
+end
+
+-- Test that texts still work when their color keeps changing,
+-- which creates and removes glyph atlases.
+local function test_animated_color()
+
+  local text_surface = sol.text_surface.create({
+    font = "minecraftia",
+    text = "Hello",
+    vertical_alignment = "top",
+  })
+  local width, height = text_surface:get_size()
+  local first_width = width
+  for i = 1, 40 do
+    text_surface:set_color({ i * 6, 255 - i * 6, 128 })
+    width, height = text_surface:get_size()
+    assert_equal(width, first_width)
+    local surface = sol.surface.create(width, height)
+    text_surface:draw(surface)
+    assert(has_visible_pixels(surface))
+  end
+end
+
+test_bitmap_font_size()
+test_outline_font_size()
+test_alignment()
+test_draw("8_bit", "solid")
+test_draw("minecraftia", "solid")
+test_draw("minecraftia", "antialiasing")
+test_draw_with_opacity("8_bit")
+test_draw_with_opacity("minecraftia")
+test_animated_color()
+
+function map:on_started()
+  sol.main.exit()
+end
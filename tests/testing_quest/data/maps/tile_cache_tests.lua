@@ -0,0 +1,34 @@
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  local initial_cache_size = sol.video.get_tile_cache_size()
+  assert(initial_cache_size > 0)
+
+  -- Only the visible cell is built when the camera does not move.
+  local num_resident_cells, num_cells_built = map:get_tile_cache_stats()
+  assert(num_resident_cells == 1)
+  assert(num_cells_built == 0)
+
+  local camera = map:get_camera()
+  camera:start_manual()
+  camera:set_position(520, 0)
+
+  sol.timer.start(map, 100, function()
+    -- The visible cell and the next ones to the right are built.
+    num_resident_cells = map:get_tile_cache_stats()
+    assert(num_resident_cells >= 2)
+
+    -- Cells behind the camera are unloaded when the cache is full.
+    sol.video.set_tile_cache_size(0)
+    assert(sol.video.get_tile_cache_size() == 0)
+    sol.timer.start(map, 100, function()
+      num_resident_cells = map:get_tile_cache_stats()
+      assert(num_resident_cells >= 1)
+      assert(num_resident_cells <= 2)
+
+      sol.video.set_tile_cache_size(initial_cache_size)
+      sol.main.exit()
+    end)
+  end)
+end
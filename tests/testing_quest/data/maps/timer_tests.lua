@@ -0,0 +1,132 @@
+local map = ...
+
+-- Timers started in any order are triggered by expiration date.
+local function test_order(next_test)
+
+  local triggered = {}
+  for _, delay in ipairs({ 300, 100, 200, 50, 250 }) do
+    sol.timer.start(map, delay, function()
+      triggered[#triggered + 1] = delay
+    end)
+  end
+
+  sol.timer.start(map, 400, function()
+    assert(#triggered == 5)
+    for i = 2, #triggered do
+      assert(triggered[i - 1] < triggered[i])
+    end
+    next_test()
+  end)
+end
+
+-- Suspended timers are not triggered and keep their remaining time.
+local function test_suspended(next_test)
+
+  local triggered = false
+  local timer = sol.timer.start(map, 100, function()
+    triggered = true
+  end)
+  timer:set_suspended(true)
+
+  sol.timer.start(map, 200, function()
+    assert(not triggered)
+    timer:set_suspended(false)
+    local remaining_time = timer:get_remaining_time()
+    assert(remaining_time > 0 and remaining_time <= 100)
+    sol.timer.start(map, 150, function()
+      assert(triggered)
+      next_test()
+    end)
+  end)
+end
+
+-- Changing the remaining time reschedules the timer.
+local function test_remaining_time(next_test)
+
+  local triggered = false
+  local timer = sol.timer.start(map, 10000, function()
+    triggered = true
+  end)
+  timer:set_remaining_time(50)
+
+  sol.timer.start(map, 100, function()
+    assert(triggered)
+    assert(timer:get_remaining_time() == 0)
+    next_test()
+  end)
+end
+
+-- Repeated timers.
+local function test_repeat(next_test)
+
+  local count = 0
+  sol.timer.start(map, 20, function()
+    count = count + 1
+    return count < 5
+  end)
+
+  sol.timer.start(map, 300, function()
+    assert(count == 5)
+    next_test()
+  end)
+end
+
+-- Stopping all timers of a context only stops these ones.
+local function test_stop_all(next_test)
+
+  local context = {}
+  local num_triggered_in_context = 0
+  for i = 1, 10 do
+    sol.timer.start(context, 50, function()
+      num_triggered_in_context = num_triggered_in_context + 1
+    end)
+  end
+  local triggered_in_map = false
+  sol.timer.start(map, 50, function()
+    triggered_in_map = true
+  end)
+
+  sol.timer.stop_all(context)
+
+  sol.timer.start(map, 100, function()
+    assert(num_triggered_in_context == 0)
+    assert(triggered_in_map)
+    next_test()
+  end)
+end
+
+-- Timers of a disabled entity are suspended.
+local function test_entity(next_test)
+
+  local triggered = false
+  sol.timer.start(entity, 100, function()
+    triggered = true
+  end)
+  entity:set_enabled(false)
+
+  sol.timer.start(map, 200, function()
+    assert(not triggered)
+    entity:set_enabled(true)
+    sol.timer.start(map, 200, function()
+      assert(triggered)
+      next_test()
+    end)
+  end)
+end
+
+function map:on_opening_transition_finished()
+
+  test_order(function()
+    test_suspended(function()
+      test_remaining_time(function()
+        test_repeat(function()
+          test_stop_all(function()
+            test_entity(function()
+              sol.main.exit()
+            end)
+          end)
+        end)
+      end)
+    end)
+  end)
+end
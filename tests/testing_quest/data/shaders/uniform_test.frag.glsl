@@ -0,0 +1,32 @@
+#if __VERSION__ >= 130
+#define COMPAT_VARYING in
+#define COMPAT_TEXTURE texture
+out vec4 FragColor;
+#else
+#define COMPAT_VARYING varying
+#define FragColor gl_FragColor
+#define COMPAT_TEXTURE texture2D
+#endif
+
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+uniform sampler2D sol_texture;
+uniform float brightness;
+uniform vec2 offset;
+uniform vec3 tint;
+uniform vec4 fade_color;
+uniform bool inverted;
+
+COMPAT_VARYING vec2 sol_vtex_coord;
+COMPAT_VARYING vec4 sol_vcolor;
+
+void main() {
+  vec4 tex_color = COMPAT_TEXTURE(sol_texture, sol_vtex_coord + offset) * sol_vcolor;
+  vec3 color = tex_color.rgb * tint * brightness;
+  if (inverted) {
+    color = vec3(1.0) - color;
+  }
+  FragColor = vec4(mix(color, fade_color.rgb, fade_color.a), tex_color.a);
+}